@@ -11,6 +11,7 @@
 #include <pbio/main.h>
 #include <pbio/util.h>
 #include <pbsys/main.h>
+#include <pbsys/program_modules.h>
 #include <pbsys/program_stop.h>
 
 #include <pybricks/common.h>
@@ -176,51 +177,43 @@ static void do_execute_raw_code(mp_module_context_t *context, const mp_raw_code_
     }
 }
 
-/** mpy info and data for one script or module. */
-typedef struct {
-    /** Size of the mpy program. Not aligned, use pbio_get_uint32_le() to read. */
-    uint8_t mpy_size[4];
-    /** Null-terminated name of the script, without file extension. */
-    char mpy_name[];
-    /** mpy data follows thereafter. */
-} mpy_info_t;
-
-// Program data is a concatenation of multiple mpy files. This sets a reference
-// to the first script and the total size so we can search for modules.
-static mpy_info_t *mpy_first;
-static mpy_info_t *mpy_end;
-static inline void mpy_data_init(pbsys_main_program_t *program) {
-    mpy_first = (mpy_info_t *)program->code_start;
-    mpy_end = (mpy_info_t *)program->code_end;
-}
+// Program data is a concatenation of multiple mpy files. This indexes them by
+// name, so modules can be found quickly on import.
+static pbsys_program_modules_index_t mpy_index;
 
 /**
- * Gets a reference to the mpy data of a script.
- * @param [in]  info    A pointer to an mpy info header.
- * @return              A pointer to the .mpy file.
+ * Builds the module index in RAM just after the program data.
+ * @param [in]  program     The program.
+ * @return                  Start of the remaining RAM, for the heap.
  */
-static uint8_t *mpy_data_get_buf(mpy_info_t *info) {
-    // The header consists of the size and a zero-terminated module name string.
-    return (uint8_t *)info + sizeof(info->mpy_size) + strlen(info->mpy_name) + 1;
+static void *mpy_data_init(pbsys_main_program_t *program) {
+    uint32_t program_size = (uint8_t *)program->code_end - (uint8_t *)program->code_start;
+    uint32_t num_modules = pbsys_program_modules_count(program->code_start, program_size);
+
+    // Place the index entries at the first aligned address after the program.
+    uintptr_t start = ((uintptr_t)program->code_end + sizeof(uint32_t) - 1) & ~(sizeof(uint32_t) - 1);
+    pbsys_program_modules_index_entry_t *entries = (pbsys_program_modules_index_entry_t *)start;
+
+    // Keep at least half of the remaining RAM for the heap. Without room for
+    // the index, modules are found by searching the whole program instead.
+    uint32_t max_entries = ((uint8_t *)program->data_end - (uint8_t *)start) / 2 / sizeof(*entries);
+    if (num_modules > max_entries) {
+        pbsys_program_modules_index_init(&mpy_index, program->code_start, program_size, NULL, num_modules);
+        return program->code_end;
+    }
+
+    pbsys_program_modules_index_init(&mpy_index, program->code_start, program_size, entries, num_modules);
+    return entries + num_modules;
 }
 
 /**
  * Finds a MicroPython module in the program data.
  * @param [in]  name    The fully qualified name of the module.
- * @return              A pointer to the .mpy file in user RAM or NULL if the
- *                      module was not found.
+ * @param [out] module  The module.
+ * @return              True if the module was found.
  */
-static mpy_info_t *mpy_data_find(qstr name) {
-    const char *name_str = qstr_str(name);
-
-    for (mpy_info_t *info = mpy_first; info < mpy_end;
-         info = (mpy_info_t *)(mpy_data_get_buf(info) + pbio_get_uint32_le(info->mpy_size))) {
-        if (strcmp(info->mpy_name, name_str) == 0) {
-            return info;
-        }
-    }
-
-    return NULL;
+static bool mpy_data_find(qstr name, pbsys_program_module_t *module) {
+    return pbsys_program_modules_find(&mpy_index, qstr_str(name), module) == PBIO_SUCCESS;
 }
 
 /**
@@ -235,16 +228,15 @@ static void run_user_program(void) {
     if (nlr_push(&nlr) == 0) {
         nlr_set_abort(&nlr);
 
-        mpy_info_t *info = mpy_data_find(MP_QSTR___main__);
-
-        if (!info) {
+        pbsys_program_module_t module;
+        if (!mpy_data_find(MP_QSTR___main__, &module)) {
             mp_raise_msg(&mp_type_RuntimeError, MP_ERROR_TEXT("no __main__ module"));
         }
 
         // This is similar to __import__ except we don't push/pop globals
         mp_reader_t reader;
         mp_vfs_map_minimal_t data;
-        mp_vfs_map_minimal_new_reader(&reader, &data, mpy_data_get_buf(info), pbio_get_uint32_le(info->mpy_size));
+        mp_vfs_map_minimal_new_reader(&reader, &data, module.data, module.data_size);
         mp_module_context_t *context = m_new_obj(mp_module_context_t);
         context->module.globals = mp_globals_get();
         mp_compiled_module_t compiled_module;
@@ -305,12 +297,9 @@ void pbsys_main_run_program(pbsys_main_program_t *program) {
     mp_stack_set_top(estack);
     mp_stack_set_limit(estack - sstack - 1024);
 
-    // MicroPython heap starts after program data.
-    gc_init(program->code_end, program->data_end);
-
-    // Set program data reference to first script. This is used to run main,
-    // and to set the starting point for finding downloaded modules.
-    mpy_data_init(program);
+    // Index the downloaded modules. This is used to run main, and to find
+    // modules on import. The MicroPython heap starts after the index.
+    gc_init(mpy_data_init(program), program->data_end);
 
     // Initialize MicroPython.
     mp_init();
@@ -368,14 +357,14 @@ mp_obj_t pb_builtin_import(size_t n_args, const mp_obj_t *args) {
     }
 
     // Check for presence of user program in user RAM.
-    mpy_info_t *info = mpy_data_find(module_name_qstr);
+    pbsys_program_module_t module;
 
     // If a downloaded module was found but not yet loaded, load it.
-    if (info) {
+    if (mpy_data_find(module_name_qstr, &module)) {
         // Parse the static script data.
         mp_reader_t reader;
         mp_vfs_map_minimal_t data;
-        mp_vfs_map_minimal_new_reader(&reader, &data, mpy_data_get_buf(info), pbio_get_uint32_le(info->mpy_size));
+        mp_vfs_map_minimal_new_reader(&reader, &data, module.data, module.data_size);
 
         // Create new module and execute in its own context.
         mp_obj_t module_obj = mp_obj_new_module(module_name_qstr);
@@ -94,6 +94,7 @@ PYBRICKS_PYBRICKS_SRC_C = $(addprefix pybricks/,\
 	pybricks.c \
 	robotics/pb_module_robotics.c \
 	robotics/pb_type_drivebase.c \
+	robotics/pb_type_motorgroup.c \
 	robotics/pb_type_spikebase.c \
 	tools/pb_module_tools.c \
 	tools/pb_type_awaitable.c \
@@ -149,6 +150,7 @@ PBIO_SRC_C = $(addprefix lib/pbio/,\
 	drv/gpio/gpio_stm32f4.c \
 	drv/gpio/gpio_stm32l4.c \
 	drv/imu/imu_lsm6ds3tr_c_stm32.c \
+	drv/imu/imu_test.c \
 	drv/ioport/ioport_pup.c \
 	drv/ioport/ioport_debug_uart.c \
 	drv/led/led_array_pwm.c \
@@ -206,6 +208,7 @@ PBIO_SRC_C = $(addprefix lib/pbio/,\
 	src/light/color_light.c \
 	src/light/light_matrix.c \
 	src/logger.c \
+	src/lz.c \
 	src/main.c \
 	src/motor_process.c \
 	src/motor/servo_settings.c \
@@ -215,6 +218,7 @@ PBIO_SRC_C = $(addprefix lib/pbio/,\
 	src/protocol/nus.c \
 	src/protocol/pybricks.c \
 	src/servo.c \
+	src/snapshot.c \
 	src/tacho.c \
 	src/task.c \
 	src/trajectory.c \
@@ -229,6 +233,7 @@ PBIO_SRC_C = $(addprefix lib/pbio/,\
 	sys/light.c \
 	sys/main.c \
 	sys/program_load.c \
+	sys/program_modules.c \
 	sys/program_stop.c \
 	sys/status.c \
 	sys/supervisor.c \
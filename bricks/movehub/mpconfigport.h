@@ -36,6 +36,7 @@
 #define PYBRICKS_PY_ROBOTICS                    (1)
 #define PYBRICKS_PY_ROBOTICS_EXTRA              (0)
 #define PYBRICKS_PY_ROBOTICS_DRIVEBASE_GYRO     (0)
+#define PYBRICKS_PY_ROBOTICS_DRIVEBASE_POSE     (0)
 #define PYBRICKS_PY_ROBOTICS_DRIVEBASE_SPIKE    (0)
 #define PYBRICKS_PY_TOOLS                       (1)
 #define PYBRICKS_PY_TOOLS_HUB_MENU              (0)
@@ -11,7 +11,7 @@
 #define PYBRICKS_PY_COMMON_BLE          (0)
 #define PYBRICKS_PY_COMMON_CHARGER      (1)
 #define PYBRICKS_PY_COMMON_CONTROL      (1)
-#define PYBRICKS_PY_COMMON_IMU          (0)
+#define PYBRICKS_PY_COMMON_IMU          (1)
 #define PYBRICKS_PY_COMMON_KEYPAD       (1)
 #define PYBRICKS_PY_COMMON_KEYPAD_HUB_BUTTONS (1)
 #define PYBRICKS_PY_COMMON_LIGHT_ARRAY  (1)
@@ -34,6 +34,7 @@
 #define PYBRICKS_PY_PUPDEVICES          (1)
 #define PYBRICKS_PY_DEVICES             (1)
 #define PYBRICKS_PY_ROBOTICS            (1)
+#define PYBRICKS_PY_ROBOTICS_DRIVEBASE_POSE (1)
 #define PYBRICKS_PY_ROBOTICS_DRIVEBASE_SPIKE (0)
 #define PYBRICKS_PY_TOOLS               (1)
 #define PYBRICKS_PY_TOOLS_HUB_MENU      (0)
@@ -130,6 +130,13 @@ HEADER = textwrap.dedent(
         int32_t d_torque_d_acceleration;
         int32_t torque_friction;
         int32_t feedback_gain;
+        #if PBIO_CONFIG_CONTROL_LOOP_TIME_ADJUSTABLE
+        float phi_speed_current;
+        float phi_current_speed;
+        float phi_current_current;
+        float gam_speed_torque;
+        float gam_current_voltage;
+        #endif
     }} pbio_observer_model_t;"""
 )
 
@@ -153,6 +160,14 @@ def make_model(name, *, V, tau_0, tau_x, w_0, w_x, i_0, i_x, a, Lm, h):
     # Substitute parameters into model to get numeric system matrices
     exponent_numeric = numpy.array(exponent.subs(model).evalf().tolist()).astype(numpy.float64)
 
+    # Nonzero entries of the continuous time system matrices other than the
+    # angle derivative, so the model can be discretized for other loop times.
+    phi_speed_current = exponent_numeric[1, 2]
+    phi_current_speed = exponent_numeric[2, 1]
+    phi_current_current = exponent_numeric[2, 2]
+    gam_speed_torque = exponent_numeric[1, 4]
+    gam_current_voltage = exponent_numeric[2, 3]
+
     # Get matrix exponential and system matrices
     exponential = scipy.linalg.expm(exponent_numeric * h)
     A = exponential[0:3, 0:3]
@@ -191,6 +206,13 @@ def make_model(name, *, V, tau_0, tau_x, w_0, w_x, i_0, i_x, a, Lm, h):
             .d_torque_d_speed = {round(PRESCALE_SPEED / dtau_dw.subs(model).evalf())},
             .d_torque_d_acceleration = {round(PRESCALE_ACCELERATION / dtau_da.subs(model).evalf())},
             .torque_friction = {round(tau_s * c_tau)},
+            #if PBIO_CONFIG_CONTROL_LOOP_TIME_ADJUSTABLE
+            .phi_speed_current = {phi_speed_current:.7g}f,
+            .phi_current_speed = {phi_current_speed:.7g}f,
+            .phi_current_current = {phi_current_current:.7g}f,
+            .gam_speed_torque = {gam_speed_torque:.7g}f,
+            .gam_current_voltage = {gam_current_voltage:.7g}f,
+            #endif
         }};"""
     )
 
@@ -15,6 +15,7 @@
 #include <lego_lwp3.h>
 
 #include <pbdrv/bluetooth.h>
+#include <pbio/int_math.h>
 #include <pbio/protocol.h>
 #include <pbio/task.h>
 #include <pbio/version.h>
@@ -598,6 +599,13 @@ bool pbdrv_bluetooth_is_connected(pbdrv_bluetooth_connection_t connection) {
     return false;
 }
 
+uint16_t pbdrv_bluetooth_get_max_char_size(void) {
+    if (pybricks_con_handle == HCI_CON_HANDLE_INVALID) {
+        return ATT_DEFAULT_MTU - 3;
+    }
+    return pbio_int_math_min(att_server_get_mtu(pybricks_con_handle), PBDRV_BLUETOOTH_MAX_MTU_SIZE) - 3;
+}
+
 void pbdrv_bluetooth_set_on_event(pbdrv_bluetooth_on_event_t on_event) {
     bluetooth_on_event = on_event;
 }
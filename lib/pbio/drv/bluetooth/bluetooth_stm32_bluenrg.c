@@ -344,6 +344,11 @@ bool pbdrv_bluetooth_is_connected(pbdrv_bluetooth_connection_t connection) {
     return false;
 }
 
+uint16_t pbdrv_bluetooth_get_max_char_size(void) {
+    // MTU exchange is not implemented, so this is always the minimum MTU.
+    return ATT_MTU - 3;
+}
+
 void pbdrv_bluetooth_set_on_event(pbdrv_bluetooth_on_event_t on_event) {
     bluetooth_on_event = on_event;
 }
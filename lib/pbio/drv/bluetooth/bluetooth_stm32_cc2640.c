@@ -398,6 +398,10 @@ bool pbdrv_bluetooth_is_connected(pbdrv_bluetooth_connection_t connection) {
     return false;
 }
 
+uint16_t pbdrv_bluetooth_get_max_char_size(void) {
+    return (conn_handle == NO_CONNECTION ? ATT_MTU_SIZE : conn_mtu) - 3;
+}
+
 void pbdrv_bluetooth_set_on_event(pbdrv_bluetooth_on_event_t on_event) {
     bluetooth_on_event = on_event;
 }
@@ -27,6 +27,20 @@
 #include "../core.h"
 #include "./imu_lsm6ds3tr_c_stm32.h"
 
+/** All data rate dependent values should be defined here so it is clear
+ *  what needs to be changed when the data rate is changed. */
+#define LSM6DS3TR_INITIAL_DATA_RATE (833)
+#define LSM6DS3TR_GYRO_DATA_RATE (LSM6DS3TR_C_GY_ODR_833Hz)
+#define LSM6DS3TR_ACCL_DATA_RATE (LSM6DS3TR_C_XL_ODR_833Hz)
+#define LSM6DS3TR_FIFO_DATA_RATE (LSM6DS3TR_C_FIFO_833Hz)
+
+/** Number of frames in the FIFO that raise the INT1 interrupt. At 833 Hz,
+ *  this gives about 100 interrupts per second instead of one per sample. */
+#define LSM6DS3TR_FIFO_NUM_FRAMES (8)
+
+/** Maximum number of frames read at once, in case reading was delayed. */
+#define LSM6DS3TR_FIFO_MAX_FRAMES (LSM6DS3TR_FIFO_NUM_FRAMES * 2)
+
 typedef enum {
     /** Initialization is not complete yet. */
     IMU_INIT_STATE_BUSY,
@@ -47,8 +61,10 @@ struct _pbdrv_imu_dev_t {
     pbdrv_imu_handle_frame_data_func_t handle_frame_data;
     /* Callback to process unfiltered gyro and accelerometer data recorded while stationary. */
     pbdrv_imu_handle_stationary_data_func_t handle_stationary_data;
-    /** Raw data. */
-    int16_t data[6];
+    /** Raw data of the most recent frame. */
+    int16_t data[PBDRV_IMU_NUM_FRAME_VALUES];
+    /** Raw data of the frames read from the FIFO in one batch. */
+    int16_t frames[LSM6DS3TR_FIFO_MAX_FRAMES * PBDRV_IMU_NUM_FRAME_VALUES];
     /** Start time of window in which stationary samples are recorded (us)*/
     uint32_t stationary_time_start;
     /** Raw data point to which new samples are compared to detect stationary. */
@@ -70,12 +86,6 @@ struct _pbdrv_imu_dev_t {
 /** The size of the data field in pbdrv_imu_dev_t in bytes. */
 #define NUM_DATA_BYTES sizeof(((struct _pbdrv_imu_dev_t *)0)->data)
 
-/** All data rate dependent values should be defined here so it is clear
- *  what needs to be changed when the data rate is changed. */
-#define LSM6DS3TR_INITIAL_DATA_RATE (833)
-#define LSM6DS3TR_GYRO_DATA_RATE (LSM6DS3TR_C_GY_ODR_833Hz)
-#define LSM6DS3TR_ACCL_DATA_RATE (LSM6DS3TR_C_XL_ODR_833Hz)
-
 static pbdrv_imu_dev_t global_imu_dev;
 PROCESS(pbdrv_imu_lsm6ds3tr_c_stm32_process, "LSM6DS3TR-C");
 
@@ -231,17 +241,20 @@ static PT_THREAD(pbdrv_imu_lsm6ds3tr_c_stm32_init(struct pt *pt)) {
     imu_dev->config.gyro_stationary_threshold = 71; // 5 deg/s
     imu_dev->config.accel_stationary_threshold = 1044; // 2500 mm/s^2, or approx 25% of gravity
 
-    // Configure INT1 to trigger when new gyro data is ready.
+    // Store gyro and accel samples in the FIFO, so we can read them in
+    // batches. With equal data rates and no decimation, each frame in the
+    // FIFO is gyro xyz followed by accel xyz, just like the data registers.
+    PT_SPAWN(pt, &child, lsm6ds3tr_c_fifo_gy_batch_set(&child, ctx, LSM6DS3TR_C_FIFO_GY_NO_DEC));
+    PT_SPAWN(pt, &child, lsm6ds3tr_c_fifo_xl_batch_set(&child, ctx, LSM6DS3TR_C_FIFO_XL_NO_DEC));
+    PT_SPAWN(pt, &child, lsm6ds3tr_c_fifo_watermark_set(&child, ctx, LSM6DS3TR_FIFO_NUM_FRAMES * PBDRV_IMU_NUM_FRAME_VALUES));
+    PT_SPAWN(pt, &child, lsm6ds3tr_c_fifo_data_rate_set(&child, ctx, LSM6DS3TR_FIFO_DATA_RATE));
+    PT_SPAWN(pt, &child, lsm6ds3tr_c_fifo_mode_set(&child, ctx, LSM6DS3TR_C_STREAM_MODE));
+
+    // Configure INT1 to trigger when the FIFO reaches the watermark.
     PT_SPAWN(pt, &child, lsm6ds3tr_c_pin_int1_route_set(&child, ctx, (lsm6ds3tr_c_int1_route_t) {
-        .int1_drdy_g = 1,
+        .int1_fth = 1,
     }));
 
-    // If we leave the default latched mode, sometimes we don't get the INT1 interrupt.
-    PT_SPAWN(pt, &child, lsm6ds3tr_c_data_ready_mode_set(&child, ctx, LSM6DS3TR_C_DRDY_PULSED));
-
-    // Enable rounding mode so we can get gyro + accel in continuous reads.
-    PT_SPAWN(pt, &child, lsm6ds3tr_c_rounding_mode_set(&child, ctx, LSM6DS3TR_C_ROUND_GY_XL));
-
     if (HAL_I2C_GetError(hi2c) != HAL_I2C_ERROR_NONE) {
         imu_dev->init_state = IMU_INIT_STATE_FAILED;
         PT_EXIT(pt);
@@ -256,14 +269,14 @@ static inline bool is_bounded(int16_t diff, int16_t threshold) {
     return diff < threshold && diff > -threshold;
 }
 
-static void pbdrv_imu_lsm6ds3tr_c_stm32_reset_stationary_buffer(pbdrv_imu_dev_t *imu_dev) {
+static void pbdrv_imu_lsm6ds3tr_c_stm32_reset_stationary_buffer(pbdrv_imu_dev_t *imu_dev, uint32_t time) {
     imu_dev->stationary_sample_count = 0;
-    imu_dev->stationary_time_start = pbdrv_clock_get_us();
+    imu_dev->stationary_time_start = time;
     memset(&imu_dev->stationary_accel_data_sum, 0, sizeof(imu_dev->stationary_accel_data_sum));
     memset(&imu_dev->stationary_gyro_data_sum, 0, sizeof(imu_dev->stationary_gyro_data_sum));
 }
 
-static void pbdrv_imu_lsm6ds3tr_c_stm32_update_stationary_status(pbdrv_imu_dev_t *imu_dev) {
+static void pbdrv_imu_lsm6ds3tr_c_stm32_update_stationary_status(pbdrv_imu_dev_t *imu_dev, uint32_t time) {
 
     // Check whether still stationary compared to constant start sample.
     if (!is_bounded(imu_dev->data[0] - imu_dev->stationary_data_start[0], imu_dev->config.gyro_stationary_threshold) ||
@@ -275,7 +288,7 @@ static void pbdrv_imu_lsm6ds3tr_c_stm32_update_stationary_status(pbdrv_imu_dev_t
         ) {
         // Not stationary anymore, so reset counter and gyro sum data so we can start over.
         imu_dev->stationary_now = false;
-        pbdrv_imu_lsm6ds3tr_c_stm32_reset_stationary_buffer(imu_dev);
+        pbdrv_imu_lsm6ds3tr_c_stm32_reset_stationary_buffer(imu_dev, time);
 
         // Current sample becomes new starting value to compare to.
         memcpy(&imu_dev->stationary_data_start[0], &imu_dev->data[0], NUM_DATA_BYTES);
@@ -300,7 +313,7 @@ static void pbdrv_imu_lsm6ds3tr_c_stm32_update_stationary_status(pbdrv_imu_dev_t
     imu_dev->stationary_now = true;
 
     // The actual sampling rate is slightly different from the configured rate, so measure it.
-    imu_dev->config.sample_time = (pbdrv_clock_get_us() - imu_dev->stationary_time_start) / 1000000.0f / imu_dev->stationary_sample_count;
+    imu_dev->config.sample_time = (time - imu_dev->stationary_time_start) / 1000000.0f / imu_dev->stationary_sample_count;
 
     // Process the data recorded while stationary.
     if (imu_dev->handle_stationary_data) {
@@ -308,7 +321,7 @@ static void pbdrv_imu_lsm6ds3tr_c_stm32_update_stationary_status(pbdrv_imu_dev_t
     }
 
     // Reset counter and gyro sum data so we can start over.
-    pbdrv_imu_lsm6ds3tr_c_stm32_reset_stationary_buffer(imu_dev);
+    pbdrv_imu_lsm6ds3tr_c_stm32_reset_stationary_buffer(imu_dev, time);
 }
 
 PROCESS_THREAD(pbdrv_imu_lsm6ds3tr_c_stm32_process, ev, data) {
@@ -316,7 +329,9 @@ PROCESS_THREAD(pbdrv_imu_lsm6ds3tr_c_stm32_process, ev, data) {
     I2C_HandleTypeDef *hi2c = &imu_dev->hi2c;
 
     static struct pt child;
-    static uint8_t buf[NUM_DATA_BYTES];
+    static uint8_t status[4];
+    static uint32_t num_frames;
+    static uint32_t num_skip;
 
     PROCESS_BEGIN();
 
@@ -329,37 +344,74 @@ PROCESS_THREAD(pbdrv_imu_lsm6ds3tr_c_stm32_process, ev, data) {
         PROCESS_EXIT();
     }
 
-retry:
-    // Write the register address of the start of the gyro and accel data.
-    buf[0] = LSM6DS3TR_C_OUTX_L_G;
-    imu_dev->ctx.read_write_done = false;
-    HAL_StatusTypeDef ret = HAL_I2C_Master_Seq_Transmit_IT(
-        &imu_dev->hi2c, LSM6DS3TR_C_I2C_ADD_L, buf, 1, I2C_FIRST_FRAME);
+    // The FIFO may have reached the watermark before the interrupt was
+    // enabled, so check it once without waiting for an edge.
+    pbdrv_imu_lsm6ds3tr_c_stm32_handle_int1_irq();
 
-    if (ret != HAL_OK) {
-        pbdrv_imu_lsm6ds3tr_c_stm32_i2c_reset(hi2c);
-        goto retry;
-    }
+    for (;;) {
+        PROCESS_WAIT_EVENT_UNTIL(atomic_exchange(&imu_dev->int1, false));
 
-    PROCESS_WAIT_UNTIL(imu_dev->ctx.read_write_done);
+    retry:
+        // Read the number of unread words in the FIFO and the position of the
+        // next word in the gyro/accel pattern.
+        imu_dev->ctx.read_write_done = false;
+        HAL_StatusTypeDef ret = HAL_I2C_Mem_Read_IT(hi2c, LSM6DS3TR_C_I2C_ADD_L,
+            LSM6DS3TR_C_FIFO_STATUS1, I2C_MEMADD_SIZE_8BIT, status, sizeof(status));
 
-    if (HAL_I2C_GetError(hi2c) != HAL_I2C_ERROR_NONE) {
-        pbdrv_imu_lsm6ds3tr_c_stm32_i2c_reset(hi2c);
-        goto retry;
-    }
+        if (ret != HAL_OK) {
+            pbdrv_imu_lsm6ds3tr_c_stm32_i2c_reset(hi2c);
+            goto retry;
+        }
 
-    // Since we configured the IMU to enable "rounding" on the accel and gyro
-    // data registers, we can just keep reading forever and it automatically
-    // loops around. This way we don't have to keep writing the register
-    // value each time we want to read new data. This saves CPU usage since
-    // we have fewer interrupts per sample.
+        PROCESS_WAIT_UNTIL(imu_dev->ctx.read_write_done);
 
-    for (;;) {
-        PROCESS_WAIT_EVENT_UNTIL(atomic_exchange(&imu_dev->int1, false));
+        if (HAL_I2C_GetError(hi2c) != HAL_I2C_ERROR_NONE) {
+            pbdrv_imu_lsm6ds3tr_c_stm32_i2c_reset(hi2c);
+            goto retry;
+        }
 
+        // INT1 follows the FIFO threshold level, but only its rising edge
+        // raises the interrupt. So we keep reading batches until the FIFO is
+        // below the watermark again, after which the next edge will follow.
+        uint32_t num_words = ((status[1] & 0x07) << 8) | status[0];
+        if (num_words < LSM6DS3TR_FIFO_NUM_FRAMES * PBDRV_IMU_NUM_FRAME_VALUES) {
+            continue;
+        }
+
+        // If the FIFO is not at the start of a frame, such as after an
+        // overrun, the words up to the next frame are discarded.
+        uint32_t pattern = ((status[3] & 0x03) << 8) | status[2];
+        num_skip = pattern ? PBDRV_IMU_NUM_FRAME_VALUES - pattern : 0;
+        num_frames = num_words > num_skip ? (num_words - num_skip) / PBDRV_IMU_NUM_FRAME_VALUES : 0;
+        if (num_frames > LSM6DS3TR_FIFO_MAX_FRAMES) {
+            num_frames = LSM6DS3TR_FIFO_MAX_FRAMES;
+        }
+
+        if (num_skip) {
+            imu_dev->ctx.read_write_done = false;
+            ret = HAL_I2C_Mem_Read_IT(hi2c, LSM6DS3TR_C_I2C_ADD_L, LSM6DS3TR_C_FIFO_DATA_OUT_L,
+                I2C_MEMADD_SIZE_8BIT, (uint8_t *)imu_dev->frames, num_skip * sizeof(int16_t));
+            if (ret != HAL_OK) {
+                pbdrv_imu_lsm6ds3tr_c_stm32_i2c_reset(hi2c);
+                goto retry;
+            }
+            PROCESS_WAIT_UNTIL(imu_dev->ctx.read_write_done);
+
+            if (HAL_I2C_GetError(hi2c) != HAL_I2C_ERROR_NONE) {
+                pbdrv_imu_lsm6ds3tr_c_stm32_i2c_reset(hi2c);
+                goto retry;
+            }
+        }
+
+        if (num_frames == 0) {
+            continue;
+        }
+
+        // Read all complete frames in one transfer. The register address
+        // rolls back to the start of the FIFO output while reading.
         imu_dev->ctx.read_write_done = false;
-        ret = HAL_I2C_Master_Seq_Receive_IT(
-            &imu_dev->hi2c, LSM6DS3TR_C_I2C_ADD_L, buf, NUM_DATA_BYTES, I2C_NEXT_FRAME);
+        ret = HAL_I2C_Mem_Read_IT(hi2c, LSM6DS3TR_C_I2C_ADD_L, LSM6DS3TR_C_FIFO_DATA_OUT_L,
+            I2C_MEMADD_SIZE_8BIT, (uint8_t *)imu_dev->frames, num_frames * NUM_DATA_BYTES);
 
         if (ret != HAL_OK) {
             pbdrv_imu_lsm6ds3tr_c_stm32_i2c_reset(hi2c);
@@ -373,21 +425,34 @@ retry:
             goto retry;
         }
 
-        memcpy(&imu_dev->data[0], buf, NUM_DATA_BYTES);
-
-        // Account for mounting orientation in hub. Any other tranformations
-        // are applied at the higher level in pbio.
-        imu_dev->data[0] *= PBDRV_CONFIG_IMU_LSM6S3TR_C_STM32_SIGN_X;
-        imu_dev->data[1] *= PBDRV_CONFIG_IMU_LSM6S3TR_C_STM32_SIGN_Y;
-        imu_dev->data[2] *= PBDRV_CONFIG_IMU_LSM6S3TR_C_STM32_SIGN_Z;
-        imu_dev->data[3] *= PBDRV_CONFIG_IMU_LSM6S3TR_C_STM32_SIGN_X;
-        imu_dev->data[4] *= PBDRV_CONFIG_IMU_LSM6S3TR_C_STM32_SIGN_Y;
-        imu_dev->data[5] *= PBDRV_CONFIG_IMU_LSM6S3TR_C_STM32_SIGN_Z;
+        // The last frame was sampled just now. Earlier frames are assumed to
+        // be evenly spaced before it.
+        uint32_t time_now = pbdrv_clock_get_us();
+        uint32_t sample_time_us = imu_dev->config.sample_time * 1000000.0f;
+
+        for (uint32_t f = 0; f < num_frames; f++) {
+            int16_t *frame = &imu_dev->frames[f * PBDRV_IMU_NUM_FRAME_VALUES];
+
+            // Account for mounting orientation in hub. Any other tranformations
+            // are applied at the higher level in pbio.
+            frame[0] *= PBDRV_CONFIG_IMU_LSM6S3TR_C_STM32_SIGN_X;
+            frame[1] *= PBDRV_CONFIG_IMU_LSM6S3TR_C_STM32_SIGN_Y;
+            frame[2] *= PBDRV_CONFIG_IMU_LSM6S3TR_C_STM32_SIGN_Z;
+            frame[3] *= PBDRV_CONFIG_IMU_LSM6S3TR_C_STM32_SIGN_X;
+            frame[4] *= PBDRV_CONFIG_IMU_LSM6S3TR_C_STM32_SIGN_Y;
+            frame[5] *= PBDRV_CONFIG_IMU_LSM6S3TR_C_STM32_SIGN_Z;
+
+            memcpy(&imu_dev->data[0], frame, NUM_DATA_BYTES);
+            pbdrv_imu_lsm6ds3tr_c_stm32_update_stationary_status(imu_dev, time_now - (num_frames - 1 - f) * sample_time_us);
+        }
 
-        pbdrv_imu_lsm6ds3tr_c_stm32_update_stationary_status(imu_dev);
+        // Process all new frames at once.
         if (imu_dev->handle_frame_data) {
-            imu_dev->handle_frame_data(imu_dev->data);
+            imu_dev->handle_frame_data(imu_dev->frames, num_frames);
         }
+
+        // Check if more data arrived while reading.
+        goto retry;
     }
 
     PROCESS_END();
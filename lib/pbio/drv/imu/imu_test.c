@@ -0,0 +1,218 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2023 The Pybricks Authors
+
+// Software IMU implementation for simulating an IMU in tests.
+//
+// Frames are either a constant value set by the test, or replayed from a
+// binary recording as made with pbio_imu_record_start(). Such a recording
+// starts with the sample time in microseconds as a native uint32, followed by
+// a sequence of frames, each with six native int16 values: the unscaled gyro
+// (xyz) and accelerometer (xyz) samples.
+
+#include <pbdrv/config.h>
+
+#if PBDRV_CONFIG_IMU_TEST
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <contiki.h>
+
+#include <pbdrv/clock.h>
+#include <pbdrv/imu.h>
+#include <pbio/error.h>
+
+#include "../core.h"
+#include "imu_test.h"
+
+/** Number of frames passed to the frame data handler at once. */
+#define IMU_TEST_NUM_FRAMES (8)
+
+/** Default time between two samples (us), the same as the hubs at 833 Hz. */
+#define IMU_TEST_SAMPLE_TIME_US (1200)
+
+struct _pbdrv_imu_dev_t {
+    /** IMU configuration to convert raw data to phsyical units. */
+    pbdrv_imu_config_t config;
+    /** Callback to process a batch of unfiltered gyro and accelerometer data. */
+    pbdrv_imu_handle_frame_data_func_t handle_frame_data;
+    /* Callback to process unfiltered gyro and accelerometer data recorded while stationary. */
+    pbdrv_imu_handle_stationary_data_func_t handle_stationary_data;
+    /** Simulated raw data, repeated for every sample. */
+    int16_t data[PBDRV_IMU_NUM_FRAME_VALUES];
+    /** Buffer of frames passed to the frame data handler. */
+    int16_t frames[IMU_TEST_NUM_FRAMES * PBDRV_IMU_NUM_FRAME_VALUES];
+    /** Number of batches passed to the frame data handler. */
+    uint32_t batch_count;
+    /** Time between two samples (us), also given as a float in the config. */
+    uint32_t sample_time_us;
+    /** Recording being replayed, or NULL to repeat data. */
+    FILE *replay_file;
+    /** Whether the requested recording could not be opened. */
+    bool failed;
+};
+
+static pbdrv_imu_dev_t global_imu_dev = {
+    .config = {
+        .sample_time = IMU_TEST_SAMPLE_TIME_US / 1000000.0f,
+        // Same scale as the hubs.
+        .gyro_scale = 0.07f,
+        .accel_scale = 0.244f * 9.81f,
+        .gyro_stationary_threshold = 71,
+        .accel_stationary_threshold = 1044,
+    },
+    .sample_time_us = IMU_TEST_SAMPLE_TIME_US,
+};
+
+// Gets the next frame from the recording, if any.
+static bool pbdrv_imu_test_read_frame(pbdrv_imu_dev_t *imu_dev) {
+    if (!imu_dev->replay_file) {
+        return true;
+    }
+    if (fread(imu_dev->data, sizeof(imu_dev->data), 1, imu_dev->replay_file) == 1) {
+        return true;
+    }
+    // At the end of the recording, no more data is given, as if the sensor
+    // stopped. The last values remain available.
+    fclose(imu_dev->replay_file);
+    imu_dev->replay_file = NULL;
+    return false;
+}
+
+PROCESS(pbdrv_imu_test_process, "pbdrv_imu_test");
+
+PROCESS_THREAD(pbdrv_imu_test_process, ev, data) {
+    static struct etimer timer;
+    static uint32_t frame_time;
+    static bool replay_done;
+
+    pbdrv_imu_dev_t *imu_dev = &global_imu_dev;
+
+    PROCESS_BEGIN();
+
+    // Emulates a sensor that raises an interrupt when a batch is ready.
+    frame_time = pbdrv_clock_get_us();
+    etimer_set(&timer, IMU_TEST_NUM_FRAMES);
+
+    for (;;) {
+        PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_TIMER && etimer_expired(&timer));
+        etimer_reset(&timer);
+
+        if (replay_done) {
+            continue;
+        }
+
+        // Give all frames sampled since the previous batch, at the configured
+        // sample time. Frames that do not fit are given in the next batch.
+        uint32_t now = pbdrv_clock_get_us();
+        uint32_t num_frames = 0;
+        while (num_frames < IMU_TEST_NUM_FRAMES && (int32_t)(now - frame_time) >= 0) {
+            frame_time += imu_dev->sample_time_us;
+            num_frames++;
+        }
+
+        uint32_t f;
+        for (f = 0; f < num_frames; f++) {
+            if (!pbdrv_imu_test_read_frame(imu_dev)) {
+                replay_done = true;
+                break;
+            }
+            memcpy(&imu_dev->frames[f * PBDRV_IMU_NUM_FRAME_VALUES], imu_dev->data, sizeof(imu_dev->data));
+        }
+        if (f > 0 && imu_dev->handle_frame_data) {
+            imu_dev->handle_frame_data(imu_dev->frames, f);
+            imu_dev->batch_count++;
+        }
+    }
+
+    PROCESS_END();
+}
+
+void pbdrv_imu_test_start(void) {
+    // IMU tests can start the simulation as needed, so that it does not
+    // affect the timing of other tests.
+    process_start(&pbdrv_imu_test_process);
+}
+
+/**
+ * Replays frames from a recording instead of repeating the same data.
+ *
+ * Frames are given at the sample time stored in the recording.
+ *
+ * @param [in]  path    Path to the recording.
+ * @return              ::PBIO_SUCCESS on success, ::PBIO_ERROR_IO if the file
+ *                      could not be opened or read, ::PBIO_ERROR_INVALID_ARG
+ *                      if the recording has no valid sample time.
+ */
+pbio_error_t pbdrv_imu_test_replay(const char *path) {
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        return PBIO_ERROR_IO;
+    }
+    uint32_t sample_time_us;
+    if (fread(&sample_time_us, sizeof(sample_time_us), 1, file) != 1) {
+        fclose(file);
+        return PBIO_ERROR_IO;
+    }
+    if (sample_time_us == 0) {
+        fclose(file);
+        return PBIO_ERROR_INVALID_ARG;
+    }
+    if (global_imu_dev.replay_file) {
+        fclose(global_imu_dev.replay_file);
+    }
+    global_imu_dev.replay_file = file;
+    global_imu_dev.sample_time_us = sample_time_us;
+    global_imu_dev.config.sample_time = sample_time_us / 1000000.0f;
+    return PBIO_SUCCESS;
+}
+
+void pbdrv_imu_test_set_frame(const int16_t *frame) {
+    memcpy(global_imu_dev.data, frame, sizeof(global_imu_dev.data));
+}
+
+uint32_t pbdrv_imu_test_get_batch_count(void) {
+    return global_imu_dev.batch_count;
+}
+
+// internal driver interface implementation
+
+void pbdrv_imu_init(void) {
+    #if PBDRV_CONFIG_IMU_TEST_AUTO_START
+    // Optionally replay a recording, such as on the virtual hub.
+    const char *replay_path = getenv("PBIO_TEST_IMU_REPLAY");
+    if (replay_path && pbdrv_imu_test_replay(replay_path) != PBIO_SUCCESS) {
+        // Without the requested data, the IMU is not available.
+        global_imu_dev.failed = true;
+        return;
+    }
+    pbdrv_imu_test_start();
+    #endif
+}
+
+// public driver interface implementation
+
+pbio_error_t pbdrv_imu_get_imu(pbdrv_imu_dev_t **imu_dev, pbdrv_imu_config_t **config) {
+    *imu_dev = &global_imu_dev;
+    *config = &global_imu_dev.config;
+
+    if (global_imu_dev.failed) {
+        return PBIO_ERROR_FAILED;
+    }
+
+    return PBIO_SUCCESS;
+}
+
+void pbdrv_imu_set_data_handlers(pbdrv_imu_dev_t *imu_dev, pbdrv_imu_handle_frame_data_func_t frame_data_func, pbdrv_imu_handle_stationary_data_func_t stationary_data_func) {
+    imu_dev->handle_frame_data = frame_data_func;
+    imu_dev->handle_stationary_data = stationary_data_func;
+}
+
+bool pbdrv_imu_is_stationary(pbdrv_imu_dev_t *imu_dev) {
+    return false;
+}
+
+#endif // PBDRV_CONFIG_IMU_TEST
@@ -0,0 +1,23 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2023 The Pybricks Authors
+
+#ifndef _INTERNAL_PBDRV_IMU_TEST_H_
+#define _INTERNAL_PBDRV_IMU_TEST_H_
+
+#include <pbdrv/config.h>
+
+#if PBDRV_CONFIG_IMU_TEST
+
+#include <stdint.h>
+
+#include <pbio/error.h>
+
+// extra imu functions just for tests
+void pbdrv_imu_test_start(void);
+pbio_error_t pbdrv_imu_test_replay(const char *path);
+void pbdrv_imu_test_set_frame(const int16_t *frame);
+uint32_t pbdrv_imu_test_get_batch_count(void);
+
+#endif // PBDRV_CONFIG_IMU_TEST
+
+#endif // _INTERNAL_PBDRV_IMU_TEST_H_
@@ -86,6 +86,61 @@ pbio_error_t pbdrv_motor_driver_set_duty_cycle(pbdrv_motor_driver_dev_t *driver,
     return PBIO_SUCCESS;
 }
 
+/**
+ * Advances the simulated motor by one millisecond.
+ *
+ * @param [in]  driver      The driver instance.
+ */
+static void pbdrv_motor_driver_virtual_simulation_step(pbdrv_motor_driver_dev_t *driver) {
+
+    // Shorthand notation for frequent local references to model.
+    const pbio_simulation_model_t *m = driver->model;
+
+    // Modified coulomb friction with transition linear in speed through origin.
+    const double limit = 2000;
+    double friction;
+    if (driver->speed > limit) {
+        friction = m->torque_friction;
+    } else if (driver->speed < -limit) {
+        friction = -m->torque_friction;
+    } else {
+        friction = m->torque_friction * driver->speed / limit;
+    }
+
+    // Stall obstacle torque
+    double external_torque = 0;
+    if (driver->angle > driver->pdata->endstop_angle_positive) {
+        external_torque = (driver->angle - driver->pdata->endstop_angle_positive) * 500 + driver->speed * 5;
+    } else if (driver->angle < driver->pdata->endstop_angle_negative) {
+        external_torque = (driver->angle - driver->pdata->endstop_angle_negative) * 500 + driver->speed * 5;
+    }
+
+    double voltage = driver->voltage;
+    double torque = friction + external_torque;
+
+    // Get next state based on current state and input: x(k+1) = Ax(k) + Bu(k)
+    double angle_next = driver->angle +
+        driver->speed * m->d_angle_d_speed +
+        driver->current * m->d_angle_d_current +
+        voltage * m->d_angle_d_voltage +
+        torque * m->d_angle_d_torque;
+    double speed_next = 0 +
+        driver->speed * m->d_speed_d_speed +
+        driver->current * m->d_speed_d_current +
+        voltage * m->d_speed_d_voltage +
+        torque * m->d_speed_d_torque;
+    double current_next = 0 +
+        driver->speed * m->d_current_d_speed +
+        driver->current * m->d_current_d_current +
+        voltage * m->d_current_d_voltage +
+        torque * m->d_current_d_torque;
+
+    // Save new state.
+    driver->angle = angle_next;
+    driver->speed = speed_next;
+    driver->current = current_next;
+}
+
 static pid_t data_parser_pid;
 static FILE *data_parser_in;
 
@@ -97,6 +152,7 @@ PROCESS_THREAD(pbdrv_motor_driver_virtual_simulation_process, ev, data) {
 
     static uint32_t dev_index;
     static pbdrv_motor_driver_dev_t *driver;
+    static clock_time_t sim_time;
 
     PROCESS_BEGIN();
 
@@ -132,6 +188,7 @@ PROCESS_THREAD(pbdrv_motor_driver_virtual_simulation_process, ev, data) {
 
     pbdrv_init_busy_down();
 
+    sim_time = clock_time();
     etimer_set(&tick_timer, 1);
     timer_set(&frame_timer, 40);
 
@@ -163,60 +220,18 @@ PROCESS_THREAD(pbdrv_motor_driver_virtual_simulation_process, ev, data) {
             }
         }
 
-        for (dev_index = 0; dev_index < PBDRV_CONFIG_MOTOR_DRIVER_NUM_DEV; dev_index++) {
-            driver = &motor_driver_devs[dev_index];
-
-            // Skip simulating if there is no model.
-            if (!driver->model) {
-                continue;
-            }
-
-            // Shorthand notation for frequent local references to model.
-            const pbio_simulation_model_t *m = driver->model;
-
-            // Modified coulomb friction with transition linear in speed through origin.
-            const double limit = 2000;
-            double friction;
-            if (driver->speed > limit) {
-                friction = m->torque_friction;
-            } else if (driver->speed < -limit) {
-                friction = -m->torque_friction;
-            } else {
-                friction = m->torque_friction * driver->speed / limit;
-            }
+        // Simulate every millisecond since the previous update. This process
+        // does not always get to run on each one if other processes are busy.
+        while (sim_time != clock_time()) {
+            sim_time++;
+            for (dev_index = 0; dev_index < PBDRV_CONFIG_MOTOR_DRIVER_NUM_DEV; dev_index++) {
+                driver = &motor_driver_devs[dev_index];
 
-            // Stall obstacle torque
-            double external_torque = 0;
-            if (driver->angle > driver->pdata->endstop_angle_positive) {
-                external_torque = (driver->angle - driver->pdata->endstop_angle_positive) * 500 + driver->speed * 5;
-            } else if (driver->angle < driver->pdata->endstop_angle_negative) {
-                external_torque = (driver->angle - driver->pdata->endstop_angle_negative) * 500 + driver->speed * 5;
+                // Skip simulating if there is no model.
+                if (driver->model) {
+                    pbdrv_motor_driver_virtual_simulation_step(driver);
+                }
             }
-
-            double voltage = driver->voltage;
-            double torque = friction + external_torque;
-
-            // Get next state based on current state and input: x(k+1) = Ax(k) + Bu(k)
-            double angle_next = driver->angle +
-                driver->speed * m->d_angle_d_speed +
-                driver->current * m->d_angle_d_current +
-                voltage * m->d_angle_d_voltage +
-                torque * m->d_angle_d_torque;
-            double speed_next = 0 +
-                driver->speed * m->d_speed_d_speed +
-                driver->current * m->d_speed_d_current +
-                voltage * m->d_speed_d_voltage +
-                torque * m->d_speed_d_torque;
-            double current_next = 0 +
-                driver->speed * m->d_current_d_speed +
-                driver->current * m->d_current_d_current +
-                voltage * m->d_current_d_voltage +
-                torque * m->d_current_d_torque;
-
-            // Save new state.
-            driver->angle = angle_next;
-            driver->speed = speed_next;
-            driver->current = current_next;
         }
 
         etimer_reset(&tick_timer);
@@ -175,6 +175,15 @@ void pbdrv_bluetooth_stop_advertising(void);
  */
 bool pbdrv_bluetooth_is_connected(pbdrv_bluetooth_connection_t connection);
 
+/**
+ * Gets the maximum size of a characteristic value notification on the
+ * Pybricks service. This is the negotiated MTU - 3.
+ *
+ * @return                  The size in bytes, or the size for the minimum MTU
+ *                          if no MTU was negotiated.
+ */
+uint16_t pbdrv_bluetooth_get_max_char_size(void);
+
 /**
  * Registers a callback that is called when Bluetooth event occurs.
  *
@@ -291,6 +300,10 @@ static inline bool pbdrv_bluetooth_is_connected(pbdrv_bluetooth_connection_t con
     return false;
 }
 
+static inline uint16_t pbdrv_bluetooth_get_max_char_size(void) {
+    return 0;
+}
+
 static inline void pbdrv_bluetooth_send(pbdrv_bluetooth_send_context_t *context) {
     context->done();
 }
@@ -58,11 +58,21 @@ pbio_error_t pbdrv_imu_get_imu(pbdrv_imu_dev_t **imu_dev, pbdrv_imu_config_t **c
 bool pbdrv_imu_is_stationary(pbdrv_imu_dev_t *imu_dev);
 
 /**
- * Callback to process one frame of unfiltered gyro and accelerometer data.
+ * Number of values in one frame of IMU data: gyro (xyz) and acceleration (xyz).
+ */
+#define PBDRV_IMU_NUM_FRAME_VALUES (6)
+
+/**
+ * Callback to process a batch of frames of unfiltered gyro and accelerometer
+ * data, oldest first.
+ *
+ * Drivers may collect several samples before passing them on all at once, so
+ * that they need not wake up the CPU for every sample.
  *
- * @param [in]  data        Array with unscaled gyro (xyz) and acceleration (xyz) samples to process.
+ * @param [in]  data        Array with unscaled gyro (xyz) and acceleration (xyz) samples for each frame.
+ * @param [in]  num_frames  Number of frames in @p data.
  */
-typedef void (*pbdrv_imu_handle_frame_data_func_t)(int16_t *data);
+typedef void (*pbdrv_imu_handle_frame_data_func_t)(const int16_t *data, uint32_t num_frames);
 
 /**
  * Callback to process @p num_samples unfiltered gyro and accelerometer data
@@ -78,7 +88,7 @@ typedef void (*pbdrv_imu_handle_stationary_data_func_t)(const int32_t *gyro_data
  * Sets the data handlers for processing new data.
  *
  * @param [in]  imu_dev                The IMU device instance.
- * @param [in]  frame_data_func        Callback that handles one data frame.
+ * @param [in]  frame_data_func        Callback that handles a batch of data frames.
  * @param [in]  stationary_data_func   Callback that handles multiple stationary data frames.
  */
 void pbdrv_imu_set_data_handlers(pbdrv_imu_dev_t *imu_dev, pbdrv_imu_handle_frame_data_func_t frame_data_func, pbdrv_imu_handle_stationary_data_func_t stationary_data_func);
@@ -16,9 +16,25 @@
 #define PBIO_CONFIG_CONTROL_LOOP_TIME_MS (5)
 #endif
 
+// Allow the control loop time to be changed at runtime. The loop time above
+// is then the default, and the time step for which motor models are defined.
+#ifndef PBIO_CONFIG_CONTROL_LOOP_TIME_ADJUSTABLE
+#define PBIO_CONFIG_CONTROL_LOOP_TIME_ADJUSTABLE (0)
+#endif
+
+// Shortest and longest loop time if it is adjustable.
+#if PBIO_CONFIG_CONTROL_LOOP_TIME_ADJUSTABLE
+#define PBIO_CONFIG_CONTROL_LOOP_TIME_MIN_MS (2)
+#define PBIO_CONFIG_CONTROL_LOOP_TIME_MAX_MS (PBIO_CONFIG_CONTROL_LOOP_TIME_MS * 2)
+#else
+#define PBIO_CONFIG_CONTROL_LOOP_TIME_MIN_MS (PBIO_CONFIG_CONTROL_LOOP_TIME_MS)
+#define PBIO_CONFIG_CONTROL_LOOP_TIME_MAX_MS (PBIO_CONFIG_CONTROL_LOOP_TIME_MS)
+#endif
+
 // Angle differentiation time window, defined as a multiple of the loop time.
 // This is the time window used for calculating the average speed, so 100ms.
-#define PBIO_CONFIG_DIFFERENTIATOR_WINDOW_SIZE (100 / PBIO_CONFIG_CONTROL_LOOP_TIME_MS)
+// If the loop time is adjustable, this is the size for the shortest loop.
+#define PBIO_CONFIG_DIFFERENTIATOR_WINDOW_SIZE (100 / PBIO_CONFIG_CONTROL_LOOP_TIME_MIN_MS)
 
 // Total number of position samples to store in the differentiator buffer.
 // Must be > PBIO_CONFIG_DIFFERENTIATOR_WINDOW_SIZE. This allows a user
@@ -28,6 +44,52 @@
 #define PBIO_CONFIG_DIFFERENTIATOR_BUFFER_SIZE (PBIO_CONFIG_DIFFERENTIATOR_WINDOW_SIZE * 3 + 1)
 #endif
 
+// Evaluate trajectories incrementally from one control loop step to the next,
+// instead of from scratch. This avoids slow divisions on hubs without a
+// hardware divider.
+#ifndef PBIO_CONFIG_TRAJECTORY_INCREMENTAL
+#define PBIO_CONFIG_TRAJECTORY_INCREMENTAL (0)
+#endif
+
+// Support jerk-limited (S-curve) acceleration and deceleration ramps as an
+// alternative to constant acceleration.
+#ifndef PBIO_CONFIG_TRAJECTORY_S_CURVE
+#define PBIO_CONFIG_TRAJECTORY_S_CURVE (0)
+#endif
+
+// Number of position targets that can be queued per controller, to be run
+// back to back after the ongoing one. Zero disables the queue.
+#ifndef PBIO_CONFIG_CONTROL_QUEUE_SIZE
+#define PBIO_CONFIG_CONTROL_QUEUE_SIZE (0)
+#endif
+
+// Maximum number of columns in a log row, including the default columns.
+#ifndef PBIO_CONFIG_LOGGER_MAX_COLS
+#define PBIO_CONFIG_LOGGER_MAX_COLS (16)
+#endif
+
+// Control loop timing statistics. This is opt-in per platform to save space
+// on small hubs.
+#ifndef PBIO_CONFIG_MOTOR_PROCESS_STATS
+#define PBIO_CONFIG_MOTOR_PROCESS_STATS (0)
+#endif
+
 #define PBIO_CONFIG_NUM_DRIVEBASES (PBIO_CONFIG_SERVO_NUM_DEV / 2)
 
+// Maximum number of values in a snapshot of ports and the IMU.
+#ifndef PBIO_CONFIG_SNAPSHOT_NUM_VALUES
+#define PBIO_CONFIG_SNAPSHOT_NUM_VALUES (64)
+#endif
+
+// Maximum number of wheels of a drive base. With more than two, drive bases
+// can also have four wheel drive, mecanum wheels or omni wheels.
+#ifndef PBIO_CONFIG_DRIVEBASE_NUM_WHEELS
+#define PBIO_CONFIG_DRIVEBASE_NUM_WHEELS (2)
+#endif
+
+// Number of line or arc segments in a drive base path. Zero disables paths.
+#ifndef PBIO_CONFIG_DRIVEBASE_PATH_SIZE
+#define PBIO_CONFIG_DRIVEBASE_PATH_SIZE (0)
+#endif
+
 #endif // _PBIO_CONFIG_H_
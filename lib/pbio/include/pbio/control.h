@@ -17,6 +17,7 @@
 #include <stdint.h>
 
 #include <pbio/angle.h>
+#include <pbio/config.h>
 #include <pbio/control_settings.h>
 #include <pbio/error.h>
 #include <pbio/port.h>
@@ -125,6 +126,25 @@ typedef enum {
     PBIO_CONTROL_STATUS_COMPLETE = 1 << 1,
 } pbio_control_status_flag_t;
 
+/**
+ * Position command that waits in the queue until the ongoing one completes.
+ */
+typedef struct _pbio_control_queue_entry_t {
+    /**
+     * Position to run to (control units).
+     */
+    pbio_angle_t target;
+    /**
+     * Top speed on the way to the target (control units).
+     */
+    int32_t speed;
+    /**
+     * What to do on completion, unless the next command continues in the
+     * same direction, in which case the target is passed at speed.
+     */
+    pbio_control_on_completion_t on_completion;
+} pbio_control_queue_entry_t;
+
 /**
  * Controller status and state.
  */
@@ -167,6 +187,20 @@ typedef struct _pbio_control_t {
      * Control state flags such as being on target and/or being stalled.
      */
     pbio_control_status_flag_t status;
+    #if PBIO_CONFIG_CONTROL_QUEUE_SIZE
+    /**
+     * Ring buffer of position commands to run after the ongoing one.
+     */
+    pbio_control_queue_entry_t queue[PBIO_CONFIG_CONTROL_QUEUE_SIZE];
+    /**
+     * Index of the next command in the queue.
+     */
+    uint8_t queue_first;
+    /**
+     * Number of commands in the queue.
+     */
+    uint8_t queue_size;
+    #endif
 } pbio_control_t;
 
 // Time and reference functions:
@@ -200,10 +234,29 @@ pbio_dcmotor_actuation_t pbio_control_passive_completion_to_actuation_type(pbio_
 // Start new control command:
 
 pbio_error_t pbio_control_start_position_control(pbio_control_t *ctl, uint32_t time_now, const pbio_control_state_t *state, int32_t position, int32_t speed, pbio_control_on_completion_t on_completion);
+pbio_error_t pbio_control_start_position_control_synchronized(pbio_control_t *const *ctl, const pbio_control_state_t *state, uint8_t num_ctl, uint32_t time_now, const int32_t *position, int32_t speed, pbio_control_on_completion_t on_completion);
 pbio_error_t pbio_control_start_position_control_relative(pbio_control_t *ctl, uint32_t time_now, const pbio_control_state_t *state, int32_t distance, int32_t speed, pbio_control_on_completion_t on_completion, bool allow_trajectory_shift);
 pbio_error_t pbio_control_start_position_control_hold(pbio_control_t *ctl, uint32_t time_now, int32_t position);
 pbio_error_t pbio_control_start_timed_control(pbio_control_t *ctl, uint32_t time_now, const pbio_control_state_t *state, uint32_t duration, int32_t speed, pbio_control_on_completion_t on_completion);
 
+// Queue position commands to run back to back:
+
+#if PBIO_CONFIG_CONTROL_QUEUE_SIZE
+
+pbio_error_t pbio_control_queue_position_control(pbio_control_t *ctl, uint32_t time_now, const pbio_control_state_t *state, int32_t position, int32_t speed, pbio_control_on_completion_t on_completion);
+uint8_t pbio_control_queue_get_size(const pbio_control_t *ctl);
+
+#else
+
+static inline pbio_error_t pbio_control_queue_position_control(pbio_control_t *ctl, uint32_t time_now, const pbio_control_state_t *state, int32_t position, int32_t speed, pbio_control_on_completion_t on_completion) {
+    return PBIO_ERROR_NOT_SUPPORTED;
+}
+static inline uint8_t pbio_control_queue_get_size(const pbio_control_t *ctl) {
+    return 0;
+}
+
+#endif // PBIO_CONFIG_CONTROL_QUEUE_SIZE
+
 #endif // _PBIO_CONTROL_H_
 
 /** @} */
@@ -10,6 +10,7 @@
 #include <stdint.h>
 
 #include <pbio/angle.h>
+#include <pbio/config.h>
 #include <pbio/error.h>
 #include <pbio/trajectory.h>
 
@@ -77,6 +78,10 @@ typedef struct _pbio_control_settings_t {
      * Absolute rate of change of the speed during off-ramp of the maneuver.
      */
     int32_t deceleration;
+    /**
+     * Shape of the speed profile during acceleration and deceleration.
+     */
+    pbio_trajectory_profile_t profile;
     /**
      * Maximum feedback actuation value. On a motor this is the maximum torque.
      */
@@ -139,6 +144,22 @@ bool pbio_control_settings_time_is_later(uint32_t sample, uint32_t base);
 // Scale values by given constants:
 
 int32_t pbio_control_settings_mul_by_loop_time(int32_t input);
+
+#if PBIO_CONFIG_CONTROL_LOOP_TIME_ADJUSTABLE
+
+uint32_t pbio_control_settings_get_loop_time(void);
+pbio_error_t pbio_control_settings_set_loop_time(uint32_t loop_time);
+
+#else
+
+static inline uint32_t pbio_control_settings_get_loop_time(void) {
+    return PBIO_CONFIG_CONTROL_LOOP_TIME_MS;
+}
+static inline pbio_error_t pbio_control_settings_set_loop_time(uint32_t loop_time) {
+    return loop_time == PBIO_CONFIG_CONTROL_LOOP_TIME_MS ? PBIO_SUCCESS : PBIO_ERROR_NOT_SUPPORTED;
+}
+
+#endif // PBIO_CONFIG_CONTROL_LOOP_TIME_ADJUSTABLE
 int32_t pbio_control_settings_mul_by_gain(int32_t value, int32_t gain);
 int32_t pbio_control_settings_div_by_gain(int32_t value, int32_t gain);
 
@@ -146,6 +167,8 @@ int32_t pbio_control_settings_div_by_gain(int32_t value, int32_t gain);
 
 void pbio_control_settings_get_trajectory_limits(const pbio_control_settings_t *s, int32_t *speed, int32_t *acceleration, int32_t *deceleration);
 pbio_error_t pbio_control_settings_set_trajectory_limits(pbio_control_settings_t *s, int32_t speed, int32_t acceleration, int32_t deceleration);
+pbio_trajectory_profile_t pbio_control_settings_get_trajectory_profile(const pbio_control_settings_t *s);
+pbio_error_t pbio_control_settings_set_trajectory_profile(pbio_control_settings_t *s, pbio_trajectory_profile_t profile);
 int32_t pbio_control_settings_get_actuation_limit(const pbio_control_settings_t *s);
 pbio_error_t pbio_control_settings_set_actuation_limit(pbio_control_settings_t *s, int32_t limit);
 void pbio_control_settings_get_pid(const pbio_control_settings_t *s, int32_t *pid_kp, int32_t *pid_ki, int32_t *pid_kd, int32_t *integral_deadzone, int32_t *integral_change_max);
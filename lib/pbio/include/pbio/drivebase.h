@@ -18,6 +18,155 @@
 
 #if PBIO_CONFIG_NUM_DRIVEBASES > 0
 
+/**
+ * Scale of the kinematics coefficients of a drive base wheel. A coefficient
+ * equal to this scale means that the wheel turns as much as the wheels of a
+ * standard two-wheeled drive base.
+ */
+#define PBIO_DRIVEBASE_KINEMATICS_SCALE (1000)
+
+/**
+ * A wheel of a drive base and how it turns as the drive base moves.
+ *
+ * For example, the left wheel of a standard drive base has distance and
+ * heading coefficients of ::PBIO_DRIVEBASE_KINEMATICS_SCALE and no lateral
+ * coefficient. The right wheel has a negative heading coefficient. Wheels that
+ * can drive sideways, such as mecanum and omni wheels, have a nonzero lateral
+ * coefficient.
+ */
+typedef struct _pbio_drivebase_wheel_t {
+    /** The servo that drives the wheel. */
+    pbio_servo_t *servo;
+    /** Wheel rotation for driving forward. */
+    int16_t distance;
+    /** Wheel rotation for turning clockwise. */
+    int16_t heading;
+    /** Wheel rotation for driving to the right without turning. */
+    int16_t lateral;
+} pbio_drivebase_wheel_t;
+
+/**
+ * Number of axes along which a drive base can move: distance, heading, and
+ * sideways if there may be more than two wheels.
+ */
+#if PBIO_CONFIG_DRIVEBASE_NUM_WHEELS > 2
+#define PBIO_DRIVEBASE_NUM_AXES (3)
+#else
+#define PBIO_DRIVEBASE_NUM_AXES (2)
+#endif
+
+#if PBIO_CONFIG_DRIVEBASE_POSE
+
+/**
+ * Estimated position and orientation of a drive base on the floor.
+ *
+ * The x-axis points forward and the y-axis points to the right of the drive
+ * base at the time the pose was reset. The heading is positive clockwise, just
+ * like the drive base angle.
+ */
+typedef struct _pbio_drivebase_pose_t {
+    /** Position along the x-axis (mm). */
+    float x;
+    /** Position along the y-axis (mm). */
+    float y;
+    /** Heading with respect to the x-axis (deg). */
+    float heading;
+    /** Distance state at the previous update, in control units. */
+    pbio_angle_t distance_last;
+    /** Heading state at the previous update, in control units. */
+    pbio_angle_t heading_last;
+    #if PBIO_CONFIG_DRIVEBASE_NUM_WHEELS > 2
+    /** Lateral state at the previous update, in control units. */
+    pbio_angle_t lateral_last;
+    #endif
+} pbio_drivebase_pose_t;
+
+#endif // PBIO_CONFIG_DRIVEBASE_POSE
+
+/**
+ * Part of a path that drives by a distance while turning by an angle.
+ *
+ * A straight line has no angle. An arc has a distance equal to its length.
+ */
+typedef struct _pbio_drivebase_path_segment_t {
+    /** Distance to drive by (mm). */
+    int32_t distance;
+    /** Angle to turn by (deg). */
+    int32_t angle;
+} pbio_drivebase_path_segment_t;
+
+#if PBIO_CONFIG_DRIVEBASE_FOLLOW
+
+/**
+ * Gets a new value from a sensor used by a drive base to follow a line.
+ *
+ * @param [in]  context     Sensor instance.
+ * @param [out] value       Sensor value, such as the reflection in %.
+ * @return                  ::PBIO_ERROR_AGAIN if the sensor is not ready yet,
+ *                          otherwise error code.
+ */
+typedef pbio_error_t (*pbio_drivebase_follow_sensor_func_t)(void *context, int32_t *value);
+
+/**
+ * State of the line follower, which steers based on a sensor value.
+ */
+typedef struct _pbio_drivebase_follow_t {
+    /** Function to read the sensor, or NULL if not following. */
+    pbio_drivebase_follow_sensor_func_t sensor;
+    /** Sensor instance passed to the sensor function. */
+    void *context;
+    /** Sensor value to steer toward. */
+    float target;
+    /** Proportional gain ((deg/s) per unit of the sensor value). */
+    float kp;
+    /** Integral gain ((deg/s) per unit of the sensor value times s). */
+    float ki;
+    /** Derivative gain ((deg/s) per unit of the sensor value per s). */
+    float kd;
+    /** Integral of the error (unit of the sensor value times s). */
+    float integral;
+    /** Error at the previous update. */
+    float error_last;
+    /** Low-pass filtered derivative of the error (unit of the sensor value per s). */
+    float derivative;
+    /** Time of the previous update (ticks). */
+    uint32_t time_last;
+    /** Whether the sensor has been read since following started. */
+    bool started;
+} pbio_drivebase_follow_t;
+
+#endif // PBIO_CONFIG_DRIVEBASE_FOLLOW
+
+#if PBIO_CONFIG_DRIVEBASE_SLIP
+
+/**
+ * State of the slip detector, which compares the motion measured by the wheels
+ * to the motion measured by the IMU.
+ */
+typedef struct _pbio_drivebase_slip_t {
+    /** Low-pass filtered heading rate of the wheels minus that of the gyro (deg/s). */
+    float heading_rate_error;
+    /** Low-pass filtered acceleration of the wheels minus that of the accelerometer (mm/s^2). */
+    float acceleration_error;
+    /** Drive speed of the wheels at the previous update (mm/s). */
+    float speed_last;
+    /** Time of the previous update (ticks). */
+    uint32_t time_last;
+    /** Whether the speed has been measured since the drive base was set up. */
+    bool started;
+    /** Whether the wheels are slipping. */
+    bool slipping;
+    /** Whether to reduce the acceleration when the wheels start slipping. */
+    bool limit;
+    /** Acceleration and deceleration of distance and heading control before they were reduced (control units). */
+    int32_t distance_acceleration;
+    int32_t distance_deceleration;
+    int32_t heading_acceleration;
+    int32_t heading_deceleration;
+} pbio_drivebase_slip_t;
+
+#endif // PBIO_CONFIG_DRIVEBASE_SLIP
+
 typedef struct _pbio_drivebase_t {
     /**
      * True if a gyro or compass is used for heading control, else false.
@@ -27,13 +176,116 @@ typedef struct _pbio_drivebase_t {
      * Synchronization state to indicate that one or more controllers are paused.
      */
     bool control_paused;
-    pbio_servo_t *left;
-    pbio_servo_t *right;
+    /**
+     * Wheels of the drive base. The first two are the left and right wheels
+     * of a standard drive base.
+     */
+    pbio_drivebase_wheel_t wheels[PBIO_CONFIG_DRIVEBASE_NUM_WHEELS];
+    uint8_t num_wheels;
+    /**
+     * Pseudo-inverse of the wheel kinematics, used to get the motion along
+     * each axis from the wheel rotations. Fixed point with 16 fractional bits.
+     */
+    int32_t odometry[PBIO_DRIVEBASE_NUM_AXES][PBIO_CONFIG_DRIVEBASE_NUM_WHEELS];
     pbio_control_t control_heading;
     pbio_control_t control_distance;
+    #if PBIO_CONFIG_DRIVEBASE_NUM_WHEELS > 2
+    /**
+     * True if the wheels can drive sideways, so the lateral motion is
+     * controlled too.
+     */
+    bool holonomic;
+    /**
+     * Projection of the wheel rotations onto the motion that the axes don't
+     * describe, such as the front wheels turning against the rear wheels.
+     * On the floor, this can't happen, but the wheels are still kept in sync
+     * if the drive base is lifted. Fixed point with 16 fractional bits.
+     */
+    int32_t wheel_sync[PBIO_CONFIG_DRIVEBASE_NUM_WHEELS][PBIO_CONFIG_DRIVEBASE_NUM_WHEELS];
+    /**
+     * Projected wheel rotations at the start of the latest command. Wheels
+     * are kept in sync relative to this, so they don't undo earlier slip.
+     */
+    pbio_angle_t wheel_sync_start[PBIO_CONFIG_DRIVEBASE_NUM_WHEELS];
+    /**
+     * True if the start of the wheel sync must be set in the next update.
+     */
+    bool wheel_sync_restart;
+    /**
+     * Controls the sideways motion. Unlike the other controllers, this one
+     * just keeps running at the requested lateral speed, which is 0 unless set
+     * with pbio_drivebase_drive_forever_holonomic.
+     */
+    pbio_control_t control_lateral;
+    int32_t lateral_speed;
+    /**
+     * True if the lateral controller must (re)start at the lateral speed.
+     */
+    bool lateral_restart;
+    #endif
+    #if PBIO_CONFIG_DRIVEBASE_POSE
+    /**
+     * Pose estimate, updated in every control loop iteration.
+     */
+    pbio_drivebase_pose_t pose;
+    /**
+     * True while turning toward the target of pbio_drivebase_drive_to, before
+     * driving to it.
+     */
+    bool drive_to_pending;
+    /**
+     * Target of pbio_drivebase_drive_to (mm).
+     */
+    float drive_to_x;
+    float drive_to_y;
+    /**
+     * What to do when pbio_drivebase_drive_to reaches its target.
+     */
+    pbio_control_on_completion_t drive_to_on_completion;
+    #endif
+    #if PBIO_CONFIG_DRIVEBASE_PATH_SIZE
+    /**
+     * Segments of the path that is being followed.
+     */
+    pbio_drivebase_path_segment_t path[PBIO_CONFIG_DRIVEBASE_PATH_SIZE];
+    /**
+     * Index of the next segment to start.
+     */
+    uint8_t path_next;
+    /**
+     * Number of segments in the path.
+     */
+    uint8_t path_size;
+    /**
+     * Distance (mm) and heading (deg) at the end of the ongoing segment.
+     */
+    int32_t path_distance_end;
+    int32_t path_heading_end;
+    /**
+     * What to do when reaching the end of the path.
+     */
+    pbio_control_on_completion_t path_on_completion;
+    #endif
+    #if PBIO_CONFIG_DRIVEBASE_FOLLOW
+    /**
+     * Line follower, updated in every control loop iteration.
+     */
+    pbio_drivebase_follow_t follow;
+    #endif
+    #if PBIO_CONFIG_DRIVEBASE_SLIP
+    /**
+     * Slip detector, updated in every control loop iteration.
+     */
+    pbio_drivebase_slip_t slip;
+    #endif
 } pbio_drivebase_t;
 
 pbio_error_t pbio_drivebase_get_drivebase(pbio_drivebase_t **db_address, pbio_servo_t *left, pbio_servo_t *right, int32_t wheel_diameter, int32_t axle_track);
+pbio_error_t pbio_drivebase_get_drivebase_wheels(pbio_drivebase_t **db_address, const pbio_drivebase_wheel_t *wheels, uint8_t num_wheels, int32_t wheel_diameter, int32_t axle_track);
+
+#if PBIO_CONFIG_DRIVEBASE_NUM_WHEELS > 2
+void pbio_drivebase_get_mecanum_wheels(pbio_servo_t *front_left, pbio_servo_t *front_right, pbio_servo_t *rear_left, pbio_servo_t *rear_right, pbio_drivebase_wheel_t *wheels);
+#endif
 
 // Drive base status:
 
@@ -41,24 +293,56 @@ void pbio_drivebase_update_all(void);
 bool pbio_drivebase_update_loop_is_running(pbio_drivebase_t *db);
 bool pbio_drivebase_is_done(const pbio_drivebase_t *db);
 pbio_error_t pbio_drivebase_is_stalled(pbio_drivebase_t *db, bool *stalled, uint32_t *stall_duration);
+#if PBIO_CONFIG_DRIVEBASE_SLIP
+pbio_error_t pbio_drivebase_is_slipping(pbio_drivebase_t *db, bool *slipping, float *heading_rate_error, float *acceleration_error);
+#endif
 
 // Finite point to point control:
 
 pbio_error_t pbio_drivebase_drive_straight(pbio_drivebase_t *db, int32_t distance, pbio_control_on_completion_t on_completion);
 pbio_error_t pbio_drivebase_drive_curve(pbio_drivebase_t *db, int32_t radius, int32_t angle, pbio_control_on_completion_t on_completion);
+void pbio_drivebase_get_arc_segment(int32_t radius, int32_t angle, pbio_drivebase_path_segment_t *segment);
+
+#if PBIO_CONFIG_DRIVEBASE_PATH_SIZE
+pbio_error_t pbio_drivebase_drive_path(pbio_drivebase_t *db, const pbio_drivebase_path_segment_t *segments, uint8_t num_segments, pbio_control_on_completion_t on_completion);
+#endif
 
 // Infinite driving:
 
 pbio_error_t pbio_drivebase_drive_forever(pbio_drivebase_t *db, int32_t speed, int32_t turn_rate);
+#if PBIO_CONFIG_DRIVEBASE_NUM_WHEELS > 2
+pbio_error_t pbio_drivebase_drive_forever_holonomic(pbio_drivebase_t *db, int32_t speed, int32_t lateral_speed, int32_t turn_rate);
+#endif
 pbio_error_t pbio_drivebase_stop(pbio_drivebase_t *db, pbio_control_on_completion_t on_completion);
 
+#if PBIO_CONFIG_DRIVEBASE_FOLLOW
+pbio_error_t pbio_drivebase_follow(pbio_drivebase_t *db, pbio_drivebase_follow_sensor_func_t sensor, void *context, int32_t speed, float target, float kp, float ki, float kd);
+pbio_error_t pbio_drivebase_follow_get_reflection(void *legodev, int32_t *reflection);
+pbio_error_t pbio_drivebase_follow_check_sensor_mode(void *legodev, uint8_t mode);
+#endif
+
 
 // Measuring and settings:
 
 pbio_error_t pbio_drivebase_get_state_user(pbio_drivebase_t *db, int32_t *distance, int32_t *drive_speed, int32_t *angle, int32_t *turn_rate);
 pbio_error_t pbio_drivebase_get_drive_settings(const pbio_drivebase_t *db, int32_t *drive_speed, int32_t *drive_acceleration, int32_t *drive_deceleration, int32_t *turn_rate, int32_t *turn_acceleration, int32_t *turn_deceleration);
 pbio_error_t pbio_drivebase_set_drive_settings(pbio_drivebase_t *db, int32_t drive_speed, int32_t drive_acceleration, int32_t drive_deceleration, int32_t turn_rate, int32_t turn_acceleration, int32_t turn_deceleration);
+pbio_trajectory_profile_t pbio_drivebase_get_drive_profile(const pbio_drivebase_t *db);
+pbio_error_t pbio_drivebase_set_drive_profile(pbio_drivebase_t *db, pbio_trajectory_profile_t profile);
 pbio_error_t pbio_drivebase_set_use_gyro(pbio_drivebase_t *db, bool use_gyro);
+#if PBIO_CONFIG_DRIVEBASE_SLIP
+void pbio_drivebase_set_slip_limit(pbio_drivebase_t *db, bool limit);
+#endif
+
+#if PBIO_CONFIG_DRIVEBASE_POSE
+
+// Pose estimation:
+
+pbio_error_t pbio_drivebase_get_pose(pbio_drivebase_t *db, float *x, float *y, float *heading);
+pbio_error_t pbio_drivebase_reset_pose(pbio_drivebase_t *db, float x, float y, float heading);
+pbio_error_t pbio_drivebase_drive_to(pbio_drivebase_t *db, float x, float y, pbio_control_on_completion_t on_completion);
+
+#endif // PBIO_CONFIG_DRIVEBASE_POSE
 
 #if PBIO_CONFIG_DRIVEBASE_SPIKE
 
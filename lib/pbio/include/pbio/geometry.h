@@ -62,6 +62,21 @@ typedef struct _pbio_geometry_matrix_3x3_t {
     };
 } pbio_geometry_matrix_3x3_t;
 
+/**
+ * Unit quaternion that represents a rotation, with scalar part w.
+ */
+typedef struct _pbio_geometry_quaternion_t {
+    union {
+        struct {
+            float w; /**< Scalar part.*/
+            float x; /**< X component of the vector part.*/
+            float y; /**< Y component of the vector part.*/
+            float z; /**< Z component of the vector part.*/
+        };
+        float values[4];
+    };
+} pbio_geometry_quaternion_t;
+
 void pbio_geometry_side_get_axis(pbio_geometry_side_t side, uint8_t *index, int8_t *sign);
 
 void pbio_geometry_get_complementary_axis(uint8_t *index, int8_t *sign);
@@ -78,6 +93,16 @@ void pbio_geometry_vector_map(pbio_geometry_matrix_3x3_t *map, pbio_geometry_xyz
 
 pbio_error_t pbio_geometry_map_from_base_axes(pbio_geometry_xyz_t *x_axis, pbio_geometry_xyz_t *z_axis, pbio_geometry_matrix_3x3_t *rotation);
 
+void pbio_geometry_matrix_multiply_transpose(pbio_geometry_matrix_3x3_t *a, pbio_geometry_matrix_3x3_t *b, pbio_geometry_matrix_3x3_t *output);
+
+pbio_error_t pbio_geometry_quaternion_normalize(pbio_geometry_quaternion_t *q);
+
+pbio_error_t pbio_geometry_quaternion_from_gravity(pbio_geometry_xyz_t *gravity, pbio_geometry_quaternion_t *q);
+
+void pbio_geometry_quaternion_to_rotation_matrix(pbio_geometry_quaternion_t *q, pbio_geometry_matrix_3x3_t *rotation);
+
+void pbio_geometry_quaternion_update_attitude(pbio_geometry_quaternion_t *q, pbio_geometry_xyz_t *angular_velocity, pbio_geometry_xyz_t *acceleration, float time_step, float gain);
+
 #endif // _PBIO_GEOMETRY_H_
 
 /** @} */
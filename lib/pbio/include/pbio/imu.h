@@ -13,11 +13,63 @@
 
 #include <stdint.h>
 
+#include <pbdrv/imu.h>
+
 #include <pbio/angle.h>
 #include <pbio/config.h>
 #include <pbio/error.h>
 #include <pbio/geometry.h>
 
+/**
+ * Flags that indicate which persistent IMU settings are valid.
+ */
+typedef enum {
+    /** The gyro bias was measured. */
+    PBIO_IMU_PERSISTENT_SETTINGS_FLAG_BIAS = 1 << 0,
+    /** The gyro scale correction is set. */
+    PBIO_IMU_PERSISTENT_SETTINGS_FLAG_SCALE = 1 << 1,
+    /** All known flags. */
+    PBIO_IMU_PERSISTENT_SETTINGS_FLAG_ALL = (1 << 2) - 1,
+} pbio_imu_persistent_settings_flags_t;
+
+/**
+ * IMU calibration values that are kept when the hub is turned off.
+ */
+typedef struct _pbio_imu_persistent_settings_t {
+    /** Which of the values below are valid. */
+    uint32_t flags;
+    /** Gyro bias (deg/s) in the hub frame. */
+    pbio_geometry_xyz_t gyro_bias;
+    /** Per-axis correction factor of the gyro scale in the hub frame. */
+    pbio_geometry_xyz_t gyro_scale_correction;
+} pbio_imu_persistent_settings_t;
+
+/** Largest plausible gyro bias (deg/s). */
+#define PBIO_IMU_BIAS_MAX (10.0f)
+
+/** Largest plausible deviation of the gyro scale correction from 1. */
+#define PBIO_IMU_SCALE_CORRECTION_MAX (0.1f)
+
+/** Smallest change of the gyro bias (deg/s) that is worth saving again. */
+#define PBIO_IMU_BIAS_SAVE_THRESHOLD (0.05f)
+
+/**
+ * Recording of raw IMU data frames, as given by the driver.
+ */
+typedef struct _pbio_imu_recording_t {
+    /** Time between two frames (us). */
+    uint32_t sample_time_us;
+    /**
+     * Frames of ::PBDRV_IMU_NUM_FRAME_VALUES native values each: the unscaled
+     * gyro (xyz) and accelerometer (xyz) samples.
+     */
+    int16_t frames[];
+} pbio_imu_recording_t;
+
+/** Size of a recording with the given number of frames (bytes). */
+#define PBIO_IMU_RECORDING_SIZE(num_frames) \
+    (sizeof(pbio_imu_recording_t) + (num_frames) * PBDRV_IMU_NUM_FRAME_VALUES * sizeof(int16_t))
+
 #if PBIO_CONFIG_IMU
 
 void pbio_imu_init(void);
@@ -36,16 +88,40 @@ void pbio_imu_get_angular_velocity(pbio_geometry_xyz_t *values);
 
 void pbio_imu_get_acceleration(pbio_geometry_xyz_t *values);
 
+void pbio_imu_get_linear_acceleration(pbio_geometry_xyz_t *values);
+
 pbio_error_t pbio_imu_get_single_axis_rotation(pbio_geometry_xyz_t *axis, float *angle);
 
 pbio_geometry_side_t pbio_imu_get_up_side(void);
 
+void pbio_imu_get_orientation(pbio_geometry_matrix_3x3_t *rotation);
+
+void pbio_imu_get_euler_angles(pbio_geometry_xyz_t *angles);
+
 float pbio_imu_get_heading(void);
 
 void pbio_imu_set_heading(float desired_heading);
 
 void pbio_imu_get_heading_scaled(pbio_angle_t *heading, int32_t *heading_rate, int32_t ctl_steps_per_degree);
 
+void pbio_imu_record_start(pbio_imu_recording_t *recording, uint32_t num_frames);
+
+uint32_t pbio_imu_record_stop(void);
+
+uint32_t pbio_imu_record_get_count(void);
+
+void pbio_imu_get_persistent_settings(pbio_imu_persistent_settings_t *settings);
+
+pbio_error_t pbio_imu_apply_persistent_settings(const pbio_imu_persistent_settings_t *settings);
+
+bool pbio_imu_persistent_settings_changed(const pbio_imu_persistent_settings_t *stored, const pbio_imu_persistent_settings_t *settings);
+
+void pbio_imu_calibrate_scale_start(void);
+
+pbio_error_t pbio_imu_calibrate_scale_finish(const pbio_geometry_xyz_t *rotation);
+
+void pbio_imu_get_scale_correction(pbio_geometry_xyz_t *correction);
+
 #else // PBIO_CONFIG_IMU
 
 static inline void pbio_imu_init(void) {
@@ -68,10 +144,19 @@ static inline void pbio_imu_get_angular_velocity(pbio_geometry_xyz_t *values) {
 static inline void pbio_imu_get_acceleration(pbio_geometry_xyz_t *values) {
 }
 
+static inline void pbio_imu_get_linear_acceleration(pbio_geometry_xyz_t *values) {
+}
+
 static inline pbio_geometry_side_t pbio_imu_get_up_side(void) {
     return PBIO_GEOMETRY_SIDE_TOP;
 }
 
+static inline void pbio_imu_get_orientation(pbio_geometry_matrix_3x3_t *rotation) {
+}
+
+static inline void pbio_imu_get_euler_angles(pbio_geometry_xyz_t *angles) {
+}
+
 static inline float pbio_imu_get_heading(void) {
     return 0.0f;
 }
@@ -82,6 +167,38 @@ static inline void pbio_imu_set_heading(float desired_heading) {
 static inline void pbio_imu_get_heading_scaled(pbio_angle_t *heading, int32_t *heading_rate, int32_t ctl_steps_per_degree) {
 }
 
+static inline void pbio_imu_record_start(pbio_imu_recording_t *recording, uint32_t num_frames) {
+}
+
+static inline uint32_t pbio_imu_record_stop(void) {
+    return 0;
+}
+
+static inline uint32_t pbio_imu_record_get_count(void) {
+    return 0;
+}
+
+static inline void pbio_imu_get_persistent_settings(pbio_imu_persistent_settings_t *settings) {
+}
+
+static inline pbio_error_t pbio_imu_apply_persistent_settings(const pbio_imu_persistent_settings_t *settings) {
+    return PBIO_ERROR_NOT_SUPPORTED;
+}
+
+static inline bool pbio_imu_persistent_settings_changed(const pbio_imu_persistent_settings_t *stored, const pbio_imu_persistent_settings_t *settings) {
+    return false;
+}
+
+static inline void pbio_imu_calibrate_scale_start(void) {
+}
+
+static inline pbio_error_t pbio_imu_calibrate_scale_finish(const pbio_geometry_xyz_t *rotation) {
+    return PBIO_ERROR_NOT_SUPPORTED;
+}
+
+static inline void pbio_imu_get_scale_correction(pbio_geometry_xyz_t *correction) {
+}
+
 #endif // PBIO_CONFIG_IMU
 
 #endif // _PBIO_IMU_H_
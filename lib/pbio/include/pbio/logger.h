@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2018-2022 The Pybricks Authors
+// Copyright (c) 2018-2023 The Pybricks Authors
 
 /**
  * @addtogroup Logger pbio/logger: Logging control loop data
@@ -17,6 +17,40 @@
 #include <pbio/config.h>
 #include <pbio/error.h>
 
+/**
+ * Maximum number of columns in a compact log, including the default columns.
+ */
+#define PBIO_LOGGER_COMPACT_MAX_COLS (PBIO_CONFIG_LOGGER_MAX_COLS)
+
+/**
+ * Every this many rows, a compact log stores full values instead of
+ * differences, so that decoding can start from there.
+ */
+#define PBIO_LOGGER_COMPACT_KEYFRAME_INTERVAL (32)
+
+/**
+ * Version of the compact log format, stored in the header.
+ */
+#define PBIO_LOGGER_COMPACT_VERSION (1)
+
+/**
+ * Size of the header that describes compact log data.
+ */
+#define PBIO_LOGGER_COMPACT_HEADER_SIZE (6)
+
+/**
+ * Callback that sends out one row of a streaming log.
+ *
+ * This is called from the background control loop, so it must not block.
+ *
+ * @param [in]  context     Context given when starting the stream.
+ * @param [in]  row_data    Row data, including the default columns.
+ * @param [in]  num_cols    Number of values in @p row_data.
+ * @return                  ::PBIO_SUCCESS if the row was sent,
+ *                          ::PBIO_ERROR_AGAIN if there is no room right now.
+ *                          Other errors stop the stream.
+ */
+typedef pbio_error_t (*pbio_logger_stream_func_t)(void *context, const int32_t *row_data, uint8_t num_cols);
 
 /**
  * Logger object for storing data from background control loops.
@@ -55,6 +89,45 @@ typedef struct _pbio_log_t {
      * How many rows have been skipped so far, counts up to down_sample.
      */
     uint32_t skipped_samples;
+    /**
+     * Callback to send rows out while logging. If set, the data buffer is
+     * used as a ring buffer of unsent rows instead of a full recording.
+     */
+    pbio_logger_stream_func_t stream;
+    /**
+     * Context passed to the stream callback.
+     */
+    void *stream_context;
+    /**
+     * Index of the oldest row in the ring buffer.
+     */
+    uint32_t row_first;
+    /**
+     * Number of rows sent out by the stream callback.
+     */
+    uint32_t num_rows_sent;
+    /**
+     * Number of rows discarded because the ring buffer was full.
+     */
+    uint32_t num_rows_dropped;
+    /**
+     * Buffer for compact (encoded) rows. If set, rows are stored here instead
+     * of in the data buffer.
+     */
+    uint8_t *compact_data;
+    /**
+     * Size of the compact data buffer in bytes.
+     */
+    uint32_t compact_size;
+    /**
+     * How many bytes of the compact data buffer have been used so far.
+     */
+    uint32_t compact_size_used;
+    /**
+     * Previous row, used to compute the differences for the next row. This
+     * is stored at the start of the buffer given for the compact log.
+     */
+    int32_t *compact_prev;
     #endif
 } pbio_log_t;
 
@@ -65,17 +138,33 @@ typedef struct _pbio_log_t {
 #define PBIO_LOGGER_NUM_DEFAULT_COLS (1)
 
 void pbio_logger_start(pbio_log_t *log, int32_t *buf, uint32_t num_rows, uint8_t num_cols, int32_t down_sample);
+void pbio_logger_start_stream(pbio_log_t *log, int32_t *buf, uint32_t num_rows, uint8_t num_cols, int32_t down_sample, pbio_logger_stream_func_t stream, void *stream_context);
+pbio_error_t pbio_logger_stream_flush(pbio_log_t *log);
+pbio_error_t pbio_logger_start_compact(pbio_log_t *log, int32_t *buf, uint32_t size, uint8_t num_cols, int32_t down_sample);
 void pbio_logger_stop(pbio_log_t *log);
 bool pbio_logger_is_active(const pbio_log_t *log);
 void pbio_logger_add_row(pbio_log_t *log, const int32_t *row_data);
 
 uint32_t pbio_logger_get_num_rows_used(const pbio_log_t *log);
 int32_t *pbio_logger_get_row_data(const pbio_log_t *log, uint32_t index);
+uint32_t pbio_logger_get_num_rows_sent(const pbio_log_t *log);
+uint32_t pbio_logger_get_num_rows_dropped(const pbio_log_t *log);
+const uint8_t *pbio_logger_get_compact_data(const pbio_log_t *log, uint32_t *size);
+void pbio_logger_get_compact_header(const pbio_log_t *log, uint8_t *header);
+uint32_t pbio_logger_compact_decode_row(const uint8_t *data, uint32_t size, uint32_t index, uint8_t num_cols, int32_t *row_data);
 
 #else
 
 static inline void pbio_logger_start(pbio_log_t *log, int32_t *buf, uint32_t num_rows, uint8_t num_cols, int32_t down_sample) {
 }
+static inline void pbio_logger_start_stream(pbio_log_t *log, int32_t *buf, uint32_t num_rows, uint8_t num_cols, int32_t down_sample, pbio_logger_stream_func_t stream, void *stream_context) {
+}
+static inline pbio_error_t pbio_logger_stream_flush(pbio_log_t *log) {
+    return PBIO_ERROR_NOT_SUPPORTED;
+}
+static inline pbio_error_t pbio_logger_start_compact(pbio_log_t *log, int32_t *buf, uint32_t size, uint8_t num_cols, int32_t down_sample) {
+    return PBIO_ERROR_NOT_SUPPORTED;
+}
 static inline void pbio_logger_stop(pbio_log_t *log) {
 }
 static inline bool pbio_logger_is_active(const pbio_log_t *log) {
@@ -89,6 +178,21 @@ static inline uint32_t pbio_logger_get_num_rows_used(const pbio_log_t *log) {
 static inline int32_t *pbio_logger_get_row_data(pbio_log_t *log, uint32_t index) {
     return NULL;
 }
+static inline uint32_t pbio_logger_get_num_rows_sent(const pbio_log_t *log) {
+    return 0;
+}
+static inline uint32_t pbio_logger_get_num_rows_dropped(const pbio_log_t *log) {
+    return 0;
+}
+static inline const uint8_t *pbio_logger_get_compact_data(const pbio_log_t *log, uint32_t *size) {
+    *size = 0;
+    return NULL;
+}
+static inline void pbio_logger_get_compact_header(const pbio_log_t *log, uint8_t *header) {
+}
+static inline uint32_t pbio_logger_compact_decode_row(const uint8_t *data, uint32_t size, uint32_t index, uint8_t num_cols, int32_t *row_data) {
+    return 0;
+}
 
 #endif // PBIO_CONFIG_LOGGER
 
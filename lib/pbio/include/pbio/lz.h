@@ -0,0 +1,74 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2023 The Pybricks Authors
+
+/**
+ * @addtogroup LZ pbio/lz: Decompression of LZ-compressed data
+ *
+ * Decodes a simple LZ77-style stream in chunks, straight into the output
+ * buffer. Matches are copied from data that was already decoded, so no
+ * separate window buffer is needed.
+ *
+ * The stream is a sequence of tokens, each starting with a control byte c:
+ *
+ * - c < 0x80: a literal run. The next c + 1 bytes are copied to the output.
+ * - c >= 0x80: a match of (c & 0x7F) + ::PBIO_LZ_MIN_MATCH bytes, followed by
+ *   a 16-bit little-endian distance d >= 1. The bytes are copied one by one
+ *   from d bytes back in the output, so a match may overlap itself.
+ *
+ * Tokens may be split at any point between chunks.
+ * @{
+ */
+
+#ifndef _PBIO_LZ_H_
+#define _PBIO_LZ_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <pbio/error.h>
+
+/**
+ * Length of the shortest match. Shorter matches are stored as literals.
+ */
+#define PBIO_LZ_MIN_MATCH (3)
+
+/**
+ * Length of the longest match.
+ */
+#define PBIO_LZ_MAX_MATCH (0x7F + PBIO_LZ_MIN_MATCH)
+
+/**
+ * Length of the longest literal run.
+ */
+#define PBIO_LZ_MAX_LITERAL (0x80)
+
+/**
+ * Largest distance a match can refer back to.
+ */
+#define PBIO_LZ_MAX_DISTANCE (0xFFFF)
+
+/**
+ * State of an LZ decoder.
+ */
+typedef struct _pbio_lz_decoder_t {
+    /** Output buffer. */
+    uint8_t *out;
+    /** Size of the output buffer. */
+    uint32_t out_size;
+    /** Number of bytes decoded so far. */
+    uint32_t size;
+    /** Distance of the match being parsed. */
+    uint16_t distance;
+    /** Remaining literal bytes, or the length of the match being parsed. */
+    uint8_t count;
+    /** What the next byte of the stream is. */
+    uint8_t state;
+} pbio_lz_decoder_t;
+
+void pbio_lz_decoder_init(pbio_lz_decoder_t *decoder, uint8_t *out, uint32_t out_size);
+pbio_error_t pbio_lz_decoder_write(pbio_lz_decoder_t *decoder, const uint8_t *data, uint32_t size);
+bool pbio_lz_decoder_is_complete(const pbio_lz_decoder_t *decoder);
+
+#endif // _PBIO_LZ_H_
+
+/** @} */
@@ -11,6 +11,9 @@
 #ifndef _PBIO_MOTOR_PROCESS_H_
 #define _PBIO_MOTOR_PROCESS_H_
 
+#include <stddef.h>
+#include <stdint.h>
+
 #include <pbio/config.h>
 
 #if PBIO_CONFIG_MOTOR_PROCESS
@@ -29,6 +32,79 @@ static inline void pbio_motor_process_start(void) {
 
 #endif // PBIO_CONFIG_MOTOR_PROCESS
 
+/** Number of bins in the loop period jitter histogram. */
+#define PBIO_MOTOR_PROCESS_STATS_JITTER_NUM_BINS (8)
+
+/** Width of one bin in the loop period jitter histogram (us). */
+#define PBIO_MOTOR_PROCESS_STATS_JITTER_BIN_US (250)
+
+/**
+ * Stages of one motor process update, each of which is timed separately.
+ */
+typedef enum {
+    /** Battery voltage update. */
+    PBIO_MOTOR_PROCESS_STAGE_BATTERY,
+    /** Drivebase control updates. */
+    PBIO_MOTOR_PROCESS_STAGE_DRIVEBASE,
+    /** Servo state and control updates. */
+    PBIO_MOTOR_PROCESS_STAGE_SERVO,
+    /** Total number of stages. */
+    PBIO_MOTOR_PROCESS_NUM_STAGES,
+} pbio_motor_process_stage_t;
+
+/**
+ * Execution time statistics of one stage of the motor process.
+ */
+typedef struct _pbio_motor_process_stage_stats_t {
+    /** Shortest execution time (us). */
+    uint32_t time_min;
+    /** Longest execution time (us). */
+    uint32_t time_max;
+    /** Sum of all execution times, used to compute the mean (us). */
+    uint64_t time_total;
+    /** Number of times this stage was executed. */
+    uint32_t count;
+} pbio_motor_process_stage_stats_t;
+
+/**
+ * Timing statistics of the motor process.
+ */
+typedef struct _pbio_motor_process_stats_t {
+    /** Execution time statistics per stage. */
+    pbio_motor_process_stage_stats_t stages[PBIO_MOTOR_PROCESS_NUM_STAGES];
+    /**
+     * Histogram of the absolute difference between the measured loop period
+     * and the configured loop time. Each bin is
+     * ::PBIO_MOTOR_PROCESS_STATS_JITTER_BIN_US wide. The last bin also counts
+     * all larger deviations.
+     */
+    uint32_t jitter_histogram[PBIO_MOTOR_PROCESS_STATS_JITTER_NUM_BINS];
+    /**
+     * Number of times the update was delayed by at least two loop periods, so
+     * that the loop timer had to catch up.
+     */
+    uint32_t overruns;
+} pbio_motor_process_stats_t;
+
+#if PBIO_CONFIG_MOTOR_PROCESS && PBIO_CONFIG_MOTOR_PROCESS_STATS
+
+const pbio_motor_process_stats_t *pbio_motor_process_get_stats(void);
+void pbio_motor_process_reset_stats(void);
+uint32_t pbio_motor_process_get_stage_time_mean(pbio_motor_process_stage_t stage);
+
+#else
+
+static inline const pbio_motor_process_stats_t *pbio_motor_process_get_stats(void) {
+    return NULL;
+}
+static inline void pbio_motor_process_reset_stats(void) {
+}
+static inline uint32_t pbio_motor_process_get_stage_time_mean(pbio_motor_process_stage_t stage) {
+    return 0;
+}
+
+#endif // PBIO_CONFIG_MOTOR_PROCESS && PBIO_CONFIG_MOTOR_PROCESS_STATS
+
 #endif // _PBIO_MOTOR_PROCESS_H_
 
 /** @} */
@@ -42,8 +42,56 @@ typedef struct _pbio_observer_model_t {
     int32_t d_torque_d_speed;
     int32_t d_torque_d_acceleration;
     int32_t torque_friction;
+    #if PBIO_CONFIG_CONTROL_LOOP_TIME_ADJUSTABLE
+    /**
+     * Nonzero entries of the continuous time model, other than the angle
+     * derivative. This is used to discretize the model for other loop times.
+     */
+    float phi_speed_current;
+    float phi_current_speed;
+    float phi_current_current;
+    float gam_speed_torque;
+    float gam_current_voltage;
+    #endif
 } pbio_observer_model_t;
 
+/**
+ * Model constants prepared for use in the control loop.
+ *
+ * Each value is the prescaler of the input divided by the matching model
+ * constant, scaled by 2^24. This replaces a division by a multiplication,
+ * which is much faster on hubs without a hardware divider.
+ *
+ * The model is defined for the default loop time. For other loop times, the
+ * model is discretized again for the model step time.
+ */
+typedef struct _pbio_observer_coefficients_t {
+    int32_t angle_speed;
+    int32_t speed_speed;
+    int32_t current_speed;
+    int32_t angle_current;
+    int32_t speed_current;
+    int32_t current_current;
+    int32_t angle_voltage;
+    int32_t speed_voltage;
+    int32_t current_voltage;
+    int32_t angle_torque;
+    int32_t speed_torque;
+    int32_t current_torque;
+    int32_t voltage_torque;
+    int32_t torque_voltage;
+    int32_t torque_speed;
+    int32_t torque_acceleration;
+    /**
+     * Loop time (ms) for which the coefficients were computed.
+     */
+    uint32_t loop_time;
+    /**
+     * Number of model steps per loop.
+     */
+    uint32_t num_steps;
+} pbio_observer_coefficients_t;
+
 /**
  * Configurable observer settings.
  */
@@ -123,6 +171,10 @@ typedef struct _pbio_observer_t {
      * Model parameters used by this model.
      */
     const pbio_observer_model_t *model;
+    /**
+     * Model constants prepared for fast evaluation, computed from the model.
+     */
+    pbio_observer_coefficients_t coefficients;
     /**
      * Control settings, which includes stall settings.
      */
@@ -131,18 +183,20 @@ typedef struct _pbio_observer_t {
 
 // Observer state functions:
 
+void pbio_observer_set_model(pbio_observer_t *obs, const pbio_observer_model_t *model);
 void pbio_observer_reset(pbio_observer_t *obs, const pbio_angle_t *angle);
 void pbio_observer_get_estimated_state(const pbio_observer_t *obs, int32_t *speed_num, pbio_angle_t *angle_est, int32_t *speed_est);
 void pbio_observer_update(pbio_observer_t *obs, uint32_t time, const pbio_angle_t *angle, pbio_dcmotor_actuation_t actuation, int32_t voltage);
+void pbio_observer_update_passive(pbio_observer_t *obs, const pbio_angle_t *angle);
 bool pbio_observer_is_stalled(const pbio_observer_t *obs, uint32_t time, uint32_t *stall_duration);
 int32_t pbio_observer_get_feedback_voltage(const pbio_observer_t *obs, const pbio_angle_t *angle);
 
 // Model conversion functions:
 
 int32_t pbio_observer_get_max_torque(void);
-int32_t pbio_observer_get_feedforward_torque(const pbio_observer_model_t *model, int32_t rate_ref, int32_t acceleration_ref);
-int32_t pbio_observer_torque_to_voltage(const pbio_observer_model_t *model, int32_t desired_torque);
-int32_t pbio_observer_voltage_to_torque(const pbio_observer_model_t *model, int32_t voltage);
+int32_t pbio_observer_get_feedforward_torque(const pbio_observer_t *obs, int32_t rate_ref, int32_t acceleration_ref);
+int32_t pbio_observer_torque_to_voltage(const pbio_observer_t *obs, int32_t desired_torque);
+int32_t pbio_observer_voltage_to_torque(const pbio_observer_t *obs, int32_t voltage);
 
 #endif // _PBIO_OBSERVER_H_
 
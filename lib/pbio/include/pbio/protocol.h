@@ -24,7 +24,7 @@
 #define PBIO_PROTOCOL_VERSION_MAJOR 1
 
 /** The minor version number for the protocol. */
-#define PBIO_PROTOCOL_VERSION_MINOR 3
+#define PBIO_PROTOCOL_VERSION_MINOR 5
 
 /** The patch version number for the protocol. */
 #define PBIO_PROTOCOL_VERSION_PATCH 0
@@ -122,6 +122,87 @@ typedef enum {
      * @since Pybricks Profile v1.3.0
      */
     PBIO_PYBRICKS_COMMAND_WRITE_STDIN = 6,
+
+    /**
+     * Requests to write compressed user program data to user RAM.
+     *
+     * The data is decompressed into user RAM as it arrives, starting at the
+     * user RAM base address. See @ref LZ for the format of the stream.
+     *
+     * Parameters:
+     * - offset: The offset in the compressed stream (32-bit little-endian
+     *   unsigned integer). This must be 0 for the first chunk, which starts
+     *   a new stream, and the total size of the previous chunks thereafter.
+     * - payload: The compressed data (0 to 507 bytes).
+     *
+     * Errors:
+     * - ::PBIO_PYBRICKS_ERROR_BUSY if the user program is running.
+     * - ::PBIO_PYBRICKS_ERROR_VALUE_NOT_ALLOWED if the offset is missing, if
+     *   a chunk is missing, or if the stream is invalid or does not fit.
+     *   Start again at offset 0.
+     *
+     * @since Pybricks Profile v1.5.0
+     */
+    PBIO_PYBRICKS_COMMAND_WRITE_USER_RAM_COMPRESSED = 7,
+
+    /**
+     * Requests to write user program metadata, checking the program first.
+     *
+     * This is like ::PBIO_PYBRICKS_COMMAND_WRITE_USER_PROGRAM_META, but the
+     * program is only accepted if its CRC-32 matches. This works for both
+     * compressed and uncompressed downloads.
+     *
+     * Parameters:
+     * - size: The size of the user program in bytes (32-bit little-endian unsigned integer).
+     * - crc32: The CRC-32 of the user program (32-bit little-endian unsigned integer),
+     *   as computed by zlib.
+     *
+     * Errors:
+     * - ::PBIO_PYBRICKS_ERROR_BUSY if the user program is running.
+     * - ::PBIO_PYBRICKS_ERROR_VALUE_NOT_ALLOWED if a parameter is missing.
+     * - ::PBIO_PYBRICKS_ERROR_VALUE_NOT_ALLOWED if the size is invalid or the
+     *   CRC-32 does not match. The program is then erased so it can't be started.
+     *
+     * @since Pybricks Profile v1.5.0
+     */
+    PBIO_PYBRICKS_COMMAND_WRITE_USER_PROGRAM_META_CRC = 8,
+
+    /**
+     * Requests the CRC-32 of each module of the user program in user RAM.
+     *
+     * The hub replies with a ::PBIO_PYBRICKS_EVENT_USER_PROGRAM_MODULES event.
+     * Together with ::PBIO_PYBRICKS_COMMAND_KEEP_USER_PROGRAM_MODULES, this
+     * lets the host download only the modules that changed.
+     *
+     * Parameters:
+     * - index: Index of the first module (16-bit little-endian unsigned integer).
+     *
+     * Errors:
+     * - ::PBIO_PYBRICKS_ERROR_BUSY if the previous reply has not been sent yet.
+     * - ::PBIO_PYBRICKS_ERROR_VALUE_NOT_ALLOWED if the index is missing.
+     *
+     * @since Pybricks Profile v1.5.0
+     */
+    PBIO_PYBRICKS_COMMAND_READ_USER_PROGRAM_MODULES = 9,
+
+    /**
+     * Requests to keep only some modules of the user program in user RAM.
+     *
+     * The kept modules are moved to the start of user RAM in their original
+     * order and the program size is set to their total size. The host can
+     * then write the new and changed modules after them using
+     * ::PBIO_PYBRICKS_COMMAND_WRITE_USER_RAM, and set the new program size.
+     *
+     * Parameters:
+     * - keep: Bit map of modules to keep (0 to 508 bytes). Bit i % 8 of byte
+     *   i / 8 is set to keep module i. Modules beyond the bit map are removed.
+     *
+     * Errors:
+     * - ::PBIO_PYBRICKS_ERROR_BUSY if the user program is running.
+     *
+     * @since Pybricks Profile v1.5.0
+     */
+    PBIO_PYBRICKS_COMMAND_KEEP_USER_PROGRAM_MODULES = 10,
 } pbio_pybricks_command_t;
 
 /**
@@ -179,6 +260,33 @@ typedef enum {
      * @since Pybricks Profile v1.3.0
      */
     PBIO_PYBRICKS_EVENT_WRITE_STDOUT = 1,
+
+    /**
+     * Data written to a streaming log event.
+     *
+     * The payload is a variable number of bytes from the log stream. Rows may
+     * be split across several events. Each row is an 8-bit unsigned integer
+     * with the number of values in the row, followed by that many 32-bit
+     * little-endian signed integers. The first value is the time in
+     * milliseconds since the log was started.
+     *
+     * @since Pybricks Profile v1.4.0
+     */
+    PBIO_PYBRICKS_EVENT_WRITE_LOG = 2,
+
+    /**
+     * CRC-32 of the modules of the user program, in reply to
+     * ::PBIO_PYBRICKS_COMMAND_READ_USER_PROGRAM_MODULES.
+     *
+     * The payload is the index of the first module and the total number of
+     * modules in the program (16-bit little-endian unsigned integers),
+     * followed by the CRC-32 of as many modules as fit (32-bit little-endian
+     * unsigned integers). Each CRC-32 covers the whole module: its 32-bit
+     * size, its zero-terminated name and its data.
+     *
+     * @since Pybricks Profile v1.5.0
+     */
+    PBIO_PYBRICKS_EVENT_USER_PROGRAM_MODULES = 3,
 } pbio_pybricks_event_t;
 
 /**
@@ -283,6 +391,21 @@ typedef enum {
      * @since Pybricks Profile v1.3.0.
      */
     PBIO_PYBRICKS_FEATURE_USER_PROG_FORMAT_MULTI_MPY_V6_1_NATIVE = 1 << 2,
+    /**
+     * Hub supports compressed user program downloads and checking them with
+     * a CRC-32.
+     *
+     * @since Pybricks Profile v1.5.0.
+     */
+    PBIO_PYBRICKS_FEATURE_USER_PROG_COMPRESSED = 1 << 3,
+    /**
+     * Hub supports reading the CRC-32 of each module of the user program and
+     * keeping only some of them, so that only changed modules need to be
+     * downloaded.
+     *
+     * @since Pybricks Profile v1.5.0.
+     */
+    PBIO_PYBRICKS_FEATURE_USER_PROG_MODULES = 1 << 4,
 } pbio_pybricks_feature_flags_t;
 
 void pbio_pybricks_hub_capabilities(uint8_t *buf,
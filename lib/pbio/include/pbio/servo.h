@@ -85,6 +85,10 @@ typedef struct _pbio_servo_t {
      * occur.
      */
     bool run_update_loop;
+    /**
+     * Next servo in the list of servos whose update loop is running.
+     */
+    struct _pbio_servo_t *next_active;
 } pbio_servo_t;
 
 /**
@@ -165,6 +169,8 @@ pbio_error_t pbio_servo_run_time(pbio_servo_t *srv, int32_t speed, uint32_t dura
 pbio_error_t pbio_servo_run_until_stalled(pbio_servo_t *srv, int32_t speed, int32_t torque_limit, pbio_control_on_completion_t on_completion);
 pbio_error_t pbio_servo_run_angle(pbio_servo_t *srv, int32_t speed, int32_t angle, pbio_control_on_completion_t on_completion);
 pbio_error_t pbio_servo_run_target(pbio_servo_t *srv, int32_t speed, int32_t target, pbio_control_on_completion_t on_completion);
+pbio_error_t pbio_servo_run_target_synchronized(pbio_servo_t *const *srv, uint8_t num_servos, int32_t speed, const int32_t *targets, pbio_control_on_completion_t on_completion);
+pbio_error_t pbio_servo_queue_target(pbio_servo_t *srv, int32_t speed, int32_t target, pbio_control_on_completion_t on_completion);
 pbio_error_t pbio_servo_track_target(pbio_servo_t *srv, int32_t target);
 /**@}*/
 
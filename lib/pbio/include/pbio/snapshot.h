@@ -0,0 +1,62 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2023 The Pybricks Authors
+
+/**
+ * @addtogroup Snapshot pbio/snapshot: Snapshot of several ports at once
+ *
+ * Reads the values of several devices and the IMU in one go, all at the same
+ * time. This is faster than reading them one by one, and the values are
+ * guaranteed to belong together.
+ * @{
+ */
+
+#ifndef _PBIO_SNAPSHOT_H_
+#define _PBIO_SNAPSHOT_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <pbio/config.h>
+#include <pbio/error.h>
+#include <pbio/port.h>
+
+/**
+ * Number of values added to a snapshot by a motor that is being controlled:
+ * the angle (deg) and speed (deg/s).
+ */
+#define PBIO_SNAPSHOT_NUM_MOTOR_VALUES (2)
+
+/**
+ * Number of values added to a snapshot by the IMU: the heading (deg), the
+ * angular velocity (deg/s) around x, y, z, and the acceleration (mm/s^2)
+ * along x, y, z.
+ */
+#define PBIO_SNAPSHOT_NUM_IMU_VALUES (7)
+
+/**
+ * Values of several ports and the IMU at one point in time.
+ */
+typedef struct _pbio_snapshot_t {
+    /** Time at which the values were read (ms). */
+    uint32_t time;
+    /** Number of values. */
+    uint8_t num_values;
+    /** Values of each port in the requested order, followed by the IMU. */
+    int32_t values[PBIO_CONFIG_SNAPSHOT_NUM_VALUES];
+} pbio_snapshot_t;
+
+#if PBIO_CONFIG_SNAPSHOT
+
+pbio_error_t pbio_snapshot_take(pbio_snapshot_t *snapshot, const pbio_port_id_t *ports, uint8_t num_ports, bool imu);
+
+#else // PBIO_CONFIG_SNAPSHOT
+
+static inline pbio_error_t pbio_snapshot_take(pbio_snapshot_t *snapshot, const pbio_port_id_t *ports, uint8_t num_ports, bool imu) {
+    return PBIO_ERROR_NOT_SUPPORTED;
+}
+
+#endif // PBIO_CONFIG_SNAPSHOT
+
+#endif // _PBIO_SNAPSHOT_H_
+
+/** @} */
@@ -14,9 +14,11 @@
 #ifndef _PBIO_TRAJECTORY_H_
 #define _PBIO_TRAJECTORY_H_
 
+#include <stdbool.h>
 #include <stdint.h>
 
 #include <pbio/angle.h>
+#include <pbio/config.h>
 #include <pbio/error.h>
 
 // Trajectories use sub-millisecond steps for increased resolution.
@@ -28,6 +30,24 @@
 // acceleration part of the maneuver.
 #define PBIO_TRAJECTORY_DURATION_FOREVER_MS (5 * 60 * 1000)
 
+/**
+ * Shape of the speed profile during acceleration and deceleration.
+ */
+typedef enum {
+    /**
+     * Speed changes at constant acceleration, giving a trapezoidal speed
+     * profile. Acceleration changes in steps between the phases.
+     */
+    PBIO_TRAJECTORY_PROFILE_TRAPEZOID = 0,
+    /**
+     * Speed changes along a smooth S-curve. Acceleration rises from zero to
+     * the configured value during the first quarter of each phase, and falls
+     * back to zero during the last quarter. The mean acceleration is 3/4 of
+     * the configured value, so each phase takes 4/3 as long as a trapezoid.
+     */
+    PBIO_TRAJECTORY_PROFILE_S_CURVE = 1,
+} pbio_trajectory_profile_t;
+
 /**
  * Minimal set of trajectory parameters from which a full trajectory is
  * calculated. All values in control units and time in ticks.
@@ -43,6 +63,7 @@ typedef struct _pbio_trajectory_command_t {
     int32_t acceleration;          /**<  Encoder acceleration magnitude during in-phase */
     int32_t deceleration;          /**<  Encoder acceleration magnitude during out-phase */
     bool continue_running;         /**<  Whether it movement continues after t3 (true) or not (false) */
+    pbio_trajectory_profile_t profile; /**<  Shape of acceleration and deceleration phases */
 } pbio_trajectory_command_t;
 
 /**
@@ -55,6 +76,37 @@ typedef struct _pbio_trajectory_reference_t {
     int32_t acceleration;   /**<  Reference acceleration */
 } pbio_trajectory_reference_t;
 
+/**
+ * State for evaluating a trajectory incrementally, one control loop step
+ * after the other. Each value is stored as an integer part and a nonnegative
+ * remainder, so that no precision is lost and no divisions are needed for
+ * steps of one control loop. Per-tick differences allow other steps too.
+ */
+typedef struct _pbio_trajectory_incremental_t {
+    bool valid;             /**<  Whether the state matches the last evaluated time */
+    uint8_t segment;        /**<  Index of the segment (0 to 3) containing the last evaluated time */
+    int32_t time;           /**<  Last evaluated time relative to start of trajectory */
+    int32_t step;           /**<  Time step for which the differences were computed */
+    int32_t th;             /**<  Angle relative to start of segment (mdeg) */
+    int32_t th_rem;         /**<  Remainder of th */
+    int32_t dth;            /**<  Angle increment for the next step (mdeg) */
+    int32_t dth_rem;        /**<  Remainder of dth */
+    int32_t ddth;           /**<  Change of dth per step (mdeg) */
+    int32_t ddth_rem;       /**<  Remainder of ddth */
+    int32_t dth_tick;       /**<  Angle increment for the next tick (mdeg) */
+    int32_t dth_tick_rem;   /**<  Remainder of dth_tick */
+    int32_t ddth_tick;      /**<  Change of dth_tick per tick (mdeg) */
+    int32_t ddth_tick_rem;  /**<  Remainder of ddth_tick */
+    int32_t ddth_tick_step; /**<  Change of dth_tick per step, and of dth per tick (mdeg) */
+    int32_t ddth_tick_step_rem; /**<  Remainder of ddth_tick_step */
+    int32_t dw;             /**<  Speed change relative to start of segment (ddeg/s) */
+    int32_t dw_rem;         /**<  Remainder of dw */
+    int32_t ddw;            /**<  Change of dw per step (ddeg/s) */
+    int32_t ddw_rem;        /**<  Remainder of ddw */
+    int32_t ddw_tick;       /**<  Change of dw per tick (ddeg/s) */
+    int32_t ddw_tick_rem;   /**<  Remainder of ddw_tick */
+} pbio_trajectory_incremental_t;
+
 /**
  * Complete set of motor trajectory parameters for an ideal maneuver without
  * disturbances. These values have custom units to keep them within safe
@@ -75,6 +127,13 @@ typedef struct _pbio_trajectory_t {
     int32_t w3;                          /**<  Encoder rate target after the maneuver ends */
     int32_t a0;                          /**<  Encoder acceleration during in-phase */
     int32_t a2;                          /**<  Encoder acceleration during out-phase */
+    pbio_trajectory_profile_t profile;   /**<  Shape of acceleration and deceleration phases */
+    #if PBIO_CONFIG_TRAJECTORY_S_CURVE
+    int32_t th_curve[2];                 /**<  Angle gained by the S-curve in-phase and out-phase on top of their start speed */
+    #endif
+    #if PBIO_CONFIG_TRAJECTORY_INCREMENTAL
+    pbio_trajectory_incremental_t incremental; /**<  State for evaluating the next control loop step */
+    #endif
 } pbio_trajectory_t;
 
 // Make or modify trajectories:
@@ -85,6 +144,7 @@ pbio_error_t pbio_trajectory_new_angle_command(pbio_trajectory_t *trj, const pbi
 pbio_error_t pbio_trajectory_new_time_command(pbio_trajectory_t *trj, const pbio_trajectory_command_t *command);
 void pbio_trajectory_make_constant(pbio_trajectory_t *trj, const pbio_trajectory_command_t *command);
 void pbio_trajectory_stretch(pbio_trajectory_t *trj, const pbio_trajectory_t *leader);
+void pbio_trajectory_reset_incremental(pbio_trajectory_t *trj);
 
 // Reference getter functions:
 
@@ -121,6 +121,8 @@ void pbio_set_uint32_be(uint8_t *buf, uint32_t value) {
 bool pbio_uuid128_reverse_compare(const uint8_t *uuid1, const uint8_t *uuid2);
 void pbio_uuid128_reverse_copy(uint8_t *dst, const uint8_t *src);
 
+uint32_t pbio_crc32(const uint8_t *data, uint32_t size);
+
 /**
  * Declares a new oneshot state variable.
  * @param [in]  name    The name of the variable.
@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2021-2022 The Pybricks Authors
+// Copyright (c) 2021-2023 The Pybricks Authors
 
 /**
  * @addtogroup SystemBluetooth System: Bluetooth
@@ -25,12 +25,18 @@ typedef bool (*pbsys_bluetooth_stdin_event_callback_t)(uint8_t c);
 
 #if PBSYS_CONFIG_BLUETOOTH
 
+// Size of the buffer for log data that has not been sent yet.
+#ifndef PBSYS_BLUETOOTH_LOG_BUF_SIZE
+#define PBSYS_BLUETOOTH_LOG_BUF_SIZE (256)
+#endif
+
 void pbsys_bluetooth_init(void);
 void pbsys_bluetooth_rx_set_callback(pbsys_bluetooth_stdin_event_callback_t callback);
 void pbsys_bluetooth_rx_flush(void);
 uint32_t pbsys_bluetooth_rx_get_available(void);
 pbio_error_t pbsys_bluetooth_rx(uint8_t *data, uint32_t *size);
 pbio_error_t pbsys_bluetooth_tx(const uint8_t *data, uint32_t *size);
+pbio_error_t pbsys_bluetooth_tx_log(const uint8_t *data, uint32_t size);
 bool pbsys_bluetooth_tx_is_idle(void);
 
 #else // PBSYS_CONFIG_BLUETOOTH
@@ -46,6 +52,9 @@ static inline pbio_error_t pbsys_bluetooth_rx(uint8_t *data, uint32_t *size) {
 static inline pbio_error_t pbsys_bluetooth_tx(const uint8_t *data, uint32_t *size) {
     return PBIO_ERROR_NOT_SUPPORTED;
 }
+static inline pbio_error_t pbsys_bluetooth_tx_log(const uint8_t *data, uint32_t size) {
+    return PBIO_ERROR_NOT_SUPPORTED;
+}
 static inline bool pbsys_bluetooth_tx_is_idle(void) {
     return false;
 }
@@ -14,6 +14,8 @@
 
 #include <stdint.h>
 
+#include <pbio/config.h>
+#include <pbio/imu.h>
 #include <pbsys/config.h>
 
 #if PBSYS_CONFIG_PROGRAM_LOAD
@@ -23,6 +25,13 @@
 #error "Application RAM must be at least ROM size + 2K."
 #endif
 
+/**
+ * Identifies the layout of the header below. This must be changed whenever
+ * the layout after the user data changes, so that data stored by another
+ * firmware version is not misinterpreted.
+ */
+#define PBSYS_PROGRAM_LOAD_LAYOUT_VERSION (0x50420001)
+
 /**
  * Header of loaded data. All data types are little-endian.
  */
@@ -45,6 +54,17 @@ typedef struct _pbsys_program_load_data_header_t {
      * End-user read-write accessible data.
      */
     uint8_t user_data[PBSYS_CONFIG_PROGRAM_LOAD_USER_DATA_SIZE];
+    /**
+     * Layout of the remainder of this header. The data below is discarded if
+     * this is not ::PBSYS_PROGRAM_LOAD_LAYOUT_VERSION.
+     */
+    uint32_t layout_version;
+    #if PBIO_CONFIG_IMU
+    /**
+     * IMU calibration, so it need not be repeated every time the hub starts.
+     */
+    pbio_imu_persistent_settings_t imu_settings;
+    #endif
     /**
      * Size of the application program (size of code only).
      */
@@ -0,0 +1,69 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2023 The Pybricks Authors
+
+/**
+ * @addtogroup SysProgramModules System: Modules of user programs.
+ *
+ * A user program consists of one or more modules stored back to back. Each
+ * module has a 32-bit little-endian size of its data, followed by its
+ * zero-terminated name, followed by the data itself (e.g. an .mpy file).
+ *
+ * @{
+ */
+
+#ifndef _PBSYS_PROGRAM_MODULES_H_
+#define _PBSYS_PROGRAM_MODULES_H_
+
+#include <stdint.h>
+
+#include <pbio/error.h>
+
+/**
+ * One module of a user program.
+ */
+typedef struct _pbsys_program_module_t {
+    /** Zero-terminated name of the module. */
+    const char *name;
+    /** Data of the module. */
+    const uint8_t *data;
+    /** Size of @p data. */
+    uint32_t data_size;
+    /** Size of the whole module, including the size and name. */
+    uint32_t size;
+} pbsys_program_module_t;
+
+/**
+ * Entry of a module index.
+ */
+typedef struct _pbsys_program_modules_index_entry_t {
+    /** Hash of the module name. */
+    uint32_t hash;
+    /** Offset of the module in the program. */
+    uint32_t offset;
+} pbsys_program_modules_index_entry_t;
+
+/**
+ * Index of the modules of a user program, sorted by the hash of their names.
+ */
+typedef struct _pbsys_program_modules_index_t {
+    /** The user program. */
+    const uint8_t *program;
+    /** Size of the user program. */
+    uint32_t program_size;
+    /** Index entries, or NULL if the program is searched without index. */
+    pbsys_program_modules_index_entry_t *entries;
+    /** Number of index entries. */
+    uint32_t num_entries;
+} pbsys_program_modules_index_t;
+
+pbio_error_t pbsys_program_modules_get(const uint8_t *program, uint32_t program_size, uint32_t offset, pbsys_program_module_t *module);
+uint32_t pbsys_program_modules_get_hashes(const uint8_t *program, uint32_t program_size, uint32_t first, uint8_t *buf, uint32_t *size);
+uint32_t pbsys_program_modules_keep(uint8_t *program, uint32_t program_size, const uint8_t *keep, uint32_t keep_size);
+uint32_t pbsys_program_modules_count(const uint8_t *program, uint32_t program_size);
+void pbsys_program_modules_index_init(pbsys_program_modules_index_t *index, const uint8_t *program, uint32_t program_size,
+    pbsys_program_modules_index_entry_t *entries, uint32_t num_modules);
+pbio_error_t pbsys_program_modules_find(const pbsys_program_modules_index_t *index, const char *name, pbsys_program_module_t *module);
+
+#endif // _PBSYS_PROGRAM_MODULES_H_
+
+/** @} */
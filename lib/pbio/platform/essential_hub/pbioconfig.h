@@ -4,18 +4,26 @@
 #define PBIO_CONFIG_BATTERY                 (1)
 #define PBIO_CONFIG_DCMOTOR                 (1)
 #define PBIO_CONFIG_DCMOTOR_NUM_DEV         (2)
+#define PBIO_CONFIG_DRIVEBASE_FOLLOW        (1)
+#define PBIO_CONFIG_DRIVEBASE_POSE          (1)
+#define PBIO_CONFIG_DRIVEBASE_SLIP          (1)
 #define PBIO_CONFIG_DRIVEBASE_SPIKE         (1)
 #define PBIO_CONFIG_IMU                     (1)
 #define PBIO_CONFIG_LIGHT                   (1)
 #define PBIO_CONFIG_LOGGER                  (1)
 #define PBIO_CONFIG_LIGHT_MATRIX            (0)
 #define PBIO_CONFIG_MOTOR_PROCESS           (1)
+#define PBIO_CONFIG_MOTOR_PROCESS_STATS     (1)
 #define PBIO_CONFIG_SERVO                   (1)
 #define PBIO_CONFIG_SERVO_NUM_DEV           (2)
 #define PBIO_CONFIG_SERVO_EV3_NXT           (0)
 #define PBIO_CONFIG_SERVO_PUP               (1)
 #define PBIO_CONFIG_SERVO_PUP_MOVE_HUB      (0)
+#define PBIO_CONFIG_SNAPSHOT                (1)
 #define PBIO_CONFIG_TACHO                   (1)
+#define PBIO_CONFIG_CONTROL_QUEUE_SIZE      (4)
+#define PBIO_CONFIG_DRIVEBASE_PATH_SIZE     (16)
+#define PBIO_CONFIG_TRAJECTORY_S_CURVE      (1)
 
 #define PBIO_CONFIG_UARTDEV                 (1)
 #define PBIO_CONFIG_UARTDEV_NUM_DEV         (2)
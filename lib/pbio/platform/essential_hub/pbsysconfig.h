@@ -3,6 +3,8 @@
 
 #define PBSYS_CONFIG_BATTERY_CHARGER                (1)
 #define PBSYS_CONFIG_BLUETOOTH                      (1)
+#define PBSYS_CONFIG_BLUETOOTH_STDIN_BUF_SIZE       (1024)
+#define PBSYS_CONFIG_BLUETOOTH_STDOUT_BUF_SIZE      (2048)
 #define PBSYS_CONFIG_HUB_LIGHT_MATRIX               (0)
 #define PBSYS_CONFIG_MAIN                           (1)
 #define PBSYS_CONFIG_PROGRAM_LOAD                   (1)
@@ -4,6 +4,9 @@
 #define PBIO_CONFIG_BATTERY                 (1)
 #define PBIO_CONFIG_DCMOTOR                 (1)
 #define PBIO_CONFIG_DCMOTOR_NUM_DEV         (4)
+#define PBIO_CONFIG_DRIVEBASE_FOLLOW        (0)
+#define PBIO_CONFIG_DRIVEBASE_POSE          (1)
+#define PBIO_CONFIG_DRIVEBASE_SLIP          (0)
 #define PBIO_CONFIG_DRIVEBASE_SPIKE         (0)
 #define PBIO_CONFIG_EV3_INPUT_DEVICE        (1)
 #define PBIO_CONFIG_IMU                     (0)
@@ -16,7 +19,12 @@
 #define PBIO_CONFIG_SERVO_EV3_NXT           (1)
 #define PBIO_CONFIG_SERVO_PUP               (0)
 #define PBIO_CONFIG_SERVO_PUP_MOVE_HUB      (0)
+#define PBIO_CONFIG_SNAPSHOT                (1)
 #define PBIO_CONFIG_TACHO                   (1)
+#define PBIO_CONFIG_CONTROL_QUEUE_SIZE      (4)
+#define PBIO_CONFIG_DRIVEBASE_PATH_SIZE     (16)
+#define PBIO_CONFIG_DRIVEBASE_NUM_WHEELS    (4)
+#define PBIO_CONFIG_TRAJECTORY_S_CURVE      (1)
 
 // On ev3dev, we can't keep up with a 5 ms loop.
 #define PBIO_CONFIG_CONTROL_LOOP_TIME_MS    (10)
@@ -5,6 +5,9 @@
 #define PBIO_CONFIG_DCMOTOR                 (1)
 #define PBIO_CONFIG_DCMOTOR_NUM_DEV         (4)
 #define PBIO_CONFIG_DIFFERENTIATOR_BUFFER_SIZE (21) // Must be > PBIO_CONFIG_DIFFERENTIATOR_WINDOW_SIZE
+#define PBIO_CONFIG_DRIVEBASE_FOLLOW        (0)
+#define PBIO_CONFIG_DRIVEBASE_POSE          (0)
+#define PBIO_CONFIG_DRIVEBASE_SLIP          (0)
 #define PBIO_CONFIG_DRIVEBASE_SPIKE         (0)
 #define PBIO_CONFIG_IMU                     (0)
 #define PBIO_CONFIG_LIGHT                   (1)
@@ -15,8 +18,10 @@
 #define PBIO_CONFIG_SERVO_EV3_NXT           (0)
 #define PBIO_CONFIG_SERVO_PUP               (1)
 #define PBIO_CONFIG_SERVO_PUP_MOVE_HUB      (1)
+#define PBIO_CONFIG_SNAPSHOT                (0)
 #define PBIO_CONFIG_TACHO                   (1)
 #define PBIO_CONFIG_CONTROL_MINIMAL         (1)
+#define PBIO_CONFIG_TRAJECTORY_INCREMENTAL  (1)
 
 #define PBIO_CONFIG_UARTDEV                 (0)
 #define PBIO_CONFIG_UARTDEV_NUM_DEV         (2)
@@ -4,6 +4,9 @@
 #define PBIO_CONFIG_BATTERY                 (1)
 #define PBIO_CONFIG_DCMOTOR                 (1)
 #define PBIO_CONFIG_DCMOTOR_NUM_DEV         (3)
+#define PBIO_CONFIG_DRIVEBASE_FOLLOW        (1)
+#define PBIO_CONFIG_DRIVEBASE_POSE          (1)
+#define PBIO_CONFIG_DRIVEBASE_SLIP          (0)
 #define PBIO_CONFIG_DRIVEBASE_SPIKE         (0)
 #define PBIO_CONFIG_IMU                     (0)
 #define PBIO_CONFIG_LIGHT                   (0)
@@ -14,7 +17,11 @@
 #define PBIO_CONFIG_SERVO_EV3_NXT           (1)
 #define PBIO_CONFIG_SERVO_PUP               (0)
 #define PBIO_CONFIG_SERVO_PUP_MOVE_HUB      (0)
+#define PBIO_CONFIG_SNAPSHOT                (0)
 #define PBIO_CONFIG_TACHO                   (1)
+#define PBIO_CONFIG_CONTROL_QUEUE_SIZE      (4)
+#define PBIO_CONFIG_DRIVEBASE_PATH_SIZE     (16)
+#define PBIO_CONFIG_TRAJECTORY_S_CURVE      (1)
 
 #define PBIO_CONFIG_UARTDEV                 (0)
 #define PBIO_CONFIG_UARTDEV_NUM_DEV         (0)
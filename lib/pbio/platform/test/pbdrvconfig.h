@@ -8,12 +8,17 @@
 #define PBDRV_CONFIG_BUTTON_TEST                    (1)
 
 #define PBDRV_CONFIG_BLUETOOTH                      (1)
+#define PBDRV_CONFIG_BLUETOOTH_MAX_MTU_SIZE         515
 #define PBDRV_CONFIG_BLUETOOTH_BTSTACK              (1)
 #define PBDRV_CONFIG_BLUETOOTH_BTSTACK_HUB_KIND     0xff
 
 #define PBDRV_CONFIG_CLOCK                          (1)
 #define PBDRV_CONFIG_CLOCK_TEST                     (1)
 
+#define PBDRV_CONFIG_IMU                            (1)
+#define PBDRV_CONFIG_IMU_TEST                       (1)
+#define PBDRV_CONFIG_IMU_TEST_AUTO_START            (0)
+
 #define PBDRV_CONFIG_LED                            (1)
 #define PBDRV_CONFIG_LED_NUM_DEV                    (0)
 
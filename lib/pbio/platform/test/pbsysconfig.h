@@ -2,6 +2,7 @@
 // Copyright (c) 2020-2023 The Pybricks Authors
 
 #define PBSYS_CONFIG_BLUETOOTH                      (1)
+#define PBSYS_CONFIG_BLUETOOTH_STDOUT_BUF_SIZE      (1024)
 #define PBSYS_CONFIG_HUB_LIGHT_MATRIX               (1)
 #define PBSYS_CONFIG_MAIN                           (0)
 #define PBSYS_CONFIG_PROGRAM_LOAD                   (0)
@@ -11,6 +11,10 @@
 #define PBDRV_CONFIG_CLOCK_LINUX                            (1)
 #define PBDRV_CONFIG_CLOCK_LINUX_SIGNAL                     (1)
 
+#define PBDRV_CONFIG_IMU                                    (1)
+#define PBDRV_CONFIG_IMU_TEST                               (1)
+#define PBDRV_CONFIG_IMU_TEST_AUTO_START                    (1)
+
 #define PBDRV_CONFIG_LEGODEV                                (1)
 #define PBDRV_CONFIG_LEGODEV_MODE_INFO                      (1)
 #define PBDRV_CONFIG_LEGODEV_VIRTUAL                        (1)
@@ -90,6 +90,26 @@ static bool pbio_control_status_test(const pbio_control_t *ctl, pbio_control_sta
     return ctl->status & flag;
 }
 
+#if PBIO_CONFIG_CONTROL_QUEUE_SIZE
+
+static void pbio_control_queue_clear(pbio_control_t *ctl) {
+    ctl->queue_first = 0;
+    ctl->queue_size = 0;
+}
+
+static bool pbio_control_queue_start_next(pbio_control_t *ctl, uint32_t time_now, const pbio_control_state_t *state);
+
+#else
+
+static inline void pbio_control_queue_clear(pbio_control_t *ctl) {
+}
+
+static inline bool pbio_control_queue_start_next(pbio_control_t *ctl, uint32_t time_now, const pbio_control_state_t *state) {
+    return false;
+}
+
+#endif // PBIO_CONFIG_CONTROL_QUEUE_SIZE
+
 static bool pbio_control_check_completion(const pbio_control_t *ctl, uint32_t time, const pbio_control_state_t *state, const pbio_trajectory_reference_t *end) {
 
     // If no control is active, then all targets are complete.
@@ -341,8 +361,16 @@ void pbio_control_update(
     pbio_control_status_set(ctl, PBIO_CONTROL_STATUS_COMPLETE,
         pbio_control_check_completion(ctl, ref->time, state, &ref_end));
 
+    // If the command is complete and there are more in the queue, start the
+    // next one right away. This clears the complete status, so we keep
+    // actuating without stopping or returning to the user in between.
+    if (pbio_control_status_test(ctl, PBIO_CONTROL_STATUS_COMPLETE)) {
+        pbio_control_queue_start_next(ctl, time_now, state);
+    }
+
     // Save (low-pass filtered) load for diagnostics
-    ctl->pid_average = (ctl->pid_average * (100 - PBIO_CONFIG_CONTROL_LOOP_TIME_MS) + torque * PBIO_CONFIG_CONTROL_LOOP_TIME_MS) / 100;
+    uint32_t loop_time = pbio_control_settings_get_loop_time();
+    ctl->pid_average = (ctl->pid_average * (int32_t)(100 - loop_time) + torque * (int32_t)loop_time) / 100;
 
     // Decide actuation based on control status.
     if (// Not on target yet, so keep actuating.
@@ -421,6 +449,7 @@ void pbio_control_update(
  * @param [in]  ctl         Control status structure.
  */
 void pbio_control_stop(pbio_control_t *ctl) {
+    pbio_control_queue_clear(ctl);
     ctl->type = PBIO_CONTROL_TYPE_NONE;
     pbio_control_status_set(ctl, PBIO_CONTROL_STATUS_COMPLETE, true);
     pbio_control_status_set(ctl, PBIO_CONTROL_STATUS_STALLED, false);
@@ -506,6 +535,7 @@ static pbio_error_t _pbio_control_start_position_control(pbio_control_t *ctl, ui
         .acceleration = ctl->settings.acceleration,
         .deceleration = ctl->settings.deceleration,
         .continue_running = on_completion == PBIO_CONTROL_ON_COMPLETION_CONTINUE,
+        .profile = ctl->settings.profile,
     };
 
 
@@ -583,6 +613,131 @@ static pbio_error_t _pbio_control_start_position_control(pbio_control_t *ctl, ui
     return PBIO_SUCCESS;
 }
 
+#if PBIO_CONFIG_CONTROL_QUEUE_SIZE
+
+/**
+ * Checks if a motion through @p via continues in the same direction.
+ *
+ * @param [in]  start       Where the motion starts.
+ * @param [in]  via         Intermediate target.
+ * @param [in]  end         Final target.
+ * @return                  True if both parts move in the same direction.
+ */
+static bool pbio_control_queue_is_same_direction(const pbio_angle_t *start, const pbio_angle_t *via, const pbio_angle_t *end) {
+    int32_t direction = pbio_int_math_sign(pbio_angle_diff_mdeg(via, start));
+    return direction != 0 && direction == pbio_int_math_sign(pbio_angle_diff_mdeg(end, via));
+}
+
+/**
+ * Starts the next queued position command, if there is one.
+ *
+ * The new trajectory branches off from the current reference. If the
+ * previous command passed its target at speed, the motor keeps moving.
+ *
+ * @param [in]  ctl            The control instance.
+ * @param [in]  time_now       The wall time (ticks).
+ * @param [in]  state          The current state of the system being controlled (control units).
+ * @return                     True if a new command was started, false if not.
+ */
+static bool pbio_control_queue_start_next(pbio_control_t *ctl, uint32_t time_now, const pbio_control_state_t *state) {
+
+    if (ctl->queue_size == 0) {
+        return false;
+    }
+
+    // Take the oldest command from the queue.
+    pbio_control_queue_entry_t entry = ctl->queue[ctl->queue_first];
+    ctl->queue_first = (ctl->queue_first + 1) % PBIO_CONFIG_CONTROL_QUEUE_SIZE;
+    ctl->queue_size--;
+
+    // If the command after this one goes on in the same direction, pass the
+    // target at speed instead of stopping there.
+    pbio_control_on_completion_t on_completion = entry.on_completion;
+    if (ctl->queue_size > 0) {
+        pbio_trajectory_reference_t end;
+        pbio_trajectory_get_endpoint(&ctl->trajectory, &end);
+        if (pbio_control_queue_is_same_direction(&end.position, &entry.target, &ctl->queue[ctl->queue_first].target)) {
+            on_completion = PBIO_CONTROL_ON_COMPLETION_CONTINUE;
+        }
+    }
+
+    // Discard the rest of the queue if this one can't be started, so the
+    // ongoing command completes as usual.
+    if (_pbio_control_start_position_control(ctl, time_now, state, &entry.target, entry.speed, on_completion, true) != PBIO_SUCCESS) {
+        pbio_control_queue_clear(ctl);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Queues a position command to start when the ongoing one completes.
+ *
+ * If the queued command continues in the same direction as the one before
+ * it, that one passes its target at speed, so the motion is blended into
+ * one continuous movement. Otherwise, it stops at its target as usual
+ * before the queued command starts.
+ *
+ * If no position command is ongoing, the command starts right away.
+ *
+ * @param [in]  ctl            The control instance.
+ * @param [in]  time_now       The wall time (ticks).
+ * @param [in]  state          The current state of the system being controlled (control units).
+ * @param [in]  position       The target position to run to (application units).
+ * @param [in]  speed          The top speed on the way to the target (application units). The sign is ignored. If zero, default speed is used.
+ * @param [in]  on_completion  What to do when reaching the target position, if it is the last command.
+ * @return                     ::PBIO_ERROR_BUSY if the queue is full, otherwise error code.
+ */
+pbio_error_t pbio_control_queue_position_control(pbio_control_t *ctl, uint32_t time_now, const pbio_control_state_t *state, int32_t position, int32_t speed, pbio_control_on_completion_t on_completion) {
+
+    // If there is nothing to follow up on, start right away.
+    if (!pbio_control_type_is_position(ctl) || pbio_control_is_done(ctl)) {
+        return pbio_control_start_position_control(ctl, time_now, state, position, speed, on_completion);
+    }
+
+    if (ctl->queue_size == PBIO_CONFIG_CONTROL_QUEUE_SIZE) {
+        return PBIO_ERROR_BUSY;
+    }
+
+    // Convert command to control units.
+    pbio_control_queue_entry_t entry = {
+        .speed = pbio_control_settings_app_to_ctl(&ctl->settings, speed),
+        .on_completion = on_completion,
+    };
+    pbio_control_settings_app_to_ctl_long(&ctl->settings, position, &entry.target);
+
+    // If the ongoing command is the last one so far and the new command goes
+    // on in the same direction, replan the ongoing command so that it passes
+    // its target at speed.
+    if (ctl->queue_size == 0) {
+        pbio_trajectory_reference_t end;
+        pbio_trajectory_get_endpoint(&ctl->trajectory, &end);
+        if (end.speed == 0 && pbio_control_queue_is_same_direction(&ctl->trajectory.start.position, &end.position, &entry.target)) {
+            pbio_error_t err = _pbio_control_start_position_control(ctl, time_now, state, &end.position,
+                pbio_trajectory_get_abs_command_speed(&ctl->trajectory), PBIO_CONTROL_ON_COMPLETION_CONTINUE, true);
+            if (err != PBIO_SUCCESS) {
+                return err;
+            }
+        }
+    }
+
+    ctl->queue[(ctl->queue_first + ctl->queue_size) % PBIO_CONFIG_CONTROL_QUEUE_SIZE] = entry;
+    ctl->queue_size++;
+    return PBIO_SUCCESS;
+}
+
+/**
+ * Gets the number of position commands waiting in the queue.
+ *
+ * @param [in]  ctl            The control instance.
+ * @return                     Number of queued commands, excluding the ongoing one.
+ */
+uint8_t pbio_control_queue_get_size(const pbio_control_t *ctl) {
+    return ctl->queue_size;
+}
+
+#endif // PBIO_CONFIG_CONTROL_QUEUE_SIZE
+
 /**
  * Starts the controller to run to a given target position.
  *
@@ -598,6 +753,9 @@ static pbio_error_t _pbio_control_start_position_control(pbio_control_t *ctl, ui
  */
 pbio_error_t pbio_control_start_position_control(pbio_control_t *ctl, uint32_t time_now, const pbio_control_state_t *state, int32_t position, int32_t speed, pbio_control_on_completion_t on_completion) {
 
+    // A new command replaces everything that was queued.
+    pbio_control_queue_clear(ctl);
+
     // Convert target position to control units.
     pbio_angle_t target;
     pbio_control_settings_app_to_ctl_long(&ctl->settings, position, &target);
@@ -606,6 +764,66 @@ pbio_error_t pbio_control_start_position_control(pbio_control_t *ctl, uint32_t t
     return _pbio_control_start_position_control(ctl, time_now, state, &target, pbio_control_settings_app_to_ctl(&ctl->settings, speed), on_completion, true);
 }
 
+/**
+ * Starts several controllers to run to given target positions, such that
+ * they all start and complete at the same time.
+ *
+ * Each trajectory is first planned on its own. Then all trajectories are
+ * stretched to take as long as the slowest one, as in a drivebase.
+ *
+ * If any of the trajectories cannot be started, the controllers that were
+ * already started are stopped again, so that none of them run on their own.
+ *
+ * @param [in]  ctl            The control instances.
+ * @param [in]  state          The current state of each system being controlled (control units).
+ * @param [in]  num_ctl        The number of control instances.
+ * @param [in]  time_now       The wall time (ticks).
+ * @param [in]  position       The target position of each controller (application units).
+ * @param [in]  speed          The top speed of the slowest controller (application units). The sign is ignored. If zero, default speed is used.
+ * @param [in]  on_completion  What to do when reaching the target positions.
+ * @return                     Error code.
+ */
+pbio_error_t pbio_control_start_position_control_synchronized(pbio_control_t *const *ctl, const pbio_control_state_t *state, uint8_t num_ctl, uint32_t time_now, const int32_t *position, int32_t speed, pbio_control_on_completion_t on_completion) {
+
+    if (num_ctl == 0) {
+        return PBIO_ERROR_INVALID_ARG;
+    }
+
+    // Start each controller, keeping track of which one takes the longest.
+    const pbio_control_t *leader = ctl[0];
+    for (uint8_t i = 0; i < num_ctl; i++) {
+
+        // A new command replaces everything that was queued.
+        pbio_control_queue_clear(ctl[i]);
+
+        pbio_angle_t target;
+        pbio_control_settings_app_to_ctl_long(&ctl[i]->settings, position[i], &target);
+
+        // Time shifting is not allowed, since all trajectories must start now.
+        pbio_error_t err = _pbio_control_start_position_control(ctl[i], time_now, &state[i], &target,
+            pbio_control_settings_app_to_ctl(&ctl[i]->settings, speed), on_completion, false);
+        if (err != PBIO_SUCCESS) {
+            for (uint8_t j = 0; j < i; j++) {
+                pbio_control_stop(ctl[j]);
+            }
+            return err;
+        }
+
+        if (pbio_trajectory_get_duration(&ctl[i]->trajectory) > pbio_trajectory_get_duration(&leader->trajectory)) {
+            leader = ctl[i];
+        }
+    }
+
+    // Revise the other trajectories so they take as long as the leader.
+    for (uint8_t i = 0; i < num_ctl; i++) {
+        if (ctl[i] != leader) {
+            pbio_trajectory_stretch(&ctl[i]->trajectory, &leader->trajectory);
+        }
+    }
+
+    return PBIO_SUCCESS;
+}
+
 /**
  * Starts the controller to run by a given distance.
  *
@@ -625,6 +843,9 @@ pbio_error_t pbio_control_start_position_control(pbio_control_t *ctl, uint32_t t
  */
 pbio_error_t pbio_control_start_position_control_relative(pbio_control_t *ctl, uint32_t time_now, const pbio_control_state_t *state, int32_t distance, int32_t speed, pbio_control_on_completion_t on_completion, bool allow_trajectory_shift) {
 
+    // A new command replaces everything that was queued.
+    pbio_control_queue_clear(ctl);
+
     // Convert distance to control units.
     pbio_angle_t increment;
     pbio_control_settings_app_to_ctl_long(&ctl->settings, (speed < 0 ? -distance : distance), &increment);
@@ -674,6 +895,9 @@ pbio_error_t pbio_control_start_position_control_relative(pbio_control_t *ctl, u
  */
 pbio_error_t pbio_control_start_position_control_hold(pbio_control_t *ctl, uint32_t time_now, int32_t position) {
 
+    // A new command replaces everything that was queued.
+    pbio_control_queue_clear(ctl);
+
     // Compute new maneuver based on user argument, starting from the initial state
     pbio_trajectory_command_t command = {
         .time_start = pbio_control_get_ref_time(ctl, time_now),
@@ -707,6 +931,9 @@ pbio_error_t pbio_control_start_timed_control(pbio_control_t *ctl, uint32_t time
 
     pbio_error_t err;
 
+    // A new command replaces everything that was queued.
+    pbio_control_queue_clear(ctl);
+
     // For timed maneuvers, being "smart" by remembering the position endpoint
     // does nothing useful, so discard it to keep only the passive actuation type.
     on_completion = pbio_control_on_completion_discard_smart(on_completion);
@@ -720,6 +947,7 @@ pbio_error_t pbio_control_start_timed_control(pbio_control_t *ctl, uint32_t time
         .acceleration = ctl->settings.acceleration,
         .deceleration = ctl->settings.deceleration,
         .continue_running = on_completion == PBIO_CONTROL_ON_COMPLETION_CONTINUE,
+        .profile = ctl->settings.profile,
     };
 
     // Given the control status, fill in remaining commands and get trajectory.
@@ -151,9 +151,46 @@ int32_t pbio_control_settings_div_by_gain(int32_t value, int32_t gain) {
  * @return                    Input scaled by loop time in seconds.
  */
 int32_t pbio_control_settings_mul_by_loop_time(int32_t input) {
-    return input / (1000 / PBIO_CONFIG_CONTROL_LOOP_TIME_MS);
+    return input / (int32_t)(1000 / pbio_control_settings_get_loop_time());
 }
 
+#if PBIO_CONFIG_CONTROL_LOOP_TIME_ADJUSTABLE
+
+// Currently active control loop time (ms).
+static uint32_t loop_time_ms = PBIO_CONFIG_CONTROL_LOOP_TIME_MS;
+
+/**
+ * Gets the control loop time.
+ *
+ * @return                    Loop time in ms.
+ */
+uint32_t pbio_control_settings_get_loop_time(void) {
+    return loop_time_ms;
+}
+
+/**
+ * Sets the control loop time. This takes effect on the next control loop.
+ *
+ * The loop time must be a divisor of 100 ms so that the speed window is an
+ * exact number of samples. Loop times longer than the default must be a
+ * multiple of it, so the motor model can take whole steps.
+ *
+ * @param [in] loop_time      Loop time in ms.
+ * @return                    ::PBIO_SUCCESS on success, ::PBIO_ERROR_INVALID_ARG if the loop time is not supported.
+ */
+pbio_error_t pbio_control_settings_set_loop_time(uint32_t loop_time) {
+    if (loop_time < PBIO_CONFIG_CONTROL_LOOP_TIME_MIN_MS ||
+        loop_time > PBIO_CONFIG_CONTROL_LOOP_TIME_MAX_MS ||
+        100 % loop_time != 0 ||
+        (loop_time > PBIO_CONFIG_CONTROL_LOOP_TIME_MS && loop_time % PBIO_CONFIG_CONTROL_LOOP_TIME_MS != 0)) {
+        return PBIO_ERROR_INVALID_ARG;
+    }
+    loop_time_ms = loop_time;
+    return PBIO_SUCCESS;
+}
+
+#endif // PBIO_CONFIG_CONTROL_LOOP_TIME_ADJUSTABLE
+
 /**
  * Checks if a time sample is equal to or newer than a given base time stamp.
  *
@@ -209,6 +246,36 @@ pbio_error_t pbio_control_settings_set_trajectory_limits(pbio_control_settings_t
     return PBIO_SUCCESS;
 }
 
+/**
+ * Gets the shape of the speed profile during acceleration and deceleration.
+ *
+ * @param [in]  s             Control settings structure from which to read.
+ * @return                    The trajectory profile.
+ */
+pbio_trajectory_profile_t pbio_control_settings_get_trajectory_profile(const pbio_control_settings_t *s) {
+    return s->profile;
+}
+
+/**
+ * Sets the shape of the speed profile during acceleration and deceleration.
+ *
+ * @param [in] s              Control settings structure to modify.
+ * @param [in] profile        The trajectory profile.
+ * @return                    ::PBIO_SUCCESS on success
+ *                            ::PBIO_ERROR_NOT_SUPPORTED if the profile is not enabled on this platform.
+ *                            ::PBIO_ERROR_INVALID_ARG if the profile is not known.
+ */
+pbio_error_t pbio_control_settings_set_trajectory_profile(pbio_control_settings_t *s, pbio_trajectory_profile_t profile) {
+    if (profile == PBIO_TRAJECTORY_PROFILE_S_CURVE && !PBIO_CONFIG_TRAJECTORY_S_CURVE) {
+        return PBIO_ERROR_NOT_SUPPORTED;
+    }
+    if (profile != PBIO_TRAJECTORY_PROFILE_TRAPEZOID && profile != PBIO_TRAJECTORY_PROFILE_S_CURVE) {
+        return PBIO_ERROR_INVALID_ARG;
+    }
+    s->profile = profile;
+    return PBIO_SUCCESS;
+}
+
 /**
  * Gets the control limits for actuation, in application units.
  *
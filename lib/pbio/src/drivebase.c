@@ -4,9 +4,11 @@
 // SPDX-License-Identifier: BSD-3-Clause
 // Copyright (c) 2020-2023 LEGO System A/S
 
+#include <math.h>
 #include <stdlib.h>
 
 #include <pbdrv/clock.h>
+#include <pbdrv/legodev.h>
 #include <pbio/error.h>
 #include <pbio/drivebase.h>
 #include <pbio/int_math.h>
@@ -18,6 +20,15 @@
 // Drivebase objects
 static pbio_drivebase_t drivebases[PBIO_CONFIG_NUM_DRIVEBASES];
 
+/**
+ * Axes along which a drivebase moves, used as index of the odometry.
+ */
+enum {
+    PBIO_DRIVEBASE_AXIS_DISTANCE,
+    PBIO_DRIVEBASE_AXIS_HEADING,
+    PBIO_DRIVEBASE_AXIS_LATERAL,
+};
+
 /**
  * Gets the state of the drivebase update loop.
  *
@@ -30,74 +41,86 @@ static pbio_drivebase_t drivebases[PBIO_CONFIG_NUM_DRIVEBASES];
 bool pbio_drivebase_update_loop_is_running(pbio_drivebase_t *db) {
 
     // Drivebase must have servos.
-    if (!db->left || !db->right) {
+    if (db->num_wheels < 2) {
         return false;
     }
 
-    // Drivebase must be the parent of its two servos.
-    if (!pbio_parent_equals(&db->left->parent, db) || !pbio_parent_equals(&db->right->parent, db)) {
-        return false;
-    }
+    for (uint8_t i = 0; i < db->num_wheels; i++) {
+        pbio_servo_t *srv = db->wheels[i].servo;
+
+        // Drivebase must be the parent of its servos.
+        if (!pbio_parent_equals(&srv->parent, db)) {
+            return false;
+        }
 
-    // Both servo update loops must be running, since we want to read the servo observer state.
-    return pbio_servo_update_loop_is_running(db->left) && pbio_servo_update_loop_is_running(db->right);
+        // All servo update loops must be running, since we want to read the servo observer state.
+        if (!pbio_servo_update_loop_is_running(srv)) {
+            return false;
+        }
+    }
+    return true;
 }
 
 /**
- * Sets the drivebase settings based on the left and right motor settings.
+ * Sets the drivebase settings based on the settings of the wheel motors.
  *
  * Sets all settings except ctl_steps_per_app_step. This must be set after
  * calling this function.
  *
  * @param [out] s_distance  Settings of the distance controller.
  * @param [out] s_heading   Settings of the heading controller.
- * @param [in]  s_left      Settings of the left motor controller.
- * @param [in]  s_right     Settings of the right motor controller.
+ * @param [in]  wheels      Wheels of the drivebase.
+ * @param [in]  num_wheels  Number of wheels.
  */
-static void drivebase_adopt_settings(pbio_control_settings_t *s_distance, pbio_control_settings_t *s_heading, const pbio_control_settings_t *s_left, const pbio_control_settings_t *s_right) {
-
-    // Use minimum PID of both motors, to avoid overly aggressive control if
-    // one of the two motors has much higher PID values. Then scale it such
-    // that we use the reduced kp value not just for low errors, but always.
-    int32_t pid_kp = pbio_int_math_min(s_left->pid_kp, s_right->pid_kp) *
-        pbio_int_math_min(s_left->pid_kp_low_pct, s_right->pid_kp_low_pct) / 100;
-
-    // Cap maximum speed at the most constrained of the two motors.
-    int32_t actuation_max = pbio_int_math_min(s_left->actuation_max, s_right->actuation_max);
-    int32_t speed_max = pbio_int_math_min(s_left->speed_max, s_right->speed_max);
+static void drivebase_adopt_settings(pbio_control_settings_t *s_distance, pbio_control_settings_t *s_heading, const pbio_drivebase_wheel_t *wheels, uint8_t num_wheels) {
 
     // For all settings, take the value of the least powerful motor to ensure
-    // that the drivebase can meet the given specs.
-    *s_distance = (pbio_control_settings_t) {
-        // Must be set immediately after calling the current function.
-        .ctl_steps_per_app_step = 0,
-        .stall_speed_limit = pbio_int_math_min(s_left->stall_speed_limit, s_right->stall_speed_limit),
-        .stall_time = pbio_int_math_min(s_left->stall_time, s_right->stall_time),
-        .speed_max = speed_max,
-        // The default speed is 40% of the maximum speed.
-        .speed_default = speed_max * 10 / 25,
-        .speed_tolerance = pbio_int_math_min(s_left->speed_tolerance, s_right->speed_tolerance),
-        // To account for reduced kp, adjust the position tolerance so we
-        // always apply enough proportional torque to keep moving near the end.
-        .position_tolerance = pbio_control_settings_div_by_gain(actuation_max, pid_kp),
-        // Make acceleration, deceleration a bit slower for smoother driving.
-        .acceleration = pbio_int_math_min(s_left->acceleration, s_right->acceleration) * 3 / 4,
-        .deceleration = pbio_int_math_min(s_left->deceleration, s_right->deceleration) * 3 / 4,
-        .actuation_max = actuation_max,
-        .pid_kp = pid_kp,
-        // Dynamic kp reduction is disabled for drivebases. Instead, it uses
-        // reduced kp across the board.
-        .pid_kp_low_pct = 0,
-        .pid_kp_low_error_threshold = 0,
-        .pid_kp_low_speed_threshold = 0,
-        // Integral control is not necessary since there is no constant external
-        // force to overcome that wouldn't be done by proportional control.
-        .pid_ki = 0,
-        .pid_kd = pbio_int_math_min(s_left->pid_kd, s_right->pid_kd),
-        .integral_deadzone = pbio_int_math_max(s_left->integral_deadzone, s_right->integral_deadzone),
-        .integral_change_max = pbio_int_math_min(s_left->integral_change_max, s_right->integral_change_max),
-        .smart_passive_hold_time = pbio_int_math_max(s_left->smart_passive_hold_time, s_right->smart_passive_hold_time),
-    };
+    // that the drivebase can meet the given specs. Start from the first one.
+    const pbio_control_settings_t *s_first = &wheels[0].servo->control.settings;
+    *s_distance = *s_first;
+    for (uint8_t i = 1; i < num_wheels; i++) {
+        const pbio_control_settings_t *s = &wheels[i].servo->control.settings;
+        s_distance->pid_kp = pbio_int_math_min(s_distance->pid_kp, s->pid_kp);
+        s_distance->pid_kp_low_pct = pbio_int_math_min(s_distance->pid_kp_low_pct, s->pid_kp_low_pct);
+        s_distance->pid_kd = pbio_int_math_min(s_distance->pid_kd, s->pid_kd);
+        s_distance->actuation_max = pbio_int_math_min(s_distance->actuation_max, s->actuation_max);
+        s_distance->speed_max = pbio_int_math_min(s_distance->speed_max, s->speed_max);
+        s_distance->speed_tolerance = pbio_int_math_min(s_distance->speed_tolerance, s->speed_tolerance);
+        s_distance->stall_speed_limit = pbio_int_math_min(s_distance->stall_speed_limit, s->stall_speed_limit);
+        s_distance->stall_time = pbio_int_math_min(s_distance->stall_time, s->stall_time);
+        s_distance->acceleration = pbio_int_math_min(s_distance->acceleration, s->acceleration);
+        s_distance->deceleration = pbio_int_math_min(s_distance->deceleration, s->deceleration);
+        s_distance->integral_deadzone = pbio_int_math_max(s_distance->integral_deadzone, s->integral_deadzone);
+        s_distance->integral_change_max = pbio_int_math_min(s_distance->integral_change_max, s->integral_change_max);
+        s_distance->smart_passive_hold_time = pbio_int_math_max(s_distance->smart_passive_hold_time, s->smart_passive_hold_time);
+    }
+
+    // Use minimum PID of all motors, to avoid overly aggressive control if
+    // one of the motors has much higher PID values. Then scale it such
+    // that we use the reduced kp value not just for low errors, but always.
+    s_distance->pid_kp = s_distance->pid_kp * s_distance->pid_kp_low_pct / 100;
+
+    // The profile is a setting of the drivebase, so it starts from the
+    // default rather than the profile of any of the motors.
+    s_distance->profile = PBIO_TRAJECTORY_PROFILE_TRAPEZOID;
+    // Must be set immediately after calling the current function.
+    s_distance->ctl_steps_per_app_step = 0;
+    // The default speed is 40% of the maximum speed.
+    s_distance->speed_default = s_distance->speed_max * 10 / 25;
+    // To account for reduced kp, adjust the position tolerance so we
+    // always apply enough proportional torque to keep moving near the end.
+    s_distance->position_tolerance = pbio_control_settings_div_by_gain(s_distance->actuation_max, s_distance->pid_kp);
+    // Make acceleration, deceleration a bit slower for smoother driving.
+    s_distance->acceleration = s_distance->acceleration * 3 / 4;
+    s_distance->deceleration = s_distance->deceleration * 3 / 4;
+    // Dynamic kp reduction is disabled for drivebases. Instead, it uses
+    // reduced kp across the board.
+    s_distance->pid_kp_low_pct = 0;
+    s_distance->pid_kp_low_error_threshold = 0;
+    s_distance->pid_kp_low_speed_threshold = 0;
+    // Integral control is not necessary since there is no constant external
+    // force to overcome that wouldn't be done by proportional control.
+    s_distance->pid_ki = 0;
 
     // By default, heading control is the nearly same as distance control.
     *s_heading = *s_distance;
@@ -113,51 +136,156 @@ static void drivebase_adopt_settings(pbio_control_settings_t *s_distance, pbio_c
     s_heading->actuation_max = s_distance->actuation_max * 2;
 }
 
+#if PBIO_CONFIG_DRIVEBASE_NUM_WHEELS > 2
+
 /**
- * Get the physical and estimated state of a drivebase in units of control.
+ * Combines the wheel angles into an angle along one axis of the drivebase.
+ *
+ * @param [in]  odometry        Odometry coefficients of this axis.
+ * @param [in]  angles          Angle of each wheel.
+ * @param [in]  num_wheels      Number of wheels.
+ * @param [out] result          Angle along the axis.
+ */
+static void pbio_drivebase_odometry_angle(const int32_t *odometry, const pbio_angle_t *const *angles, uint8_t num_wheels, pbio_angle_t *result) {
+
+    // Weigh both components separately so nothing overflows.
+    int64_t rotations = 0;
+    int64_t millidegrees = 0;
+    for (uint8_t i = 0; i < num_wheels; i++) {
+        rotations += (int64_t)odometry[i] * angles[i]->rotations;
+        millidegrees += (int64_t)odometry[i] * angles[i]->millidegrees;
+    }
+
+    // Keep whole rotations and move the fraction of a rotation to the
+    // millidegrees, which is exact for the usual odometry of 1/2 or 1/4.
+    result->rotations = rotations / 65536;
+    result->millidegrees = (rotations % 65536) * 360000 / 65536 + millidegrees / 65536;
+}
+
+#endif // PBIO_CONFIG_DRIVEBASE_NUM_WHEELS > 2
+
+/**
+ * Get the physical and estimated state of a drivebase along all axes in
+ * units of control.
  *
  * @param [in]  db              The drivebase instance
- * @param [out] state_distance  Physical and estimated state of the distance.
- * @param [out] state_heading   Physical and estimated state of the heading.
+ * @param [out] states          Physical and estimated state along each axis.
+ * @param [out] state_wheels    Physical and estimated state of each wheel.
  * @return                      Error code.
  */
-static pbio_error_t pbio_drivebase_get_state_control(pbio_drivebase_t *db, pbio_control_state_t *state_distance, pbio_control_state_t *state_heading) {
+static pbio_error_t pbio_drivebase_get_state_axes(pbio_drivebase_t *db, pbio_control_state_t *states, pbio_control_state_t *state_wheels) {
 
-    // Get left servo state
-    pbio_control_state_t state_left;
-    pbio_error_t err = pbio_servo_get_state_control(db->left, &state_left);
-    if (err != PBIO_SUCCESS) {
-        return err;
+    // Get the state of each wheel.
+    for (uint8_t i = 0; i < db->num_wheels; i++) {
+        pbio_error_t err = pbio_servo_get_state_control(db->wheels[i].servo, &state_wheels[i]);
+        if (err != PBIO_SUCCESS) {
+            return err;
+        }
     }
 
-    // Get right servo state
-    pbio_control_state_t state_right;
-    err = pbio_servo_get_state_control(db->right, &state_right);
-    if (err != PBIO_SUCCESS) {
-        return err;
+    #if PBIO_CONFIG_DRIVEBASE_NUM_WHEELS > 2
+    // Combine them to get the state along each axis.
+    if (db->num_wheels > 2) {
+        const pbio_angle_t *positions[PBIO_CONFIG_DRIVEBASE_NUM_WHEELS];
+        const pbio_angle_t *position_estimates[PBIO_CONFIG_DRIVEBASE_NUM_WHEELS];
+        for (uint8_t i = 0; i < db->num_wheels; i++) {
+            positions[i] = &state_wheels[i].position;
+            position_estimates[i] = &state_wheels[i].position_estimate;
+        }
+        for (uint8_t a = 0; a < PBIO_DRIVEBASE_NUM_AXES; a++) {
+            const int32_t *odometry = db->odometry[a];
+            pbio_drivebase_odometry_angle(odometry, positions, db->num_wheels, &states[a].position);
+            pbio_drivebase_odometry_angle(odometry, position_estimates, db->num_wheels, &states[a].position_estimate);
+            int64_t speed = 0;
+            int64_t speed_estimate = 0;
+            for (uint8_t i = 0; i < db->num_wheels; i++) {
+                speed += (int64_t)odometry[i] * state_wheels[i].speed;
+                speed_estimate += (int64_t)odometry[i] * state_wheels[i].speed_estimate;
+            }
+            states[a].speed = speed / 65536;
+            states[a].speed_estimate = speed_estimate / 65536;
+        }
+    } else
+    #endif // PBIO_CONFIG_DRIVEBASE_NUM_WHEELS > 2
+    {
+        const pbio_control_state_t *state_left = &state_wheels[0];
+        const pbio_control_state_t *state_right = &state_wheels[1];
+        pbio_control_state_t *state_distance = &states[PBIO_DRIVEBASE_AXIS_DISTANCE];
+        pbio_control_state_t *state_heading = &states[PBIO_DRIVEBASE_AXIS_HEADING];
+
+        // Take average to get distance state
+        pbio_angle_avg(&state_left->position, &state_right->position, &state_distance->position);
+        pbio_angle_avg(&state_left->position_estimate, &state_right->position_estimate, &state_distance->position_estimate);
+        state_distance->speed_estimate = (state_left->speed_estimate + state_right->speed_estimate) / 2;
+        state_distance->speed = (state_left->speed + state_right->speed) / 2;
+
+        // Take average difference to get heading state, which is implemented as:
+        // (left - right) / 2 = (left + right) / 2 - right = avg - right.
+        pbio_angle_diff(&state_distance->position, &state_right->position, &state_heading->position);
+        pbio_angle_diff(&state_distance->position_estimate, &state_right->position_estimate, &state_heading->position_estimate);
+        state_heading->speed_estimate = state_distance->speed_estimate - state_right->speed_estimate;
+        state_heading->speed = state_distance->speed - state_right->speed;
+
+        #if PBIO_CONFIG_DRIVEBASE_NUM_WHEELS > 2
+        // A drive base with two wheels doesn't move sideways.
+        states[PBIO_DRIVEBASE_AXIS_LATERAL] = (pbio_control_state_t) {0};
+        #endif
     }
 
-    // Take average to get distance state
-    pbio_angle_avg(&state_left.position, &state_right.position, &state_distance->position);
-    pbio_angle_avg(&state_left.position_estimate, &state_right.position_estimate, &state_distance->position_estimate);
-    state_distance->speed_estimate = (state_left.speed_estimate + state_right.speed_estimate) / 2;
-    state_distance->speed = (state_left.speed + state_right.speed) / 2;
-
-    // Take average difference to get heading state, which is implemented as:
-    // (left - right) / 2 = (left + right) / 2 - right = avg - right.
-    pbio_angle_diff(&state_distance->position, &state_right.position, &state_heading->position);
-    pbio_angle_diff(&state_distance->position_estimate, &state_right.position_estimate, &state_heading->position_estimate);
-    state_heading->speed_estimate = state_distance->speed_estimate - state_right.speed_estimate;
-    state_heading->speed = state_distance->speed - state_right.speed;
-
     // Optionally use gyro to override the heading source for more accuracy.
     if (db->use_gyro) {
+        pbio_control_state_t *state_heading = &states[PBIO_DRIVEBASE_AXIS_HEADING];
         pbio_imu_get_heading_scaled(&state_heading->position, &state_heading->speed, db->control_heading.settings.ctl_steps_per_app_step);
     }
 
     return PBIO_SUCCESS;
 }
 
+/**
+ * Get the physical and estimated state of a drivebase in units of control.
+ *
+ * @param [in]  db              The drivebase instance
+ * @param [out] state_distance  Physical and estimated state of the distance.
+ * @param [out] state_heading   Physical and estimated state of the heading.
+ * @return                      Error code.
+ */
+static pbio_error_t pbio_drivebase_get_state_control(pbio_drivebase_t *db, pbio_control_state_t *state_distance, pbio_control_state_t *state_heading) {
+    pbio_control_state_t states[PBIO_DRIVEBASE_NUM_AXES];
+    pbio_control_state_t state_wheels[PBIO_CONFIG_DRIVEBASE_NUM_WHEELS];
+    pbio_error_t err = pbio_drivebase_get_state_axes(db, states, state_wheels);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+    *state_distance = states[PBIO_DRIVEBASE_AXIS_DISTANCE];
+    *state_heading = states[PBIO_DRIVEBASE_AXIS_HEADING];
+    return PBIO_SUCCESS;
+}
+
+/**
+ * Cancels commands that would otherwise start when the ongoing one completes,
+ * such as the remainder of a path.
+ *
+ * @param [in]  db              The drivebase instance
+ */
+static void pbio_drivebase_cancel_pending_commands(pbio_drivebase_t *db) {
+    #if PBIO_CONFIG_DRIVEBASE_POSE
+    db->drive_to_pending = false;
+    #endif
+    #if PBIO_CONFIG_DRIVEBASE_PATH_SIZE
+    db->path_size = 0;
+    db->path_next = 0;
+    #endif
+    #if PBIO_CONFIG_DRIVEBASE_FOLLOW
+    db->follow.sensor = NULL;
+    #endif
+    #if PBIO_CONFIG_DRIVEBASE_NUM_WHEELS > 2
+    // The next command stops moving sideways unless it says otherwise.
+    db->lateral_speed = 0;
+    db->lateral_restart = true;
+    db->wheel_sync_restart = true;
+    #endif
+}
+
 /**
  * Stop the drivebase from updating its controllers.
  *
@@ -169,7 +297,11 @@ static void pbio_drivebase_stop_drivebase_control(pbio_drivebase_t *db) {
     // Stop drivebase control so polling will stop
     pbio_control_stop(&db->control_distance);
     pbio_control_stop(&db->control_heading);
+    #if PBIO_CONFIG_DRIVEBASE_NUM_WHEELS > 2
+    pbio_control_stop(&db->control_lateral);
+    #endif
     db->control_paused = false;
+    pbio_drivebase_cancel_pending_commands(db);
 }
 
 /**
@@ -181,8 +313,9 @@ static void pbio_drivebase_stop_drivebase_control(pbio_drivebase_t *db) {
  */
 static void pbio_drivebase_stop_servo_control(pbio_drivebase_t *db) {
     // Stop servo control so polling will stop
-    pbio_control_stop(&db->left->control);
-    pbio_control_stop(&db->right->control);
+    for (uint8_t i = 0; i < db->num_wheels; i++) {
+        pbio_control_stop(&db->wheels[i].servo->control);
+    }
 }
 
 /**
@@ -222,45 +355,198 @@ static pbio_error_t pbio_drivebase_stop_from_servo(void *drivebase, bool clear_p
     // Stop the drive base controller so the motors don't start moving again.
     pbio_drivebase_stop_drivebase_control(db);
 
-    // Since we don't know which child called the parent to stop, we stop both
+    // Since we don't know which child called the parent to stop, we stop all
     // motors. We don't stop their parents to avoid escalating the stop calls
     // up the chain (and back here) once again.
-    pbio_error_t err = pbio_dcmotor_coast(db->left->dcmotor);
-    if (err != PBIO_SUCCESS) {
-        return err;
+    for (uint8_t i = 0; i < db->num_wheels; i++) {
+        pbio_error_t err = pbio_dcmotor_coast(db->wheels[i].servo->dcmotor);
+        if (err != PBIO_SUCCESS) {
+            return err;
+        }
+    }
+    return PBIO_SUCCESS;
+}
+
+#if PBIO_CONFIG_DRIVEBASE_NUM_WHEELS > 2
+
+/**
+ * Gets the kinematics coefficient of a wheel along one axis.
+ *
+ * @param [in]  wheel       The wheel.
+ * @param [in]  axis        The axis.
+ * @return                  Coefficient, scaled by ::PBIO_DRIVEBASE_KINEMATICS_SCALE.
+ */
+static int32_t pbio_drivebase_wheel_coefficient(const pbio_drivebase_wheel_t *wheel, uint8_t axis) {
+    switch (axis) {
+        case PBIO_DRIVEBASE_AXIS_DISTANCE:
+            return wheel->distance;
+        case PBIO_DRIVEBASE_AXIS_HEADING:
+            return wheel->heading;
+        default:
+            return wheel->lateral;
+    }
+}
+
+#endif // PBIO_CONFIG_DRIVEBASE_NUM_WHEELS > 2
+
+/**
+ * Gets the rotation of a wheel from the motion along each axis.
+ *
+ * @param [in]  db          The drivebase instance.
+ * @param [in]  index       Index of the wheel.
+ * @param [in]  distance    Value along the distance axis.
+ * @param [in]  heading     Value along the heading axis.
+ * @param [in]  lateral     Value along the lateral axis.
+ * @return                  Value for the wheel.
+ */
+static int32_t pbio_drivebase_wheel_combine(const pbio_drivebase_t *db, uint8_t index, int32_t distance, int32_t heading, int32_t lateral) {
+    #if PBIO_CONFIG_DRIVEBASE_NUM_WHEELS > 2
+    if (db->num_wheels > 2) {
+        const pbio_drivebase_wheel_t *wheel = &db->wheels[index];
+        return ((int64_t)wheel->distance * distance + (int64_t)wheel->heading * heading + (int64_t)wheel->lateral * lateral) / PBIO_DRIVEBASE_KINEMATICS_SCALE;
+    }
+    #endif
+    // On a standard drive base, the left wheel drives at (average) + (difference)
+    // and the right wheel at (average) - (difference).
+    return index == 0 ? distance + heading : distance - heading;
+}
+
+/**
+ * Sets the odometry from the wheel kinematics, so the motion along each axis
+ * can be found from the wheel rotations.
+ *
+ * @param [in]  db          The drivebase instance.
+ * @return                  ::PBIO_SUCCESS on success.
+ *                          ::PBIO_ERROR_INVALID_ARG if the wheels can't tell
+ *                          the motion along all axes apart.
+ */
+static pbio_error_t pbio_drivebase_set_odometry(pbio_drivebase_t *db) {
+
+    // Two wheels must make a standard drive base, for which the distance and
+    // heading are simply the average and average difference of the wheels.
+    if (db->num_wheels == 2) {
+        const pbio_drivebase_wheel_t *left = &db->wheels[0];
+        const pbio_drivebase_wheel_t *right = &db->wheels[1];
+        if (left->distance != PBIO_DRIVEBASE_KINEMATICS_SCALE || left->heading != PBIO_DRIVEBASE_KINEMATICS_SCALE || left->lateral != 0 ||
+            right->distance != PBIO_DRIVEBASE_KINEMATICS_SCALE || right->heading != -PBIO_DRIVEBASE_KINEMATICS_SCALE || right->lateral != 0) {
+            return PBIO_ERROR_INVALID_ARG;
+        }
+        db->odometry[PBIO_DRIVEBASE_AXIS_DISTANCE][0] = 32768;
+        db->odometry[PBIO_DRIVEBASE_AXIS_DISTANCE][1] = 32768;
+        db->odometry[PBIO_DRIVEBASE_AXIS_HEADING][0] = 32768;
+        db->odometry[PBIO_DRIVEBASE_AXIS_HEADING][1] = -32768;
+        return PBIO_SUCCESS;
+    }
+
+    #if PBIO_CONFIG_DRIVEBASE_NUM_WHEELS > 2
+
+    // The odometry is the least squares solution, which is the pseudo-inverse
+    // of the kinematics K given by (K^T K)^-1 K^T. Begin with M = K^T K. If
+    // the drive base can't move sideways, the lateral axis is left out by
+    // making it independent from the rest.
+    float m[3][3] = { { 0.0f } };
+    for (uint8_t a = 0; a < 3; a++) {
+        for (uint8_t b = 0; b < 3; b++) {
+            for (uint8_t i = 0; i < db->num_wheels; i++) {
+                m[a][b] += (float)pbio_drivebase_wheel_coefficient(&db->wheels[i], a) *
+                    pbio_drivebase_wheel_coefficient(&db->wheels[i], b) /
+                    (PBIO_DRIVEBASE_KINEMATICS_SCALE * PBIO_DRIVEBASE_KINEMATICS_SCALE);
+            }
+        }
+    }
+    if (!db->holonomic) {
+        m[PBIO_DRIVEBASE_AXIS_LATERAL][PBIO_DRIVEBASE_AXIS_LATERAL] = 1.0f;
+    }
+
+    // Invert M using its cofactors.
+    float inv[3][3];
+    for (uint8_t a = 0; a < 3; a++) {
+        for (uint8_t b = 0; b < 3; b++) {
+            uint8_t r0 = (b + 1) % 3, r1 = (b + 2) % 3;
+            uint8_t c0 = (a + 1) % 3, c1 = (a + 2) % 3;
+            inv[a][b] = m[r0][c0] * m[r1][c1] - m[r0][c1] * m[r1][c0];
+        }
+    }
+    float det = m[0][0] * inv[0][0] + m[0][1] * inv[1][0] + m[0][2] * inv[2][0];
+    if (fabsf(det) < 1e-3f) {
+        return PBIO_ERROR_INVALID_ARG;
+    }
+
+    // Odometry is M^-1 K^T, in fixed point.
+    for (uint8_t a = 0; a < PBIO_DRIVEBASE_NUM_AXES; a++) {
+        for (uint8_t i = 0; i < db->num_wheels; i++) {
+            float p = 0.0f;
+            for (uint8_t b = 0; b < 3; b++) {
+                p += inv[a][b] * pbio_drivebase_wheel_coefficient(&db->wheels[i], b);
+            }
+            db->odometry[a][i] = lroundf(p * 65536 / det / PBIO_DRIVEBASE_KINEMATICS_SCALE);
+        }
     }
-    return pbio_dcmotor_coast(db->right->dcmotor);
+
+    // Whatever is left of the wheel rotations after taking out the motion
+    // along each axis is given by I - K * odometry.
+    for (uint8_t i = 0; i < db->num_wheels; i++) {
+        for (uint8_t j = 0; j < db->num_wheels; j++) {
+            int32_t k_odometry = 0;
+            for (uint8_t a = 0; a < PBIO_DRIVEBASE_NUM_AXES; a++) {
+                k_odometry += pbio_drivebase_wheel_coefficient(&db->wheels[i], a) * db->odometry[a][j] / PBIO_DRIVEBASE_KINEMATICS_SCALE;
+            }
+            db->wheel_sync[i][j] = (i == j ? 65536 : 0) - k_odometry;
+        }
+    }
+    return PBIO_SUCCESS;
+
+    #else // PBIO_CONFIG_DRIVEBASE_NUM_WHEELS > 2
+    return PBIO_ERROR_INVALID_ARG;
+    #endif // PBIO_CONFIG_DRIVEBASE_NUM_WHEELS > 2
 }
 
 #define ROT_MDEG_OVER_PI (114592) // 360 000 / pi
 
 /**
- * Gets drivebase instance from two servo instances.
+ * Gets drivebase instance from two or more wheels.
+ *
+ * The wheel diameter and axle track set the scale of the distance and heading
+ * of a drive base whose wheel kinematics are ::PBIO_DRIVEBASE_KINEMATICS_SCALE.
+ * For other types of drive bases, such as with mecanum wheels, the axle track
+ * is the diameter of the circle traced by the wheels when turning in place.
+ * Two wheels must have the kinematics of a standard drive base, with the
+ * left wheel first.
  *
  * @param [out] db_address       Drivebase instance if available.
- * @param [in]  left             Left servo instance.
- * @param [in]  right            Right servo instance.
+ * @param [in]  wheels           Wheels of the drive base.
+ * @param [in]  num_wheels       Number of wheels.
  * @param [in]  wheel_diameter   Wheel diameter in um.
  * @param [in]  axle_track       Distance between wheel-ground contact points in um.
  * @return                       Error code.
  */
-pbio_error_t pbio_drivebase_get_drivebase(pbio_drivebase_t **db_address, pbio_servo_t *left, pbio_servo_t *right, int32_t wheel_diameter, int32_t axle_track) {
+pbio_error_t pbio_drivebase_get_drivebase_wheels(pbio_drivebase_t **db_address, const pbio_drivebase_wheel_t *wheels, uint8_t num_wheels, int32_t wheel_diameter, int32_t axle_track) {
 
-    // Can't build a drive base with just one motor.
-    if (left == right) {
+    if (num_wheels < 2 || num_wheels > PBIO_CONFIG_DRIVEBASE_NUM_WHEELS) {
         return PBIO_ERROR_INVALID_ARG;
     }
 
-    // Assert that both motors have the same gearing
-    if (left->control.settings.ctl_steps_per_app_step != right->control.settings.ctl_steps_per_app_step) {
-        return PBIO_ERROR_INVALID_ARG;
-    }
+    for (uint8_t i = 0; i < num_wheels; i++) {
+        pbio_servo_t *srv = wheels[i].servo;
 
-    // Check if the servos already have parents.
-    if (pbio_parent_exists(&left->parent) || pbio_parent_exists(&right->parent)) {
-        // If a servo is already in use by a higher level
-        // abstraction like a drivebase, we can't re-use it.
-        return PBIO_ERROR_BUSY;
+        // Can't use the same motor for more than one wheel.
+        for (uint8_t j = 0; j < i; j++) {
+            if (srv == wheels[j].servo) {
+                return PBIO_ERROR_INVALID_ARG;
+            }
+        }
+
+        // Assert that all motors have the same gearing
+        if (srv->control.settings.ctl_steps_per_app_step != wheels[0].servo->control.settings.ctl_steps_per_app_step) {
+            return PBIO_ERROR_INVALID_ARG;
+        }
+
+        // Check if the servos already have parents.
+        if (pbio_parent_exists(&srv->parent)) {
+            // If a servo is already in use by a higher level
+            // abstraction like a drivebase, we can't re-use it.
+            return PBIO_ERROR_BUSY;
+        }
     }
 
     // Now we know that the servos are free, there must be an available
@@ -279,48 +565,70 @@ pbio_error_t pbio_drivebase_get_drivebase(pbio_drivebase_t **db_address, pbio_se
     // So, this is the drivebase we'll use.
     pbio_drivebase_t *db = &drivebases[index];
 
+    // Attach wheels. The drive base can move sideways if any wheel can.
+    db->num_wheels = num_wheels;
+    #if PBIO_CONFIG_DRIVEBASE_NUM_WHEELS > 2
+    db->holonomic = false;
+    #endif
+    for (uint8_t i = 0; i < num_wheels; i++) {
+        db->wheels[i] = wheels[i];
+        #if PBIO_CONFIG_DRIVEBASE_NUM_WHEELS > 2
+        db->holonomic |= wheels[i].lateral != 0;
+        #else
+        db->wheels[i].lateral = 0;
+        #endif
+    }
+
+    // Verify that we can tell how the drive base moves from the wheels.
+    pbio_error_t err = pbio_drivebase_set_odometry(db);
+    if (err != PBIO_SUCCESS) {
+        db->num_wheels = 0;
+        return err;
+    }
+
     // Set return value.
     *db_address = db;
 
-    // Attach servos
-    db->left = left;
-    db->right = right;
-
-    // Set parents of both servos, so they can stop this drivebase.
-    pbio_parent_set(&left->parent, db, pbio_drivebase_stop_from_servo);
-    pbio_parent_set(&right->parent, db, pbio_drivebase_stop_from_servo);
+    // Set parents of all servos, so they can stop this drivebase.
+    for (uint8_t i = 0; i < num_wheels; i++) {
+        pbio_parent_set(&wheels[i].servo->parent, db, pbio_drivebase_stop_from_servo);
+    }
 
     // Stop any existing drivebase controls
     pbio_control_reset(&db->control_distance);
     pbio_control_reset(&db->control_heading);
+    #if PBIO_CONFIG_DRIVEBASE_NUM_WHEELS > 2
+    pbio_control_reset(&db->control_lateral);
+    #endif
     db->control_paused = false;
 
-    // Reset both motors to a passive state
+    // Reset all motors to a passive state
     pbio_drivebase_stop_servo_control(db);
-    pbio_error_t err = pbio_drivebase_stop(db, PBIO_CONTROL_ON_COMPLETION_COAST);
+    err = pbio_drivebase_stop(db, PBIO_CONTROL_ON_COMPLETION_COAST);
     if (err != PBIO_SUCCESS) {
         return err;
     }
 
-    // Adopt settings as the average or sum of both servos, except scaling
-    drivebase_adopt_settings(&db->control_distance.settings, &db->control_heading.settings, &left->control.settings, &right->control.settings);
+    // Adopt settings as the average or sum of all servos, except scaling
+    drivebase_adopt_settings(&db->control_distance.settings, &db->control_heading.settings, wheels, num_wheels);
 
     // Verify that the given dimensions are not too small or large to compute
     // a correct result for heading and distance control scale below.
+    int32_t ctl_steps_per_app_step = wheels[0].servo->control.settings.ctl_steps_per_app_step;
     if (wheel_diameter < 1000 || axle_track < 1000 ||
-        left->control.settings.ctl_steps_per_app_step > INT32_MAX / ROT_MDEG_OVER_PI ||
-        left->control.settings.ctl_steps_per_app_step > INT32_MAX / axle_track
+        ctl_steps_per_app_step > INT32_MAX / ROT_MDEG_OVER_PI ||
+        ctl_steps_per_app_step > INT32_MAX / axle_track
         ) {
         return PBIO_ERROR_INVALID_ARG;
     }
 
     // Average rotation of the motors for every 1 degree drivebase rotation.
     db->control_heading.settings.ctl_steps_per_app_step =
-        left->control.settings.ctl_steps_per_app_step * axle_track / wheel_diameter;
+        ctl_steps_per_app_step * axle_track / wheel_diameter;
 
     // Average rotation of the motors for every 1 mm forward.
     db->control_distance.settings.ctl_steps_per_app_step =
-        left->control.settings.ctl_steps_per_app_step * ROT_MDEG_OVER_PI / wheel_diameter;
+        ctl_steps_per_app_step * ROT_MDEG_OVER_PI / wheel_diameter;
 
 
     // Verify that wheel diameter was not so large that scale is now zero.
@@ -329,10 +637,80 @@ pbio_error_t pbio_drivebase_get_drivebase(pbio_drivebase_t **db_address, pbio_se
         return PBIO_ERROR_INVALID_ARG;
     }
 
+    #if PBIO_CONFIG_DRIVEBASE_NUM_WHEELS > 2
+    // Moving sideways is scaled like moving forward.
+    db->control_lateral.settings = db->control_distance.settings;
+    #endif
+
+    #if PBIO_CONFIG_DRIVEBASE_SLIP
+    // Start detecting slip from scratch, without reducing the acceleration.
+    db->slip = (pbio_drivebase_slip_t) { 0 };
+    #endif
+
     // Finish setup. By default, don't use gyro.
-    return pbio_drivebase_set_use_gyro(db, false);
+    err = pbio_drivebase_set_use_gyro(db, false);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+
+    #if PBIO_CONFIG_DRIVEBASE_POSE
+    // The pose is relative to where the drive base was created.
+    return pbio_drivebase_reset_pose(db, 0.0f, 0.0f, 0.0f);
+    #else
+    return PBIO_SUCCESS;
+    #endif
+}
+
+/**
+ * Gets drivebase instance from two servo instances.
+ *
+ * @param [out] db_address       Drivebase instance if available.
+ * @param [in]  left             Left servo instance.
+ * @param [in]  right            Right servo instance.
+ * @param [in]  wheel_diameter   Wheel diameter in um.
+ * @param [in]  axle_track       Distance between wheel-ground contact points in um.
+ * @return                       Error code.
+ */
+pbio_error_t pbio_drivebase_get_drivebase(pbio_drivebase_t **db_address, pbio_servo_t *left, pbio_servo_t *right, int32_t wheel_diameter, int32_t axle_track) {
+    const pbio_drivebase_wheel_t wheels[] = {
+        {
+            .servo = left,
+            .distance = PBIO_DRIVEBASE_KINEMATICS_SCALE,
+            .heading = PBIO_DRIVEBASE_KINEMATICS_SCALE,
+        },
+        {
+            .servo = right,
+            .distance = PBIO_DRIVEBASE_KINEMATICS_SCALE,
+            .heading = -PBIO_DRIVEBASE_KINEMATICS_SCALE,
+        },
+    };
+    return pbio_drivebase_get_drivebase_wheels(db_address, wheels, 2, wheel_diameter, axle_track);
+}
+
+#if PBIO_CONFIG_DRIVEBASE_NUM_WHEELS > 2
+
+/**
+ * Gets the wheels of a drive base with four mecanum wheels.
+ *
+ * The rollers of the wheels should form an X when seen from above. Omni wheels
+ * mounted diagonally in each corner move the same way.
+ *
+ * @param [in]  front_left      Front left servo instance.
+ * @param [in]  front_right     Front right servo instance.
+ * @param [in]  rear_left       Rear left servo instance.
+ * @param [in]  rear_right      Rear right servo instance.
+ * @param [out] wheels          The four wheels.
+ */
+void pbio_drivebase_get_mecanum_wheels(pbio_servo_t *front_left, pbio_servo_t *front_right, pbio_servo_t *rear_left, pbio_servo_t *rear_right, pbio_drivebase_wheel_t *wheels) {
+    const int16_t k = PBIO_DRIVEBASE_KINEMATICS_SCALE;
+    wheels[0] = (pbio_drivebase_wheel_t) { .servo = front_left, .distance = k, .heading = k, .lateral = k };
+    wheels[1] = (pbio_drivebase_wheel_t) { .servo = front_right, .distance = k, .heading = -k, .lateral = -k };
+    wheels[2] = (pbio_drivebase_wheel_t) { .servo = rear_left, .distance = k, .heading = k, .lateral = -k };
+    wheels[3] = (pbio_drivebase_wheel_t) { .servo = rear_right, .distance = k, .heading = -k, .lateral = k };
 }
 
+#endif // PBIO_CONFIG_DRIVEBASE_NUM_WHEELS > 2
+
 /**
  * Makes the drivebase use gyro or motor rotation sensors for heading control.
  *
@@ -352,9 +730,191 @@ pbio_error_t pbio_drivebase_set_use_gyro(pbio_drivebase_t *db, bool use_gyro) {
     }
 
     db->use_gyro = use_gyro;
+
+    #if PBIO_CONFIG_DRIVEBASE_POSE
+    // Keep the pose, but continue from the state of the new heading source.
+    float x, y, heading;
+    err = pbio_drivebase_get_pose(db, &x, &y, &heading);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+    return pbio_drivebase_reset_pose(db, x, y, heading);
+    #else
+    return PBIO_SUCCESS;
+    #endif
+}
+
+#if PBIO_CONFIG_DRIVEBASE_POSE
+
+/**
+ * Advances the pose estimate by the change in distance and heading since the
+ * previous update.
+ *
+ * The heading comes from the gyro if the drive base uses it, and from the
+ * wheel encoders otherwise. The distance always comes from the encoders.
+ *
+ * @param [in]  db              The drivebase instance
+ * @param [in]  states          Physical and estimated state along each axis.
+ */
+static void pbio_drivebase_update_pose(pbio_drivebase_t *db, const pbio_control_state_t *states) {
+
+    pbio_drivebase_pose_t *pose = &db->pose;
+    const pbio_control_state_t *state_distance = &states[PBIO_DRIVEBASE_AXIS_DISTANCE];
+    const pbio_control_state_t *state_heading = &states[PBIO_DRIVEBASE_AXIS_HEADING];
+
+    // Distance (mm) and turn (deg) since the previous update.
+    float distance = pbio_angle_diff_mdeg(&state_distance->position, &pose->distance_last) /
+        (float)db->control_distance.settings.ctl_steps_per_app_step;
+    float turn = pbio_angle_diff_mdeg(&state_heading->position, &pose->heading_last) /
+        (float)db->control_heading.settings.ctl_steps_per_app_step;
+
+    pose->distance_last = state_distance->position;
+    pose->heading_last = state_heading->position;
+
+    // Sideways motion (mm) since the previous update, if any.
+    float lateral = 0.0f;
+    #if PBIO_CONFIG_DRIVEBASE_NUM_WHEELS > 2
+    const pbio_control_state_t *state_lateral = &states[PBIO_DRIVEBASE_AXIS_LATERAL];
+    lateral = pbio_angle_diff_mdeg(&state_lateral->position, &pose->lateral_last) /
+        (float)db->control_distance.settings.ctl_steps_per_app_step;
+    pose->lateral_last = state_lateral->position;
+    #endif
+
+    // Move along the average heading during this step, which is exact for
+    // straight lines and close for arcs at the short loop time.
+    float heading_mid = (pose->heading + turn / 2) * (float)(M_PI / 180);
+    float cos_mid = cosf(heading_mid);
+    float sin_mid = sinf(heading_mid);
+    pose->x += distance * cos_mid - lateral * sin_mid;
+    pose->y += distance * sin_mid + lateral * cos_mid;
+    pose->heading += turn;
+}
+
+/**
+ * Brings the pose estimate up to date if the drivebase is not controlled.
+ *
+ * The control loop skips passive drivebases, so motion while passive, such as
+ * when pushed by hand, is added here in one step when the pose is needed.
+ *
+ * @param [in]  db              The drivebase instance
+ * @return                      Error code.
+ */
+static pbio_error_t pbio_drivebase_update_pose_passive(pbio_drivebase_t *db) {
+
+    if (pbio_drivebase_control_is_active(db)) {
+        return PBIO_SUCCESS;
+    }
+
+    pbio_control_state_t states[PBIO_DRIVEBASE_NUM_AXES];
+    pbio_control_state_t state_wheels[PBIO_CONFIG_DRIVEBASE_NUM_WHEELS];
+    pbio_error_t err = pbio_drivebase_get_state_axes(db, states, state_wheels);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+    pbio_drivebase_update_pose(db, states);
+    return PBIO_SUCCESS;
+}
+
+/**
+ * Gets the estimated pose of the drivebase.
+ *
+ * @param [in]  db          The drivebase instance.
+ * @param [out] x           Position along the initial forward direction in mm.
+ * @param [out] y           Position along the initial rightward direction in mm.
+ * @param [out] heading     Heading in degrees, positive clockwise.
+ * @return                  Error code.
+ */
+pbio_error_t pbio_drivebase_get_pose(pbio_drivebase_t *db, float *x, float *y, float *heading) {
+
+    if (!pbio_drivebase_update_loop_is_running(db)) {
+        return PBIO_ERROR_INVALID_OP;
+    }
+
+    pbio_error_t err = pbio_drivebase_update_pose_passive(db);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+
+    *x = db->pose.x;
+    *y = db->pose.y;
+    *heading = db->pose.heading;
+    return PBIO_SUCCESS;
+}
+
+/**
+ * Sets the estimated pose of the drivebase.
+ *
+ * This does not affect the distance and angle of the drivebase.
+ *
+ * @param [in]  db          The drivebase instance.
+ * @param [in]  x           Position along the forward direction in mm.
+ * @param [in]  y           Position along the rightward direction in mm.
+ * @param [in]  heading     Heading in degrees, positive clockwise.
+ * @return                  Error code.
+ */
+pbio_error_t pbio_drivebase_reset_pose(pbio_drivebase_t *db, float x, float y, float heading) {
+
+    // Get the current state so that the next update continues from here.
+    pbio_control_state_t states[PBIO_DRIVEBASE_NUM_AXES];
+    pbio_control_state_t state_wheels[PBIO_CONFIG_DRIVEBASE_NUM_WHEELS];
+    pbio_error_t err = pbio_drivebase_get_state_axes(db, states, state_wheels);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+
+    db->pose = (pbio_drivebase_pose_t) {
+        .x = x,
+        .y = y,
+        .heading = heading,
+        .distance_last = states[PBIO_DRIVEBASE_AXIS_DISTANCE].position,
+        .heading_last = states[PBIO_DRIVEBASE_AXIS_HEADING].position,
+        #if PBIO_CONFIG_DRIVEBASE_NUM_WHEELS > 2
+        .lateral_last = states[PBIO_DRIVEBASE_AXIS_LATERAL].position,
+        #endif
+    };
     return PBIO_SUCCESS;
 }
 
+static pbio_error_t pbio_drivebase_drive_to_continue(pbio_drivebase_t *db);
+
+#endif // PBIO_CONFIG_DRIVEBASE_POSE
+
+#if PBIO_CONFIG_DRIVEBASE_PATH_SIZE
+
+/**
+ * Checks if the ongoing path segment is done, so the next one can start.
+ *
+ * @param [in]  db          The drivebase instance
+ * @param [in]  time_now    The wall time (ticks).
+ * @return                  True if the next segment can start.
+ */
+static bool pbio_drivebase_path_segment_is_done(pbio_drivebase_t *db, uint32_t time_now) {
+
+    // A segment that is passed at speed is done as soon as its reference
+    // reaches the end. Waiting for the measured position to get there too
+    // would make the next segment start late and cut the path short.
+    if (db->control_distance.on_completion == PBIO_CONTROL_ON_COMPLETION_CONTINUE) {
+        pbio_trajectory_reference_t end;
+        pbio_trajectory_get_endpoint(&db->control_distance.trajectory, &end);
+        return pbio_control_settings_time_is_later(pbio_control_get_ref_time(&db->control_distance, time_now), end.time);
+    }
+
+    // Otherwise, wait until we stand still at the end.
+    return pbio_control_is_done(&db->control_distance) && pbio_control_is_done(&db->control_heading);
+}
+
+static pbio_error_t pbio_drivebase_drive_path_next(pbio_drivebase_t *db);
+
+#endif
+
+#if PBIO_CONFIG_DRIVEBASE_FOLLOW
+static pbio_error_t pbio_drivebase_follow_update(pbio_drivebase_t *db, uint32_t time_now, const pbio_control_state_t *state_heading);
+#endif
+
+#if PBIO_CONFIG_DRIVEBASE_SLIP
+static void pbio_drivebase_slip_update(pbio_drivebase_t *db, uint32_t time_now, const pbio_control_state_t *state_wheels);
+#endif
+
 /**
  * Stops a drivebase.
  *
@@ -383,11 +943,13 @@ pbio_error_t pbio_drivebase_stop(pbio_drivebase_t *db, pbio_control_on_completio
     pbio_drivebase_stop_drivebase_control(db);
 
     // Stop the servos and pass on requested stop type.
-    pbio_error_t err = pbio_servo_stop(db->left, on_completion);
-    if (err != PBIO_SUCCESS) {
-        return err;
+    for (uint8_t i = 0; i < db->num_wheels; i++) {
+        pbio_error_t err = pbio_servo_stop(db->wheels[i].servo, on_completion);
+        if (err != PBIO_SUCCESS) {
+            return err;
+        }
     }
-    return pbio_servo_stop(db->right, on_completion);
+    return PBIO_SUCCESS;
 }
 
 /**
@@ -397,9 +959,68 @@ pbio_error_t pbio_drivebase_stop(pbio_drivebase_t *db, pbio_control_on_completio
  * @return                  True if still moving to target, false if not.
  */
 bool pbio_drivebase_is_done(const pbio_drivebase_t *db) {
+    #if PBIO_CONFIG_DRIVEBASE_POSE
+    // Turning toward the drive_to target is only the first part.
+    if (db->drive_to_pending) {
+        return false;
+    }
+    #endif
+    #if PBIO_CONFIG_DRIVEBASE_PATH_SIZE
+    // A path is done when its last segment is done.
+    if (db->path_next < db->path_size) {
+        return false;
+    }
+    #endif
+    #if PBIO_CONFIG_DRIVEBASE_FOLLOW
+    // Following a line goes on until stopped.
+    if (db->follow.sensor) {
+        return false;
+    }
+    #endif
     return pbio_control_is_done(&db->control_distance) && pbio_control_is_done(&db->control_heading);
 }
 
+/**
+ * Gets the torque that keeps a wheel in sync with the other wheels, for
+ * motion that the axes don't describe.
+ *
+ * @param [in]  db              The drivebase instance.
+ * @param [in]  index           Index of the wheel.
+ * @param [in]  state_wheels    Physical and estimated state of each wheel.
+ * @return                      Torque for this wheel.
+ */
+static int32_t pbio_drivebase_get_wheel_sync_torque(pbio_drivebase_t *db, uint8_t index, const pbio_control_state_t *state_wheels) {
+
+    #if PBIO_CONFIG_DRIVEBASE_NUM_WHEELS > 2
+    // With as many wheels as axes, there is nothing else to keep in sync.
+    if (db->num_wheels <= (db->holonomic ? 3 : 2)) {
+        return 0;
+    }
+
+    // Get how much this wheel is out of sync with the rest.
+    const int32_t *sync = db->wheel_sync[index];
+    const pbio_angle_t *positions[PBIO_CONFIG_DRIVEBASE_NUM_WHEELS];
+    int64_t speed = 0;
+    for (uint8_t i = 0; i < db->num_wheels; i++) {
+        positions[i] = &state_wheels[i].position_estimate;
+        speed += (int64_t)sync[i] * state_wheels[i].speed_estimate;
+    }
+    pbio_angle_t position;
+    pbio_drivebase_odometry_angle(sync, positions, db->num_wheels, &position);
+    if (db->wheel_sync_restart) {
+        db->wheel_sync_start[index] = position;
+    }
+
+    // Drive it back gently, using the reduced gains of distance control
+    // rather than the full gains of the servo.
+    const pbio_control_settings_t *settings = &db->control_distance.settings;
+    return -pbio_control_settings_mul_by_gain(pbio_angle_diff_mdeg(&position, &db->wheel_sync_start[index]), settings->pid_kp) -
+           pbio_control_settings_mul_by_gain(speed / 65536, settings->pid_kd);
+    #else
+    return 0;
+    #endif
+}
+
 /**
  * Updates one drivebase in the control loop.
  *
@@ -419,30 +1040,101 @@ static pbio_error_t pbio_drivebase_update(pbio_drivebase_t *db) {
     // Get current time
     uint32_t time_now = pbio_control_get_time_ticks();
 
-    // Get drive base state
-    pbio_control_state_t state_distance;
-    pbio_control_state_t state_heading;
-    pbio_error_t err = pbio_drivebase_get_state_control(db, &state_distance, &state_heading);
+    // Get drive base state along each axis.
+    pbio_control_state_t states[PBIO_DRIVEBASE_NUM_AXES];
+    pbio_control_state_t state_wheels[PBIO_CONFIG_DRIVEBASE_NUM_WHEELS];
+    pbio_error_t err = pbio_drivebase_get_state_axes(db, states, state_wheels);
     if (err != PBIO_SUCCESS) {
         return err;
     }
+    pbio_control_state_t *state_distance = &states[PBIO_DRIVEBASE_AXIS_DISTANCE];
+    pbio_control_state_t *state_heading = &states[PBIO_DRIVEBASE_AXIS_HEADING];
+
+    #if PBIO_CONFIG_DRIVEBASE_SLIP
+    // Compare the wheels to the IMU to see if they are slipping.
+    pbio_drivebase_slip_update(db, time_now, state_wheels);
+    #endif
+
+    #if PBIO_CONFIG_DRIVEBASE_POSE
+    pbio_drivebase_update_pose(db, states);
+
+    // Once drive_to has turned toward its target, start driving there.
+    if (db->drive_to_pending &&
+        pbio_control_is_done(&db->control_distance) &&
+        pbio_control_is_done(&db->control_heading)) {
+        err = pbio_drivebase_drive_to_continue(db);
+        if (err != PBIO_SUCCESS) {
+            return err;
+        }
+    }
+    #endif
+
+    #if PBIO_CONFIG_DRIVEBASE_PATH_SIZE
+    // Once a path segment is done, start the next one right away.
+    if (db->path_next < db->path_size && pbio_drivebase_path_segment_is_done(db, time_now)) {
+        err = pbio_drivebase_drive_path_next(db);
+        if (err != PBIO_SUCCESS) {
+            return err;
+        }
+    }
+    #endif
+
+    #if PBIO_CONFIG_DRIVEBASE_FOLLOW
+    // Steer toward the line using the latest sensor value.
+    if (db->follow.sensor) {
+        err = pbio_drivebase_follow_update(db, time_now, state_heading);
+        if (err != PBIO_SUCCESS) {
+            // Without a valid sensor value, we can't keep following.
+            pbio_drivebase_stop(db, PBIO_CONTROL_ON_COMPLETION_COAST);
+            return err;
+        }
+    }
+    #endif
 
     // Get reference and torque signals for distance control.
     pbio_trajectory_reference_t ref_distance;
     int32_t distance_torque;
     pbio_dcmotor_actuation_t distance_actuation;
     bool distance_external_pause = db->control_paused;
-    pbio_control_update(&db->control_distance, time_now, &state_distance, &ref_distance, &distance_actuation, &distance_torque, &distance_external_pause);
+    pbio_control_update(&db->control_distance, time_now, state_distance, &ref_distance, &distance_actuation, &distance_torque, &distance_external_pause);
 
     // Get reference and torque signals for heading control.
     pbio_trajectory_reference_t ref_heading;
     int32_t heading_torque;
     pbio_dcmotor_actuation_t heading_actuation;
     bool heading_external_pause = db->control_paused;
-    pbio_control_update(&db->control_heading, time_now, &state_heading, &ref_heading, &heading_actuation, &heading_torque, &heading_external_pause);
+    pbio_control_update(&db->control_heading, time_now, state_heading, &ref_heading, &heading_actuation, &heading_torque, &heading_external_pause);
+
+    // Get reference and torque signals for lateral control, if any.
+    pbio_trajectory_reference_t ref_lateral = { 0 };
+    int32_t lateral_torque = 0;
+    bool lateral_external_pause = false;
+    #if PBIO_CONFIG_DRIVEBASE_NUM_WHEELS > 2
+    if (db->holonomic) {
+        // Following the latest command, start moving sideways at the
+        // requested speed, or start holding still if there is none.
+        if (db->lateral_restart) {
+            db->lateral_restart = false;
+            db->control_lateral.settings = db->control_distance.settings;
+            err = pbio_control_start_timed_control(&db->control_lateral, time_now, &states[PBIO_DRIVEBASE_AXIS_LATERAL],
+                PBIO_TRAJECTORY_DURATION_FOREVER_MS, db->lateral_speed, PBIO_CONTROL_ON_COMPLETION_CONTINUE);
+            if (err != PBIO_SUCCESS) {
+                return err;
+            }
+        }
+        pbio_dcmotor_actuation_t lateral_actuation;
+        lateral_external_pause = db->control_paused;
+        pbio_control_update(&db->control_lateral, time_now, &states[PBIO_DRIVEBASE_AXIS_LATERAL], &ref_lateral, &lateral_actuation, &lateral_torque, &lateral_external_pause);
+
+        // Moving sideways at a given speed never completes, so this is always torque.
+        if (lateral_actuation != PBIO_DCMOTOR_ACTUATION_TORQUE) {
+            return PBIO_ERROR_FAILED;
+        }
+    }
+    #endif
 
-    // If either controller is paused, pause both.
-    db->control_paused = distance_external_pause || heading_external_pause;
+    // If any controller is paused, pause all.
+    db->control_paused = distance_external_pause || heading_external_pause || lateral_external_pause;
 
     // If either controller coasts, coast both, thereby also stopping control.
     if (distance_actuation == PBIO_DCMOTOR_ACTUATION_COAST ||
@@ -461,24 +1153,25 @@ static pbio_error_t pbio_drivebase_update(pbio_drivebase_t *db) {
         return PBIO_ERROR_FAILED;
     }
 
-    // The left servo drives at a torque and speed of (average) + (difference).
-    int32_t feed_forward_left = pbio_observer_get_feedforward_torque(
-        db->left->observer.model,
-        ref_distance.speed + ref_heading.speed, // left speed
-        ref_distance.acceleration + ref_heading.acceleration); // left acceleration
-    err = pbio_servo_actuate(db->left, PBIO_DCMOTOR_ACTUATION_TORQUE,
-        distance_torque + heading_torque + feed_forward_left);
-    if (err != PBIO_SUCCESS) {
-        return err;
+    // Each wheel drives at the torque and speed of its share in the motion
+    // along each axis.
+    for (uint8_t i = 0; i < db->num_wheels; i++) {
+        const pbio_drivebase_wheel_t *wheel = &db->wheels[i];
+        int32_t sync_torque = pbio_drivebase_get_wheel_sync_torque(db, i, state_wheels);
+        int32_t feed_forward = pbio_observer_get_feedforward_torque(
+            &wheel->servo->observer,
+            pbio_drivebase_wheel_combine(db, i, ref_distance.speed, ref_heading.speed, ref_lateral.speed),
+            pbio_drivebase_wheel_combine(db, i, ref_distance.acceleration, ref_heading.acceleration, ref_lateral.acceleration));
+        err = pbio_servo_actuate(wheel->servo, PBIO_DCMOTOR_ACTUATION_TORQUE,
+            pbio_drivebase_wheel_combine(db, i, distance_torque, heading_torque, lateral_torque) + sync_torque + feed_forward);
+        if (err != PBIO_SUCCESS) {
+            return err;
+        }
     }
-
-    // The right servo drives at a torque and speed of (average) - (difference).
-    int32_t feed_forward_right = pbio_observer_get_feedforward_torque(
-        db->right->observer.model,
-        ref_distance.speed - ref_heading.speed, // right speed
-        ref_distance.acceleration - ref_heading.acceleration); // right acceleration
-    return pbio_servo_actuate(db->right, PBIO_DCMOTOR_ACTUATION_TORQUE,
-        distance_torque - heading_torque + feed_forward_right);
+    #if PBIO_CONFIG_DRIVEBASE_NUM_WHEELS > 2
+    db->wheel_sync_restart = false;
+    #endif
+    return PBIO_SUCCESS;
 }
 
 /**
@@ -490,13 +1183,46 @@ void pbio_drivebase_update_all(void) {
 
         pbio_drivebase_t *db = &drivebases[i];
 
-        // If it's registered for updates, run its update loop
-        if (pbio_drivebase_update_loop_is_running(db)) {
+        // If it's registered for updates and actively controlled, run its
+        // update loop. Passive drive bases are skipped without checking
+        // their servos, which are updated on their own.
+        if (pbio_drivebase_control_is_active(db) && pbio_drivebase_update_loop_is_running(db)) {
             pbio_drivebase_update(db);
         }
     }
 }
 
+/**
+ * Stretches the shorter of the distance and heading trajectories so both
+ * controllers complete at the same time.
+ *
+ * @param [in]  db              The drivebase instance.
+ */
+static void pbio_drivebase_synchronize_trajectories(pbio_drivebase_t *db) {
+
+    // At this point, the two trajectories may have different durations, so they won't complete at the same time
+    // To account for this, we re-compute the shortest trajectory to have the same duration as the longest.
+
+    // First, find out which controller takes the lead
+    const pbio_control_t *control_leader;
+    pbio_control_t *control_follower;
+
+    if (pbio_trajectory_get_duration(&db->control_distance.trajectory) >
+        pbio_trajectory_get_duration(&db->control_heading.trajectory)) {
+        // Distance control takes the longest, so it will take the lead
+        control_leader = &db->control_distance;
+        control_follower = &db->control_heading;
+    } else {
+        // Heading control takes the longest, so it will take the lead
+        control_leader = &db->control_heading;
+        control_follower = &db->control_distance;
+    }
+
+    // Revise follower trajectory so it takes as long as the leader, achieved
+    // by picking a lower speed and accelerations that makes the times match.
+    pbio_trajectory_stretch(&control_follower->trajectory, &control_leader->trajectory);
+}
+
 /**
  * Starts the drivebase controllers to run by a given distance and angle.
  *
@@ -518,6 +1244,9 @@ static pbio_error_t pbio_drivebase_drive_relative(pbio_drivebase_t *db, int32_t
     // Stop servo control in case it was running.
     pbio_drivebase_stop_servo_control(db);
 
+    // This replaces any ongoing drive_to or path command.
+    pbio_drivebase_cancel_pending_commands(db);
+
     // Get current time
     uint32_t time_now = pbio_control_get_time_ticks();
 
@@ -541,28 +1270,7 @@ static pbio_error_t pbio_drivebase_drive_relative(pbio_drivebase_t *db, int32_t
         return err;
     }
 
-    // At this point, the two trajectories may have different durations, so they won't complete at the same time
-    // To account for this, we re-compute the shortest trajectory to have the same duration as the longest.
-
-    // First, find out which controller takes the lead
-    const pbio_control_t *control_leader;
-    pbio_control_t *control_follower;
-
-    if (pbio_trajectory_get_duration(&db->control_distance.trajectory) >
-        pbio_trajectory_get_duration(&db->control_heading.trajectory)) {
-        // Distance control takes the longest, so it will take the lead
-        control_leader = &db->control_distance;
-        control_follower = &db->control_heading;
-    } else {
-        // Heading control takes the longest, so it will take the lead
-        control_leader = &db->control_heading;
-        control_follower = &db->control_distance;
-    }
-
-    // Revise follower trajectory so it takes as long as the leader, achieved
-    // by picking a lower speed and accelerations that makes the times match.
-    pbio_trajectory_stretch(&control_follower->trajectory, &control_leader->trajectory);
-
+    pbio_drivebase_synchronize_trajectories(db);
     return PBIO_SUCCESS;
 }
 
@@ -594,16 +1302,210 @@ pbio_error_t pbio_drivebase_drive_straight(pbio_drivebase_t *db, int32_t distanc
  */
 pbio_error_t pbio_drivebase_drive_curve(pbio_drivebase_t *db, int32_t radius, int32_t angle, pbio_control_on_completion_t on_completion) {
 
+    pbio_drivebase_path_segment_t arc;
+    pbio_drivebase_get_arc_segment(radius, angle, &arc);
+
+    // Execute the common drive command at default speed (by passing 0 speed).
+    return pbio_drivebase_drive_relative(db, arc.distance, 0, arc.angle, 0, on_completion);
+}
+
+/**
+ * Gets the distance and angle to drive by to follow an arc.
+ *
+ * @param [in]  radius          Radius of the arc in mm.
+ * @param [in]  angle           Angle in degrees.
+ * @param [out] segment         Distance and angle of the arc.
+ */
+void pbio_drivebase_get_arc_segment(int32_t radius, int32_t angle, pbio_drivebase_path_segment_t *segment) {
+
     // The angle is signed by the radius so we can go both ways.
-    int32_t arc_angle = radius < 0 ? -angle : angle;
+    segment->angle = radius < 0 ? -angle : angle;
 
     // Arc length is computed accordingly.
-    int32_t arc_length = (10 * pbio_int_math_abs(angle) * radius) / 573;
+    segment->distance = (10 * pbio_int_math_abs(angle) * radius) / 573;
+}
 
-    // Execute the common drive command at default speed (by passing 0 speed).
-    return pbio_drivebase_drive_relative(db, arc_length, 0, arc_angle, 0, on_completion);
+#if PBIO_CONFIG_DRIVEBASE_PATH_SIZE
+
+/**
+ * Starts the next segment of the path.
+ *
+ * @param [in]  db              The drivebase instance.
+ * @return                      Error code.
+ */
+static pbio_error_t pbio_drivebase_drive_path_next(pbio_drivebase_t *db) {
+
+    const pbio_drivebase_path_segment_t *segment = &db->path[db->path_next++];
+
+    // Pass the end of this segment at speed if the next one keeps driving in
+    // the same direction, so there is no stop in between. Otherwise hold
+    // there until the next one starts.
+    pbio_control_on_completion_t on_completion = db->path_on_completion;
+    if (db->path_next < db->path_size) {
+        int32_t direction = pbio_int_math_sign(segment->distance);
+        on_completion = direction != 0 && direction == pbio_int_math_sign(db->path[db->path_next].distance) ?
+            PBIO_CONTROL_ON_COMPLETION_CONTINUE : PBIO_CONTROL_ON_COMPLETION_HOLD;
+    }
+
+    // The segment ends add up, so deviations at the joins don't accumulate.
+    db->path_distance_end += segment->distance;
+    db->path_heading_end += segment->angle;
+
+    // Get current time
+    uint32_t time_now = pbio_control_get_time_ticks();
+
+    // Get drive base state
+    pbio_control_state_t state_distance;
+    pbio_control_state_t state_heading;
+    pbio_error_t err = pbio_drivebase_get_state_control(db, &state_distance, &state_heading);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+
+    // Each controller branches off from its ongoing reference, if any.
+    err = pbio_control_start_position_control(&db->control_distance, time_now, &state_distance, db->path_distance_end, 0, on_completion);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+    err = pbio_control_start_position_control(&db->control_heading, time_now, &state_heading, db->path_heading_end, 0, on_completion);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+
+    pbio_drivebase_synchronize_trajectories(db);
+    return PBIO_SUCCESS;
+}
+
+/**
+ * Starts driving along a path of lines and arcs.
+ *
+ * Each segment starts right after the previous one. Where consecutive
+ * segments drive in the same direction, the drivebase keeps going at speed
+ * instead of stopping at the join. This will use the default speed.
+ *
+ * @param [in]  db              The drivebase instance.
+ * @param [in]  segments        Distance and angle of each segment.
+ * @param [in]  num_segments    Number of segments.
+ * @param [in]  on_completion   What to do at the end of the path.
+ * @return                      ::PBIO_ERROR_INVALID_ARG if there are no
+ *                              segments or too many, otherwise error code.
+ */
+pbio_error_t pbio_drivebase_drive_path(pbio_drivebase_t *db, const pbio_drivebase_path_segment_t *segments, uint8_t num_segments, pbio_control_on_completion_t on_completion) {
+
+    // Don't allow new user command if update loop not registered.
+    if (!pbio_drivebase_update_loop_is_running(db)) {
+        return PBIO_ERROR_INVALID_OP;
+    }
+
+    if (num_segments == 0 || num_segments > PBIO_CONFIG_DRIVEBASE_PATH_SIZE) {
+        return PBIO_ERROR_INVALID_ARG;
+    }
+
+    // Stop servo control in case it was running.
+    pbio_drivebase_stop_servo_control(db);
+
+    // This replaces any ongoing drive_to or path command.
+    pbio_drivebase_cancel_pending_commands(db);
+
+    // Get current time
+    uint32_t time_now = pbio_control_get_time_ticks();
+
+    // Get drive base state
+    pbio_control_state_t state_distance;
+    pbio_control_state_t state_heading;
+    pbio_error_t err = pbio_drivebase_get_state_control(db, &state_distance, &state_heading);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+
+    // The path starts from the ongoing reference if the drivebase is already
+    // being controlled, or from where it is now otherwise.
+    pbio_trajectory_reference_t ref;
+    if (pbio_drivebase_control_is_active(db)) {
+        pbio_control_get_reference(&db->control_distance, time_now, &state_distance, &ref);
+        state_distance.position = ref.position;
+        pbio_control_get_reference(&db->control_heading, time_now, &state_heading, &ref);
+        state_heading.position = ref.position;
+    }
+    db->path_distance_end = pbio_control_settings_ctl_to_app_long(&db->control_distance.settings, &state_distance.position);
+    db->path_heading_end = pbio_control_settings_ctl_to_app_long(&db->control_heading.settings, &state_heading.position);
+
+    for (uint8_t i = 0; i < num_segments; i++) {
+        db->path[i] = segments[i];
+    }
+    db->path_size = num_segments;
+    db->path_next = 0;
+    db->path_on_completion = on_completion;
+
+    return pbio_drivebase_drive_path_next(db);
+}
+
+#endif // PBIO_CONFIG_DRIVEBASE_PATH_SIZE
+
+#if PBIO_CONFIG_DRIVEBASE_POSE
+
+/**
+ * Starts driving to a point, by first turning toward it and then driving
+ * straight to it.
+ *
+ * This will use the default speed.
+ *
+ * @param [in]  db              The drivebase instance.
+ * @param [in]  x               Target position along the x-axis of the pose in mm.
+ * @param [in]  y               Target position along the y-axis of the pose in mm.
+ * @param [in]  on_completion   What to do when reaching the target.
+ * @return                      Error code.
+ */
+pbio_error_t pbio_drivebase_drive_to(pbio_drivebase_t *db, float x, float y, pbio_control_on_completion_t on_completion) {
+
+    // Start from where the drive base is now, even if it was moved by hand.
+    pbio_error_t err = pbio_drivebase_update_pose_passive(db);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+
+    float dx = x - db->pose.x;
+    float dy = y - db->pose.y;
+
+    // Turn the shortest way to face the target, unless we are already there.
+    float turn = 0.0f;
+    if (dx * dx + dy * dy >= 1.0f) {
+        turn = remainderf(atan2f(dy, dx) * (float)(180 / M_PI) - db->pose.heading, 360.0f);
+    }
+
+    // Hold at the end of the turn so the heading doesn't drift before we
+    // start driving. This also resets the pending state.
+    err = pbio_drivebase_drive_relative(db, 0, 0, lroundf(turn), 0, PBIO_CONTROL_ON_COMPLETION_HOLD);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+
+    db->drive_to_pending = true;
+    db->drive_to_x = x;
+    db->drive_to_y = y;
+    db->drive_to_on_completion = on_completion;
+    return PBIO_SUCCESS;
+}
+
+/**
+ * Drives straight toward the drive_to target after turning toward it.
+ *
+ * @param [in]  db              The drivebase instance.
+ * @return                      Error code.
+ */
+static pbio_error_t pbio_drivebase_drive_to_continue(pbio_drivebase_t *db) {
+
+    // Drive by the distance to the target as seen along the current heading,
+    // so a small remaining heading error does not make us overshoot.
+    float heading = db->pose.heading * (float)(M_PI / 180);
+    float distance = (db->drive_to_x - db->pose.x) * cosf(heading) +
+        (db->drive_to_y - db->pose.y) * sinf(heading);
+
+    return pbio_drivebase_drive_relative(db, lroundf(distance), 0, 0, 0, db->drive_to_on_completion);
 }
 
+#endif // PBIO_CONFIG_DRIVEBASE_POSE
+
 /**
  * Starts the drivebase controllers to run for a given duration.
  *
@@ -624,6 +1526,9 @@ static pbio_error_t pbio_drivebase_drive_time_common(pbio_drivebase_t *db, int32
     // Stop servo control in case it was running.
     pbio_drivebase_stop_servo_control(db);
 
+    // This replaces any ongoing drive_to or path command.
+    pbio_drivebase_cancel_pending_commands(db);
+
     // Get current time
     uint32_t time_now = pbio_control_get_time_ticks();
 
@@ -661,6 +1566,394 @@ pbio_error_t pbio_drivebase_drive_forever(pbio_drivebase_t *db, int32_t speed, i
     return pbio_drivebase_drive_time_common(db, speed, turn_rate, PBIO_TRAJECTORY_DURATION_FOREVER_MS, PBIO_CONTROL_ON_COMPLETION_CONTINUE);
 }
 
+#if PBIO_CONFIG_DRIVEBASE_NUM_WHEELS > 2
+
+/**
+ * Starts the drivebase controllers to run forever, also moving sideways.
+ *
+ * This only works with wheels that can drive sideways, such as mecanum wheels.
+ *
+ * @param [in]  db              The drivebase instance.
+ * @param [in]  speed           The drive speed in mm/s.
+ * @param [in]  lateral_speed   The sideways speed to the right in mm/s.
+ * @param [in]  turn_rate       The turn rate in deg/s.
+ * @return                      Error code.
+ */
+pbio_error_t pbio_drivebase_drive_forever_holonomic(pbio_drivebase_t *db, int32_t speed, int32_t lateral_speed, int32_t turn_rate) {
+
+    if (!db->holonomic && lateral_speed != 0) {
+        return PBIO_ERROR_NOT_SUPPORTED;
+    }
+
+    pbio_error_t err = pbio_drivebase_drive_forever(db, speed, turn_rate);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+
+    // The lateral controller picks this up in the next control loop update.
+    db->lateral_speed = lateral_speed;
+    db->lateral_restart = true;
+    return PBIO_SUCCESS;
+}
+
+#endif // PBIO_CONFIG_DRIVEBASE_NUM_WHEELS > 2
+
+#if PBIO_CONFIG_DRIVEBASE_FOLLOW
+
+/** Time constant (s) of the low-pass filter on the derivative of the line follower. */
+#define PBIO_DRIVEBASE_FOLLOW_DERIVATIVE_TIME_CONSTANT (0.05f)
+
+/** Time (ms) without a new sensor value after which the line follower stops. */
+#define PBIO_DRIVEBASE_FOLLOW_TIMEOUT (500)
+
+/**
+ * Starts driving forever while steering toward a line.
+ *
+ * In every control loop iteration, the sensor is read and the turn rate is
+ * set proportional to the difference between the sensor value and the
+ * target, plus the integral and derivative of this difference. A positive
+ * difference makes the robot turn clockwise. Negative gains can be used to
+ * follow the other edge of the line.
+ *
+ * This continues until another command is given, or until the sensor fails
+ * or gives no new value for ::PBIO_DRIVEBASE_FOLLOW_TIMEOUT ms.
+ *
+ * @param [in]  db              The drivebase instance.
+ * @param [in]  sensor          Function that reads the sensor.
+ * @param [in]  context         Sensor instance passed to @p sensor.
+ * @param [in]  speed           The drive speed in mm/s.
+ * @param [in]  target          Sensor value to steer toward.
+ * @param [in]  kp              Proportional gain ((deg/s) per unit of the sensor value).
+ * @param [in]  ki              Integral gain ((deg/s) per unit of the sensor value times s).
+ * @param [in]  kd              Derivative gain ((deg/s) per unit of the sensor value per s).
+ * @return                      Error code.
+ */
+pbio_error_t pbio_drivebase_follow(pbio_drivebase_t *db, pbio_drivebase_follow_sensor_func_t sensor, void *context, int32_t speed, float target, float kp, float ki, float kd) {
+
+    if (!sensor) {
+        return PBIO_ERROR_INVALID_ARG;
+    }
+
+    // Start driving straight. The heading is updated once the sensor is read.
+    pbio_error_t err = pbio_drivebase_drive_forever(db, speed, 0);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+
+    db->follow = (pbio_drivebase_follow_t) {
+        .sensor = sensor,
+        .context = context,
+        .target = target,
+        .kp = kp,
+        .ki = ki,
+        .kd = kd,
+        .time_last = pbio_control_get_time_ticks(),
+    };
+    return PBIO_SUCCESS;
+}
+
+/**
+ * Updates the turn rate of the line follower using the latest sensor value.
+ *
+ * @param [in]  db              The drivebase instance.
+ * @param [in]  time_now        The wall time (ticks).
+ * @param [in]  state_heading   The current heading state.
+ * @return                      ::PBIO_ERROR_TIMEDOUT if the sensor gave no new
+ *                              value for too long, otherwise error code.
+ */
+static pbio_error_t pbio_drivebase_follow_update(pbio_drivebase_t *db, uint32_t time_now, const pbio_control_state_t *state_heading) {
+
+    pbio_drivebase_follow_t *follow = &db->follow;
+
+    // Read the sensor. If it isn't ready, keep the current turn rate for a
+    // little while, but don't steer on an old value indefinitely.
+    int32_t value;
+    pbio_error_t err = follow->sensor(follow->context, &value);
+    if (err == PBIO_ERROR_AGAIN) {
+        if (time_now - follow->time_last > pbio_control_time_ms_to_ticks(PBIO_DRIVEBASE_FOLLOW_TIMEOUT)) {
+            return PBIO_ERROR_TIMEDOUT;
+        }
+        return PBIO_SUCCESS;
+    }
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+
+    float error = value - follow->target;
+
+    // The first sample has no history to differentiate or integrate.
+    float dt = 0.0f;
+    if (follow->started) {
+        dt = pbio_control_time_ticks_to_ms(time_now - follow->time_last) / 1000.0f;
+        if (dt > 0.0f) {
+            // Sensor values are integers that change by only a few units per
+            // sample, so low-pass filter the derivative to reduce the noise.
+            float derivative = (error - follow->error_last) / dt;
+            follow->derivative += (derivative - follow->derivative) * dt / (PBIO_DRIVEBASE_FOLLOW_DERIVATIVE_TIME_CONSTANT + dt);
+        }
+    }
+    follow->started = true;
+    follow->error_last = error;
+    follow->time_last = time_now;
+
+    // Compute the turn rate, limited to the maximum turn rate.
+    float turn_rate_max = pbio_control_settings_ctl_to_app(&db->control_heading.settings, db->control_heading.settings.speed_max);
+    float turn_rate = follow->kp * error + follow->ki * (follow->integral + error * dt) + follow->kd * follow->derivative;
+    if (turn_rate > turn_rate_max) {
+        turn_rate = turn_rate_max;
+    } else if (turn_rate < -turn_rate_max) {
+        turn_rate = -turn_rate_max;
+    } else {
+        // Integrate only while not saturated to avoid windup.
+        follow->integral += error * dt;
+    }
+
+    // Branch off from the current heading reference at the new turn rate.
+    return pbio_control_start_timed_control(&db->control_heading, time_now, state_heading,
+        PBIO_TRAJECTORY_DURATION_FOREVER_MS, (int32_t)turn_rate, PBIO_CONTROL_ON_COMPLETION_CONTINUE);
+}
+
+// Gets the mode in which a color sensor measures the reflection.
+static pbio_error_t pbio_drivebase_follow_get_reflection_mode(pbdrv_legodev_type_id_t type_id, uint8_t *mode) {
+    switch (type_id) {
+        case PBDRV_LEGODEV_TYPE_ID_SPIKE_COLOR_SENSOR:
+            *mode = PBDRV_LEGODEV_MODE_PUP_COLOR_SENSOR__RGB_I;
+            return PBIO_SUCCESS;
+        case PBDRV_LEGODEV_TYPE_ID_COLOR_DIST_SENSOR:
+            *mode = PBDRV_LEGODEV_MODE_PUP_COLOR_DISTANCE_SENSOR__RGB_I;
+            return PBIO_SUCCESS;
+        case PBDRV_LEGODEV_TYPE_ID_EV3_COLOR_SENSOR:
+            *mode = PBDRV_LEGODEV_MODE_EV3_COLOR_SENSOR__REFLECT;
+            return PBIO_SUCCESS;
+        default:
+            return PBIO_ERROR_NOT_SUPPORTED;
+    }
+}
+
+/**
+ * Reads the reflection of a color sensor, for use with the line follower.
+ *
+ * Supports the SPIKE Color Sensor, the Color and Distance Sensor, and the
+ * EV3 Color Sensor. If the sensor is not in the right mode, it is switched.
+ * While following, the sensor stays in this mode, as checked by
+ * ::pbio_drivebase_follow_check_sensor_mode.
+ *
+ * @param [in]  legodev         The legodev instance of the sensor.
+ * @param [out] reflection      Reflection (%).
+ * @return                      ::PBIO_SUCCESS on success.
+ *                              ::PBIO_ERROR_AGAIN if the sensor is not ready yet.
+ *                              ::PBIO_ERROR_NOT_SUPPORTED if this is not a supported sensor.
+ *                              Otherwise another error code.
+ */
+pbio_error_t pbio_drivebase_follow_get_reflection(void *legodev, int32_t *reflection) {
+
+    pbdrv_legodev_info_t *info;
+    pbio_error_t err = pbdrv_legodev_get_info(legodev, &info);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+
+    uint8_t mode;
+    err = pbio_drivebase_follow_get_reflection_mode(info->type_id, &mode);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+
+    void *data;
+    err = pbdrv_legodev_get_data(legodev, mode, &data);
+    if (err == PBIO_ERROR_INVALID_OP) {
+        // Wrong mode, so switch and try again later.
+        err = pbdrv_legodev_set_mode(legodev, mode);
+        return err == PBIO_SUCCESS ? PBIO_ERROR_AGAIN : err;
+    }
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+
+    // Scale as in the reflection methods of the respective sensors.
+    switch (info->type_id) {
+        case PBDRV_LEGODEV_TYPE_ID_SPIKE_COLOR_SENSOR: {
+            int16_t *rgb = data;
+            *reflection = (rgb[0] + rgb[1] + rgb[2]) * 100 / 3072;
+            break;
+        }
+        case PBDRV_LEGODEV_TYPE_ID_COLOR_DIST_SENSOR: {
+            int16_t *rgb = data;
+            *reflection = (rgb[0] + rgb[1] + rgb[2]) / 12;
+            break;
+        }
+        default:
+            *reflection = *(int8_t *)data;
+            break;
+    }
+    return PBIO_SUCCESS;
+}
+
+/**
+ * Checks that a sensor can be used in the given mode.
+ *
+ * A sensor used by a line follower must stay in the mode that it reads, so
+ * it can't be used in other modes until the drive base does something else.
+ *
+ * @param [in]  legodev         The legodev instance of the sensor.
+ * @param [in]  mode            The mode to use.
+ * @return                      ::PBIO_ERROR_BUSY if a line follower uses the
+ *                              sensor in another mode, otherwise ::PBIO_SUCCESS.
+ */
+pbio_error_t pbio_drivebase_follow_check_sensor_mode(void *legodev, uint8_t mode) {
+    for (uint8_t i = 0; i < PBIO_CONFIG_NUM_DRIVEBASES; i++) {
+        pbio_drivebase_follow_t *follow = &drivebases[i].follow;
+        if (follow->sensor != pbio_drivebase_follow_get_reflection || follow->context != legodev) {
+            continue;
+        }
+        pbdrv_legodev_info_t *info;
+        uint8_t follow_mode;
+        if (pbdrv_legodev_get_info(legodev, &info) == PBIO_SUCCESS &&
+            pbio_drivebase_follow_get_reflection_mode(info->type_id, &follow_mode) == PBIO_SUCCESS &&
+            follow_mode != mode) {
+            return PBIO_ERROR_BUSY;
+        }
+    }
+    return PBIO_SUCCESS;
+}
+
+#endif // PBIO_CONFIG_DRIVEBASE_FOLLOW
+
+#if PBIO_CONFIG_DRIVEBASE_SLIP
+
+/** Time constant (s) of the low-pass filter on the slip errors. */
+#define PBIO_DRIVEBASE_SLIP_TIME_CONSTANT (0.1f)
+
+/** Heading rate error (deg/s) above which the wheels are slipping. */
+#define PBIO_DRIVEBASE_SLIP_HEADING_RATE_MAX (30.0f)
+
+/** Acceleration error (mm/s^2) above which the wheels are slipping. */
+#define PBIO_DRIVEBASE_SLIP_ACCELERATION_MAX (2000.0f)
+
+/**
+ * Compares the heading rate and acceleration measured by the wheels to those
+ * measured by the IMU, and reduces the acceleration if the wheels start
+ * slipping and this is enabled.
+ *
+ * @param [in]  db              The drivebase instance.
+ * @param [in]  time_now        The wall time (ticks).
+ * @param [in]  state_wheels    Physical and estimated state of each wheel.
+ */
+static void pbio_drivebase_slip_update(pbio_drivebase_t *db, uint32_t time_now, const pbio_control_state_t *state_wheels) {
+
+    pbio_drivebase_slip_t *slip = &db->slip;
+
+    // Get the drive speed and heading rate of the wheels, even if the heading
+    // is otherwise taken from the gyro.
+    int64_t speed = 0;
+    int64_t heading_rate = 0;
+    for (uint8_t i = 0; i < db->num_wheels; i++) {
+        speed += (int64_t)db->odometry[PBIO_DRIVEBASE_AXIS_DISTANCE][i] * state_wheels[i].speed_estimate;
+        heading_rate += (int64_t)db->odometry[PBIO_DRIVEBASE_AXIS_HEADING][i] * state_wheels[i].speed_estimate;
+    }
+    float speed_wheels = (speed / 65536) / (float)db->control_distance.settings.ctl_steps_per_app_step;
+    float heading_rate_wheels = (heading_rate / 65536) / (float)db->control_heading.settings.ctl_steps_per_app_step;
+
+    // The first sample has no history to differentiate.
+    float dt = pbio_control_time_ticks_to_ms(time_now - slip->time_last) / 1000.0f;
+    float speed_last = slip->speed_last;
+    bool started = slip->started;
+    slip->started = true;
+    slip->speed_last = speed_wheels;
+    slip->time_last = time_now;
+    if (!started || dt <= 0.0f) {
+        return;
+    }
+    float acceleration_wheels = (speed_wheels - speed_last) / dt;
+
+    // The gyro and accelerometer in the frame of the robot. Like the gyro
+    // heading, a positive heading rate is clockwise. Gravity is taken out of
+    // the acceleration so that driving on a ramp is not seen as slipping.
+    pbio_geometry_xyz_t angular_velocity;
+    pbio_geometry_xyz_t acceleration;
+    pbio_imu_get_angular_velocity(&angular_velocity);
+    pbio_imu_get_linear_acceleration(&acceleration);
+
+    // Differentiating the speed is noisy, and so is the accelerometer on a
+    // moving robot, so low-pass filter the errors.
+    float alpha = dt / (PBIO_DRIVEBASE_SLIP_TIME_CONSTANT + dt);
+    slip->heading_rate_error += (heading_rate_wheels + angular_velocity.z - slip->heading_rate_error) * alpha;
+    slip->acceleration_error += (acceleration_wheels - acceleration.x - slip->acceleration_error) * alpha;
+
+    bool slipping_last = slip->slipping;
+    slip->slipping = fabsf(slip->heading_rate_error) > PBIO_DRIVEBASE_SLIP_HEADING_RATE_MAX ||
+        fabsf(slip->acceleration_error) > PBIO_DRIVEBASE_SLIP_ACCELERATION_MAX;
+
+    // Each time the wheels start slipping, reduce the acceleration for the
+    // next maneuver, down to a quarter of the original value.
+    if (slip->limit && slip->slipping && !slipping_last) {
+        pbio_control_settings_t *sd = &db->control_distance.settings;
+        pbio_control_settings_t *sh = &db->control_heading.settings;
+        sd->acceleration = pbio_int_math_max(sd->acceleration * 3 / 4, slip->distance_acceleration / 4);
+        sd->deceleration = pbio_int_math_max(sd->deceleration * 3 / 4, slip->distance_deceleration / 4);
+        sh->acceleration = pbio_int_math_max(sh->acceleration * 3 / 4, slip->heading_acceleration / 4);
+        sh->deceleration = pbio_int_math_max(sh->deceleration * 3 / 4, slip->heading_deceleration / 4);
+    }
+}
+
+/**
+ * Checks whether the wheels are slipping, based on how much the heading rate
+ * and the acceleration measured by the wheels differ from the IMU.
+ *
+ * @param [in]  db                  The drivebase instance.
+ * @param [out] slipping            True if slipping, false if not.
+ * @param [out] heading_rate_error  Heading rate of the wheels minus that of the gyro (deg/s).
+ * @param [out] acceleration_error  Acceleration of the wheels minus that of the accelerometer (mm/s^2).
+ * @return                          Error code. ::PBIO_ERROR_INVALID_OP if update
+ *                                  loop not running, else ::PBIO_SUCCESS
+ */
+pbio_error_t pbio_drivebase_is_slipping(pbio_drivebase_t *db, bool *slipping, float *heading_rate_error, float *acceleration_error) {
+
+    // Don't allow access if update loop not registered.
+    if (!pbio_drivebase_update_loop_is_running(db)) {
+        *slipping = false;
+        *heading_rate_error = 0.0f;
+        *acceleration_error = 0.0f;
+        return PBIO_ERROR_INVALID_OP;
+    }
+
+    *slipping = db->slip.slipping;
+    *heading_rate_error = db->slip.heading_rate_error;
+    *acceleration_error = db->slip.acceleration_error;
+    return PBIO_SUCCESS;
+}
+
+/**
+ * Sets whether to reduce the acceleration of the drive base each time the
+ * wheels start slipping. The reduced values apply to the next maneuver.
+ *
+ * Enabling it starts from the current drive settings. Disabling it restores
+ * the acceleration to what it was before any reductions.
+ *
+ * @param [in]  db              The drivebase instance.
+ * @param [in]  limit           Whether to reduce the acceleration on slip.
+ */
+void pbio_drivebase_set_slip_limit(pbio_drivebase_t *db, bool limit) {
+    pbio_drivebase_slip_t *slip = &db->slip;
+    pbio_control_settings_t *sd = &db->control_distance.settings;
+    pbio_control_settings_t *sh = &db->control_heading.settings;
+
+    if (limit) {
+        slip->distance_acceleration = sd->acceleration;
+        slip->distance_deceleration = sd->deceleration;
+        slip->heading_acceleration = sh->acceleration;
+        slip->heading_deceleration = sh->deceleration;
+    } else if (slip->limit) {
+        sd->acceleration = slip->distance_acceleration;
+        sd->deceleration = slip->distance_deceleration;
+        sh->acceleration = slip->heading_acceleration;
+        sh->deceleration = slip->heading_deceleration;
+    }
+    slip->limit = limit;
+}
+
+#endif // PBIO_CONFIG_DRIVEBASE_SLIP
+
 /**
  * Gets the drivebase state in user units.
  *
@@ -762,9 +2055,45 @@ pbio_error_t pbio_drivebase_set_drive_settings(pbio_drivebase_t *db, int32_t dri
     sh->acceleration = pbio_control_settings_app_to_ctl(sh, turn_acceleration);
     sh->deceleration = pbio_control_settings_app_to_ctl(sh, turn_deceleration);
 
+    #if PBIO_CONFIG_DRIVEBASE_SLIP
+    // Slip reduces the acceleration starting from these new values.
+    if (db->slip.limit) {
+        pbio_drivebase_set_slip_limit(db, true);
+    }
+    #endif
+
     return PBIO_SUCCESS;
 }
 
+/**
+ * Gets the shape of the speed profile of the drivebase.
+ *
+ * @param [in]  db                  Drivebase instance.
+ * @return                          The trajectory profile.
+ */
+pbio_trajectory_profile_t pbio_drivebase_get_drive_profile(const pbio_drivebase_t *db) {
+    return pbio_control_settings_get_trajectory_profile(&db->control_distance.settings);
+}
+
+/**
+ * Sets the shape of the speed profile of the drivebase.
+ *
+ * Distance and heading use the same profile, so that their trajectories keep
+ * the same shape when driving a curve.
+ *
+ * @param [in]  db                  Drivebase instance.
+ * @param [in]  profile             The trajectory profile.
+ * @return                          ::PBIO_SUCCESS on success, or an error
+ *                                  from ::pbio_control_settings_set_trajectory_profile.
+ */
+pbio_error_t pbio_drivebase_set_drive_profile(pbio_drivebase_t *db, pbio_trajectory_profile_t profile) {
+    pbio_error_t err = pbio_control_settings_set_trajectory_profile(&db->control_distance.settings, profile);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+    return pbio_control_settings_set_trajectory_profile(&db->control_heading.settings, profile);
+}
+
 /**
  * Checks whether drivebase is stalled. If the drivebase is actively
  * controlled, it is stalled when the controller(s) cannot maintain the
@@ -801,22 +2130,20 @@ pbio_error_t pbio_drivebase_is_stalled(pbio_drivebase_t *db, bool *stalled, uint
         return PBIO_SUCCESS;
     }
 
-    // Otherwise look at individual servos.
-    bool stalled_left;
-    bool stalled_right;
-    uint32_t stall_duration_left; // ms, 0 on false.
-    uint32_t stall_duration_right; // ms, 0 on false.
-    err = pbio_servo_is_stalled(db->left, &stalled_left, &stall_duration_left);
-    if (err != PBIO_SUCCESS) {
-        return err;
-    }
-    err = pbio_servo_is_stalled(db->left, &stalled_right, &stall_duration_right);
-    if (err != PBIO_SUCCESS) {
-        return err;
+    // Otherwise look at individual servos. We are stalled if at least one
+    // motor is stalled.
+    *stalled = false;
+    *stall_duration = 0;
+    for (uint8_t i = 0; i < db->num_wheels; i++) {
+        bool stalled_wheel;
+        uint32_t stall_duration_wheel; // ms, 0 on false.
+        err = pbio_servo_is_stalled(db->wheels[i].servo, &stalled_wheel, &stall_duration_wheel);
+        if (err != PBIO_SUCCESS) {
+            return err;
+        }
+        *stalled |= stalled_wheel;
+        *stall_duration = pbio_int_math_max(*stall_duration, stall_duration_wheel);
     }
-    // We are stalled if at least one motor is stalled.
-    *stalled = stalled_left || stalled_right;
-    *stall_duration = pbio_int_math_max(stall_duration_left, stall_duration_right);
     return PBIO_SUCCESS;
 }
 
@@ -216,3 +216,146 @@ pbio_error_t pbio_geometry_map_from_base_axes(pbio_geometry_xyz_t *x_axis, pbio_
 
     return PBIO_SUCCESS;
 }
+
+/**
+ * Multiplies a matrix by the transpose of another: output = a * b^T
+ *
+ * @param [in]  a       The first matrix.
+ * @param [in]  b       The second matrix, which is transposed.
+ * @param [out] output  The result.
+ */
+void pbio_geometry_matrix_multiply_transpose(pbio_geometry_matrix_3x3_t *a, pbio_geometry_matrix_3x3_t *b, pbio_geometry_matrix_3x3_t *output) {
+    for (uint8_t r = 0; r < 3; r++) {
+        for (uint8_t c = 0; c < 3; c++) {
+            output->values[r * 3 + c] =
+                a->values[r * 3 + 0] * b->values[c * 3 + 0] +
+                a->values[r * 3 + 1] * b->values[c * 3 + 1] +
+                a->values[r * 3 + 2] * b->values[c * 3 + 2];
+        }
+    }
+}
+
+/**
+ * Normalizes a quaternion so it has unit length.
+ *
+ * @param [inout]  q    The quaternion to normalize.
+ * @return              ::PBIO_ERROR_INVALID_ARG if the quaternion has zero length, otherwise ::PBIO_SUCCESS.
+ */
+pbio_error_t pbio_geometry_quaternion_normalize(pbio_geometry_quaternion_t *q) {
+
+    float norm = sqrtf(q->w * q->w + q->x * q->x + q->y * q->y + q->z * q->z);
+
+    if (norm == 0.0f) {
+        return PBIO_ERROR_INVALID_ARG;
+    }
+
+    q->w /= norm;
+    q->x /= norm;
+    q->y /= norm;
+    q->z /= norm;
+    return PBIO_SUCCESS;
+}
+
+/**
+ * Gets the attitude quaternion that maps the given gravity vector to the
+ * vertical axis, without rotation about that axis.
+ *
+ * @param [in]  gravity The measured acceleration while stationary, pointing up.
+ * @param [out] q       The resulting attitude.
+ * @return              ::PBIO_ERROR_INVALID_ARG if the gravity vector has zero length, otherwise ::PBIO_SUCCESS.
+ */
+pbio_error_t pbio_geometry_quaternion_from_gravity(pbio_geometry_xyz_t *gravity, pbio_geometry_quaternion_t *q) {
+
+    pbio_geometry_xyz_t up;
+    pbio_error_t err = pbio_geometry_vector_normalize(gravity, &up);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+
+    // Half angles of pitch and roll, with zero yaw.
+    float pitch = atan2f(-up.x, sqrtf(up.y * up.y + up.z * up.z)) / 2;
+    float roll = atan2f(up.y, up.z) / 2;
+
+    *q = (pbio_geometry_quaternion_t) {
+        .w = cosf(roll) * cosf(pitch),
+        .x = sinf(roll) * cosf(pitch),
+        .y = cosf(roll) * sinf(pitch),
+        .z = -sinf(roll) * sinf(pitch),
+    };
+    return PBIO_SUCCESS;
+}
+
+/**
+ * Gets the rotation matrix of a unit quaternion.
+ *
+ * Mapping a vector with the resulting matrix rotates it the same way as the
+ * quaternion does.
+ *
+ * @param [in]  q           The unit quaternion.
+ * @param [out] rotation    The rotation matrix.
+ */
+void pbio_geometry_quaternion_to_rotation_matrix(pbio_geometry_quaternion_t *q, pbio_geometry_matrix_3x3_t *rotation) {
+    *rotation = (pbio_geometry_matrix_3x3_t) {
+        .m11 = 1 - 2 * (q->y * q->y + q->z * q->z),
+        .m12 = 2 * (q->x * q->y - q->w * q->z),
+        .m13 = 2 * (q->x * q->z + q->w * q->y),
+        .m21 = 2 * (q->x * q->y + q->w * q->z),
+        .m22 = 1 - 2 * (q->x * q->x + q->z * q->z),
+        .m23 = 2 * (q->y * q->z - q->w * q->x),
+        .m31 = 2 * (q->x * q->z - q->w * q->y),
+        .m32 = 2 * (q->y * q->z + q->w * q->x),
+        .m33 = 1 - 2 * (q->x * q->x + q->y * q->y),
+    };
+}
+
+/**
+ * Updates an attitude estimate with one sample of gyro and accelerometer data.
+ *
+ * The attitude is propagated with the angular velocity. The accelerometer
+ * corrects tilt drift by rotating the estimated vertical towards the measured
+ * gravity vector (Mahony filter, proportional only). Rotation about the
+ * vertical is not observable from gravity, so only the gyro affects it.
+ *
+ * @param [inout] q                 The attitude, mapping body frame to inertial frame.
+ * @param [in]    angular_velocity  Angular velocity in the body frame in deg/s.
+ * @param [in]    acceleration      Acceleration in the body frame in any unit.
+ * @param [in]    time_step         Time since the previous sample in s.
+ * @param [in]    gain              Correction gain in rad/s. Use 0 to skip the correction.
+ */
+void pbio_geometry_quaternion_update_attitude(pbio_geometry_quaternion_t *q, pbio_geometry_xyz_t *angular_velocity, pbio_geometry_xyz_t *acceleration, float time_step, float gain) {
+
+    // Angular velocity in rad/s.
+    pbio_geometry_xyz_t rate = {
+        .x = angular_velocity->x * (float)(M_PI / 180),
+        .y = angular_velocity->y * (float)(M_PI / 180),
+        .z = angular_velocity->z * (float)(M_PI / 180),
+    };
+
+    // Correct the rate by the error between measured and estimated vertical.
+    pbio_geometry_xyz_t measured;
+    if (gain > 0.0f && pbio_geometry_vector_normalize(acceleration, &measured) == PBIO_SUCCESS) {
+        // The vertical axis in the body frame is the bottom row of the rotation matrix.
+        pbio_geometry_xyz_t estimated = {
+            .x = 2 * (q->x * q->z - q->w * q->y),
+            .y = 2 * (q->y * q->z + q->w * q->x),
+            .z = q->w * q->w - q->x * q->x - q->y * q->y + q->z * q->z,
+        };
+        pbio_geometry_xyz_t error;
+        pbio_geometry_vector_cross_product(&measured, &estimated, &error);
+        rate.x += gain * error.x;
+        rate.y += gain * error.y;
+        rate.z += gain * error.z;
+    }
+
+    // Integrate the rate of change of the quaternion: dq/dt = q * (0, rate) / 2.
+    float h = time_step / 2;
+    pbio_geometry_quaternion_t p = *q;
+    q->w += h * (-p.x * rate.x - p.y * rate.y - p.z * rate.z);
+    q->x += h * (p.w * rate.x + p.y * rate.z - p.z * rate.y);
+    q->y += h * (p.w * rate.y - p.x * rate.z + p.z * rate.x);
+    q->z += h * (p.w * rate.z + p.x * rate.y - p.y * rate.x);
+
+    // Integration does not preserve length, so restore it. The quaternion
+    // does not vanish for sensible time steps.
+    pbio_geometry_quaternion_normalize(q);
+}
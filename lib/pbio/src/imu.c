@@ -1,6 +1,7 @@
 // SPDX-License-Identifier: MIT
 // Copyright (c) 2022-2023 The Pybricks Authors
 
+#include <math.h>
 #include <stdbool.h>
 #include <string.h>
 
@@ -26,19 +27,184 @@ static pbio_geometry_xyz_t acceleration; // mm/s^2, in hub frame
 static pbio_geometry_xyz_t gyro_bias;
 static pbio_geometry_xyz_t single_axis_rotation; // deg, in hub frame
 
-// Called by driver to process one frame of unfiltered gyro and accelerometer data.
-static void pbio_imu_handle_frame_data_func(int16_t *data) {
-    for (uint8_t i = 0; i < PBIO_ARRAY_SIZE(angular_velocity.values); i++) {
-        // Update angular velocity and acceleration cache so user can read them.
-        angular_velocity.values[i] = data[i] * imu_config->gyro_scale - gyro_bias.values[i];
-        acceleration.values[i] = data[i + 3] * imu_config->accel_scale;
-
-        // Update "heading" on all axes. This is not useful for 3D attitude
-        // estimation, but it allows the user to get a 1D heading even with
-        // the hub mounted at an arbitrary orientation. Such a 1D heading
-        // is numerically more accurate, which is useful in drive base
-        // applications so long as the vehicle drives on a flat surface.
-        single_axis_rotation.values[i] += angular_velocity.values[i] * imu_config->sample_time;
+// Per-axis correction factor of the gyro scale, in the hub frame.
+static pbio_geometry_xyz_t gyro_scale_correction = { .x = 1.0f, .y = 1.0f, .z = 1.0f };
+
+// Rotation without scale correction since calibration started, in the hub frame.
+static pbio_geometry_xyz_t calibration_rotation;
+
+// Samples for online bias estimation while the hub is hardly rotating.
+static pbio_geometry_xyz_t online_bias_sum;
+static uint32_t online_bias_count;
+
+// Estimated attitude of the hub, mapping the hub frame to the inertial frame.
+static pbio_geometry_quaternion_t attitude;
+static bool attitude_initialized;
+
+// Rotation about the vertical axis of the inertial frame, in degrees.
+static float vertical_rotation;
+
+// Gain (rad/s) of the accelerometer correction of the attitude, which
+// determines how fast tilt estimation errors decay.
+#define PBIO_IMU_ATTITUDE_GAIN (1.0f)
+
+// Standard gravity in mm/s^2. The accelerometer is only used to correct the
+// attitude when the measured acceleration is close to it, since it does not
+// indicate the vertical while accelerating.
+#define PBIO_IMU_GRAVITY (9806.65f)
+#define PBIO_IMU_GRAVITY_TOLERANCE (0.15f * PBIO_IMU_GRAVITY)
+
+// Updates the attitude estimate with the latest cached frame data.
+static void pbio_imu_update_attitude(void) {
+
+    // Start from the measured gravity vector, with zero heading.
+    if (!attitude_initialized) {
+        attitude_initialized = pbio_geometry_quaternion_from_gravity(&acceleration, &attitude) == PBIO_SUCCESS;
+        return;
+    }
+
+    float gravity = sqrtf(acceleration.x * acceleration.x + acceleration.y * acceleration.y + acceleration.z * acceleration.z);
+    float gain = fabsf(gravity - PBIO_IMU_GRAVITY) < PBIO_IMU_GRAVITY_TOLERANCE ? PBIO_IMU_ATTITUDE_GAIN : 0.0f;
+    pbio_geometry_quaternion_update_attitude(&attitude, &angular_velocity, &acceleration, imu_config->sample_time, gain);
+
+    // Rotation about the vertical is the inertial Z component of the angular
+    // velocity. Unlike the hub Z axis, this holds on ramps or when tilted.
+    pbio_geometry_matrix_3x3_t rotation;
+    pbio_geometry_quaternion_to_rotation_matrix(&attitude, &rotation);
+    vertical_rotation += (rotation.m31 * angular_velocity.x + rotation.m32 * angular_velocity.y + rotation.m33 * angular_velocity.z) * imu_config->sample_time;
+}
+
+// Gyro rate (deg/s) below which the hub is assumed not to be rotating, so
+// that the measured rate is mostly bias. This holds even while accelerating,
+// such as while driving straight. Slow turns are treated as bias, which is
+// why the online estimate adapts slowly.
+#define PBIO_IMU_ONLINE_BIAS_THRESHOLD (1.0f)
+
+// Duration (s) of the window over which the gyro rate is averaged.
+#define PBIO_IMU_ONLINE_BIAS_WINDOW (0.5f)
+
+// Weight of each window average, giving a time constant of about 25 seconds
+// to follow bias drift, such as when the hub warms up.
+#define PBIO_IMU_ONLINE_BIAS_WEIGHT (0.02f)
+
+// Updates the gyro bias estimate with one frame of uncorrected gyro rates.
+// This refines the bias, but it does not count as a stationary calibration
+// for pbio_imu_is_ready(), since slow turns may also be treated as bias.
+static void pbio_imu_update_online_bias(const pbio_geometry_xyz_t *rate) {
+
+    // Start over if it rotates too much on any axis.
+    for (uint8_t i = 0; i < PBIO_ARRAY_SIZE(rate->values); i++) {
+        if (fabsf(rate->values[i] - gyro_bias.values[i]) > PBIO_IMU_ONLINE_BIAS_THRESHOLD) {
+            memset(&online_bias_sum, 0, sizeof(online_bias_sum));
+            online_bias_count = 0;
+            return;
+        }
+    }
+
+    for (uint8_t i = 0; i < PBIO_ARRAY_SIZE(rate->values); i++) {
+        online_bias_sum.values[i] += rate->values[i];
+    }
+    online_bias_count++;
+
+    if (online_bias_count * imu_config->sample_time < PBIO_IMU_ONLINE_BIAS_WINDOW) {
+        return;
+    }
+
+    // Move the bias towards the average of this window.
+    for (uint8_t i = 0; i < PBIO_ARRAY_SIZE(rate->values); i++) {
+        float average = online_bias_sum.values[i] / online_bias_count;
+        gyro_bias.values[i] += PBIO_IMU_ONLINE_BIAS_WEIGHT * (average - gyro_bias.values[i]);
+    }
+    memset(&online_bias_sum, 0, sizeof(online_bias_sum));
+    online_bias_count = 0;
+}
+
+// Buffer to which raw frames are copied while recording.
+static int16_t *record_buffer;
+static uint32_t record_size;
+static uint32_t record_count;
+
+/**
+ * Starts recording raw IMU data frames, as given by the driver.
+ *
+ * The recording starts with the sample time, followed by the raw frames.
+ * Recording stops automatically when the buffer is full. Such recordings can
+ * be played back by the test IMU driver to reproduce the same behavior
+ * off-hardware, at the same sample rate.
+ *
+ * @param [in]  recording   Recording of ::PBIO_IMU_RECORDING_SIZE(@p num_frames) bytes.
+ * @param [in]  num_frames  Maximum number of frames to record.
+ */
+void pbio_imu_record_start(pbio_imu_recording_t *recording, uint32_t num_frames) {
+    recording->sample_time_us = imu_config->sample_time * 1000000.0f + 0.5f;
+    record_buffer = recording->frames;
+    record_size = num_frames;
+    record_count = 0;
+}
+
+/**
+ * Stops recording raw IMU data frames, so the buffer may be freed.
+ *
+ * @return                  Number of frames recorded.
+ */
+uint32_t pbio_imu_record_stop(void) {
+    record_buffer = NULL;
+    return record_count;
+}
+
+/**
+ * Gets the number of raw IMU data frames recorded so far.
+ *
+ * @return                  Number of frames recorded.
+ */
+uint32_t pbio_imu_record_get_count(void) {
+    return record_count;
+}
+
+// Copies raw frames to the recording buffer, if any.
+static void pbio_imu_record_frames(const int16_t *data, uint32_t num_frames) {
+    if (!record_buffer || record_count >= record_size) {
+        return;
+    }
+    if (num_frames > record_size - record_count) {
+        num_frames = record_size - record_count;
+    }
+    memcpy(&record_buffer[record_count * PBDRV_IMU_NUM_FRAME_VALUES], data, num_frames * PBDRV_IMU_NUM_FRAME_VALUES * sizeof(int16_t));
+    record_count += num_frames;
+}
+
+// Called by driver to process a batch of unfiltered gyro and accelerometer data frames.
+static void pbio_imu_handle_frame_data_func(const int16_t *data, uint32_t num_frames) {
+
+    pbio_imu_record_frames(data, num_frames);
+
+    for (uint32_t f = 0; f < num_frames; f++) {
+        const int16_t *frame = &data[f * PBDRV_IMU_NUM_FRAME_VALUES];
+
+        pbio_geometry_xyz_t rate;
+        for (uint8_t i = 0; i < PBIO_ARRAY_SIZE(angular_velocity.values); i++) {
+            rate.values[i] = frame[i] * imu_config->gyro_scale;
+
+            // Rotation for scale calibration is measured without correction.
+            calibration_rotation.values[i] += (rate.values[i] - gyro_bias.values[i]) * imu_config->sample_time;
+
+            // Update angular velocity and acceleration cache so user can read them.
+            angular_velocity.values[i] = (rate.values[i] - gyro_bias.values[i]) * gyro_scale_correction.values[i];
+            acceleration.values[i] = frame[i + 3] * imu_config->accel_scale;
+
+            // Update "heading" on all axes. This is not useful for 3D attitude
+            // estimation, but it allows the user to get a 1D heading even with
+            // the hub mounted at an arbitrary orientation. Such a 1D heading
+            // is numerically more accurate, which is useful in drive base
+            // applications so long as the vehicle drives on a flat surface.
+            single_axis_rotation.values[i] += angular_velocity.values[i] * imu_config->sample_time;
+        }
+
+        // Update the full 3D attitude estimate.
+        pbio_imu_update_attitude();
+
+        // Keep track of the gyro bias, also when not completely stationary.
+        pbio_imu_update_online_bias(&rate);
     }
 }
 
@@ -81,6 +247,149 @@ static void pbio_imu_handle_stationary_data_func(const int32_t *gyro_data_sum, c
     }
 }
 
+/**
+ * Gets the calibration values that should be kept when the hub turns off.
+ *
+ * @param [out] settings    The calibration values.
+ */
+void pbio_imu_get_persistent_settings(pbio_imu_persistent_settings_t *settings) {
+    memset(settings, 0, sizeof(*settings));
+    settings->flags = PBIO_IMU_PERSISTENT_SETTINGS_FLAG_SCALE;
+    settings->gyro_scale_correction = gyro_scale_correction;
+
+    // Only keep a bias that was actually measured.
+    if (stationary_counter > 0) {
+        settings->flags |= PBIO_IMU_PERSISTENT_SETTINGS_FLAG_BIAS;
+        settings->gyro_bias = gyro_bias;
+    }
+}
+
+/**
+ * Applies calibration values that were stored when the hub was last used.
+ *
+ * A stored bias makes the IMU ready right away, so programs need not wait for
+ * the hub to be stationary first. The bias is still refined as usual, and
+ * the first stationary measurements get a large weight.
+ *
+ * @param [in]  settings    The calibration values.
+ * @return                  ::PBIO_SUCCESS on success, ::PBIO_ERROR_INVALID_ARG
+ *                          if the values are not plausible, such as after a
+ *                          firmware update that changed the storage layout.
+ */
+pbio_error_t pbio_imu_apply_persistent_settings(const pbio_imu_persistent_settings_t *settings) {
+
+    if (!imu_config || settings->flags & ~PBIO_IMU_PERSISTENT_SETTINGS_FLAG_ALL) {
+        return PBIO_ERROR_INVALID_ARG;
+    }
+
+    // Check everything before applying anything.
+    for (uint8_t i = 0; i < PBIO_ARRAY_SIZE(gyro_bias.values); i++) {
+        if ((settings->flags & PBIO_IMU_PERSISTENT_SETTINGS_FLAG_BIAS &&
+             !(fabsf(settings->gyro_bias.values[i]) < PBIO_IMU_BIAS_MAX)) ||
+            (settings->flags & PBIO_IMU_PERSISTENT_SETTINGS_FLAG_SCALE &&
+             !(fabsf(settings->gyro_scale_correction.values[i] - 1.0f) < PBIO_IMU_SCALE_CORRECTION_MAX))) {
+            return PBIO_ERROR_INVALID_ARG;
+        }
+    }
+
+    if (settings->flags & PBIO_IMU_PERSISTENT_SETTINGS_FLAG_SCALE) {
+        gyro_scale_correction = settings->gyro_scale_correction;
+    }
+
+    if (settings->flags & PBIO_IMU_PERSISTENT_SETTINGS_FLAG_BIAS) {
+        gyro_bias = settings->gyro_bias;
+        stationary_counter = 1;
+        stationary_time_last = pbdrv_clock_get_ms();
+    }
+
+    return PBIO_SUCCESS;
+}
+
+/**
+ * Tests if the calibration values changed enough to be worth saving again.
+ *
+ * The bias is refined all the time, so it hardly ever stays exactly the same.
+ * To avoid writing to storage every time the hub turns off, small changes of
+ * the bias are ignored. Any change of the scale correction is kept.
+ *
+ * @param [in]  stored      The calibration values that are currently stored.
+ * @param [in]  settings    The current calibration values.
+ * @return                  True if the settings should be stored again.
+ */
+bool pbio_imu_persistent_settings_changed(const pbio_imu_persistent_settings_t *stored, const pbio_imu_persistent_settings_t *settings) {
+
+    if (stored->flags != settings->flags) {
+        return true;
+    }
+
+    for (uint8_t i = 0; i < PBIO_ARRAY_SIZE(settings->gyro_bias.values); i++) {
+        if (!(fabsf(settings->gyro_bias.values[i] - stored->gyro_bias.values[i]) <= PBIO_IMU_BIAS_SAVE_THRESHOLD) ||
+            settings->gyro_scale_correction.values[i] != stored->gyro_scale_correction.values[i]) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * Starts calibrating the gyro scale.
+ *
+ * After this, rotate the hub by a known angle about one or more of its axes,
+ * such as 10 full turns about the z axis, and then call
+ * ::pbio_imu_calibrate_scale_finish.
+ */
+void pbio_imu_calibrate_scale_start(void) {
+    memset(&calibration_rotation, 0, sizeof(calibration_rotation));
+}
+
+/**
+ * Completes the gyro scale calibration.
+ *
+ * The scale is corrected for each axis with an expected rotation of at
+ * least one full turn. Other axes are unchanged.
+ *
+ * @param [in]  rotation    The actual rotation about each hub axis (deg)
+ *                          since calibration started.
+ * @return                  ::PBIO_SUCCESS on success, ::PBIO_ERROR_INVALID_ARG
+ *                          if no axis turned far enough, or ::PBIO_ERROR_FAILED
+ *                          if the measured rotation is too far off to be a
+ *                          scale error.
+ */
+pbio_error_t pbio_imu_calibrate_scale_finish(const pbio_geometry_xyz_t *rotation) {
+
+    pbio_geometry_xyz_t correction = gyro_scale_correction;
+    bool calibrated = false;
+
+    for (uint8_t i = 0; i < PBIO_ARRAY_SIZE(rotation->values); i++) {
+        if (fabsf(rotation->values[i]) < 360.0f) {
+            continue;
+        }
+        float ratio = rotation->values[i] / calibration_rotation.values[i];
+        if (!(fabsf(ratio - 1.0f) < PBIO_IMU_SCALE_CORRECTION_MAX)) {
+            return PBIO_ERROR_FAILED;
+        }
+        correction.values[i] = ratio;
+        calibrated = true;
+    }
+
+    if (!calibrated) {
+        return PBIO_ERROR_INVALID_ARG;
+    }
+
+    gyro_scale_correction = correction;
+    return PBIO_SUCCESS;
+}
+
+/**
+ * Gets the per-axis correction factor of the gyro scale.
+ *
+ * @param [out] correction  The correction factor for each hub axis.
+ */
+void pbio_imu_get_scale_correction(pbio_geometry_xyz_t *correction) {
+    *correction = gyro_scale_correction;
+}
+
 /**
  * Initializes global imu module.
  */
@@ -175,6 +484,25 @@ void pbio_imu_get_acceleration(pbio_geometry_xyz_t *values) {
     pbio_geometry_vector_map(&pbio_orientation_base_orientation, &acceleration, values);
 }
 
+/**
+ * Gets the cached IMU acceleration in mm/s^2 with gravity taken out, using
+ * the estimated orientation. This is the acceleration due to motion only,
+ * also when the robot is tilted.
+ *
+ * @param [out] values      The acceleration vector.
+ */
+void pbio_imu_get_linear_acceleration(pbio_geometry_xyz_t *values) {
+    pbio_imu_get_acceleration(values);
+
+    // At rest, the accelerometer measures gravity pointing up. In the robot
+    // frame, up is the bottom row of the orientation matrix.
+    pbio_geometry_matrix_3x3_t rotation;
+    pbio_imu_get_orientation(&rotation);
+    values->x -= rotation.m31 * PBIO_IMU_GRAVITY;
+    values->y -= rotation.m32 * PBIO_IMU_GRAVITY;
+    values->z -= rotation.m33 * PBIO_IMU_GRAVITY;
+}
+
 /**
  * Gets the rotation along a particular axis of the robot frame.
  *
@@ -207,22 +535,51 @@ pbio_geometry_side_t pbio_imu_get_up_side(void) {
     return pbio_geometry_side_from_vector(&acceleration);
 }
 
+/**
+ * Gets the estimated orientation of the robot as a rotation matrix.
+ *
+ * The matrix maps vectors in the robot frame (as given by the base
+ * orientation) to the inertial frame, with Z pointing up.
+ *
+ * @param [out] rotation    The rotation matrix.
+ */
+void pbio_imu_get_orientation(pbio_geometry_matrix_3x3_t *rotation) {
+    pbio_geometry_matrix_3x3_t hub_rotation;
+    pbio_geometry_quaternion_to_rotation_matrix(&attitude, &hub_rotation);
+    pbio_geometry_matrix_multiply_transpose(&hub_rotation, &pbio_orientation_base_orientation, rotation);
+}
+
+/**
+ * Gets the estimated orientation of the robot as roll, pitch, and yaw.
+ *
+ * These are the Z-Y-X Euler angles of the orientation, in degrees. Yaw is
+ * counterclockwise positive and bound to +/- 180 degrees, so use
+ * ::pbio_imu_get_heading for a continuous heading.
+ *
+ * @param [out] angles      Roll (x), pitch (y) and yaw (z) in degrees.
+ */
+void pbio_imu_get_euler_angles(pbio_geometry_xyz_t *angles) {
+    pbio_geometry_matrix_3x3_t r;
+    pbio_imu_get_orientation(&r);
+    angles->x = atan2f(r.m32, r.m33) * (float)(180 / M_PI);
+    angles->y = asinf(fmaxf(-1.0f, fminf(1.0f, -r.m31))) * (float)(180 / M_PI);
+    angles->z = atan2f(r.m21, r.m11) * (float)(180 / M_PI);
+}
+
 static float heading_offset = 0;
 
 /**
  * Reads the estimated IMU heading in degrees, accounting for user offset.
  *
+ * This is the rotation about the vertical, so it remains accurate when the
+ * robot is tilted, such as when driving on a ramp.
+ *
  * Heading is defined as clockwise positive.
  *
  * @return                  Heading angle in the base frame.
  */
 float pbio_imu_get_heading(void) {
-
-    pbio_geometry_xyz_t heading_mapped;
-
-    pbio_geometry_vector_map(&pbio_orientation_base_orientation, &single_axis_rotation, &heading_mapped);
-
-    return -heading_mapped.z - heading_offset;
+    return -vertical_rotation - heading_offset;
 }
 
 /**
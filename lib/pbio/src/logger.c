@@ -8,6 +8,7 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include <inttypes.h>
+#include <string.h>
 
 #include <pbdrv/clock.h>
 #include <pbio/config.h>
@@ -32,11 +33,108 @@ void pbio_logger_start(pbio_log_t *log, int32_t *buf, uint32_t num_rows, uint8_t
     log->num_cols = num_cols;
     log->down_sample = down_sample;
     log->start_time = pbdrv_clock_get_ms();
+    log->stream = NULL;
+    log->stream_context = NULL;
+    log->row_first = 0;
+    log->num_rows_sent = 0;
+    log->num_rows_dropped = 0;
+    log->compact_data = NULL;
 
     // Data may now be logged.
     log->active = true;
 }
 
+/**
+ * Starts logging in the background while sending rows out as they come in.
+ *
+ * The buffer only needs to hold rows that have been logged but not yet sent,
+ * so it can be much smaller than for a full recording. If the stream cannot
+ * keep up and the buffer is full, new rows are dropped and counted.
+ *
+ * @param [in]  log             Pointer to log.
+ * @param [in]  buf             Array large enough to hold @p num_rows rows of data.
+ * @param [in]  num_rows        Number of unsent rows that can be buffered.
+ * @param [in]  num_cols        Number of entries in one row.
+ * @param [in]  down_sample     For every @p down_sample of update calls, only one row is logged.
+ * @param [in]  stream          Callback that sends out one row.
+ * @param [in]  stream_context  Context passed to @p stream.
+ */
+void pbio_logger_start_stream(pbio_log_t *log, int32_t *buf, uint32_t num_rows, uint8_t num_cols, int32_t down_sample, pbio_logger_stream_func_t stream, void *stream_context) {
+    pbio_logger_start(log, buf, num_rows, num_cols, down_sample);
+    log->stream = stream;
+    log->stream_context = stream_context;
+}
+
+/**
+ * Sends buffered rows out through the stream callback until the buffer is
+ * empty or the stream cannot accept more data.
+ *
+ * @param [in]  log         Pointer to log.
+ * @return                  ::PBIO_SUCCESS if all rows were sent,
+ *                          ::PBIO_ERROR_AGAIN if rows remain in the buffer,
+ *                          ::PBIO_ERROR_INVALID_OP if this is not a streaming log,
+ *                          or the error raised by the stream callback.
+ */
+pbio_error_t pbio_logger_stream_flush(pbio_log_t *log) {
+
+    if (!log->stream) {
+        return PBIO_ERROR_INVALID_OP;
+    }
+
+    while (log->num_rows_used > 0) {
+        pbio_error_t err = log->stream(log->stream_context, pbio_logger_get_row_data(log, 0), log->num_cols);
+        if (err != PBIO_SUCCESS) {
+            // Stop streaming on errors other than a temporarily full stream.
+            if (err != PBIO_ERROR_AGAIN) {
+                log->active = false;
+            }
+            return err;
+        }
+        log->row_first = (log->row_first + 1) % log->num_rows;
+        log->num_rows_used--;
+        log->num_rows_sent++;
+    }
+
+    return PBIO_SUCCESS;
+}
+
+/**
+ * Starts logging in the background, storing rows in the compact format.
+ *
+ * Each value is stored as the difference from the same value in the previous
+ * row, except every ::PBIO_LOGGER_COMPACT_KEYFRAME_INTERVAL rows where the
+ * full values are stored. Values are zigzag encoded so that small negative
+ * numbers are small too, and then stored as variable length integers of 7
+ * bits per byte. Since most values change only a little from one sample to
+ * the next, most values take just one byte instead of four.
+ *
+ * Logging stops when the buffer is full.
+ *
+ * @param [in]  log         Pointer to log.
+ * @param [in]  buf         Buffer for the previous row, followed by the
+ *                          encoded data.
+ * @param [in]  size        Size of @p buf in bytes.
+ * @param [in]  num_cols    Number of entries in one row.
+ * @param [in]  down_sample For every @p down_sample of update calls, only one row is logged.
+ * @return                  ::PBIO_SUCCESS on success or ::PBIO_ERROR_INVALID_ARG
+ *                          if there are too many columns or the buffer can't
+ *                          even hold the previous row.
+ */
+pbio_error_t pbio_logger_start_compact(pbio_log_t *log, int32_t *buf, uint32_t size, uint8_t num_cols, int32_t down_sample) {
+
+    if (num_cols > PBIO_LOGGER_COMPACT_MAX_COLS || size < num_cols * sizeof(int32_t)) {
+        return PBIO_ERROR_INVALID_ARG;
+    }
+
+    // The row buffer is not used, so we don't need any rows.
+    pbio_logger_start(log, NULL, 0, num_cols, down_sample);
+    log->compact_prev = buf;
+    log->compact_data = (uint8_t *)(buf + num_cols);
+    log->compact_size = size - num_cols * sizeof(int32_t);
+    log->compact_size_used = 0;
+    return PBIO_SUCCESS;
+}
+
 /**
  * Stops accepting new data from background loops.
  *
@@ -56,6 +154,53 @@ bool pbio_logger_is_active(const pbio_log_t *log) {
     return log->active;
 }
 
+/**
+ * Encodes one value as a zigzag variable length integer.
+ *
+ * @param [out] buf         Buffer of at least 5 bytes.
+ * @param [in]  value       Value to encode.
+ * @return                  Number of bytes written.
+ */
+static uint8_t pbio_logger_compact_encode_value(uint8_t *buf, int32_t value) {
+    uint32_t zigzag = ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+    uint8_t size = 0;
+    while (zigzag >= 0x80) {
+        buf[size++] = (zigzag & 0x7F) | 0x80;
+        zigzag >>= 7;
+    }
+    buf[size++] = zigzag;
+    return size;
+}
+
+/**
+ * Adds a row to a compact log, or stops the log if it is full.
+ *
+ * @param [in]  log         Pointer to log.
+ * @param [in]  row_data    Data to be added, including default columns.
+ */
+static void pbio_logger_compact_add_row(pbio_log_t *log, const int32_t *row_data) {
+    uint8_t encoded[PBIO_LOGGER_COMPACT_MAX_COLS * 5];
+    uint32_t size = 0;
+
+    bool keyframe = log->num_rows_used % PBIO_LOGGER_COMPACT_KEYFRAME_INTERVAL == 0;
+
+    for (uint8_t i = 0; i < log->num_cols; i++) {
+        int32_t value = keyframe ? row_data[i] : (int32_t)((uint32_t)row_data[i] - (uint32_t)log->compact_prev[i]);
+        size += pbio_logger_compact_encode_value(&encoded[size], value);
+        log->compact_prev[i] = row_data[i];
+    }
+
+    // Exit if log is full.
+    if (log->compact_size_used + size > log->compact_size) {
+        log->active = false;
+        return;
+    }
+
+    memcpy(&log->compact_data[log->compact_size_used], encoded, size);
+    log->compact_size_used += size;
+    log->num_rows_used++;
+}
+
 /**
  * Add new data from a background loop.
  *
@@ -70,23 +215,46 @@ void pbio_logger_add_row(pbio_log_t *log, const int32_t *row_data) {
     }
     log->skipped_samples = 0;
 
-    // Exit if log is full.
+    if (log->compact_data) {
+        int32_t row[PBIO_LOGGER_COMPACT_MAX_COLS];
+        row[0] = pbdrv_clock_get_ms() - log->start_time;
+        for (uint8_t i = PBIO_LOGGER_NUM_DEFAULT_COLS; i < log->num_cols; i++) {
+            row[i] = row_data[i - PBIO_LOGGER_NUM_DEFAULT_COLS];
+        }
+        pbio_logger_compact_add_row(log, row);
+        return;
+    }
+
+    // Exit if log is full. A streaming log keeps going, dropping rows until
+    // the stream catches up.
     if (log->num_rows_used >= log->num_rows) {
-        log->active = false;
+        if (log->stream) {
+            log->num_rows_dropped++;
+            pbio_logger_stream_flush(log);
+        } else {
+            log->active = false;
+        }
         return;
     }
 
+    int32_t *row = pbio_logger_get_row_data(log, log->num_rows_used);
+
     // Write time of logging.
-    log->data[log->num_rows_used * log->num_cols] = pbdrv_clock_get_ms() - log->start_time;
+    row[0] = pbdrv_clock_get_ms() - log->start_time;
 
     // Write the data.
     for (uint8_t i = PBIO_LOGGER_NUM_DEFAULT_COLS; i < log->num_cols; i++) {
-        log->data[log->num_rows_used * log->num_cols + i] = row_data[i - PBIO_LOGGER_NUM_DEFAULT_COLS];
+        row[i] = row_data[i - PBIO_LOGGER_NUM_DEFAULT_COLS];
     }
 
     // Increment used row counter.
     log->num_rows_used++;
 
+    // Send out what we can without waiting.
+    if (log->stream) {
+        pbio_logger_stream_flush(log);
+    }
+
     return;
 }
 
@@ -103,11 +271,102 @@ uint32_t pbio_logger_get_num_rows_used(const pbio_log_t *log) {
 /**
  * Gets row from the log. Caller must ensure that valid index is used.
  *
+ * For a streaming log, index 0 is the oldest row that has not been sent yet.
+ *
  * @param [in]  log         Pointer to log.
+ * @param [in]  index       Index of the row.
  * @return                  Pointer to row data.
  */
 int32_t *pbio_logger_get_row_data(const pbio_log_t *log, uint32_t index) {
-    return log->data + index * log->num_cols;
+    return log->data + ((log->row_first + index) % log->num_rows) * log->num_cols;
+}
+
+/**
+ * Gets number of rows that were sent out by a streaming log.
+ *
+ * @param [in]  log         Pointer to log.
+ * @return                  Number of sent rows.
+ */
+uint32_t pbio_logger_get_num_rows_sent(const pbio_log_t *log) {
+    return log->num_rows_sent;
+}
+
+/**
+ * Gets number of rows that were dropped by a streaming log because the
+ * stream could not keep up.
+ *
+ * @param [in]  log         Pointer to log.
+ * @return                  Number of dropped rows.
+ */
+uint32_t pbio_logger_get_num_rows_dropped(const pbio_log_t *log) {
+    return log->num_rows_dropped;
+}
+
+/**
+ * Gets the data of a compact log.
+ *
+ * @param [in]  log         Pointer to log.
+ * @param [out] size        Number of bytes used.
+ * @return                  Pointer to the encoded rows, or NULL if this is
+ *                          not a compact log.
+ */
+const uint8_t *pbio_logger_get_compact_data(const pbio_log_t *log, uint32_t *size) {
+    *size = log->compact_data ? log->compact_size_used : 0;
+    return log->compact_data;
+}
+
+/**
+ * Gets the header that describes the data of a compact log, so it can be
+ * decoded elsewhere. This should be stored or sent before the data.
+ *
+ * @param [in]  log         Pointer to log.
+ * @param [out] header      Buffer of ::PBIO_LOGGER_COMPACT_HEADER_SIZE bytes.
+ */
+void pbio_logger_get_compact_header(const pbio_log_t *log, uint8_t *header) {
+    header[0] = 'P';
+    header[1] = 'B';
+    header[2] = 'L';
+    header[3] = PBIO_LOGGER_COMPACT_VERSION;
+    header[4] = log->num_cols;
+    header[5] = PBIO_LOGGER_COMPACT_KEYFRAME_INTERVAL;
+}
+
+/**
+ * Decodes one row of compact log data.
+ *
+ * Rows must be decoded in order, passing the previous row in @p row_data,
+ * unless @p index is a keyframe.
+ *
+ * @param [in]  data        Encoded data, starting at the row to decode.
+ * @param [in]  size        Number of bytes available in @p data.
+ * @param [in]  index       Index of the row in the log.
+ * @param [in]  num_cols    Number of entries in one row.
+ * @param [in, out] row_data  Previous row on input, decoded row on output.
+ * @return                  Number of bytes used by this row, or 0 if the data
+ *                          is incomplete or invalid.
+ */
+uint32_t pbio_logger_compact_decode_row(const uint8_t *data, uint32_t size, uint32_t index, uint8_t num_cols, int32_t *row_data) {
+    uint32_t offset = 0;
+
+    bool keyframe = index % PBIO_LOGGER_COMPACT_KEYFRAME_INTERVAL == 0;
+
+    for (uint8_t i = 0; i < num_cols; i++) {
+        uint32_t zigzag = 0;
+        uint8_t shift = 0;
+        uint8_t byte;
+        do {
+            if (offset >= size || shift > 28) {
+                return 0;
+            }
+            byte = data[offset++];
+            zigzag |= (uint32_t)(byte & 0x7F) << shift;
+            shift += 7;
+        } while (byte & 0x80);
+
+        int32_t value = (int32_t)(zigzag >> 1) ^ -(int32_t)(zigzag & 1);
+        row_data[i] = keyframe ? value : (int32_t)((uint32_t)row_data[i] + (uint32_t)value);
+    }
+    return offset;
 }
 
 #endif // PBIO_CONFIG_LOGGER
@@ -0,0 +1,105 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2023 The Pybricks Authors
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <pbio/error.h>
+#include <pbio/lz.h>
+
+/**
+ * What the next byte of the stream is.
+ */
+enum {
+    PBIO_LZ_STATE_CONTROL,
+    PBIO_LZ_STATE_LITERAL,
+    PBIO_LZ_STATE_DISTANCE_LOW,
+    PBIO_LZ_STATE_DISTANCE_HIGH,
+};
+
+/**
+ * Starts decoding a new stream.
+ *
+ * @param [in]  decoder     The decoder.
+ * @param [in]  out         Buffer to decode into.
+ * @param [in]  out_size    Size of @p out.
+ */
+void pbio_lz_decoder_init(pbio_lz_decoder_t *decoder, uint8_t *out, uint32_t out_size) {
+    decoder->out = out;
+    decoder->out_size = out_size;
+    decoder->size = 0;
+    decoder->distance = 0;
+    decoder->count = 0;
+    decoder->state = PBIO_LZ_STATE_CONTROL;
+}
+
+/**
+ * Decodes the next chunk of a stream.
+ *
+ * @param [in]  decoder     The decoder.
+ * @param [in]  data        The next chunk of the compressed stream.
+ * @param [in]  size        Size of @p data.
+ * @return                  ::PBIO_SUCCESS on success.
+ *                          ::PBIO_ERROR_INVALID_ARG if the output does not
+ *                          fit or a match refers to data before the start.
+ *                          The decoder should be initialized again after this.
+ */
+pbio_error_t pbio_lz_decoder_write(pbio_lz_decoder_t *decoder, const uint8_t *data, uint32_t size) {
+
+    for (uint32_t i = 0; i < size; i++) {
+        uint8_t byte = data[i];
+
+        switch (decoder->state) {
+            case PBIO_LZ_STATE_CONTROL:
+                if (byte & 0x80) {
+                    decoder->count = (byte & 0x7F) + PBIO_LZ_MIN_MATCH;
+                    decoder->state = PBIO_LZ_STATE_DISTANCE_LOW;
+                } else {
+                    decoder->count = byte + 1;
+                    decoder->state = PBIO_LZ_STATE_LITERAL;
+                }
+                break;
+            case PBIO_LZ_STATE_LITERAL:
+                if (decoder->size == decoder->out_size) {
+                    return PBIO_ERROR_INVALID_ARG;
+                }
+                decoder->out[decoder->size++] = byte;
+                if (--decoder->count == 0) {
+                    decoder->state = PBIO_LZ_STATE_CONTROL;
+                }
+                break;
+            case PBIO_LZ_STATE_DISTANCE_LOW:
+                decoder->distance = byte;
+                decoder->state = PBIO_LZ_STATE_DISTANCE_HIGH;
+                break;
+            case PBIO_LZ_STATE_DISTANCE_HIGH: {
+                decoder->distance |= byte << 8;
+                if (decoder->distance == 0 || decoder->distance > decoder->size ||
+                    decoder->count > decoder->out_size - decoder->size) {
+                    return PBIO_ERROR_INVALID_ARG;
+                }
+                // Copy byte by byte, so that overlapping matches repeat.
+                uint8_t *dst = decoder->out + decoder->size;
+                const uint8_t *src = dst - decoder->distance;
+                for (uint8_t j = 0; j < decoder->count; j++) {
+                    dst[j] = src[j];
+                }
+                decoder->size += decoder->count;
+                decoder->state = PBIO_LZ_STATE_CONTROL;
+                break;
+            }
+        }
+    }
+
+    return PBIO_SUCCESS;
+}
+
+/**
+ * Checks that the stream did not end halfway through a token.
+ *
+ * @param [in]  decoder     The decoder.
+ * @return                  True if all tokens were decoded completely.
+ */
+bool pbio_lz_decoder_is_complete(const pbio_lz_decoder_t *decoder) {
+    return decoder->state == PBIO_LZ_STATE_CONTROL;
+}
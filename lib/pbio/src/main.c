@@ -15,6 +15,7 @@
 #include <pbdrv/core.h>
 #include <pbdrv/sound.h>
 #include <pbio/config.h>
+#include <pbio/control_settings.h>
 #include <pbio/dcmotor.h>
 #include <pbio/imu.h>
 #include <pbio/light_matrix.h>
@@ -69,6 +70,11 @@ void pbio_stop_all(bool reset) {
     }
     #endif
     pbio_dcmotor_stop_all(reset);
+    #if PBIO_CONFIG_CONTROL_LOOP_TIME_ADJUSTABLE
+    if (reset) {
+        pbio_control_settings_set_loop_time(PBIO_CONFIG_CONTROL_LOOP_TIME_MS);
+    }
+    #endif
     pbdrv_sound_stop();
 }
 
@@ -36,6 +36,13 @@ static const pbio_observer_model_t model_technic_s_angular = {
     .d_torque_d_speed = 12282,
     .d_torque_d_acceleration = 35129,
     .torque_friction = 9182,
+    #if PBIO_CONFIG_CONTROL_LOOP_TIME_ADJUSTABLE
+    .phi_speed_current = 7589.562f,
+    .phi_current_speed = -2.798057f,
+    .phi_current_current = -735.5715f,
+    .gam_speed_torque = -413.2776f,
+    .gam_current_voltage = 416.6667f,
+    #endif
 };
 
 static const pbio_observer_model_t model_technic_m_angular = {
@@ -56,6 +63,13 @@ static const pbio_observer_model_t model_technic_m_angular = {
     .d_torque_d_speed = 5903,
     .d_torque_d_acceleration = 16163,
     .torque_friction = 21413,
+    #if PBIO_CONFIG_CONTROL_LOOP_TIME_ADJUSTABLE
+    .phi_speed_current = 4524.219f,
+    .phi_current_speed = -2.731141f,
+    .phi_current_current = -447.0939f,
+    .gam_speed_torque = -190.153f,
+    .gam_current_voltage = 416.6667f,
+    #endif
 };
 
 static const pbio_observer_model_t model_technic_l_angular = {
@@ -76,6 +90,13 @@ static const pbio_observer_model_t model_technic_l_angular = {
     .d_torque_d_speed = 1919,
     .d_torque_d_acceleration = 3997,
     .torque_friction = 23239,
+    #if PBIO_CONFIG_CONTROL_LOOP_TIME_ADJUSTABLE
+    .phi_speed_current = 1092.743f,
+    .phi_current_speed = -5.981601f,
+    .phi_current_current = -310.8395f,
+    .gam_speed_torque = -47.02153f,
+    .gam_current_voltage = 833.3333f,
+    #endif
 };
 
 static const pbio_observer_model_t model_interactive = {
@@ -96,6 +117,13 @@ static const pbio_observer_model_t model_interactive = {
     .d_torque_d_speed = 10599,
     .d_torque_d_acceleration = 20588,
     .torque_friction = 11227,
+    #if PBIO_CONFIG_CONTROL_LOOP_TIME_ADJUSTABLE
+    .phi_speed_current = 6632.452f,
+    .phi_current_speed = -8.989117f,
+    .phi_current_current = -3040.614f,
+    .gam_speed_torque = -242.2145f,
+    .gam_current_voltage = 1666.667f,
+    #endif
 };
 
 static const pbio_observer_model_t model_technic_l = {
@@ -116,6 +144,13 @@ static const pbio_observer_model_t model_technic_l = {
     .d_torque_d_speed = 6837,
     .d_torque_d_acceleration = 10751,
     .torque_friction = 26430,
+    #if PBIO_CONFIG_CONTROL_LOOP_TIME_ADJUSTABLE
+    .phi_speed_current = 2785.714f,
+    .phi_current_speed = -4.760545f,
+    .phi_current_current = -835.4756f,
+    .gam_speed_torque = -126.4796f,
+    .gam_current_voltage = 1111.111f,
+    #endif
 };
 
 static const pbio_observer_model_t model_technic_xl = {
@@ -136,6 +171,13 @@ static const pbio_observer_model_t model_technic_xl = {
     .d_torque_d_speed = 7713,
     .d_torque_d_acceleration = 11578,
     .torque_friction = 12893,
+    #if PBIO_CONFIG_CONTROL_LOOP_TIME_ADJUSTABLE
+    .phi_speed_current = 2926.829f,
+    .phi_current_speed = -7.156822f,
+    .phi_current_current = -1382.488f,
+    .gam_speed_torque = -136.2089f,
+    .gam_current_voltage = 1666.667f,
+    #endif
 };
 
 #if PBIO_CONFIG_SERVO_PUP_MOVE_HUB
@@ -158,6 +200,13 @@ static const pbio_observer_model_t model_movehub = {
     .d_torque_d_speed = 10851,
     .d_torque_d_acceleration = 15357,
     .torque_friction = 24835,
+    #if PBIO_CONFIG_CONTROL_LOOP_TIME_ADJUSTABLE
+    .phi_speed_current = 3204.969f,
+    .phi_current_speed = -6.213529f,
+    .phi_current_current = -1393.992f,
+    .gam_speed_torque = -180.6723f,
+    .gam_current_voltage = 1666.667f,
+    #endif
 };
 
 #endif // PBIO_CONFIG_SERVO_PUP_MOVE_HUB
@@ -184,6 +233,13 @@ static const pbio_observer_model_t model_ev3_l = {
     .d_torque_d_speed = 2083,
     .d_torque_d_acceleration = 1965,
     .torque_friction = 16476,
+    #if PBIO_CONFIG_CONTROL_LOOP_TIME_ADJUSTABLE
+    .phi_speed_current = 634.9206f,
+    .phi_current_speed = -5.504587f,
+    .phi_current_current = -366.9725f,
+    .gam_speed_torque = -23.12139f,
+    .gam_current_voltage = 666.6667f,
+    #endif
 };
 
 static const pbio_observer_model_t model_ev3_m = {
@@ -204,6 +260,13 @@ static const pbio_observer_model_t model_ev3_m = {
     .d_torque_d_speed = 7365,
     .d_torque_d_acceleration = 9355,
     .torque_friction = 18317,
+    #if PBIO_CONFIG_CONTROL_LOOP_TIME_ADJUSTABLE
+    .phi_speed_current = 2519.894f,
+    .phi_current_speed = -3.493976f,
+    .phi_current_current = -686.747f,
+    .gam_speed_torque = -110.0556f,
+    .gam_current_voltage = 666.6667f,
+    #endif
 };
 
 #endif // PBIO_CONFIG_SERVO_EV3_NXT
@@ -1,14 +1,117 @@
 // SPDX-License-Identifier: MIT
 // Copyright (c) 2018-2023 The Pybricks Authors
 
+#include <pbdrv/clock.h>
+
 #include <pbio/battery.h>
 #include <pbio/control.h>
+#include <pbio/control_settings.h>
 #include <pbio/drivebase.h>
+#include <pbio/motor_process.h>
 #include <pbio/servo.h>
 
 #include <contiki.h>
 
-#if PBIO_CONFIG_MOTOR_PROCESS != 0
+#if PBIO_CONFIG_MOTOR_PROCESS
+
+#if PBIO_CONFIG_MOTOR_PROCESS_STATS
+
+static pbio_motor_process_stats_t stats;
+
+// Start time (us) of the previous update, used to measure the loop period.
+static uint32_t stats_time_prev;
+
+// Whether stats_time_prev is valid.
+static bool stats_time_prev_valid;
+
+/**
+ * Gets the timing statistics of the motor process.
+ *
+ * @return                  The statistics collected since the last reset.
+ */
+const pbio_motor_process_stats_t *pbio_motor_process_get_stats(void) {
+    return &stats;
+}
+
+/**
+ * Resets the timing statistics of the motor process.
+ */
+void pbio_motor_process_reset_stats(void) {
+    stats = (pbio_motor_process_stats_t) {0};
+    for (uint8_t i = 0; i < PBIO_MOTOR_PROCESS_NUM_STAGES; i++) {
+        stats.stages[i].time_min = UINT32_MAX;
+    }
+    stats_time_prev_valid = false;
+}
+
+/**
+ * Gets the mean execution time of one stage of the motor process.
+ *
+ * @param [in]  stage       The stage.
+ * @return                  Mean execution time (us), or 0 if it never ran.
+ */
+uint32_t pbio_motor_process_get_stage_time_mean(pbio_motor_process_stage_t stage) {
+    const pbio_motor_process_stage_stats_t *s = &stats.stages[stage];
+    if (s->count == 0) {
+        return 0;
+    }
+    return s->time_total / s->count;
+}
+
+/**
+ * Adds the measured loop period to the jitter histogram.
+ *
+ * @param [in]  time_now    Start time of the current update (us).
+ */
+static void pbio_motor_process_stats_add_period(uint32_t time_now) {
+
+    if (stats_time_prev_valid) {
+        int32_t jitter = (int32_t)(time_now - stats_time_prev - pbio_control_settings_get_loop_time() * 1000);
+        uint32_t bin = (jitter < 0 ? -jitter : jitter) / PBIO_MOTOR_PROCESS_STATS_JITTER_BIN_US;
+        if (bin >= PBIO_MOTOR_PROCESS_STATS_JITTER_NUM_BINS) {
+            bin = PBIO_MOTOR_PROCESS_STATS_JITTER_NUM_BINS - 1;
+        }
+        stats.jitter_histogram[bin]++;
+    }
+
+    stats_time_prev = time_now;
+    stats_time_prev_valid = true;
+}
+
+/**
+ * Adds the execution time of one stage to its statistics.
+ *
+ * @param [in]  stage       The stage that just completed.
+ * @param [in]  time_start  Time at which the stage started (us).
+ * @return                  Time at which the stage completed (us).
+ */
+static uint32_t pbio_motor_process_stats_add_stage(pbio_motor_process_stage_t stage, uint32_t time_start) {
+    uint32_t time_end = pbdrv_clock_get_us();
+    uint32_t duration = time_end - time_start;
+
+    pbio_motor_process_stage_stats_t *s = &stats.stages[stage];
+    if (duration < s->time_min) {
+        s->time_min = duration;
+    }
+    if (duration > s->time_max) {
+        s->time_max = duration;
+    }
+    s->time_total += duration;
+    s->count++;
+
+    return time_end;
+}
+
+#else
+
+static inline void pbio_motor_process_stats_add_period(uint32_t time_now) {
+}
+
+static inline uint32_t pbio_motor_process_stats_add_stage(pbio_motor_process_stage_t stage, uint32_t time_start) {
+    return 0;
+}
+
+#endif // PBIO_CONFIG_MOTOR_PROCESS_STATS
 
 PROCESS(pbio_motor_process, "servo");
 
@@ -23,33 +126,49 @@ PROCESS_THREAD(pbio_motor_process, ev, data) {
     // Initialize motors in stopped state.
     pbio_dcmotor_stop_all(true);
 
-    etimer_set(&timer, PBIO_CONFIG_CONTROL_LOOP_TIME_MS);
+    // Start with empty statistics.
+    pbio_motor_process_reset_stats();
+
+    etimer_set(&timer, pbio_control_settings_get_loop_time());
 
     for (;;) {
         PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_TIMER && etimer_expired(&timer));
 
+        uint32_t time_stage = PBIO_CONFIG_MOTOR_PROCESS_STATS ? pbdrv_clock_get_us() : 0;
+        pbio_motor_process_stats_add_period(time_stage);
+
         // Update battery voltage.
         pbio_battery_update();
+        time_stage = pbio_motor_process_stats_add_stage(PBIO_MOTOR_PROCESS_STAGE_BATTERY, time_stage);
 
         // Update drivebase
         pbio_drivebase_update_all();
+        time_stage = pbio_motor_process_stats_add_stage(PBIO_MOTOR_PROCESS_STAGE_DRIVEBASE, time_stage);
 
         // Update servos
         pbio_servo_update_all();
+        pbio_motor_process_stats_add_stage(PBIO_MOTOR_PROCESS_STAGE_SERVO, time_stage);
 
         clock_time_t now = clock_time();
 
+        // Apply the loop time, which may have been changed since the
+        // previous update.
+        timer.timer.interval = pbio_control_settings_get_loop_time();
+
         // If polling was delayed too long, we need to ensure that the next
         // poll is a minimum of 1ms in the future. If we don't, the poll loop
         // will not yield until and the next update will be called with a 0 time
         // diff which causes issues.
-        if (now - etimer_start_time(&timer) >= 2 * PBIO_CONFIG_CONTROL_LOOP_TIME_MS) {
-            timer.timer.start = now - (PBIO_CONFIG_CONTROL_LOOP_TIME_MS - 1);
+        if (now - etimer_start_time(&timer) >= 2 * timer.timer.interval) {
+            timer.timer.start = now - (timer.timer.interval - 1);
+            #if PBIO_CONFIG_MOTOR_PROCESS_STATS
+            stats.overruns++;
+            #endif
         }
 
         // Reset timer to wait for next update. Using etimer_reset() instead
         // of etimer_restart() makes average update period closer to the expected
-        // PBIO_CONFIG_CONTROL_LOOP_TIME_MS when occasional delays occur.
+        // loop time when occasional delays occur.
         etimer_reset(&timer);
     }
 
@@ -4,12 +4,15 @@
 // SPDX-License-Identifier: BSD-3-Clause
 // Copyright (c) 2020-2023 LEGO System A/S
 
+#include <assert.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 
 #include <pbio/angle.h>
+#include <pbio/control_settings.h>
 #include <pbio/dcmotor.h>
 #include <pbio/int_math.h>
 #include <pbio/observer.h>
@@ -27,6 +30,215 @@
 #define PRESCALE_VOLTAGE (178956)
 #define PRESCALE_TORQUE (2147)
 
+// Scale of the precomputed model coefficients.
+#define COEFFICIENT_SHIFT (24)
+
+/**
+ * Gets the ratio of a prescaler and a model constant, scaled by 2^24.
+ *
+ * The ratio must be less than 128 in magnitude to fit. This holds for all
+ * generated models, where it is at most about 1.
+ *
+ * @param [in]  prescale       Prescaler of the input.
+ * @param [in]  model_constant The model constant.
+ * @return                     Scaled ratio.
+ */
+static int32_t get_coefficient(int32_t prescale, int32_t model_constant) {
+    int64_t coefficient = ((int64_t)prescale << COEFFICIENT_SHIFT) / model_constant;
+    assert(coefficient >= INT32_MIN && coefficient <= INT32_MAX);
+    return coefficient;
+}
+
+/**
+ * Multiplies a value by a model coefficient.
+ *
+ * This is equivalent to multiplying by the prescaler and dividing by the
+ * model constant, but without doing a division. The result is rounded to the
+ * nearest integer, away from zero if halfway, like ::pbio_angle_to_low_res.
+ * Just shifting would round negative values down, which biases the state.
+ *
+ * @param [in]  value          The input value.
+ * @param [in]  coefficient    Precomputed model coefficient.
+ * @return                     Scaled value.
+ */
+static inline int32_t mul_coefficient(int32_t value, int32_t coefficient) {
+    int64_t product = (int64_t)value * coefficient;
+    if (product < 0) {
+        return -((-product + (1 << (COEFFICIENT_SHIFT - 1))) >> COEFFICIENT_SHIFT);
+    }
+    return (product + (1 << (COEFFICIENT_SHIFT - 1))) >> COEFFICIENT_SHIFT;
+}
+
+#if PBIO_CONFIG_CONTROL_LOOP_TIME_ADJUSTABLE
+
+/**
+ * Size of the matrix that combines the state (angle, speed, current) and the
+ * inputs (voltage, torque) for discretization.
+ */
+#define NUM_DISCRETIZE (5)
+
+/**
+ * Multiplies two matrices of size ::NUM_DISCRETIZE.
+ *
+ * @param [in]  a              Left matrix.
+ * @param [in]  b              Right matrix.
+ * @param [out] result         Product of a and b. Must not alias a or b.
+ */
+static void multiply(const double a[NUM_DISCRETIZE][NUM_DISCRETIZE], const double b[NUM_DISCRETIZE][NUM_DISCRETIZE], double result[NUM_DISCRETIZE][NUM_DISCRETIZE]) {
+    for (uint8_t i = 0; i < NUM_DISCRETIZE; i++) {
+        for (uint8_t j = 0; j < NUM_DISCRETIZE; j++) {
+            result[i][j] = 0;
+            for (uint8_t k = 0; k < NUM_DISCRETIZE; k++) {
+                result[i][j] += a[i][k] * b[k][j];
+            }
+        }
+    }
+}
+
+/**
+ * Converts a discrete model entry to a coefficient scaled by 2^24.
+ *
+ * @param [in]  value          Entry of the discrete model.
+ * @return                     Scaled coefficient.
+ */
+static int32_t to_coefficient(double value) {
+    double coefficient = round(ldexp(value, COEFFICIENT_SHIFT));
+    assert(coefficient >= INT32_MIN && coefficient <= INT32_MAX);
+    return coefficient;
+}
+
+/**
+ * Discretizes the model for a model step time other than the default.
+ *
+ * This computes the matrix exponential of the continuous time model, like
+ * pbio/doc/control/motor_model.py does for the default step time. It is
+ * computed by scaling and squaring a truncated Taylor series. This uses
+ * floating point math, but only when the loop time changes.
+ *
+ * @param [in]  model          The model parameters.
+ * @param [in]  step_time      Model step time in ms.
+ * @param [out] c              Coefficients to set the state transition and input values of.
+ */
+static void discretize(const pbio_observer_model_t *model, uint32_t step_time, pbio_observer_coefficients_t *c) {
+
+    // Continuous time model with inputs, multiplied by the step time.
+    double h = step_time / 1000.0;
+    double m[NUM_DISCRETIZE][NUM_DISCRETIZE] = { { 0 } };
+    m[0][1] = h;
+    m[1][2] = model->phi_speed_current * h;
+    m[1][4] = model->gam_speed_torque * h;
+    m[2][1] = model->phi_current_speed * h;
+    m[2][2] = model->phi_current_current * h;
+    m[2][3] = model->gam_current_voltage * h;
+
+    // Scale down by a power of two until the norm is small, so that the
+    // Taylor series converges quickly.
+    double norm = 0;
+    for (uint8_t i = 0; i < NUM_DISCRETIZE; i++) {
+        double row = 0;
+        for (uint8_t j = 0; j < NUM_DISCRETIZE; j++) {
+            row += fabs(m[i][j]);
+        }
+        norm = fmax(norm, row);
+    }
+    int squarings = 0;
+    while (norm > 0.5) {
+        norm /= 2;
+        squarings++;
+    }
+    for (uint8_t i = 0; i < NUM_DISCRETIZE; i++) {
+        for (uint8_t j = 0; j < NUM_DISCRETIZE; j++) {
+            m[i][j] = ldexp(m[i][j], -squarings);
+        }
+    }
+
+    // Taylor series of the exponential: sum of m^k / k!
+    double e[NUM_DISCRETIZE][NUM_DISCRETIZE] = { { 0 } };
+    double term[NUM_DISCRETIZE][NUM_DISCRETIZE] = { { 0 } };
+    double next[NUM_DISCRETIZE][NUM_DISCRETIZE];
+    for (uint8_t i = 0; i < NUM_DISCRETIZE; i++) {
+        e[i][i] = 1;
+        term[i][i] = 1;
+    }
+    for (uint8_t k = 1; k <= 12; k++) {
+        multiply(term, m, next);
+        for (uint8_t i = 0; i < NUM_DISCRETIZE; i++) {
+            for (uint8_t j = 0; j < NUM_DISCRETIZE; j++) {
+                term[i][j] = next[i][j] / k;
+                e[i][j] += term[i][j];
+            }
+        }
+    }
+
+    // Undo the scaling by squaring the result.
+    for (int i = 0; i < squarings; i++) {
+        multiply(e, e, next);
+        memcpy(e, next, sizeof(e));
+    }
+
+    // The state transition values are in the first three columns, followed
+    // by the voltage and torque input values.
+    c->angle_speed = to_coefficient(e[0][1]);
+    c->speed_speed = to_coefficient(e[1][1]);
+    c->current_speed = to_coefficient(e[2][1]);
+    c->angle_current = to_coefficient(e[0][2]);
+    c->speed_current = to_coefficient(e[1][2]);
+    c->current_current = to_coefficient(e[2][2]);
+    c->angle_voltage = to_coefficient(e[0][3]);
+    c->speed_voltage = to_coefficient(e[1][3]);
+    c->current_voltage = to_coefficient(e[2][3]);
+    c->angle_torque = to_coefficient(e[0][4]);
+    c->speed_torque = to_coefficient(e[1][4]);
+    c->current_torque = to_coefficient(e[2][4]);
+}
+
+#endif // PBIO_CONFIG_CONTROL_LOOP_TIME_ADJUSTABLE
+
+/**
+ * Sets the model used by the observer and prepares it for use with the
+ * current loop time.
+ *
+ * @param [in]  obs            The observer instance.
+ * @param [in]  model          The model parameters.
+ */
+void pbio_observer_set_model(pbio_observer_t *obs, const pbio_observer_model_t *model) {
+
+    // Long loops take several whole model steps. Short loops take one
+    // shortened model step.
+    uint32_t loop_time = pbio_control_settings_get_loop_time();
+    uint32_t num_steps = loop_time > PBIO_CONFIG_CONTROL_LOOP_TIME_MS ? loop_time / PBIO_CONFIG_CONTROL_LOOP_TIME_MS : 1;
+    uint32_t step_time = loop_time / num_steps;
+
+    obs->model = model;
+    obs->coefficients = (pbio_observer_coefficients_t) {
+        .angle_speed = get_coefficient(PRESCALE_SPEED, model->d_angle_d_speed),
+        .speed_speed = get_coefficient(PRESCALE_SPEED, model->d_speed_d_speed),
+        .current_speed = get_coefficient(PRESCALE_SPEED, model->d_current_d_speed),
+        .angle_current = get_coefficient(PRESCALE_CURRENT, model->d_angle_d_current),
+        .speed_current = get_coefficient(PRESCALE_CURRENT, model->d_speed_d_current),
+        .current_current = get_coefficient(PRESCALE_CURRENT, model->d_current_d_current),
+        .angle_voltage = get_coefficient(PRESCALE_VOLTAGE, model->d_angle_d_voltage),
+        .speed_voltage = get_coefficient(PRESCALE_VOLTAGE, model->d_speed_d_voltage),
+        .current_voltage = get_coefficient(PRESCALE_VOLTAGE, model->d_current_d_voltage),
+        .angle_torque = get_coefficient(PRESCALE_TORQUE, model->d_angle_d_torque),
+        .speed_torque = get_coefficient(PRESCALE_TORQUE, model->d_speed_d_torque),
+        .current_torque = get_coefficient(PRESCALE_TORQUE, model->d_current_d_torque),
+        .voltage_torque = get_coefficient(PRESCALE_TORQUE, model->d_voltage_d_torque),
+        .torque_voltage = get_coefficient(PRESCALE_VOLTAGE, model->d_torque_d_voltage),
+        .torque_speed = get_coefficient(PRESCALE_SPEED, model->d_torque_d_speed),
+        .torque_acceleration = get_coefficient(PRESCALE_ACCELERATION, model->d_torque_d_acceleration),
+        .loop_time = loop_time,
+        .num_steps = num_steps,
+    };
+
+    #if PBIO_CONFIG_CONTROL_LOOP_TIME_ADJUSTABLE
+    // The generated model is for the default loop time only.
+    if (step_time != PBIO_CONFIG_CONTROL_LOOP_TIME_MS) {
+        discretize(model, step_time, &obs->coefficients);
+    }
+    #endif
+}
+
 /**
  * Resets the observer to a new angle. Speed and current are reset to zero.
  *
@@ -152,7 +364,11 @@ int32_t pbio_observer_get_feedback_voltage(const pbio_observer_t *obs, const pbi
  */
 void pbio_observer_update(pbio_observer_t *obs, uint32_t time, const pbio_angle_t *angle, pbio_dcmotor_actuation_t actuation, int32_t voltage) {
 
-    const pbio_observer_model_t *m = obs->model;
+    // Adapt the model if the loop time has changed.
+    if (obs->coefficients.loop_time != pbio_control_settings_get_loop_time()) {
+        pbio_observer_set_model(obs, obs->model);
+    }
+    const pbio_observer_coefficients_t *c = &obs->coefficients;
 
     // Update numerical derivative as speed sanity check.
     obs->speed_numeric = pbio_differentiator_update_and_get_speed(&obs->differentiator, angle);
@@ -167,45 +383,72 @@ void pbio_observer_update(pbio_observer_t *obs, uint32_t time, const pbio_angle_
     // keep it in sync with the real system.
     int32_t model_voltage = pbio_int_math_clamp(voltage + feedback_voltage, MAX_NUM_VOLTAGE);
 
-    // Modified coulomb friction with transition linear in speed through origin.
-    int32_t coulomb_friction = pbio_int_math_sign(obs->speed) * (
-        pbio_int_math_abs(obs->speed) > obs->settings.coulomb_friction_speed_cutoff ?
-        m->torque_friction:
-        pbio_int_math_abs(obs->speed) * m->torque_friction / obs->settings.coulomb_friction_speed_cutoff
-        );
-
-    // Total torque equals friction plus any known external torques (currently none).
-    int32_t torque = coulomb_friction;
-
-    // Get next state based on current state and input: x(k+1) = Ax(k) + Bu(k)
-    // This model assumes that the actuation mode is a voltage. If the real
-    // mode is coast, back EMF is slightly overestimated, but an accurate
-    // speed value is typically not needed in that use case.
-    pbio_angle_add_mdeg(&obs->angle,
-        PRESCALE_SPEED * obs->speed / m->d_angle_d_speed +
-        PRESCALE_CURRENT * obs->current / m->d_angle_d_current +
-        PRESCALE_VOLTAGE * model_voltage / m->d_angle_d_voltage +
-        PRESCALE_TORQUE * torque / m->d_angle_d_torque);
-    int32_t speed_next = pbio_int_math_clamp(0 +
-        PRESCALE_SPEED * obs->speed / m->d_speed_d_speed +
-        PRESCALE_CURRENT * obs->current / m->d_speed_d_current +
-        PRESCALE_VOLTAGE * model_voltage / m->d_speed_d_voltage +
-        PRESCALE_TORQUE * torque / m->d_speed_d_torque, MAX_NUM_SPEED);
-    int32_t current_next = pbio_int_math_clamp(0 +
-        PRESCALE_SPEED * obs->speed / m->d_current_d_speed +
-        PRESCALE_CURRENT * obs->current / m->d_current_d_current +
-        PRESCALE_VOLTAGE * model_voltage / m->d_current_d_voltage +
-        PRESCALE_TORQUE * torque / m->d_current_d_torque, MAX_NUM_CURRENT);
-
-    // In case of a speed transition through zero, undo (subtract) the effect
-    // of friction, to avoid inducing chatter in the speed signal.
-    if ((obs->speed < 0) != (speed_next < 0)) {
-        speed_next -= PRESCALE_TORQUE * coulomb_friction / m->d_speed_d_torque;
+    // Take one model step, or several if the loop time is long.
+    for (uint32_t i = 0; i < c->num_steps; i++) {
+
+        // Modified coulomb friction with transition linear in speed through origin.
+        int32_t coulomb_friction = pbio_int_math_sign(obs->speed) * (
+            pbio_int_math_abs(obs->speed) > obs->settings.coulomb_friction_speed_cutoff ?
+            obs->model->torque_friction:
+            pbio_int_math_abs(obs->speed) * obs->model->torque_friction / obs->settings.coulomb_friction_speed_cutoff
+            );
+
+        // Total torque equals friction plus any known external torques (currently none).
+        int32_t torque = coulomb_friction;
+
+        // Get next state based on current state and input: x(k+1) = Ax(k) + Bu(k)
+        // This model assumes that the actuation mode is a voltage. If the real
+        // mode is coast, back EMF is slightly overestimated, but an accurate
+        // speed value is typically not needed in that use case.
+        pbio_angle_add_mdeg(&obs->angle,
+            mul_coefficient(obs->speed, c->angle_speed) +
+            mul_coefficient(obs->current, c->angle_current) +
+            mul_coefficient(model_voltage, c->angle_voltage) +
+            mul_coefficient(torque, c->angle_torque));
+        int32_t speed_next = pbio_int_math_clamp(0 +
+            mul_coefficient(obs->speed, c->speed_speed) +
+            mul_coefficient(obs->current, c->speed_current) +
+            mul_coefficient(model_voltage, c->speed_voltage) +
+            mul_coefficient(torque, c->speed_torque), MAX_NUM_SPEED);
+        int32_t current_next = pbio_int_math_clamp(0 +
+            mul_coefficient(obs->speed, c->current_speed) +
+            mul_coefficient(obs->current, c->current_current) +
+            mul_coefficient(model_voltage, c->current_voltage) +
+            mul_coefficient(torque, c->current_torque), MAX_NUM_CURRENT);
+
+        // In case of a speed transition through zero, undo (subtract) the effect
+        // of friction, to avoid inducing chatter in the speed signal.
+        if ((obs->speed < 0) != (speed_next < 0)) {
+            speed_next -= mul_coefficient(coulomb_friction, c->speed_torque);
+        }
+
+        // Save new state.
+        obs->speed = speed_next;
+        obs->current = current_next;
     }
+}
 
-    // Save new state.
-    obs->speed = speed_next;
-    obs->current = current_next;
+/**
+ * Updates the observer for a motor that is not being driven, such as when it
+ * coasts or brakes without active control.
+ *
+ * Instead of simulating the model, the estimated state follows the measured
+ * state. This is much cheaper than a full update. When the motor is driven
+ * again, the full update resumes from this state.
+ *
+ * @param [in]  obs             The observer instance.
+ * @param [in]  angle           Measured angle in millidegrees.
+ */
+void pbio_observer_update_passive(pbio_observer_t *obs, const pbio_angle_t *angle) {
+
+    // Keep updating the numerical derivative, so speed remains available.
+    obs->speed_numeric = pbio_differentiator_update_and_get_speed(&obs->differentiator, angle);
+
+    // Follow the measured state. There is no current when passive.
+    obs->angle = *angle;
+    obs->speed = obs->speed_numeric;
+    obs->current = 0;
+    obs->stalled = false;
 }
 
 /**
@@ -241,17 +484,17 @@ int32_t pbio_observer_get_max_torque(void) {
  * Calculates the feedforward torque needed to achieve the requested reference
  * rotational speed and acceleration.
  *
- * @param [in]  model               The observer model instance.
+ * @param [in]  obs                 The observer instance.
  * @param [in]  rate_ref            The reference rate in mdeg/s.
  * @param [in]  acceleration_ref    The reference acceleration in mdeg/s/s.
  * @returns                         The feedforward torque in uNm.
  *
 */
-int32_t pbio_observer_get_feedforward_torque(const pbio_observer_model_t *model, int32_t rate_ref, int32_t acceleration_ref) {
+int32_t pbio_observer_get_feedforward_torque(const pbio_observer_t *obs, int32_t rate_ref, int32_t acceleration_ref) {
 
-    int32_t friction_compensation_torque = model->torque_friction / 2 * pbio_int_math_sign(rate_ref);
-    int32_t back_emf_compensation_torque = PRESCALE_SPEED * pbio_int_math_clamp(rate_ref, MAX_NUM_SPEED) / model->d_torque_d_speed;
-    int32_t acceleration_torque = PRESCALE_ACCELERATION * pbio_int_math_clamp(acceleration_ref, MAX_NUM_ACCELERATION) / model->d_torque_d_acceleration;
+    int32_t friction_compensation_torque = obs->model->torque_friction / 2 * pbio_int_math_sign(rate_ref);
+    int32_t back_emf_compensation_torque = mul_coefficient(pbio_int_math_clamp(rate_ref, MAX_NUM_SPEED), obs->coefficients.torque_speed);
+    int32_t acceleration_torque = mul_coefficient(pbio_int_math_clamp(acceleration_ref, MAX_NUM_ACCELERATION), obs->coefficients.torque_acceleration);
 
     // Total feedforward torque
     return pbio_int_math_clamp(friction_compensation_torque + back_emf_compensation_torque + acceleration_torque, MAX_NUM_TORQUE);
@@ -260,21 +503,21 @@ int32_t pbio_observer_get_feedforward_torque(const pbio_observer_model_t *model,
 /**
  * Converts a torque to a voltage based on the given motor model.
  *
- * @param [in]  model               The observer model instance.
+ * @param [in]  obs                 The observer instance.
  * @param [in]  desired_torque      The torque in uNm.
  * @returns                         The voltage in mV.
 */
-int32_t pbio_observer_torque_to_voltage(const pbio_observer_model_t *model, int32_t desired_torque) {
-    return PRESCALE_TORQUE * pbio_int_math_clamp(desired_torque, MAX_NUM_TORQUE) / model->d_voltage_d_torque;
+int32_t pbio_observer_torque_to_voltage(const pbio_observer_t *obs, int32_t desired_torque) {
+    return mul_coefficient(pbio_int_math_clamp(desired_torque, MAX_NUM_TORQUE), obs->coefficients.voltage_torque);
 }
 
 /**
  * Converts a voltage to a torque based on the given motor model.
  *
- * @param [in]  model               The observer model instance.
+ * @param [in]  obs                 The observer instance.
  * @param [in]  voltage             The voltage in mV.
  * @returns                         The torque in uNm.
 */
-int32_t pbio_observer_voltage_to_torque(const pbio_observer_model_t *model, int32_t voltage) {
-    return PRESCALE_VOLTAGE * pbio_int_math_clamp(voltage, MAX_NUM_VOLTAGE) / model->d_torque_d_voltage;
+int32_t pbio_observer_voltage_to_torque(const pbio_observer_t *obs, int32_t voltage) {
+    return mul_coefficient(pbio_int_math_clamp(voltage, MAX_NUM_VOLTAGE), obs->coefficients.torque_voltage);
 }
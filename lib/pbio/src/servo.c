@@ -23,6 +23,9 @@
 // Servo motor objects
 static pbio_servo_t servos[PBIO_CONFIG_SERVO_NUM_DEV];
 
+// First servo in the list of servos whose update loop is running.
+static pbio_servo_t *active_servos;
+
 /**
  * Gets pointer to static servo instance using port id.
  *
@@ -51,6 +54,24 @@ pbio_error_t pbio_servo_get_servo(pbdrv_legodev_dev_t *legodev, pbio_servo_t **s
 }
 
 static void pbio_servo_update_loop_set_state(pbio_servo_t *srv, bool update) {
+
+    // Remove servo from the active list if it is there. Its own link is kept
+    // so that an ongoing iteration over the list can carry on from it.
+    pbio_servo_t **link = &active_servos;
+    while (*link) {
+        if (*link == srv) {
+            *link = srv->next_active;
+        } else {
+            link = &(*link)->next_active;
+        }
+    }
+
+    // Append it to the end of the list if it should be updated.
+    if (update) {
+        srv->next_active = NULL;
+        *link = srv;
+    }
+
     srv->run_update_loop = update;
 }
 
@@ -101,7 +122,7 @@ static pbio_error_t pbio_servo_update(pbio_servo_t *srv) {
         pbio_control_update(&srv->control, time_now, &state, &ref, &requested_actuation, &feedback_torque, &external_pause);
 
         // Get required feedforward torque for current reference
-        feedforward_torque = pbio_observer_get_feedforward_torque(srv->observer.model, ref.speed, ref.acceleration);
+        feedforward_torque = pbio_observer_get_feedforward_torque(&srv->observer, ref.speed, ref.acceleration);
 
         // HACK: Constrain total torque to respect temporary duty_cycle limit.
         // See https://github.com/pybricks/support/issues/1069.
@@ -122,6 +143,14 @@ static pbio_error_t pbio_servo_update(pbio_servo_t *srv) {
     int32_t voltage;
     pbio_dcmotor_get_state(srv->dcmotor, &applied_actuation, &voltage);
 
+    // If the motor is not driven and nothing is logged, the observer only
+    // has to follow the measured state, which saves most of the work.
+    if (!pbio_control_is_active(&srv->control) && !pbio_logger_is_active(&srv->log) &&
+        (applied_actuation == PBIO_DCMOTOR_ACTUATION_COAST || applied_actuation == PBIO_DCMOTOR_ACTUATION_BRAKE)) {
+        pbio_observer_update_passive(&srv->observer, &state.position);
+        return PBIO_SUCCESS;
+    }
+
     // Optionally log servo state.
     if (pbio_logger_is_active(&srv->log)) {
 
@@ -165,16 +194,17 @@ static pbio_error_t pbio_servo_update(pbio_servo_t *srv) {
 /**
  * Updates the servo state and controller.
  *
- * This gets called once on every control loop.
+ * This gets called once on every control loop. Only servos whose update
+ * loop is running are visited.
  */
 void pbio_servo_update_all(void) {
     pbio_error_t err;
 
-    // Go through all motors.
-    for (uint8_t i = 0; i < PBIO_CONFIG_SERVO_NUM_DEV; i++) {
-        pbio_servo_t *srv = &servos[i];
+    // Go through all active motors.
+    for (pbio_servo_t *srv = active_servos; srv; srv = srv->next_active) {
 
-        // Run update loop only if registered.
+        // Skip servos that were deactivated while iterating, such as the
+        // other motor of a drive base that was just stopped.
         if (srv->run_update_loop) {
             err = pbio_servo_update(srv);
             if (err != PBIO_SUCCESS) {
@@ -255,15 +285,15 @@ static pbio_error_t pbio_servo_initialize_settings(pbio_servo_t *srv, pbdrv_lego
         return PBIO_ERROR_INVALID_ARG;
     }
 
-    // Save reference to motor model.
-    srv->observer.model = settings_reduced->model;
+    // Save reference to motor model and prepare it for use.
+    pbio_observer_set_model(&srv->observer, settings_reduced->model);
 
     // Initialize maximum torque as the stall torque for maximum voltage.
     // In practice, the nominal voltage is a bit lower than the 9V values.
     // REVISIT: Select nominal voltage based on battery type instead of 7500.
     int32_t max_voltage = pbio_dcmotor_get_max_voltage(type);
     int32_t nominal_voltage = pbio_int_math_min(max_voltage, 7500);
-    int32_t nominal_torque = pbio_observer_voltage_to_torque(srv->observer.model, nominal_voltage);
+    int32_t nominal_torque = pbio_observer_voltage_to_torque(&srv->observer, nominal_voltage);
 
     // Set all control settings.
     srv->control.settings = (pbio_control_settings_t) {
@@ -279,8 +309,9 @@ static pbio_error_t pbio_servo_initialize_settings(pbio_servo_t *srv, pbdrv_lego
         .position_tolerance = DEG_TO_MDEG(precision_profile),
         .acceleration = DEG_TO_MDEG(2000),
         .deceleration = DEG_TO_MDEG(2000),
-        .actuation_max = pbio_observer_voltage_to_torque(srv->observer.model, max_voltage),
-        .actuation_max_temporary = pbio_observer_voltage_to_torque(srv->observer.model, max_voltage),
+        .profile = PBIO_TRAJECTORY_PROFILE_TRAPEZOID,
+        .actuation_max = pbio_observer_voltage_to_torque(&srv->observer, max_voltage),
+        .actuation_max_temporary = pbio_observer_voltage_to_torque(&srv->observer, max_voltage),
         // The nominal voltage is an indication for the nominal torque limit. To
         // ensure proportional control can always get the motor to within the
         // configured tolerance, we select pid_kp such that proportional feedback
@@ -306,7 +337,7 @@ static pbio_error_t pbio_servo_initialize_settings(pbio_servo_t *srv, pbdrv_lego
     srv->observer.settings = (pbio_observer_settings_t) {
         .stall_speed_limit = srv->control.settings.stall_speed_limit,
         .stall_time = srv->control.settings.stall_time,
-        .feedback_voltage_negligible = pbio_observer_torque_to_voltage(srv->observer.model, srv->observer.model->torque_friction) * 5 / 2,
+        .feedback_voltage_negligible = pbio_observer_torque_to_voltage(&srv->observer, srv->observer.model->torque_friction) * 5 / 2,
         .feedback_voltage_stall_ratio = 75,
         .feedback_gain_low = settings_reduced->feedback_gain_low,
         .feedback_gain_high = settings_reduced->feedback_gain_low * 7,
@@ -526,7 +557,7 @@ pbio_error_t pbio_servo_actuate(pbio_servo_t *srv, pbio_dcmotor_actuation_t actu
         case PBIO_DCMOTOR_ACTUATION_VOLTAGE:
             return pbio_dcmotor_set_voltage(srv->dcmotor, payload);
         case PBIO_DCMOTOR_ACTUATION_TORQUE:
-            return pbio_dcmotor_set_voltage(srv->dcmotor, pbio_observer_torque_to_voltage(srv->observer.model, payload));
+            return pbio_dcmotor_set_voltage(srv->dcmotor, pbio_observer_torque_to_voltage(&srv->observer, payload));
         default:
             return PBIO_ERROR_INVALID_ARG;
     }
@@ -728,6 +759,112 @@ pbio_error_t pbio_servo_run_target(pbio_servo_t *srv, int32_t speed, int32_t tar
     return pbio_control_start_position_control(&srv->control, time_now, &state, target, speed, on_completion);
 }
 
+/**
+ * Runs several servos to given target angles, such that they all start and
+ * complete at the same time.
+ *
+ * The servo that takes the longest runs at the given speed. The others run
+ * more slowly, so that none of them have to wait for the others.
+ *
+ * @param [in]  srv            The servo instances, each used at most once.
+ * @param [in]  num_servos     The number of servos.
+ * @param [in]  speed          Top angular velocity in degrees per second of the slowest servo. If zero, default speed is used.
+ * @param [in]  targets        Angle to run to for each servo.
+ * @param [in]  on_completion  What to do after reaching the target angles.
+ * @return                     Error code.
+ */
+pbio_error_t pbio_servo_run_target_synchronized(pbio_servo_t *const *srv, uint8_t num_servos, int32_t speed, const int32_t *targets, pbio_control_on_completion_t on_completion) {
+
+    if (num_servos == 0 || num_servos > PBIO_CONFIG_SERVO_NUM_DEV) {
+        return PBIO_ERROR_INVALID_ARG;
+    }
+
+    pbio_control_t *ctl[PBIO_CONFIG_SERVO_NUM_DEV];
+    pbio_control_state_t state[PBIO_CONFIG_SERVO_NUM_DEV];
+
+    for (uint8_t i = 0; i < num_servos; i++) {
+
+        // Don't allow new user command if update loop not registered.
+        if (!pbio_servo_update_loop_is_running(srv[i])) {
+            return PBIO_ERROR_INVALID_OP;
+        }
+
+        // Each servo can have only one target.
+        for (uint8_t j = 0; j < i; j++) {
+            if (srv[j] == srv[i]) {
+                return PBIO_ERROR_INVALID_ARG;
+            }
+        }
+
+        // Stop parent object that uses this motor, if any.
+        pbio_error_t err = pbio_parent_stop(&srv[i]->parent, false);
+        if (err != PBIO_SUCCESS) {
+            return err;
+        }
+        ctl[i] = &srv[i]->control;
+    }
+
+    // Get current time, shared by all servos.
+    uint32_t time_now = pbio_control_get_time_ticks();
+
+    // Read the physical and estimated states
+    for (uint8_t i = 0; i < num_servos; i++) {
+        pbio_error_t err = pbio_servo_get_state_control(srv[i], &state[i]);
+        if (err != PBIO_SUCCESS) {
+            return err;
+        }
+    }
+
+    pbio_error_t err = pbio_control_start_position_control_synchronized(ctl, state, num_servos, time_now, targets, speed, on_completion);
+    if (err != PBIO_SUCCESS) {
+        // Controllers that were already started have been stopped again, so
+        // coast all motors to avoid leaving any of them on their last
+        // actuation.
+        for (uint8_t i = 0; i < num_servos; i++) {
+            pbio_servo_stop(srv[i], PBIO_CONTROL_ON_COMPLETION_COAST);
+        }
+    }
+    return err;
+}
+
+/**
+ * Queues a run to a given target angle, to start when the ongoing run to a
+ * target completes. If nothing is ongoing, it starts right away.
+ *
+ * Consecutive targets in the same direction are passed without stopping.
+ *
+ * @param [in]  srv            The control instance.
+ * @param [in]  speed          Top angular velocity in degrees per second. If zero, default speed is used.
+ * @param [in]  target         Angle to run to.
+ * @param [in]  on_completion  What to do after reaching the target angle, if it is the last one in the queue.
+ * @return                     Error code.
+ */
+pbio_error_t pbio_servo_queue_target(pbio_servo_t *srv, int32_t speed, int32_t target, pbio_control_on_completion_t on_completion) {
+
+    // Don't allow new user command if update loop not registered.
+    if (!pbio_servo_update_loop_is_running(srv)) {
+        return PBIO_ERROR_INVALID_OP;
+    }
+
+    // Stop parent object that uses this motor, if any.
+    pbio_error_t err = pbio_parent_stop(&srv->parent, false);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+
+    // Get current time
+    uint32_t time_now = pbio_control_get_time_ticks();
+
+    // Read the physical and estimated state
+    pbio_control_state_t state;
+    err = pbio_servo_get_state_control(srv, &state);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+
+    return pbio_control_queue_position_control(&srv->control, time_now, &state, target, speed, on_completion);
+}
+
 /**
  * Runs the servo at a given speed by a given angle and stops there.
  *
@@ -888,7 +1025,7 @@ pbio_error_t pbio_servo_get_load(pbio_servo_t *srv, int32_t *load) {
         }
         // Use observer error as a measure of torque.
         int32_t feedback_voltage = pbio_observer_get_feedback_voltage(&srv->observer, &angle);
-        *load = pbio_observer_voltage_to_torque(srv->observer.model, feedback_voltage);
+        *load = pbio_observer_voltage_to_torque(&srv->observer, feedback_voltage);
     }
 
     // Convert to user torque units (mNm).
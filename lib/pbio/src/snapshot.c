@@ -0,0 +1,206 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2023 The Pybricks Authors
+
+#include <pbio/config.h>
+
+#if PBIO_CONFIG_SNAPSHOT
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <pbdrv/clock.h>
+#include <pbdrv/legodev.h>
+#include <pbio/imu.h>
+#include <pbio/servo.h>
+#include <pbio/snapshot.h>
+
+/**
+ * Gets a motor or sensor on a port and checks that it can be read.
+ *
+ * @param [in]  port_id     The port.
+ * @param [out] legodev     The legodev instance.
+ * @param [out] srv         The servo, or NULL if there is no controlled servo.
+ * @return                  Error code.
+ */
+static pbio_error_t pbio_snapshot_get_device(pbio_port_id_t port_id, pbdrv_legodev_dev_t **legodev, pbio_servo_t **srv) {
+
+    *srv = NULL;
+
+    // Motors that are being controlled are read by their servo.
+    pbdrv_legodev_type_id_t type_id = PBDRV_LEGODEV_TYPE_ID_ANY_ENCODED_MOTOR;
+    pbio_error_t err = pbdrv_legodev_get_device(port_id, &type_id, legodev);
+    #if PBIO_CONFIG_SERVO
+    if (err == PBIO_SUCCESS && pbio_servo_get_servo(*legodev, srv) == PBIO_SUCCESS) {
+        if (pbio_servo_update_loop_is_running(*srv)) {
+            return PBIO_SUCCESS;
+        }
+        *srv = NULL;
+    }
+    #endif
+
+    // Everything else is read as a sensor.
+    if (err == PBIO_ERROR_NO_DEV) {
+        type_id = PBDRV_LEGODEV_TYPE_ID_ANY_LUMP_UART;
+        err = pbdrv_legodev_get_device(port_id, &type_id, legodev);
+    }
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+    return pbdrv_legodev_is_ready(*legodev);
+}
+
+/**
+ * Adds the values of the current mode of a device to a snapshot.
+ *
+ * @param [in]  snapshot    The snapshot.
+ * @param [in]  legodev     The legodev instance.
+ * @return                  Error code.
+ */
+static pbio_error_t pbio_snapshot_add_device(pbio_snapshot_t *snapshot, pbdrv_legodev_dev_t *legodev) {
+
+    pbdrv_legodev_info_t *info;
+    pbio_error_t err = pbdrv_legodev_get_info(legodev, &info);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+
+    #if PBDRV_CONFIG_LEGODEV_MODE_INFO
+    void *data;
+    err = pbdrv_legodev_get_data(legodev, info->mode, &data);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+
+    const pbdrv_legodev_mode_info_t *mode_info = &info->mode_info[info->mode];
+    if (snapshot->num_values + mode_info->num_values > PBIO_CONFIG_SNAPSHOT_NUM_VALUES) {
+        return PBIO_ERROR_INVALID_ARG;
+    }
+
+    // Widen all values to 32 bits. Floats are rounded.
+    int32_t *values = &snapshot->values[snapshot->num_values];
+    for (uint8_t i = 0; i < mode_info->num_values; i++) {
+        switch (mode_info->data_type) {
+            case PBDRV_LEGODEV_DATA_TYPE_INT8:
+                values[i] = ((int8_t *)data)[i];
+                break;
+            case PBDRV_LEGODEV_DATA_TYPE_INT16:
+                values[i] = ((int16_t *)data)[i];
+                break;
+            case PBDRV_LEGODEV_DATA_TYPE_INT32:
+                values[i] = ((int32_t *)data)[i];
+                break;
+            case PBDRV_LEGODEV_DATA_TYPE_FLOAT:
+                values[i] = lroundf(((float *)data)[i]);
+                break;
+            default:
+                return PBIO_ERROR_IO;
+        }
+    }
+    snapshot->num_values += mode_info->num_values;
+    return PBIO_SUCCESS;
+    #else
+    // Without mode information, the data can't be decoded.
+    return PBIO_ERROR_NOT_SUPPORTED;
+    #endif
+}
+
+/**
+ * Adds the state of a controlled motor to a snapshot.
+ *
+ * @param [in]  snapshot    The snapshot.
+ * @param [in]  srv         The servo instance.
+ * @return                  Error code.
+ */
+static pbio_error_t pbio_snapshot_add_servo(pbio_snapshot_t *snapshot, pbio_servo_t *srv) {
+    if (snapshot->num_values + PBIO_SNAPSHOT_NUM_MOTOR_VALUES > PBIO_CONFIG_SNAPSHOT_NUM_VALUES) {
+        return PBIO_ERROR_INVALID_ARG;
+    }
+    int32_t *values = &snapshot->values[snapshot->num_values];
+    pbio_error_t err = pbio_servo_get_state_user(srv, &values[0], &values[1]);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+    snapshot->num_values += PBIO_SNAPSHOT_NUM_MOTOR_VALUES;
+    return PBIO_SUCCESS;
+}
+
+/**
+ * Adds the heading, angular velocity and acceleration of the IMU to a
+ * snapshot.
+ *
+ * @param [in]  snapshot    The snapshot.
+ * @return                  Error code.
+ */
+static pbio_error_t pbio_snapshot_add_imu(pbio_snapshot_t *snapshot) {
+    #if PBIO_CONFIG_IMU
+    if (snapshot->num_values + PBIO_SNAPSHOT_NUM_IMU_VALUES > PBIO_CONFIG_SNAPSHOT_NUM_VALUES) {
+        return PBIO_ERROR_INVALID_ARG;
+    }
+    pbio_geometry_xyz_t angular_velocity;
+    pbio_geometry_xyz_t acceleration;
+    pbio_imu_get_angular_velocity(&angular_velocity);
+    pbio_imu_get_acceleration(&acceleration);
+
+    int32_t *values = &snapshot->values[snapshot->num_values];
+    values[0] = lroundf(pbio_imu_get_heading());
+    for (uint8_t i = 0; i < 3; i++) {
+        values[1 + i] = lroundf(angular_velocity.values[i]);
+        values[4 + i] = lroundf(acceleration.values[i]);
+    }
+    snapshot->num_values += PBIO_SNAPSHOT_NUM_IMU_VALUES;
+    return PBIO_SUCCESS;
+    #else
+    return PBIO_ERROR_NOT_SUPPORTED;
+    #endif
+}
+
+/**
+ * Takes a snapshot of the devices on the given ports and optionally the IMU.
+ *
+ * For each port with a motor that is being controlled, this gives its angle
+ * and speed. For other devices, this gives all values of the current mode.
+ * The IMU values come last.
+ *
+ * All values are read in one go, without processing any events in between, so
+ * they belong to the same point in time. If a device is still changing modes,
+ * nothing is read, so this can be called again later.
+ *
+ * @param [out] snapshot    The snapshot.
+ * @param [in]  ports       Ports to read.
+ * @param [in]  num_ports   Number of ports.
+ * @param [in]  imu         Whether to add the IMU values.
+ * @return                  ::PBIO_SUCCESS on success.
+ *                          ::PBIO_ERROR_AGAIN if a device is not ready yet.
+ *                          ::PBIO_ERROR_INVALID_ARG if there are too many values.
+ *                          ::PBIO_ERROR_NO_DEV if a device is not attached.
+ *                          ::PBIO_ERROR_NOT_SUPPORTED if there is no IMU.
+ */
+pbio_error_t pbio_snapshot_take(pbio_snapshot_t *snapshot, const pbio_port_id_t *ports, uint8_t num_ports, bool imu) {
+
+    snapshot->num_values = 0;
+
+    // Check that all devices are ready first, so we don't read only some.
+    pbdrv_legodev_dev_t *legodev;
+    pbio_servo_t *srv;
+    for (uint8_t i = 0; i < num_ports; i++) {
+        pbio_error_t err = pbio_snapshot_get_device(ports[i], &legodev, &srv);
+        if (err != PBIO_SUCCESS) {
+            return err;
+        }
+    }
+
+    snapshot->time = pbdrv_clock_get_ms();
+
+    for (uint8_t i = 0; i < num_ports; i++) {
+        pbio_snapshot_get_device(ports[i], &legodev, &srv);
+        pbio_error_t err = srv ? pbio_snapshot_add_servo(snapshot, srv) : pbio_snapshot_add_device(snapshot, legodev);
+        if (err != PBIO_SUCCESS) {
+            return err;
+        }
+    }
+
+    return imu ? pbio_snapshot_add_imu(snapshot) : PBIO_SUCCESS;
+}
+
+#endif // PBIO_CONFIG_SNAPSHOT
@@ -10,6 +10,7 @@
 #include <stdlib.h>
 
 #include <pbio/angle.h>
+#include <pbio/control_settings.h>
 #include <pbio/int_math.h>
 #include <pbio/trajectory.h>
 
@@ -195,6 +196,28 @@ static void pbio_trajectory_set_start(pbio_trajectory_reference_t *start, const
     start->time = c->time_start;
 }
 
+/**
+ * Sets the profile of a trajectory based on user command.
+ *
+ * The trajectory is planned with straight ramps at the mean acceleration of
+ * the profile. For S-curves, the acceleration of the command is the peak,
+ * which is 4/3 times the mean, so it is reduced accordingly.
+ *
+ * @param [out] trj     The trajectory to set the profile of.
+ * @param [in]  c       The command to use. Acceleration is modified as needed.
+ */
+static void pbio_trajectory_set_profile(pbio_trajectory_t *trj, pbio_trajectory_command_t *c) {
+    #if PBIO_CONFIG_TRAJECTORY_S_CURVE
+    trj->profile = c->profile;
+    if (trj->profile == PBIO_TRAJECTORY_PROFILE_S_CURVE) {
+        c->acceleration = c->acceleration * 3 / 4;
+        c->deceleration = c->deceleration * 3 / 4;
+    }
+    #else
+    trj->profile = PBIO_TRAJECTORY_PROFILE_TRAPEZOID;
+    #endif
+}
+
 /**
  * Initializes a trajectory struct based on a user command.
  *
@@ -205,6 +228,7 @@ void pbio_trajectory_make_constant(pbio_trajectory_t *trj, const pbio_trajectory
 
     // Almost everything will be zero, so just zero everything.
     *trj = (pbio_trajectory_t) {0};
+    pbio_trajectory_reset_incremental(trj);
 
     // Fill out starting point based on user command.
     pbio_trajectory_set_start(&trj->start, c);
@@ -671,6 +695,171 @@ static pbio_error_t pbio_trajectory_new_forward_angle_command(pbio_trajectory_t
     return PBIO_SUCCESS;
 }
 
+#if PBIO_CONFIG_TRAJECTORY_S_CURVE
+
+/*
+ * With the S-curve profile, the acceleration of the acceleration and
+ * deceleration segments rises linearly from zero to its peak during the first
+ * quarter of the segment, stays there until the last quarter, and then falls
+ * back to zero. As a function of the progress u = t / T through a segment of
+ * duration T, normalized such that the speed goes from 0 to 1:
+ *
+ *                 u < 1/4                1/4 < u < 3/4               3/4 < u
+ *     a(u) / a    16/3 * u               4/3                         16/3 * v
+ *     s(u)        8/3 * u^2              4/3 * (u - 1/8)             1 - 8/3 * v^2
+ *     p(u)        8/9 * u^3              1/72 + 2/3 * (u^2 - u/4)    1/2 - v + 8/9 * v^3
+ *
+ * where v = 1 - u, a is the mean acceleration, s is the speed change, and p
+ * is the angle gained on top of the start speed, divided by the speed change
+ * times T. So the peak acceleration is 4/3 of the mean. Each segment ends at
+ * the same time, angle, and speed as the straight ramp at the mean
+ * acceleration, so the planning of the trajectory and the other segments
+ * are unchanged.
+ */
+
+/**
+ * Fixed point representation of 1 for the progress u through a segment.
+ */
+#define S_CURVE_ONE (1 << 30)
+
+/**
+ * Checks if a segment is evaluated as an S-curve instead of a straight ramp.
+ *
+ * @param [in]  trj         The trajectory instance.
+ * @param [in]  segment     Index of the segment.
+ * @return                  True if the segment is an S-curve.
+ */
+static bool pbio_trajectory_segment_is_curved(const pbio_trajectory_t *trj, uint8_t segment) {
+    return trj->profile == PBIO_TRAJECTORY_PROFILE_S_CURVE && (segment == 0 || segment == 2);
+}
+
+/**
+ * Precomputes the angles gained by the S-curve segments of a trajectory on
+ * top of their start speed, if used.
+ *
+ * These are taken from the actual vertices rather than computed from the
+ * speeds, so that the rounding errors of the trajectory planner do not cause
+ * a jump at the vertex. Must be called whenever the vertices change.
+ *
+ * @param [in]  trj         The trajectory instance.
+ */
+static void pbio_trajectory_s_curve_update(pbio_trajectory_t *trj) {
+    if (trj->profile != PBIO_TRAJECTORY_PROFILE_S_CURVE) {
+        return;
+    }
+    trj->th_curve[0] = trj->th1 - mul_w_by_t(trj->w0, trj->t1);
+    trj->th_curve[1] = trj->th3 - trj->th2 - mul_w_by_t(trj->w1, trj->t3 - trj->t2);
+}
+
+/**
+ * Gets the progress through a segment.
+ *
+ * This is a long division in steps that fit in 32 bits, since the duration
+ * of a segment with acceleration takes up to 20 bits.
+ *
+ * @param [in]  t           Time since start of the segment.
+ * @param [in]  duration    Duration of the segment.
+ * @returns                 Progress @p t / @p duration, scaled by ::S_CURVE_ONE.
+ */
+static int32_t div_t_by_duration(int32_t t, int32_t duration) {
+
+    assert(duration < (1 << 20));
+    assert(t >= 0 && t < duration);
+
+    uint32_t u = 0;
+    uint32_t r = t;
+    for (uint8_t i = 0; i < 3; i++) {
+        uint8_t bits = i < 2 ? 12 : 6;
+        r <<= bits;
+        u = (u << bits) | (r / duration);
+        r %= duration;
+    }
+    return u;
+}
+
+/**
+ * Multiplies a value by a fraction, using only 32-bit products.
+ *
+ * @param [in]  x           Value, smaller than ::S_CURVE_ONE in magnitude.
+ * @param [in]  q           Fraction from 0 to ::S_CURVE_ONE.
+ * @returns                 @p x * @p q / ::S_CURVE_ONE, rounded towards zero.
+ */
+static int32_t mul_by_fraction(int32_t x, int32_t q) {
+
+    assert(pbio_int_math_abs(x) < S_CURVE_ONE && q >= 0 && q <= S_CURVE_ONE);
+
+    // Split both factors into 15-bit digits, so each product fits.
+    int32_t x_hi = x / (1 << 15);
+    int32_t x_lo = x % (1 << 15);
+    int32_t q_hi = q >> 15;
+    int32_t q_lo = q & 0x7fff;
+    return x_hi * q_hi + (x_hi * q_lo + x_lo * q_hi) / (1 << 15) + x_lo * q_lo / S_CURVE_ONE;
+}
+
+/**
+ * Evaluates an S-curve segment.
+ *
+ * @param [in]  t           Time since start of the segment.
+ * @param [in]  duration    Duration of the segment.
+ * @param [in]  w_s         Speed at start of the segment in ddeg/s.
+ * @param [in]  w_e         Speed at end of the segment in ddeg/s.
+ * @param [in]  th_gain     Angle gained on top of the start speed in mdeg.
+ * @param [in]  a_mean      Mean acceleration during the segment in deg/s^2.
+ * @param [out] th          Angle relative to start of the segment in mdeg.
+ * @param [out] w           Speed in ddeg/s.
+ * @param [out] a           Acceleration in deg/s^2.
+ */
+static void pbio_trajectory_evaluate_s_curve(int32_t t, int32_t duration, int32_t w_s, int32_t w_e, int32_t th_gain, int32_t a_mean, int32_t *th, int32_t *w, int32_t *a) {
+
+    // Segments without duration are evaluated at their end.
+    if (duration == 0) {
+        *th = th_gain;
+        *w = w_e;
+        *a = 0;
+        return;
+    }
+
+    int32_t u = div_t_by_duration(t, duration);
+
+    // Normalized acceleration, speed change, and twice the angle, as given
+    // above. Divisions by 3 come first where the product could overflow.
+    int32_t g;
+    int32_t s;
+    int32_t p2;
+    if (u < S_CURVE_ONE / 4) {
+        int32_t u2 = mul_by_fraction(u, u);
+        g = u * 4;
+        s = u2 * 8 / 3;
+        p2 = mul_by_fraction(u2, u) * 16 / 9;
+    } else if (u < S_CURVE_ONE / 4 * 3) {
+        int32_t u2 = mul_by_fraction(u, u);
+        g = S_CURVE_ONE;
+        s = (u - S_CURVE_ONE / 8) / 3 * 4;
+        p2 = S_CURVE_ONE / 36 + (u2 - u / 4) / 3 * 4;
+    } else {
+        int32_t v = S_CURVE_ONE - u;
+        int32_t v2 = mul_by_fraction(v, v);
+        g = v * 4;
+        s = S_CURVE_ONE - v2 * 8 / 3;
+        p2 = S_CURVE_ONE - v * 2 + mul_by_fraction(v2, v) * 16 / 9;
+    }
+
+    *w = w_s + mul_by_fraction(w_e - w_s, s);
+    *th = mul_w_by_t(w_s, t) + mul_by_fraction(th_gain, p2);
+    *a = mul_by_fraction(a_mean * 4 / 3, g);
+}
+
+#else
+
+static inline bool pbio_trajectory_segment_is_curved(const pbio_trajectory_t *trj, uint8_t segment) {
+    return false;
+}
+
+static inline void pbio_trajectory_s_curve_update(pbio_trajectory_t *trj) {
+}
+
+#endif // PBIO_CONFIG_TRAJECTORY_S_CURVE
+
 /**
  * Stretches a trajectory to end at the same time as @p leader.
  *
@@ -679,6 +868,8 @@ static pbio_error_t pbio_trajectory_new_forward_angle_command(pbio_trajectory_t
  */
 void pbio_trajectory_stretch(pbio_trajectory_t *trj, const pbio_trajectory_t *leader) {
 
+    pbio_trajectory_reset_incremental(trj);
+
     // Synchronize timestamps with leading trajectory.
     trj->t1 = leader->t1;
     trj->t2 = leader->t2;
@@ -710,6 +901,7 @@ void pbio_trajectory_stretch(pbio_trajectory_t *trj, const pbio_trajectory_t *le
     // accelerations and speeds.
     trj->th1 = mul_w_by_t(trj->w0, trj->t1) + mul_a_by_t2(trj->a0, trj->t1);
     trj->th2 = trj->th1 + mul_w_by_t(trj->w1, trj->t2 - trj->t1);
+    pbio_trajectory_s_curve_update(trj);
 }
 
 /**
@@ -723,6 +915,8 @@ void pbio_trajectory_stretch(pbio_trajectory_t *trj, const pbio_trajectory_t *le
  */
 pbio_error_t pbio_trajectory_new_time_command(pbio_trajectory_t *trj, const pbio_trajectory_command_t *command) {
 
+    pbio_trajectory_reset_incremental(trj);
+
     // Copy the command so we can modify it.
     pbio_trajectory_command_t c = *command;
 
@@ -746,6 +940,9 @@ pbio_error_t pbio_trajectory_new_time_command(pbio_trajectory_t *trj, const pbio
     // Bind target speed by maximum speed.
     c.speed_target = pbio_int_math_min(c.speed_target, c.speed_max);
 
+    // Plan with the mean acceleration of the selected profile.
+    pbio_trajectory_set_profile(trj, &c);
+
     // Calculate the trajectory, assumed to be forward.
     pbio_error_t err = pbio_trajectory_new_forward_time_command(trj, &c);
     if (err != PBIO_SUCCESS) {
@@ -756,6 +953,7 @@ pbio_error_t pbio_trajectory_new_time_command(pbio_trajectory_t *trj, const pbio
     if (backward) {
         reverse_trajectory(trj);
     }
+    pbio_trajectory_s_curve_update(trj);
     return PBIO_SUCCESS;
 }
 
@@ -770,6 +968,8 @@ pbio_error_t pbio_trajectory_new_time_command(pbio_trajectory_t *trj, const pbio
  */
 pbio_error_t pbio_trajectory_new_angle_command(pbio_trajectory_t *trj, const pbio_trajectory_command_t *command) {
 
+    pbio_trajectory_reset_incremental(trj);
+
     // Copy the command so we can modify it.
     pbio_trajectory_command_t c = *command;
 
@@ -809,6 +1009,9 @@ pbio_error_t pbio_trajectory_new_angle_command(pbio_trajectory_t *trj, const pbi
         c.speed_start *= -1;
     }
 
+    // Plan with the mean acceleration of the selected profile.
+    pbio_trajectory_set_profile(trj, &c);
+
     // Calculate the trajectory, assumed to be forward.
     pbio_error_t err = pbio_trajectory_new_forward_angle_command(trj, &c);
     if (err != PBIO_SUCCESS) {
@@ -819,10 +1022,226 @@ pbio_error_t pbio_trajectory_new_angle_command(pbio_trajectory_t *trj, const pbi
     if (backward) {
         reverse_trajectory(trj);
     }
+    pbio_trajectory_s_curve_update(trj);
 
     return PBIO_SUCCESS;
 }
 
+#if PBIO_CONFIG_TRAJECTORY_INCREMENTAL
+
+/*
+ * Within one segment, the trajectory is evaluated as
+ *
+ *     th(t) = th_s + w_s * t / 100 + a * t^2 / 200000
+ *     w(t)  = w_s + a * t / 1000
+ *
+ * where t is the time since the start of the segment. Instead of evaluating
+ * this at every control loop step, the difference between steps is updated
+ * with additions only, known as forward differencing. Values are kept as an
+ * integer and a remainder, using the denominators above as the radix.
+ *
+ * This starts from the full evaluation at the first step in each segment.
+ * From there, it is exact, whereas the full evaluation rounds intermediate
+ * results. In long acceleration phases, the two can differ by up to about
+ * 1 mdeg for every 20 ms since the start of the segment.
+ *
+ * Steps of exactly one control loop use additions only. The control loop
+ * does not always run at exactly the same interval, so other steps are
+ * supported too. These use 32-bit multiplications and divisions by the
+ * radix, which is still much cheaper than starting over with 64-bit math.
+ */
+
+/**
+ * Time step for incremental evaluation, which is one control loop.
+ */
+#define INCREMENTAL_STEP (pbio_control_settings_get_loop_time() * PBIO_TRAJECTORY_TICKS_PER_MS)
+
+/**
+ * Largest time step that can be taken without starting over. This keeps the
+ * sum of remainders in ::add_scaled_remainder within 32 bits.
+ */
+#define INCREMENTAL_STEP_MAX (200)
+
+/**
+ * Radix of angle remainders (mdeg).
+ */
+#define INCREMENTAL_TH_RADIX (200000)
+
+/**
+ * Radix of speed remainders (ddeg/s).
+ */
+#define INCREMENTAL_W_RADIX (1000)
+
+/**
+ * Splits a value into an integer part and a nonnegative remainder.
+ *
+ * @param [in]  value       Value scaled by @p radix.
+ * @param [in]  radix       Denominator of the remainder.
+ * @param [out] integer     Value divided by @p radix, rounded down.
+ * @param [out] remainder   Remainder in the range 0 to @p radix - 1.
+ */
+static void split_remainder(int64_t value, int32_t radix, int32_t *integer, int32_t *remainder) {
+    int64_t q = value / radix;
+    int64_t r = value % radix;
+    if (r < 0) {
+        q--;
+        r += radix;
+    }
+    *integer = q;
+    *remainder = r;
+}
+
+/**
+ * Adds a value with remainder to another.
+ *
+ * @param [in, out] integer     Integer part to add to.
+ * @param [in, out] remainder   Remainder to add to.
+ * @param [in]  add             Integer part to add.
+ * @param [in]  add_remainder   Remainder to add.
+ * @param [in]  radix           Denominator of the remainders.
+ */
+static void add_remainder(int32_t *integer, int32_t *remainder, int32_t add, int32_t add_remainder, int32_t radix) {
+    *integer += add;
+    *remainder += add_remainder;
+    if (*remainder >= radix) {
+        *remainder -= radix;
+        *integer += 1;
+    }
+}
+
+/**
+ * Adds a multiple of a value with remainder to another.
+ *
+ * @param [in, out] integer     Integer part to add to.
+ * @param [in, out] remainder   Remainder to add to.
+ * @param [in]  k               Multiplier of the value to add.
+ * @param [in]  add             Integer part to add.
+ * @param [in]  add_remainder   Remainder to add.
+ * @param [in]  radix           Denominator of the remainders.
+ */
+static void add_scaled_remainder(int32_t *integer, int32_t *remainder, uint32_t k, int32_t add, int32_t add_remainder, int32_t radix) {
+    uint32_t sum = (uint32_t)*remainder + k * (uint32_t)add_remainder;
+    *integer += (int32_t)k * add + (int32_t)(sum / (uint32_t)radix);
+    *remainder = sum % (uint32_t)radix;
+}
+
+/**
+ * Invalidates the incremental evaluation state, so the next reference is
+ * evaluated from scratch.
+ *
+ * This is called by all functions that change the trajectory.
+ *
+ * @param [in]  trj         The trajectory instance.
+ */
+void pbio_trajectory_reset_incremental(pbio_trajectory_t *trj) {
+    trj->incremental.valid = false;
+}
+
+/**
+ * Initializes the incremental evaluation state at a given time.
+ *
+ * This needs 64-bit divisions, but it is done only once per segment.
+ *
+ * @param [in]  trj         The trajectory instance.
+ * @param [in]  time        Time since start of the trajectory.
+ * @param [in]  segment     Index of the segment that contains @p time.
+ * @param [in]  t_s         Time at start of the segment.
+ * @param [in]  th_s        Angle at start of the segment in mdeg.
+ * @param [in]  w_s         Speed at start of the segment in ddeg/s.
+ * @param [in]  a           Acceleration during the segment in deg/s^2.
+ * @param [in]  th          Angle at @p time from the full evaluation in mdeg.
+ */
+static void pbio_trajectory_incremental_start(pbio_trajectory_t *trj, int32_t time, uint8_t segment, int32_t t_s, int32_t th_s, int32_t w_s, int32_t a, int32_t th) {
+    pbio_trajectory_incremental_t *inc = &trj->incremental;
+
+    // Curved segments are always evaluated in full.
+    if (pbio_trajectory_segment_is_curved(trj, segment)) {
+        inc->valid = false;
+        return;
+    }
+
+    int64_t t = time - t_s;
+    int64_t h = INCREMENTAL_STEP;
+
+    // Angle and its first and second difference, scaled by the radix.
+    split_remainder(2000 * w_s * t + a * t * t, INCREMENTAL_TH_RADIX, &inc->th, &inc->th_rem);
+    split_remainder(2000 * w_s * h + a * h * (2 * t + h), INCREMENTAL_TH_RADIX, &inc->dth, &inc->dth_rem);
+    split_remainder(2 * a * h * h, INCREMENTAL_TH_RADIX, &inc->ddth, &inc->ddth_rem);
+
+    // Same for a step of one tick, used when the step is not exactly h.
+    split_remainder(2000 * w_s + a * (2 * t + 1), INCREMENTAL_TH_RADIX, &inc->dth_tick, &inc->dth_tick_rem);
+    split_remainder(2 * a, INCREMENTAL_TH_RADIX, &inc->ddth_tick, &inc->ddth_tick_rem);
+    split_remainder(2 * a * h, INCREMENTAL_TH_RADIX, &inc->ddth_tick_step, &inc->ddth_tick_step_rem);
+
+    // Speed change and its difference, scaled by the radix.
+    split_remainder(a * t, INCREMENTAL_W_RADIX, &inc->dw, &inc->dw_rem);
+    split_remainder(a * h, INCREMENTAL_W_RADIX, &inc->ddw, &inc->ddw_rem);
+    split_remainder(a, INCREMENTAL_W_RADIX, &inc->ddw_tick, &inc->ddw_tick_rem);
+
+    // Start from the result of the full evaluation, so there is no jump
+    // when switching between the two. The remainder is kept.
+    inc->th = th - th_s;
+
+    inc->time = time;
+    inc->step = h;
+    inc->segment = segment;
+    inc->valid = true;
+}
+
+/**
+ * Advances the incremental evaluation state to the given time, if possible.
+ *
+ * @param [in]  trj         The trajectory instance.
+ * @param [in]  time        Time since start of the trajectory.
+ * @param [in]  segment     Index of the segment that contains @p time.
+ * @return                  True if the state now matches @p time, false if
+ *                          it must be initialized again.
+ */
+static bool pbio_trajectory_incremental_step(pbio_trajectory_t *trj, int32_t time, uint8_t segment) {
+    pbio_trajectory_incremental_t *inc = &trj->incremental;
+
+    // Curved segments are always evaluated in full.
+    if (!inc->valid || inc->segment != segment || pbio_trajectory_segment_is_curved(trj, segment)) {
+        return false;
+    }
+
+    // Nothing to do if this time was already evaluated.
+    if (time == inc->time) {
+        return true;
+    }
+
+    // Going back in time or taking long steps requires starting over.
+    int32_t k = time - inc->time;
+    if (k < 0 || k > INCREMENTAL_STEP_MAX) {
+        return false;
+    }
+
+    if (k == inc->step) {
+        // Usual case of one control loop step, using additions only.
+        add_remainder(&inc->th, &inc->th_rem, inc->dth, inc->dth_rem, INCREMENTAL_TH_RADIX);
+        add_remainder(&inc->dth, &inc->dth_rem, inc->ddth, inc->ddth_rem, INCREMENTAL_TH_RADIX);
+        add_remainder(&inc->dth_tick, &inc->dth_tick_rem, inc->ddth_tick_step, inc->ddth_tick_step_rem, INCREMENTAL_TH_RADIX);
+        add_remainder(&inc->dw, &inc->dw_rem, inc->ddw, inc->ddw_rem, INCREMENTAL_W_RADIX);
+    } else {
+        // Any other step of k ticks, where th advances by
+        // k * dth_tick + k * (k - 1) / 2 * ddth_tick.
+        add_scaled_remainder(&inc->th, &inc->th_rem, k, inc->dth_tick, inc->dth_tick_rem, INCREMENTAL_TH_RADIX);
+        add_scaled_remainder(&inc->th, &inc->th_rem, k * (k - 1) / 2, inc->ddth_tick, inc->ddth_tick_rem, INCREMENTAL_TH_RADIX);
+        add_scaled_remainder(&inc->dth, &inc->dth_rem, k, inc->ddth_tick_step, inc->ddth_tick_step_rem, INCREMENTAL_TH_RADIX);
+        add_scaled_remainder(&inc->dth_tick, &inc->dth_tick_rem, k, inc->ddth_tick, inc->ddth_tick_rem, INCREMENTAL_TH_RADIX);
+        add_scaled_remainder(&inc->dw, &inc->dw_rem, k, inc->ddw_tick, inc->ddw_tick_rem, INCREMENTAL_W_RADIX);
+    }
+    inc->time = time;
+    return true;
+}
+
+#else
+
+void pbio_trajectory_reset_incremental(pbio_trajectory_t *trj) {
+}
+
+#endif // PBIO_CONFIG_TRAJECTORY_INCREMENTAL
+
 /**
  * Populates reference point with the right units and offset.
  *
@@ -913,9 +1332,101 @@ uint32_t pbio_trajectory_get_duration(const pbio_trajectory_t *trj) {
     return TO_CONTROL_TIME(trj->t3);
 }
 
+/**
+ * Finds the segment of the trajectory that contains the given time.
+ *
+ * @param [in]  trj         The trajectory instance.
+ * @param [in]  time        Time since start of the trajectory.
+ * @param [out] t_s         Time at start of the segment.
+ * @param [out] th_s        Angle at start of the segment in mdeg.
+ * @param [out] w_s         Speed at start of the segment in ddeg/s.
+ * @param [out] a           Acceleration during the segment in deg/s^2.
+ * @return                  Index of the segment: acceleration (0), constant
+ *                          speed (1), deceleration (2), or done (3).
+ */
+static uint8_t pbio_trajectory_get_segment(const pbio_trajectory_t *trj, int32_t time, int32_t *t_s, int32_t *th_s, int32_t *w_s, int32_t *a) {
+    if (time - trj->t1 < 0 || (trj->t1 == 0 && time == 0)) {
+        *t_s = 0;
+        *th_s = 0;
+        *w_s = trj->w0;
+        *a = trj->a0;
+        return 0;
+    }
+    if (time - trj->t2 < 0) {
+        *t_s = trj->t1;
+        *th_s = trj->th1;
+        *w_s = trj->w1;
+        *a = 0;
+        return 1;
+    }
+    if (time - trj->t3 < 0) {
+        *t_s = trj->t2;
+        *th_s = trj->th2;
+        *w_s = trj->w1;
+        *a = trj->a2;
+        return 2;
+    }
+    *t_s = trj->t3;
+    *th_s = trj->th3;
+    *w_s = trj->w3;
+    *a = 0;
+    return 3;
+}
+
+/**
+ * Evaluates the angle and speed of the trajectory from scratch.
+ *
+ * @param [in]  trj         The trajectory instance.
+ * @param [in]  time        Time since start of the trajectory.
+ * @param [in]  segment     Index of the segment that contains @p time.
+ * @param [out] th          Angle in mdeg.
+ * @param [out] w           Speed in ddeg/s.
+ * @param [inout] a         Acceleration in deg/s^2. Only updated if it is
+ *                          not constant in this segment.
+ */
+static void pbio_trajectory_evaluate(const pbio_trajectory_t *trj, int32_t time, uint8_t segment, int32_t *th, int32_t *w, int32_t *a) {
+    #if PBIO_CONFIG_TRAJECTORY_S_CURVE
+    if (pbio_trajectory_segment_is_curved(trj, segment)) {
+        if (segment == 0) {
+            pbio_trajectory_evaluate_s_curve(time, trj->t1, trj->w0, trj->w1, trj->th_curve[0], trj->a0, th, w, a);
+        } else {
+            pbio_trajectory_evaluate_s_curve(time - trj->t2, trj->t3 - trj->t2, trj->w1, trj->w3, trj->th_curve[1], trj->a2, th, w, a);
+            *th += trj->th2;
+        }
+        return;
+    }
+    #endif
+
+    if (segment == 0) {
+        // If we are here, then we are still in the acceleration phase.
+        // Includes conversion from microseconds to seconds, in two steps to
+        // avoid overflows and round off errors
+        *w = trj->w0 + mul_a_by_t(trj->a0, time);
+        *th = mul_w_by_t(trj->w0, time) + mul_a_by_t2(trj->a0, time);
+    } else if (segment == 1) {
+        // If we are here, then we are in the constant speed phase
+        *w = trj->w1;
+        *th = trj->th1 + mul_w_by_t(trj->w1, time - trj->t1);
+    } else if (segment == 2) {
+        // If we are here, then we are in the deceleration phase
+        *w = trj->w1 + mul_a_by_t(trj->a2, time - trj->t2);
+        *th = trj->th2 + mul_w_by_t(trj->w1, time - trj->t2) + mul_a_by_t2(trj->a2, time - trj->t2);
+    } else {
+        // If we are here, we are in the constant speed phase after the
+        // maneuver completes
+        *w = trj->w3;
+        *th = trj->th3 + mul_w_by_t(trj->w3, time - trj->t3);
+    }
+}
+
 /**
  * Gets the calculated reference speed and velocity of the trajectory at the (shifted) time.
  *
+ * If ::PBIO_CONFIG_TRAJECTORY_INCREMENTAL is enabled and this is called once
+ * per control loop, the reference is updated from the previous one using
+ * only additions. The result may differ from a full evaluation by a few mdeg
+ * due to round off in the latter.
+ *
  * @param [in]  trj         The trajectory instance.
  * @param [in]  time_ref    The duration of time after the start of the trajectory in s*10^-4.
  * @param [out] ref         An uninitialized trajectory reference point to hold the result.
@@ -931,30 +1442,28 @@ void pbio_trajectory_get_reference(pbio_trajectory_t *trj, uint32_t time_ref, pb
     int32_t w;
     int32_t a;
 
-    if (time - trj->t1 < 0 || (trj->t1 == 0 && time == 0)) {
-        // If we are here, then we are still in the acceleration phase.
-        // Includes conversion from microseconds to seconds, in two steps to
-        // avoid overflows and round off errors
-        w = trj->w0 + mul_a_by_t(trj->a0, time);
-        th = mul_w_by_t(trj->w0, time) + mul_a_by_t2(trj->a0, time);
-        a = trj->a0;
-    } else if (time - trj->t2 < 0) {
-        // If we are here, then we are in the constant speed phase
-        w = trj->w1;
-        th = trj->th1 + mul_w_by_t(trj->w1, time - trj->t1);
-        a = 0;
-    } else if (time - trj->t3 < 0) {
-        // If we are here, then we are in the deceleration phase
-        w = trj->w1 + mul_a_by_t(trj->a2, time - trj->t2);
-        th = trj->th2 + mul_w_by_t(trj->w1, time - trj->t2) + mul_a_by_t2(trj->a2, time - trj->t2);
-        a = trj->a2;
+    // Find segment and its starting point.
+    int32_t t_s;
+    int32_t th_s;
+    int32_t w_s;
+    uint8_t segment = pbio_trajectory_get_segment(trj, time, &t_s, &th_s, &w_s, &a);
+
+    #if PBIO_CONFIG_TRAJECTORY_INCREMENTAL
+    if (pbio_trajectory_incremental_step(trj, time, segment)) {
+        // Speed is rounded towards zero, like in the full evaluation.
+        const pbio_trajectory_incremental_t *inc = &trj->incremental;
+        th = th_s + inc->th;
+        w = w_s + inc->dw + (inc->dw < 0 && inc->dw_rem > 0);
     } else {
-        // If we are here, we are in the constant speed phase after the
-        // maneuver completes
-        w = trj->w3;
-        th = trj->th3 + mul_w_by_t(trj->w3, time - trj->t3);
-        a = 0;
+        // Evaluate from scratch and prepare for next step.
+        pbio_trajectory_evaluate(trj, time, segment, &th, &w, &a);
+        pbio_trajectory_incremental_start(trj, time, segment, t_s, th_s, w_s, a, th);
+    }
+    #else
+    pbio_trajectory_evaluate(trj, time, segment, &th, &w, &a);
+    #endif
 
+    if (segment == 3) {
         // To avoid any overflows of the aforementioned time comparisons,
         // rebase the trajectory if it has been running a long time.
         if (time > PBIO_TRAJECTORY_DURATION_FOREVER_MS * PBIO_TRAJECTORY_TICKS_PER_MS) {
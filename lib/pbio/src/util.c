@@ -33,6 +33,29 @@ void pbio_uuid128_reverse_copy(uint8_t *dst, const uint8_t *src) {
     }
 }
 
+/**
+ * Computes the CRC-32 of a buffer.
+ *
+ * This is the same CRC as used by zlib and Python's binascii.crc32(). It is
+ * computed bit by bit rather than with a lookup table to save flash.
+ *
+ * @param [in]  data    The data.
+ * @param [in]  size    The size of @p data in bytes.
+ * @return              The CRC-32.
+ */
+uint32_t pbio_crc32(const uint8_t *data, uint32_t size) {
+    uint32_t crc = 0xFFFFFFFF;
+
+    for (uint32_t i = 0; i < size; i++) {
+        crc ^= data[i];
+        for (int j = 0; j < 8; j++) {
+            crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+        }
+    }
+
+    return ~crc;
+}
+
 /**
  * Performs a rising-edge oneshot test.
  * @param [in]  value   The value being tested.
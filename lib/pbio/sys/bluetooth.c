@@ -16,28 +16,55 @@
 #include <pbdrv/bluetooth.h>
 #include <pbio/error.h>
 #include <pbio/event.h>
+#include <pbio/int_math.h>
 #include <pbio/protocol.h>
 #include <pbio/util.h>
 #include <pbsys/bluetooth.h>
 #include <pbsys/command.h>
 #include <pbsys/status.h>
 
-// REVISIT: this can be the negotiated MTU - 3 to allow for better throughput
-#define MAX_CHAR_SIZE 20
+#include "./bluetooth.h"
+#include "./program_load.h"
+
+// Largest characteristic value that can be sent with any negotiated MTU. The
+// size actually used is given by pbdrv_bluetooth_get_max_char_size().
+#define MAX_CHAR_SIZE (PBDRV_BLUETOOTH_MAX_MTU_SIZE - 3)
+
+// Size of the buffer for stdout data that has not been sent yet. By default,
+// this is enough for two packets, one currently being sent and one to be
+// ready as soon as the previous one completes.
+#ifndef PBSYS_CONFIG_BLUETOOTH_STDOUT_BUF_SIZE
+#define PBSYS_CONFIG_BLUETOOTH_STDOUT_BUF_SIZE (MAX_CHAR_SIZE * 2)
+#endif
+
+// Size of the buffer for stdin data that has not been read yet. By default,
+// this is enough for one packet received.
+#ifndef PBSYS_CONFIG_BLUETOOTH_STDIN_BUF_SIZE
+#define PBSYS_CONFIG_BLUETOOTH_STDIN_BUF_SIZE (MAX_CHAR_SIZE)
+#endif
 
 // REVISIT: this needs to be moved to a common place where it can be shared with USB
 static pbsys_bluetooth_stdin_event_callback_t stdin_event_callback;
 static lwrb_t stdout_ring_buf;
 static lwrb_t stdin_ring_buf;
+static lwrb_t log_ring_buf;
 
 typedef struct {
     list_t queue;
     pbdrv_bluetooth_send_context_t context;
     bool is_queued;
-    uint8_t payload[MAX_CHAR_SIZE];
 } send_msg_t;
 
 static send_msg_t stdout_msg;
+static send_msg_t log_msg;
+static send_msg_t module_hashes_msg;
+
+// Only one message is sent at a time, so messages that can be large are
+// filled in just before sending, all in this one buffer.
+static uint8_t send_buf[MAX_CHAR_SIZE];
+
+// Index of the first module whose hash is sent in module_hashes_msg.
+static uint16_t module_hashes_first;
 LIST(send_queue);
 static bool send_busy;
 
@@ -47,14 +74,17 @@ PROCESS(pbsys_bluetooth_process, "Bluetooth");
 
 /** Initializes Bluetooth. */
 void pbsys_bluetooth_init(void) {
-    // enough for two packets, one currently being sent and one to be ready
-    // as soon as the previous one completes + 1 byte for ring buf pointer
-    static uint8_t stdout_buf[MAX_CHAR_SIZE * 2 + 1];
-    // enough for one packet received + 1 byte for ring buf pointer
-    static uint8_t stdin_buf[PBDRV_BLUETOOTH_MAX_MTU_SIZE - 3 + 1];
+    // + 1 byte for ring buf pointer
+    static uint8_t stdout_buf[PBSYS_CONFIG_BLUETOOTH_STDOUT_BUF_SIZE + 1];
+    // + 1 byte for ring buf pointer
+    static uint8_t stdin_buf[PBSYS_CONFIG_BLUETOOTH_STDIN_BUF_SIZE + 1];
+    // enough for a few log rows, so the control loop does not have to wait
+    // for each packet to be sent + 1 byte for ring buf pointer
+    static uint8_t log_buf[PBSYS_BLUETOOTH_LOG_BUF_SIZE + 1];
 
     lwrb_init(&stdout_ring_buf, stdout_buf, PBIO_ARRAY_SIZE(stdout_buf));
     lwrb_init(&stdin_ring_buf, stdin_buf, PBIO_ARRAY_SIZE(stdin_buf));
+    lwrb_init(&log_ring_buf, log_buf, PBIO_ARRAY_SIZE(log_buf));
     process_start(&pbsys_bluetooth_process);
 }
 
@@ -174,7 +204,93 @@ pbio_error_t pbsys_bluetooth_tx(const uint8_t *data, uint32_t *size) {
     }
 
     // poke the process to start tx soon-ish. This way, we can accumulate up to
-    // MAX_CHAR_SIZE bytes before actually transmitting
+    // one full packet before actually transmitting
+    process_poll(&pbsys_bluetooth_process);
+
+    return PBIO_SUCCESS;
+}
+
+/**
+ * Queues log data to be transmitted via Bluetooth.
+ *
+ * Unlike ::pbsys_bluetooth_tx, either all of @p data is queued or none of it,
+ * so that log rows are never split up by a full buffer. A @p size of 0 can
+ * be used to check that log data can be sent at all.
+ *
+ * @param data  [in]        The data to be sent.
+ * @param size  [in]        The size of @p data in bytes.
+ * @return                  ::PBIO_SUCCESS if @p data was queued, ::PBIO_ERROR_AGAIN
+ *                          if @p data could not be queued at this time (e.g. buffer
+ *                          is full), ::PBIO_ERROR_INVALID_ARG if @p data would
+ *                          never fit in the buffer, ::PBIO_ERROR_INVALID_OP if there is not an
+ *                          active Bluetooth connection or ::PBIO_ERROR_NOT_SUPPORTED
+ *                          if this platform does not support Bluetooth.
+ */
+pbio_error_t pbsys_bluetooth_tx_log(const uint8_t *data, uint32_t size) {
+    // make sure we have a Bluetooth connection
+    if (!pbdrv_bluetooth_is_connected(PBDRV_BLUETOOTH_CONNECTION_PYBRICKS)) {
+        return PBIO_ERROR_INVALID_OP;
+    }
+
+    if (size == 0) {
+        return PBIO_SUCCESS;
+    }
+
+    if (size > PBSYS_BLUETOOTH_LOG_BUF_SIZE) {
+        return PBIO_ERROR_INVALID_ARG;
+    }
+
+    if (lwrb_get_free(&log_ring_buf) < size) {
+        return PBIO_ERROR_AGAIN;
+    }
+
+    // only allow one log message in the queue at a time
+    if (!log_msg.is_queued) {
+        log_msg.context.connection = PBDRV_BLUETOOTH_CONNECTION_PYBRICKS;
+        list_add(send_queue, &log_msg);
+        log_msg.is_queued = true;
+    }
+
+    lwrb_write(&log_ring_buf, data, size);
+    process_poll(&pbsys_bluetooth_process);
+
+    return PBIO_SUCCESS;
+}
+
+/**
+ * Queues the CRC-32 of the user program modules to be sent via Bluetooth, in
+ * reply to ::PBIO_PYBRICKS_COMMAND_READ_USER_PROGRAM_MODULES.
+ *
+ * As many values are sent as fit in one event.
+ *
+ * @param first [in]        Index of the first module.
+ * @return                  ::PBIO_SUCCESS if the event was queued,
+ *                          ::PBIO_ERROR_BUSY if the previous reply has not
+ *                          been sent yet or ::PBIO_ERROR_INVALID_OP if there
+ *                          is not an active Bluetooth connection.
+ */
+pbio_error_t pbsys_bluetooth_tx_module_hashes(uint16_t first) {
+    if (!pbdrv_bluetooth_is_connected(PBDRV_BLUETOOTH_CONNECTION_PYBRICKS)) {
+        return PBIO_ERROR_INVALID_OP;
+    }
+
+    if (module_hashes_msg.is_queued) {
+        return PBIO_ERROR_BUSY;
+    }
+
+    // The hashes are filled in when the message is sent, but check that they
+    // can be read before queueing it.
+    uint32_t size = 0;
+    uint32_t num_modules;
+    pbio_error_t err = pbsys_program_load_get_module_hashes(first, NULL, &size, &num_modules);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+
+    module_hashes_first = first;
+    module_hashes_msg.context.connection = PBDRV_BLUETOOTH_CONNECTION_PYBRICKS;
+    list_add(send_queue, &module_hashes_msg);
+    module_hashes_msg.is_queued = true;
     process_poll(&pbsys_bluetooth_process);
 
     return PBIO_SUCCESS;
@@ -218,7 +334,8 @@ static pbio_pybricks_error_t handle_receive(pbdrv_bluetooth_connection_t connect
 static void send_done(void) {
     send_msg_t *msg = list_pop(send_queue);
 
-    if (msg == &stdout_msg && lwrb_get_full(&stdout_ring_buf)) {
+    if ((msg == &stdout_msg && lwrb_get_full(&stdout_ring_buf))
+        || (msg == &log_msg && lwrb_get_full(&log_ring_buf))) {
         // If there is more buffered data to send, put the message back in the queue
         list_add(send_queue, msg);
     } else {
@@ -241,12 +358,14 @@ static void reset_all(void) {
 
     lwrb_reset(&stdin_ring_buf);
     lwrb_reset(&stdout_ring_buf);
+    lwrb_reset(&log_ring_buf);
 }
 
 static PT_THREAD(pbsys_bluetooth_monitor_status(struct pt *pt)) {
     static struct etimer timer;
     static uint32_t old_status_flags, new_status_flags;
     static send_msg_t msg;
+    static uint8_t payload[5];
 
     PT_BEGIN(pt);
 
@@ -265,7 +384,8 @@ static PT_THREAD(pbsys_bluetooth_monitor_status(struct pt *pt)) {
         etimer_restart(&timer);
 
         // send the message
-        msg.context.size = pbio_pybricks_event_status_report(&msg.payload[0], new_status_flags);
+        msg.context.data = payload;
+        msg.context.size = pbio_pybricks_event_status_report(payload, new_status_flags);
         msg.context.connection = PBDRV_BLUETOOTH_CONNECTION_PYBRICKS;
         list_add(send_queue, &msg);
         msg.is_queued = true;
@@ -335,14 +455,38 @@ PROCESS_THREAD(pbsys_bluetooth_process, ev, data) {
                 if (msg) {
                     msg->context.done = send_done;
 
+                    // Fill up to the negotiated MTU, leaving room for the event type.
+                    uint32_t max_size = pbio_int_math_min(pbdrv_bluetooth_get_max_char_size(), MAX_CHAR_SIZE) - 1;
+
                     if (msg == &stdout_msg) {
-                        msg->payload[0] = PBIO_PYBRICKS_EVENT_WRITE_STDOUT;
-                        // REVISIT: use negotiated MTU instead of minimum safe size
-                        msg->context.size = lwrb_read(&stdout_ring_buf, &msg->payload[1], PBIO_ARRAY_SIZE(msg->payload) - 1) + 1;
+                        send_buf[0] = PBIO_PYBRICKS_EVENT_WRITE_STDOUT;
+                        msg->context.size = lwrb_read(&stdout_ring_buf, &send_buf[1], max_size) + 1;
+                        msg->context.data = send_buf;
+                        assert(msg->context.size > 1);
+                    } else if (msg == &log_msg) {
+                        send_buf[0] = PBIO_PYBRICKS_EVENT_WRITE_LOG;
+                        msg->context.size = lwrb_read(&log_ring_buf, &send_buf[1], max_size) + 1;
+                        msg->context.data = send_buf;
                         assert(msg->context.size > 1);
+                    } else if (msg == &module_hashes_msg) {
+                        // Event type, index of the first module and number of
+                        // modules come first, followed by as many hashes as fit.
+                        // This was checked when queued, so it only fails if
+                        // the program changed since. Then send no modules.
+                        uint32_t size = max_size + 1 - 5;
+                        uint32_t num_modules;
+                        if (pbsys_program_load_get_module_hashes(module_hashes_first, &send_buf[5], &size, &num_modules) != PBIO_SUCCESS) {
+                            size = 0;
+                            num_modules = 0;
+                        }
+                        send_buf[0] = PBIO_PYBRICKS_EVENT_USER_PROGRAM_MODULES;
+                        pbio_set_uint16_le(&send_buf[1], module_hashes_first);
+                        pbio_set_uint16_le(&send_buf[3], num_modules);
+                        msg->context.size = size + 5;
+                        msg->context.data = send_buf;
                     }
+                    // Other messages were filled in completely when queued.
 
-                    msg->context.data = &msg->payload[0];
                     send_busy = true;
                     pbdrv_bluetooth_send(&msg->context);
                 }
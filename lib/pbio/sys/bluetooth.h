@@ -6,7 +6,10 @@
 
 #include <stdint.h>
 
+#include <pbio/error.h>
+
 uint32_t pbsys_bluetooth_rx_get_free(void);
 void pbsys_bluetooth_rx_write(const uint8_t *data, uint32_t size);
+pbio_error_t pbsys_bluetooth_tx_module_hashes(uint16_t first);
 
 #endif // _PBSYS_SYS_BLUETOOTH_H_
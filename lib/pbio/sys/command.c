@@ -36,6 +36,34 @@ pbio_pybricks_error_t pbsys_command(const uint8_t *data, uint32_t size) {
         case PBIO_PYBRICKS_COMMAND_WRITE_USER_RAM:
             return pbio_pybricks_error_from_pbio_error(pbsys_program_load_set_program_data(
                 pbio_get_uint32_le(&data[1]), &data[5], size - 5));
+        case PBIO_PYBRICKS_COMMAND_WRITE_USER_RAM_COMPRESSED:
+            // Command byte and 32-bit offset, followed by the data.
+            if (size < 5) {
+                return PBIO_PYBRICKS_ERROR_VALUE_NOT_ALLOWED;
+            }
+            return pbio_pybricks_error_from_pbio_error(pbsys_program_load_set_program_data_compressed(
+                pbio_get_uint32_le(&data[1]), &data[5], size - 5));
+        case PBIO_PYBRICKS_COMMAND_WRITE_USER_PROGRAM_META_CRC:
+            // Command byte, 32-bit size and 32-bit CRC.
+            if (size < 9) {
+                return PBIO_PYBRICKS_ERROR_VALUE_NOT_ALLOWED;
+            }
+            return pbio_pybricks_error_from_pbio_error(pbsys_program_load_set_program_size_checked(
+                pbio_get_uint32_le(&data[1]), pbio_get_uint32_le(&data[5])));
+        case PBIO_PYBRICKS_COMMAND_READ_USER_PROGRAM_MODULES:
+            #if PBSYS_CONFIG_BLUETOOTH
+            // Command byte and 16-bit index of the first module.
+            if (size < 3) {
+                return PBIO_PYBRICKS_ERROR_VALUE_NOT_ALLOWED;
+            }
+            return pbio_pybricks_error_from_pbio_error(pbsys_bluetooth_tx_module_hashes(
+                pbio_get_uint16_le(&data[1])));
+            #else
+            return PBIO_PYBRICKS_ERROR_INVALID_COMMAND;
+            #endif
+        case PBIO_PYBRICKS_COMMAND_KEEP_USER_PROGRAM_MODULES:
+            return pbio_pybricks_error_from_pbio_error(pbsys_program_load_keep_modules(
+                &data[1], size - 1));
         case PBIO_PYBRICKS_COMMAND_REBOOT_TO_UPDATE_MODE:
             pbdrv_reset(PBDRV_RESET_ACTION_RESET_IN_UPDATE_MODE);
             return PBIO_PYBRICKS_ERROR_OK;
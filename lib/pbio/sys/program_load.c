@@ -12,10 +12,14 @@
 #include <contiki.h>
 
 #include <pbdrv/block_device.h>
+#include <pbio/imu.h>
+#include <pbio/lz.h>
 #include <pbio/main.h>
 #include <pbio/protocol.h>
+#include <pbio/util.h>
 #include <pbsys/main.h>
 #include <pbsys/program_load.h>
+#include <pbsys/program_modules.h>
 #include <pbsys/status.h>
 
 #include "core.h"
@@ -169,6 +173,114 @@ pbio_error_t pbsys_program_load_set_program_data(uint32_t offset, const void *da
     return PBIO_SUCCESS;
 }
 
+// Compressed program data is decoded straight into user RAM as it arrives.
+static pbio_lz_decoder_t decoder;
+static uint32_t decoder_input_size;
+
+/**
+ * Writes the next chunk of compressed program data to user RAM.
+ *
+ * @param [in]  offset      The offset in bytes in the compressed stream. The
+ *                          value 0 starts a new stream.
+ * @param [in]  data        The compressed data.
+ * @param [in]  size        The size of @p data.
+ *
+ * @returns                 ::PBIO_ERROR_INVALID_ARG if @p offset is not where
+ *                          the previous chunk ended, or if the stream is
+ *                          invalid or does not fit in user RAM.
+ *                          ::PBIO_ERROR_BUSY if the user program is running.
+ *                          Otherwise ::PBIO_SUCCESS.
+ */
+pbio_error_t pbsys_program_load_set_program_data_compressed(uint32_t offset, const void *data, uint32_t size) {
+    if (pbsys_status_test(PBIO_PYBRICKS_STATUS_USER_PROGRAM_RUNNING)) {
+        return PBIO_ERROR_BUSY;
+    }
+
+    if (offset == 0) {
+        // The previous program is overwritten, so it can't be started anymore.
+        pbsys_program_load_set_program_size(0);
+        pbio_lz_decoder_init(&decoder, map->program_data, sizeof(map->program_data));
+        decoder_input_size = 0;
+    }
+
+    // Chunks must arrive in order, without gaps or repeats.
+    if (offset != decoder_input_size || !decoder.out) {
+        return PBIO_ERROR_INVALID_ARG;
+    }
+
+    pbio_error_t err = pbio_lz_decoder_write(&decoder, data, size);
+    if (err != PBIO_SUCCESS) {
+        // Nothing more can be decoded until a new stream is started.
+        decoder.out = NULL;
+        return err;
+    }
+    decoder_input_size += size;
+
+    return PBIO_SUCCESS;
+}
+
+/**
+ * Writes the user program metadata if the program matches the given CRC.
+ *
+ * @param [in]  size    The size of the user program in bytes.
+ * @param [in]  crc     The CRC-32 of the user program.
+ *
+ * @returns             ::PBIO_ERROR_BUSY if the user program is running.
+ *                      ::PBIO_ERROR_INVALID_ARG if the size is too big or the
+ *                      CRC does not match. The program size is then reset to
+ *                      0, so the program can't be started.
+ *                      Otherwise, ::PBIO_SUCCESS.
+ */
+pbio_error_t pbsys_program_load_set_program_size_checked(uint32_t size, uint32_t crc) {
+    if (pbsys_status_test(PBIO_PYBRICKS_STATUS_USER_PROGRAM_RUNNING)) {
+        return PBIO_ERROR_BUSY;
+    }
+
+    if (size > PBSYS_PROGRAM_LOAD_MAX_PROGRAM_SIZE || pbio_crc32(map->program_data, size) != crc) {
+        pbsys_program_load_set_program_size(0);
+        return PBIO_ERROR_INVALID_ARG;
+    }
+
+    return pbsys_program_load_set_program_size(size);
+}
+
+/**
+ * Gets the CRC-32 of the modules of the user program.
+ *
+ * @param [in]    first         Index of the first module.
+ * @param [out]   buf           The CRC-32 values, each as a 32-bit little-endian integer.
+ *                              May be NULL if @p size is 0.
+ * @param [inout] size          Size of @p buf. On return, how many bytes were written.
+ * @param [out]   num_modules   Total number of modules in the user program.
+ * @returns                     ::PBIO_SUCCESS.
+ */
+pbio_error_t pbsys_program_load_get_module_hashes(uint32_t first, uint8_t *buf, uint32_t *size, uint32_t *num_modules) {
+    *num_modules = pbsys_program_modules_get_hashes(map->program_data, map->header.program_size, first, buf, size);
+    return PBIO_SUCCESS;
+}
+
+/**
+ * Keeps only the selected modules of the user program, so that only new or
+ * changed modules have to be downloaded after them.
+ *
+ * The program size is updated to the size of the kept modules. The remaining
+ * modules can then be written after them, followed by a new program size.
+ *
+ * @param [in]  keep        Bit map of modules to keep. Bit i % 8 of byte i / 8
+ *                          is set to keep module i.
+ * @param [in]  size        Size of @p keep.
+ * @returns                 ::PBIO_ERROR_BUSY if the user program is running.
+ *                          Otherwise ::PBIO_SUCCESS.
+ */
+pbio_error_t pbsys_program_load_keep_modules(const uint8_t *keep, uint32_t size) {
+    if (pbsys_status_test(PBIO_PYBRICKS_STATUS_USER_PROGRAM_RUNNING)) {
+        return PBIO_ERROR_BUSY;
+    }
+
+    return pbsys_program_load_set_program_size(
+        pbsys_program_modules_keep(map->program_data, map->header.program_size, keep, size));
+}
+
 /**
  * Requests to start the user program.
  *
@@ -243,19 +355,41 @@ PROCESS_THREAD(pbsys_program_load_process, ev, data) {
 
     // Read the available data into RAM.
     PROCESS_PT_SPAWN(&pt, pbdrv_block_device_read(&pt, 0, (uint8_t *)map, map->header.write_size, &err));
-    if (err != PBIO_SUCCESS) {
+
+    // Discard data that was not stored with the current layout, such as after
+    // a firmware update. The user data comes first, so it is always kept.
+    if (err != PBIO_SUCCESS || map->header.layout_version != PBSYS_PROGRAM_LOAD_LAYOUT_VERSION) {
+        map->header.layout_version = PBSYS_PROGRAM_LOAD_LAYOUT_VERSION;
+        #if PBIO_CONFIG_IMU
+        memset(&map->header.imu_settings, 0, sizeof(map->header.imu_settings));
+        #endif
         map->header.program_size = 0;
     }
 
     // Reset write size, so we don't write data if nothing changed.
     map->header.write_size = 0;
 
+    #if PBIO_CONFIG_IMU
+    // Restore the IMU calibration. This fails harmlessly if nothing was saved.
+    pbio_imu_apply_persistent_settings(&map->header.imu_settings);
+    #endif
+
     // Initialization done.
     pbsys_init_busy_down();
 
     // Wait for signal on signal.
     PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_CONTINUE);
 
+    #if PBIO_CONFIG_IMU
+    // Save the IMU calibration if it changed.
+    pbio_imu_persistent_settings_t imu_settings;
+    pbio_imu_get_persistent_settings(&imu_settings);
+    if (pbio_imu_persistent_settings_changed(&map->header.imu_settings, &imu_settings)) {
+        map->header.imu_settings = imu_settings;
+        update_write_size();
+    }
+    #endif
+
     // Write data to storage if it was updated.
     if (map->header.write_size) {
 
@@ -17,6 +17,10 @@ void pbsys_program_load_deinit(void);
 pbio_error_t pbsys_program_load_wait_command(pbsys_main_program_t *program);
 pbio_error_t pbsys_program_load_set_program_size(uint32_t size);
 pbio_error_t pbsys_program_load_set_program_data(uint32_t offset, const void *data, uint32_t size);
+pbio_error_t pbsys_program_load_set_program_data_compressed(uint32_t offset, const void *data, uint32_t size);
+pbio_error_t pbsys_program_load_set_program_size_checked(uint32_t size, uint32_t crc);
+pbio_error_t pbsys_program_load_get_module_hashes(uint32_t first, uint8_t *buf, uint32_t *size, uint32_t *num_modules);
+pbio_error_t pbsys_program_load_keep_modules(const uint8_t *keep, uint32_t size);
 pbio_error_t pbsys_program_load_start_user_program(void);
 pbio_error_t pbsys_program_load_start_repl(void);
 
@@ -34,6 +38,18 @@ static inline pbio_error_t pbsys_program_load_set_program_size(uint32_t size) {
 static inline pbio_error_t pbsys_program_load_set_program_data(uint32_t offset, const void *data, uint32_t size) {
     return PBIO_ERROR_NOT_SUPPORTED;
 }
+static inline pbio_error_t pbsys_program_load_set_program_data_compressed(uint32_t offset, const void *data, uint32_t size) {
+    return PBIO_ERROR_NOT_SUPPORTED;
+}
+static inline pbio_error_t pbsys_program_load_set_program_size_checked(uint32_t size, uint32_t crc) {
+    return PBIO_ERROR_NOT_SUPPORTED;
+}
+static inline pbio_error_t pbsys_program_load_get_module_hashes(uint32_t first, uint8_t *buf, uint32_t *size, uint32_t *num_modules) {
+    return PBIO_ERROR_NOT_SUPPORTED;
+}
+static inline pbio_error_t pbsys_program_load_keep_modules(const uint8_t *keep, uint32_t size) {
+    return PBIO_ERROR_NOT_SUPPORTED;
+}
 static inline pbio_error_t pbsys_program_load_start_user_program(void) {
     return PBIO_ERROR_NOT_SUPPORTED;
 }
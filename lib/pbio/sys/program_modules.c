@@ -0,0 +1,243 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2023 The Pybricks Authors
+
+// Finds, checks and rearranges the modules of a user program.
+
+#include <stdint.h>
+#include <string.h>
+
+#include <pbio/error.h>
+#include <pbio/util.h>
+#include <pbsys/program_modules.h>
+
+/**
+ * Gets the module that starts at the given offset in a user program.
+ *
+ * @param [in]  program         The user program.
+ * @param [in]  program_size    Size of @p program.
+ * @param [in]  offset          Offset of the module in @p program.
+ * @param [out] module          The module.
+ * @return                      ::PBIO_SUCCESS on success.
+ *                              ::PBIO_ERROR_INVALID_ARG if there is no module
+ *                              at @p offset or it does not fit in the program.
+ */
+pbio_error_t pbsys_program_modules_get(const uint8_t *program, uint32_t program_size, uint32_t offset, pbsys_program_module_t *module) {
+
+    // Need at least the size and an empty name.
+    if (offset >= program_size || program_size - offset < sizeof(uint32_t) + 1) {
+        return PBIO_ERROR_INVALID_ARG;
+    }
+
+    const uint8_t *start = program + offset;
+    uint32_t available = program_size - offset;
+
+    const uint8_t *name = start + sizeof(uint32_t);
+    const uint8_t *name_end = memchr(name, '\0', available - sizeof(uint32_t));
+    if (!name_end) {
+        return PBIO_ERROR_INVALID_ARG;
+    }
+
+    uint32_t header_size = name_end + 1 - start;
+    uint32_t data_size = pbio_get_uint32_le(start);
+    if (data_size > available - header_size) {
+        return PBIO_ERROR_INVALID_ARG;
+    }
+
+    module->name = (const char *)name;
+    module->data = start + header_size;
+    module->data_size = data_size;
+    module->size = header_size + data_size;
+    return PBIO_SUCCESS;
+}
+
+/**
+ * Gets the CRC-32 of the modules of a user program.
+ *
+ * The CRC-32 covers the whole module, including its size and name, so a
+ * module is only the same if it has the same name and data.
+ *
+ * @param [in]    program       The user program.
+ * @param [in]    program_size  Size of @p program.
+ * @param [in]    first         Index of the first module to get the CRC-32 of.
+ * @param [out]   buf           The CRC-32 values, each as a 32-bit little-endian integer.
+ * @param [inout] size          Size of @p buf. On return, how many bytes were written.
+ * @return                      Total number of modules in the program.
+ */
+uint32_t pbsys_program_modules_get_hashes(const uint8_t *program, uint32_t program_size, uint32_t first, uint8_t *buf, uint32_t *size) {
+
+    uint32_t written = 0;
+    uint32_t index = 0;
+    pbsys_program_module_t module;
+
+    for (uint32_t offset = 0; pbsys_program_modules_get(program, program_size, offset, &module) == PBIO_SUCCESS; offset += module.size) {
+        if (index >= first && written + sizeof(uint32_t) <= *size) {
+            pbio_set_uint32_le(&buf[written], pbio_crc32(program + offset, module.size));
+            written += sizeof(uint32_t);
+        }
+        index++;
+    }
+
+    *size = written;
+    return index;
+}
+
+/**
+ * Keeps only the selected modules of a user program.
+ *
+ * The kept modules are moved to the start of the program in their original
+ * order, so that new modules can be added after them.
+ *
+ * @param [in]  program         The user program.
+ * @param [in]  program_size    Size of @p program.
+ * @param [in]  keep            Bit map of modules to keep. Bit i % 8 of byte
+ *                              i / 8 is set to keep module i.
+ * @param [in]  keep_size       Size of @p keep. Modules past the end of the
+ *                              bit map are not kept.
+ * @return                      Size of the program with only the kept modules.
+ */
+uint32_t pbsys_program_modules_keep(uint8_t *program, uint32_t program_size, const uint8_t *keep, uint32_t keep_size) {
+
+    uint32_t new_size = 0;
+    uint32_t index = 0;
+    pbsys_program_module_t module;
+
+    for (uint32_t offset = 0; pbsys_program_modules_get(program, program_size, offset, &module) == PBIO_SUCCESS; offset += module.size) {
+        if (index / 8 < keep_size && keep[index / 8] & (1 << (index % 8))) {
+            // The module only ever moves down, so modules that are yet to
+            // be visited are not overwritten.
+            memmove(program + new_size, program + offset, module.size);
+            new_size += module.size;
+        }
+        index++;
+    }
+
+    return new_size;
+}
+
+/**
+ * Counts the modules of a user program.
+ *
+ * @param [in]  program         The user program.
+ * @param [in]  program_size    Size of @p program.
+ * @return                      Number of modules.
+ */
+uint32_t pbsys_program_modules_count(const uint8_t *program, uint32_t program_size) {
+    uint32_t count = 0;
+    pbsys_program_module_t module;
+
+    for (uint32_t offset = 0; pbsys_program_modules_get(program, program_size, offset, &module) == PBIO_SUCCESS; offset += module.size) {
+        count++;
+    }
+
+    return count;
+}
+
+/**
+ * Hashes a module name (32-bit FNV-1a).
+ *
+ * @param [in]  name    Zero-terminated module name.
+ * @return              The hash.
+ */
+static uint32_t pbsys_program_modules_hash(const char *name) {
+    uint32_t hash = 2166136261;
+    while (*name) {
+        hash = (hash ^ (uint8_t)*name++) * 16777619;
+    }
+    return hash;
+}
+
+/**
+ * Builds an index of the modules of a user program, so modules can be found
+ * by name without comparing against every module.
+ *
+ * The index refers to the program, so it must be built again if the program
+ * changes.
+ *
+ * @param [out] index           The index.
+ * @param [in]  program         The user program.
+ * @param [in]  program_size    Size of @p program.
+ * @param [in]  entries         Storage for one entry per module, or NULL to
+ *                              find modules by searching the whole program
+ *                              instead.
+ * @param [in]  num_modules     Number of modules, as given by
+ *                              ::pbsys_program_modules_count.
+ */
+void pbsys_program_modules_index_init(pbsys_program_modules_index_t *index, const uint8_t *program, uint32_t program_size,
+    pbsys_program_modules_index_entry_t *entries, uint32_t num_modules) {
+
+    index->program = program;
+    index->program_size = program_size;
+    index->entries = NULL;
+    index->num_entries = 0;
+
+    if (!entries) {
+        return;
+    }
+
+    // Insertion sort by hash. Modules with the same hash stay in program
+    // order, so the first module wins if a name occurs twice, like before.
+    uint32_t n = 0;
+    pbsys_program_module_t module;
+    for (uint32_t offset = 0; pbsys_program_modules_get(program, program_size, offset, &module) == PBIO_SUCCESS; offset += module.size) {
+        // Don't write past the entries if the given count is wrong.
+        if (n == num_modules) {
+            return;
+        }
+        uint32_t hash = pbsys_program_modules_hash(module.name);
+        uint32_t i = n++;
+        while (i > 0 && entries[i - 1].hash > hash) {
+            entries[i] = entries[i - 1];
+            i--;
+        }
+        entries[i].hash = hash;
+        entries[i].offset = offset;
+    }
+
+    index->entries = entries;
+    index->num_entries = n;
+}
+
+/**
+ * Finds a module of a user program by name.
+ *
+ * @param [in]  index   Index of the user program.
+ * @param [in]  name    Zero-terminated name of the module.
+ * @param [out] module  The module.
+ * @return              ::PBIO_SUCCESS if the module was found, otherwise
+ *                      ::PBIO_ERROR_NO_DEV.
+ */
+pbio_error_t pbsys_program_modules_find(const pbsys_program_modules_index_t *index, const char *name, pbsys_program_module_t *module) {
+
+    // Without an index, go through all modules.
+    if (!index->entries) {
+        for (uint32_t offset = 0; pbsys_program_modules_get(index->program, index->program_size, offset, module) == PBIO_SUCCESS; offset += module->size) {
+            if (strcmp(module->name, name) == 0) {
+                return PBIO_SUCCESS;
+            }
+        }
+        return PBIO_ERROR_NO_DEV;
+    }
+
+    // Find the first entry with this hash.
+    uint32_t hash = pbsys_program_modules_hash(name);
+    uint32_t low = 0;
+    uint32_t high = index->num_entries;
+    while (low < high) {
+        uint32_t mid = low + (high - low) / 2;
+        if (index->entries[mid].hash < hash) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+
+    // Different names rarely have the same hash, but check the name anyway.
+    for (uint32_t i = low; i < index->num_entries && index->entries[i].hash == hash; i++) {
+        pbsys_program_modules_get(index->program, index->program_size, index->entries[i].offset, module);
+        if (strcmp(module->name, name) == 0) {
+            return PBIO_SUCCESS;
+        }
+    }
+
+    return PBIO_ERROR_NO_DEV;
+}
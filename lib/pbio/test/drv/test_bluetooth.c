@@ -13,6 +13,7 @@
 #include <tinytest_macros.h>
 #include <tinytest.h>
 
+#include <pbio/protocol.h>
 #include <test-pbio.h>
 
 #include "../../drv/bluetooth/bluetooth_btstack_run_loop_contiki.h"
@@ -187,6 +188,7 @@ void pbio_test_bluetooth_enable_pybricks_service_notifications(void) {
 }
 
 static uint32_t pybricks_service_notification_count;
+static uint32_t pybricks_service_stdout_size;
 
 /**
  * This count increases each time the hub sends a notification on the Pybricks
@@ -196,6 +198,33 @@ uint32_t pbio_test_bluetooth_get_pybricks_service_notification_count(void) {
     return pybricks_service_notification_count;
 }
 
+/**
+ * This count increases by the number of stdout bytes each time the hub sends
+ * a stdout event notification on the Pybricks service command characteristic.
+ */
+uint32_t pbio_test_bluetooth_get_pybricks_service_stdout_size(void) {
+    return pybricks_service_stdout_size;
+}
+
+/**
+ * This simulates a remote device requesting a larger MTU.
+ */
+void pbio_test_bluetooth_exchange_mtu(uint16_t mtu) {
+    const uint16_t length = 3;
+    uint8_t buffer[length + 9];
+
+    buffer[0] = 0x02; // packet type = ACL Data
+    little_endian_store_16(buffer, 1, 0x0400); // connection handle
+    buffer[2] |= 0x02 << 4; // PB flag
+    little_endian_store_16(buffer, 3, length + 4); // total data length
+    little_endian_store_16(buffer, 5, length); // L2CAP length
+    little_endian_store_16(buffer, 7, 4); // Attribute protocol
+    buffer[9] = ATT_EXCHANGE_MTU_REQUEST;
+    little_endian_store_16(buffer, 10, mtu); // client Rx MTU
+
+    queue_packet(buffer, length + 9);
+}
+
 void pbio_test_bluetooth_send_pybricks_command(const uint8_t *data, uint32_t size) {
     // Pybricks command/event characteristic value (comes from header file generated by .gatt)
     const uint16_t attribute_handle = 0x000d;
@@ -428,12 +457,11 @@ static void handle_send(const uint8_t *buffer, uint16_t length) {
         break;
 
         case 0x02: { // ACL
-            uint16_t connection_handle = little_endian_read_16(buffer, 1);
+            uint16_t connection_handle = little_endian_read_16(buffer, 1) & 0x0fff;
             uint16_t total_length = little_endian_read_16(buffer, 3);
             uint16_t length = little_endian_read_16(buffer, 5);
             uint16_t cid = little_endian_read_16(buffer, 7);
 
-            (void)connection_handle;
             (void)total_length;
             (void)length;
 
@@ -452,6 +480,11 @@ static void handle_send(const uint8_t *buffer, uint16_t length) {
                         }
                         break;
 
+                        case 0x03: { // ATT_EXCHANGE_MTU_RESPONSE
+                            log_debug("ATT_EXCHANGE_MTU_RESPONSE: server Rx MTU: %u", little_endian_read_16(buffer, 10));
+                        }
+                        break;
+
                         case 0x13: { // ATT_WRITE_RESPONSE
                             // REVISIT: maybe set a flag here?
                         }
@@ -466,6 +499,9 @@ static void handle_send(const uint8_t *buffer, uint16_t length) {
                             switch (attr_handle) {
                                 case 0x000d:
                                     pybricks_service_notification_count++;
+                                    if (value[0] == PBIO_PYBRICKS_EVENT_WRITE_STDOUT) {
+                                        pybricks_service_stdout_size += size - 1;
+                                    }
                                     break;
                                 case 0x0013:
                                     uart_service_notification_count++;
@@ -488,6 +524,20 @@ static void handle_send(const uint8_t *buffer, uint16_t length) {
                     break;
             }
 
+            // Let btstack know the packet was sent over the air so that the
+            // controller buffer can be used again.
+            {
+                uint8_t buffer[8];
+
+                buffer[0] = 0x04; // packet type = Event
+                buffer[1] = 0x13; // number of completed packets event
+                buffer[2] = sizeof(buffer) - 3; // length
+                buffer[3] = 1; // number of handles
+                little_endian_store_16(buffer, 4, connection_handle);
+                little_endian_store_16(buffer, 6, 1); // number of completed packets
+
+                queue_packet(buffer, sizeof(buffer));
+            }
         }
         break;
 
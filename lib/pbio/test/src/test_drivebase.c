@@ -2,6 +2,7 @@
 // Copyright (c) 2020-2022 The Pybricks Authors
 
 #include <errno.h>
+#include <math.h>
 #include <signal.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -29,6 +30,7 @@
 #include "../src/processes.h"
 #include "../drv/core.h"
 #include "../drv/clock/clock_test.h"
+#include "../drv/imu/imu_test.h"
 #include "../drv/motor_driver/motor_driver_virtual_simulation.h"
 
 static PT_THREAD(test_drivebase_basics(struct pt *pt)) {
@@ -82,11 +84,19 @@ static PT_THREAD(test_drivebase_basics(struct pt *pt)) {
     tt_uint_op(pbio_servo_setup(srv_right, id, PBIO_DIRECTION_CLOCKWISE, 1000, true, 0), ==, PBIO_SUCCESS);
 
     // Set up the drivebase.
+    tt_uint_op(pbio_control_settings_set_trajectory_profile(&srv_left->control.settings, PBIO_TRAJECTORY_PROFILE_S_CURVE), ==, PBIO_SUCCESS);
     tt_uint_op(pbio_drivebase_get_drivebase(&db, srv_left, srv_right, 56000, 112000), ==, PBIO_SUCCESS);
     tt_uint_op(pbio_drivebase_get_state_user(db, &drive_distance, &drive_speed, &turn_angle_start, &turn_rate), ==, PBIO_SUCCESS);
     tt_uint_op(pbio_drivebase_is_stalled(db, &stalled, &stall_duration), ==, PBIO_SUCCESS);
     tt_want(!stalled);
 
+    // The profile is a drivebase setting, not taken from the motors, and
+    // applies to both distance and heading.
+    tt_want_int_op(pbio_drivebase_get_drive_profile(db), ==, PBIO_TRAJECTORY_PROFILE_TRAPEZOID);
+    tt_uint_op(pbio_drivebase_set_drive_profile(db, PBIO_TRAJECTORY_PROFILE_S_CURVE), ==, PBIO_SUCCESS);
+    tt_want_int_op(pbio_control_settings_get_trajectory_profile(&db->control_heading.settings), ==, PBIO_TRAJECTORY_PROFILE_S_CURVE);
+    tt_uint_op(pbio_drivebase_set_drive_profile(db, PBIO_TRAJECTORY_PROFILE_TRAPEZOID), ==, PBIO_SUCCESS);
+
     // Get current settings and change them.
     tt_uint_op(pbio_drivebase_get_drive_settings(db,
         &drive_speed,
@@ -130,9 +140,10 @@ static PT_THREAD(test_drivebase_basics(struct pt *pt)) {
     tt_uint_op(pbio_drivebase_drive_straight(db, 1000, PBIO_CONTROL_ON_COMPLETION_CONTINUE), ==, PBIO_SUCCESS);
     pbio_test_sleep_until(pbio_drivebase_is_done(db));
 
-    // Target should be moving at given speed and close to target.
+    // Target should be moving at given speed and close to target. The
+    // measured distance lags behind the reference while moving.
     tt_uint_op(pbio_drivebase_get_state_user(db, &drive_distance, &drive_speed, &turn_angle, &turn_rate), ==, PBIO_SUCCESS);
-    tt_want(pbio_test_int_is_close(drive_distance, 2000, 20));
+    tt_want(pbio_test_int_is_close(drive_distance, 2000 - 10, 20));
     tt_want(pbio_test_int_is_close(drive_speed, 200, 5));
     tt_want(pbio_test_int_is_close(turn_angle, turn_angle_start, 5));
     tt_want(pbio_test_int_is_close(turn_rate, 0, 5));
@@ -140,7 +151,7 @@ static PT_THREAD(test_drivebase_basics(struct pt *pt)) {
     // Test driving/turning forever, maintaining the speed we are already on.
     tt_uint_op(pbio_drivebase_drive_forever(db, 200, 90), ==, PBIO_SUCCESS);
     tt_uint_op(pbio_drivebase_get_state_user(db, &drive_distance, &drive_speed, &turn_angle, &turn_rate), ==, PBIO_SUCCESS);
-    tt_want(pbio_test_int_is_close(drive_distance, 2000, 20));
+    tt_want(pbio_test_int_is_close(drive_distance, 2000 - 10, 20));
     tt_want(pbio_test_int_is_close(drive_speed, 200, 5));
     tt_want(pbio_test_int_is_close(turn_angle, turn_angle_start, 5));
     tt_want(pbio_test_int_is_close(turn_rate, 0, 5));
@@ -183,7 +194,599 @@ end:
     PT_END(pt);
 }
 
+/**
+ * Writes a recording of IMU frames for a hub that is flat and rotates at a
+ * constant rate about the vertical, as if the robot is pushed aside.
+ *
+ * @param [in]  path        Path of the recording.
+ * @param [in]  sample_time Time between two frames (us).
+ * @param [in]  num_frames  Number of frames to write.
+ * @param [in]  rate        Raw gyro z value of each frame.
+ * @return                  True if the recording was written.
+ */
+static bool write_imu_recording(char *path, uint32_t sample_time, uint32_t num_frames, int16_t rate) {
+    int fd = mkstemp(path);
+    if (fd == -1) {
+        return false;
+    }
+    FILE *file = fdopen(fd, "wb");
+    if (!file) {
+        close(fd);
+        return false;
+    }
+
+    if (fwrite(&sample_time, sizeof(sample_time), 1, file) != 1) {
+        fclose(file);
+        return false;
+    }
+
+    // Gyro xyz, accelerometer xyz, with gravity pointing along the z axis.
+    const int16_t frame[] = { 0, 0, rate, 0, 0, 4097 };
+    for (uint32_t i = 0; i < num_frames; i++) {
+        if (fwrite(frame, sizeof(frame), 1, file) != 1) {
+            fclose(file);
+            return false;
+        }
+    }
+    return fclose(file) == 0;
+}
+
+static PT_THREAD(test_drivebase_gyro(struct pt *pt)) {
+
+    static struct timer timer;
+
+    static pbio_servo_t *srv_left;
+    static pbio_servo_t *srv_right;
+    static pbdrv_legodev_dev_t *legodev_left;
+    static pbdrv_legodev_dev_t *legodev_right;
+    static pbio_drivebase_t *db;
+
+    static char path[] = "/tmp/pbio-test-imu-XXXXXX";
+
+    static int32_t drive_distance;
+    static int32_t drive_speed;
+    static int32_t turn_angle_start;
+    static int32_t turn_angle;
+    static int32_t turn_rate;
+
+    // Start motor driver simulation process.
+    pbdrv_motor_driver_init_manual();
+
+    PT_BEGIN(pt);
+
+    // Replay 2 seconds of a hub turning counterclockwise at 10 deg/s,
+    // sampled at 500 Hz.
+    tt_want(write_imu_recording(path, 2000, 1000, 143));
+    tt_uint_op(pbdrv_imu_test_replay(path), ==, PBIO_SUCCESS);
+    unlink(path);
+    pbdrv_imu_test_start();
+
+    // Wait for motor simulation process to be ready.
+    while (pbdrv_init_busy()) {
+        PT_YIELD(pt);
+    }
+
+    // Start motor control process manually.
+    pbio_motor_process_start();
+
+    // Initialize the servos and the drivebase.
+    pbdrv_legodev_type_id_t id = PBDRV_LEGODEV_TYPE_ID_ANY_ENCODED_MOTOR;
+    tt_uint_op(pbdrv_legodev_get_device(PBIO_PORT_ID_A, &id, &legodev_left), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_servo_get_servo(legodev_left, &srv_left), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_servo_setup(srv_left, id, PBIO_DIRECTION_COUNTERCLOCKWISE, 1000, true, 0), ==, PBIO_SUCCESS);
+    id = PBDRV_LEGODEV_TYPE_ID_ANY_ENCODED_MOTOR;
+    tt_uint_op(pbdrv_legodev_get_device(PBIO_PORT_ID_B, &id, &legodev_right), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_servo_get_servo(legodev_right, &srv_right), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_servo_setup(srv_right, id, PBIO_DIRECTION_CLOCKWISE, 1000, true, 0), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_drivebase_get_drivebase(&db, srv_left, srv_right, 56000, 112000), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_drivebase_get_state_user(db, &drive_distance, &drive_speed, &turn_angle_start, &turn_rate), ==, PBIO_SUCCESS);
+
+    // Drive straight using the gyro for heading control.
+    tt_uint_op(pbio_drivebase_set_use_gyro(db, true), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_drivebase_drive_forever(db, 100, 0), ==, PBIO_SUCCESS);
+    pbio_test_sleep_ms(&timer, 1000);
+
+    // The heading is now taken from the replayed gyro data. The recording is
+    // not affected by the motors, so the heading keeps going.
+    tt_uint_op(pbio_drivebase_get_state_user(db, &drive_distance, &drive_speed, &turn_angle, &turn_rate), ==, PBIO_SUCCESS);
+    tt_want(pbio_test_int_is_close(turn_angle, -10, 1));
+    tt_want(pbio_test_int_is_close(turn_rate, -10, 1));
+    tt_want(pbio_test_int_is_close(drive_speed, 100, 5));
+
+    // The wheels turn the robot the other way to correct for it.
+    tt_uint_op(pbio_drivebase_set_use_gyro(db, false), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_drivebase_get_state_user(db, &drive_distance, &drive_speed, &turn_angle, &turn_rate), ==, PBIO_SUCCESS);
+    tt_want_int_op(turn_angle - turn_angle_start, >, 5);
+
+end:
+
+    PT_END(pt);
+}
+
+static PT_THREAD(test_drivebase_pose(struct pt *pt)) {
+
+    static struct timer timer;
+
+    static pbio_servo_t *srv_left;
+    static pbio_servo_t *srv_right;
+    static pbdrv_legodev_dev_t *legodev_left;
+    static pbdrv_legodev_dev_t *legodev_right;
+    static pbio_drivebase_t *db;
+
+    static float x;
+    static float y;
+    static float heading;
+
+    // Start motor driver simulation process.
+    pbdrv_motor_driver_init_manual();
+
+    PT_BEGIN(pt);
+
+    // Wait for motor simulation process to be ready.
+    while (pbdrv_init_busy()) {
+        PT_YIELD(pt);
+    }
+
+    // Start motor control process manually.
+    pbio_motor_process_start();
+
+    // Initialize the servos and the drivebase.
+    pbdrv_legodev_type_id_t id = PBDRV_LEGODEV_TYPE_ID_ANY_ENCODED_MOTOR;
+    tt_uint_op(pbdrv_legodev_get_device(PBIO_PORT_ID_A, &id, &legodev_left), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_servo_get_servo(legodev_left, &srv_left), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_servo_setup(srv_left, id, PBIO_DIRECTION_COUNTERCLOCKWISE, 1000, true, 0), ==, PBIO_SUCCESS);
+    id = PBDRV_LEGODEV_TYPE_ID_ANY_ENCODED_MOTOR;
+    tt_uint_op(pbdrv_legodev_get_device(PBIO_PORT_ID_B, &id, &legodev_right), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_servo_get_servo(legodev_right, &srv_right), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_servo_setup(srv_right, id, PBIO_DIRECTION_CLOCKWISE, 1000, true, 0), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_drivebase_get_drivebase(&db, srv_left, srv_right, 56000, 112000), ==, PBIO_SUCCESS);
+
+    // A new drive base starts at the origin.
+    tt_uint_op(pbio_drivebase_get_pose(db, &x, &y, &heading), ==, PBIO_SUCCESS);
+    tt_want(x == 0.0f && y == 0.0f && heading == 0.0f);
+
+    // Driving straight moves along the x-axis.
+    tt_uint_op(pbio_drivebase_drive_straight(db, 300, PBIO_CONTROL_ON_COMPLETION_HOLD), ==, PBIO_SUCCESS);
+    pbio_test_sleep_until(pbio_drivebase_is_done(db));
+    pbio_test_sleep_ms(&timer, 200);
+    tt_uint_op(pbio_drivebase_get_pose(db, &x, &y, &heading), ==, PBIO_SUCCESS);
+    tt_want(fabsf(x - 300.0f) < 10.0f);
+    tt_want(fabsf(y) < 5.0f);
+    tt_want(fabsf(heading) < 3.0f);
+
+    // Drive to a point on the right, which turns clockwise first.
+    tt_uint_op(pbio_drivebase_drive_to(db, 300.0f, 200.0f, PBIO_CONTROL_ON_COMPLETION_HOLD), ==, PBIO_SUCCESS);
+    pbio_test_sleep_until(pbio_drivebase_is_done(db));
+    pbio_test_sleep_ms(&timer, 200);
+    tt_uint_op(pbio_drivebase_get_pose(db, &x, &y, &heading), ==, PBIO_SUCCESS);
+    tt_want(fabsf(x - 300.0f) < 10.0f);
+    tt_want(fabsf(y - 200.0f) < 10.0f);
+    tt_want(fabsf(heading - 90.0f) < 3.0f);
+
+    // Drive back to the origin, going the shortest way around.
+    tt_uint_op(pbio_drivebase_drive_to(db, 0.0f, 0.0f, PBIO_CONTROL_ON_COMPLETION_HOLD), ==, PBIO_SUCCESS);
+    pbio_test_sleep_until(pbio_drivebase_is_done(db));
+    pbio_test_sleep_ms(&timer, 200);
+    tt_uint_op(pbio_drivebase_get_pose(db, &x, &y, &heading), ==, PBIO_SUCCESS);
+    tt_want(fabsf(x) < 10.0f);
+    tt_want(fabsf(y) < 10.0f);
+    tt_want(fabsf(heading - 213.7f) < 3.0f);
+
+    // Resetting the pose does not move the drive base.
+    tt_uint_op(pbio_drivebase_reset_pose(db, 10.0f, 20.0f, 30.0f), ==, PBIO_SUCCESS);
+    pbio_test_sleep_ms(&timer, 100);
+    tt_uint_op(pbio_drivebase_get_pose(db, &x, &y, &heading), ==, PBIO_SUCCESS);
+    tt_want(fabsf(x - 10.0f) < 1.0f);
+    tt_want(fabsf(y - 20.0f) < 1.0f);
+    tt_want(fabsf(heading - 30.0f) < 1.0f);
+
+    // The pose is still tracked when the motors are driven directly.
+    tt_uint_op(pbio_servo_run_angle(srv_left, 500, 360, PBIO_CONTROL_ON_COMPLETION_HOLD), ==, PBIO_SUCCESS);
+    pbio_test_sleep_until(pbio_control_is_done(&srv_left->control));
+    tt_uint_op(pbio_drivebase_get_pose(db, &x, &y, &heading), ==, PBIO_SUCCESS);
+    tt_want(fabsf(heading - 30.0f) > 45.0f);
+
+end:
+
+    PT_END(pt);
+}
+
+static PT_THREAD(test_drivebase_path(struct pt *pt)) {
+
+    static struct timer timer;
+
+    static pbio_servo_t *srv_left;
+    static pbio_servo_t *srv_right;
+    static pbdrv_legodev_dev_t *legodev_left;
+    static pbdrv_legodev_dev_t *legodev_right;
+    static pbio_drivebase_t *db;
+
+    static pbio_drivebase_path_segment_t path[3];
+
+    static int32_t drive_distance_start;
+    static int32_t drive_distance;
+    static int32_t drive_speed;
+    static int32_t drive_speed_min;
+    static int32_t turn_angle_start;
+    static int32_t turn_angle;
+    static int32_t turn_rate;
+
+    static float x;
+    static float y;
+    static float heading;
+
+    // Start motor driver simulation process.
+    pbdrv_motor_driver_init_manual();
+
+    PT_BEGIN(pt);
+
+    // Wait for motor simulation process to be ready.
+    while (pbdrv_init_busy()) {
+        PT_YIELD(pt);
+    }
+
+    // Start motor control process manually.
+    pbio_motor_process_start();
+
+    // Initialize the servos and the drivebase.
+    pbdrv_legodev_type_id_t id = PBDRV_LEGODEV_TYPE_ID_ANY_ENCODED_MOTOR;
+    tt_uint_op(pbdrv_legodev_get_device(PBIO_PORT_ID_A, &id, &legodev_left), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_servo_get_servo(legodev_left, &srv_left), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_servo_setup(srv_left, id, PBIO_DIRECTION_COUNTERCLOCKWISE, 1000, true, 0), ==, PBIO_SUCCESS);
+    id = PBDRV_LEGODEV_TYPE_ID_ANY_ENCODED_MOTOR;
+    tt_uint_op(pbdrv_legodev_get_device(PBIO_PORT_ID_B, &id, &legodev_right), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_servo_get_servo(legodev_right, &srv_right), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_servo_setup(srv_right, id, PBIO_DIRECTION_CLOCKWISE, 1000, true, 0), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_drivebase_get_drivebase(&db, srv_left, srv_right, 56000, 112000), ==, PBIO_SUCCESS);
+
+    // A path needs at least one segment and must fit.
+    tt_uint_op(pbio_drivebase_drive_path(db, path, 0, PBIO_CONTROL_ON_COMPLETION_HOLD), ==, PBIO_ERROR_INVALID_ARG);
+    tt_uint_op(pbio_drivebase_drive_path(db, path, PBIO_CONFIG_DRIVEBASE_PATH_SIZE + 1, PBIO_CONTROL_ON_COMPLETION_HOLD), ==, PBIO_ERROR_INVALID_ARG);
+
+    // Drive straight, turn right along an arc, and drive straight again.
+    path[0] = (pbio_drivebase_path_segment_t) { .distance = 200, .angle = 0 };
+    pbio_drivebase_get_arc_segment(100, 90, &path[1]);
+    path[2] = (pbio_drivebase_path_segment_t) { .distance = 200, .angle = 0 };
+    tt_uint_op(pbio_drivebase_get_state_user(db, &drive_distance_start, &drive_speed, &turn_angle_start, &turn_rate), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_drivebase_drive_path(db, path, 3, PBIO_CONTROL_ON_COMPLETION_HOLD), ==, PBIO_SUCCESS);
+
+    // The drive base does not slow down at the joins.
+    drive_speed_min = INT32_MAX;
+    while (!pbio_drivebase_is_done(db)) {
+        tt_uint_op(pbio_drivebase_get_state_user(db, &drive_distance, &drive_speed, &turn_angle, &turn_rate), ==, PBIO_SUCCESS);
+        if (drive_distance - drive_distance_start > 150 && drive_distance - drive_distance_start < 400) {
+            drive_speed_min = pbio_int_math_min(drive_speed_min, drive_speed);
+        }
+        pbio_test_clock_tick(1);
+        PT_YIELD(pt);
+    }
+    tt_want_int_op(drive_speed_min, >, 150);
+
+    // It ends up where the segments lead to.
+    pbio_test_sleep_ms(&timer, 200);
+    tt_uint_op(pbio_drivebase_get_state_user(db, &drive_distance, &drive_speed, &turn_angle, &turn_rate), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_drivebase_get_pose(db, &x, &y, &heading), ==, PBIO_SUCCESS);
+    tt_want(pbio_test_int_is_close(drive_distance - drive_distance_start, 200 + path[1].distance + 200, 5));
+    tt_want(pbio_test_int_is_close(turn_angle - turn_angle_start, 90, 2));
+    tt_want(fabsf(x - 300.0f) < 15.0f);
+    tt_want(fabsf(y - 300.0f) < 15.0f);
+
+    // Another command cancels the rest of the path.
+    tt_uint_op(pbio_drivebase_drive_path(db, path, 3, PBIO_CONTROL_ON_COMPLETION_HOLD), ==, PBIO_SUCCESS);
+    pbio_test_sleep_ms(&timer, 100);
+    tt_uint_op(pbio_drivebase_drive_straight(db, 0, PBIO_CONTROL_ON_COMPLETION_HOLD), ==, PBIO_SUCCESS);
+    pbio_test_sleep_until(pbio_drivebase_is_done(db));
+    tt_want(db->path_size == 0);
+
+end:
+
+    PT_END(pt);
+}
+
+// Simulated reflection of a line along the x-axis that gets darker toward
+// the right, so the edge at 50% is where y = 0.
+static pbio_error_t test_drivebase_follow_sensor(void *context, int32_t *value) {
+    pbio_drivebase_t *db = context;
+    float x, y, heading;
+    pbio_error_t err = pbio_drivebase_get_pose(db, &x, &y, &heading);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+    *value = 50 - (int32_t)y;
+    return PBIO_SUCCESS;
+}
+
+// Sensor that stops working, as if it was unplugged.
+static pbio_error_t test_drivebase_follow_sensor_fail(void *context, int32_t *value) {
+    return PBIO_ERROR_NO_DEV;
+}
+
+// Sensor that never gives a new value, as if stuck switching modes.
+static pbio_error_t test_drivebase_follow_sensor_stale(void *context, int32_t *value) {
+    return PBIO_ERROR_AGAIN;
+}
+
+static PT_THREAD(test_drivebase_follow(struct pt *pt)) {
+
+    static struct timer timer;
+
+    static pbio_servo_t *srv_left;
+    static pbio_servo_t *srv_right;
+    static pbdrv_legodev_dev_t *legodev_left;
+    static pbdrv_legodev_dev_t *legodev_right;
+    static pbio_drivebase_t *db;
+
+    static float x;
+    static float y;
+    static float heading;
+
+    // Start motor driver simulation process.
+    pbdrv_motor_driver_init_manual();
+
+    PT_BEGIN(pt);
+
+    // Wait for motor simulation process to be ready.
+    while (pbdrv_init_busy()) {
+        PT_YIELD(pt);
+    }
+
+    // Start motor control process manually.
+    pbio_motor_process_start();
+
+    // Initialize the servos and the drivebase.
+    pbdrv_legodev_type_id_t id = PBDRV_LEGODEV_TYPE_ID_ANY_ENCODED_MOTOR;
+    tt_uint_op(pbdrv_legodev_get_device(PBIO_PORT_ID_A, &id, &legodev_left), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_servo_get_servo(legodev_left, &srv_left), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_servo_setup(srv_left, id, PBIO_DIRECTION_COUNTERCLOCKWISE, 1000, true, 0), ==, PBIO_SUCCESS);
+    id = PBDRV_LEGODEV_TYPE_ID_ANY_ENCODED_MOTOR;
+    tt_uint_op(pbdrv_legodev_get_device(PBIO_PORT_ID_B, &id, &legodev_right), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_servo_get_servo(legodev_right, &srv_right), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_servo_setup(srv_right, id, PBIO_DIRECTION_CLOCKWISE, 1000, true, 0), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_drivebase_get_drivebase(&db, srv_left, srv_right, 56000, 112000), ==, PBIO_SUCCESS);
+
+    // A sensor function is required.
+    tt_uint_op(pbio_drivebase_follow(db, NULL, db, 200, 50.0f, 3.0f, 0.0f, 0.0f), ==, PBIO_ERROR_INVALID_ARG);
+
+    // Start off to the right of the line, which should steer back onto it.
+    tt_uint_op(pbio_drivebase_reset_pose(db, 0.0f, 30.0f, 0.0f), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_drivebase_follow(db, test_drivebase_follow_sensor, db, 200, 50.0f, 3.0f, 0.0f, 1.5f), ==, PBIO_SUCCESS);
+    pbio_test_sleep_ms(&timer, 3000);
+    tt_uint_op(pbio_drivebase_get_pose(db, &x, &y, &heading), ==, PBIO_SUCCESS);
+    tt_want(x > 400.0f);
+    tt_want(fabsf(y) < 5.0f);
+    tt_want(fabsf(heading) < 5.0f);
+    tt_want(!pbio_drivebase_is_done(db));
+
+    // Another command ends line following.
+    tt_uint_op(pbio_drivebase_stop(db, PBIO_CONTROL_ON_COMPLETION_HOLD), ==, PBIO_SUCCESS);
+    tt_want(db->follow.sensor == NULL);
+    pbio_test_sleep_ms(&timer, 500);
+
+    // If the sensor fails, the drive base stops.
+    tt_uint_op(pbio_drivebase_follow(db, test_drivebase_follow_sensor_fail, db, 200, 50.0f, 3.0f, 0.0f, 0.0f), ==, PBIO_SUCCESS);
+    pbio_test_sleep_ms(&timer, 100);
+    tt_want(db->follow.sensor == NULL);
+    tt_want(pbio_drivebase_is_done(db));
+
+    // Without new sensor values, the drive base goes on for a little while,
+    // but then it stops.
+    tt_uint_op(pbio_drivebase_follow(db, test_drivebase_follow_sensor_stale, db, 200, 50.0f, 3.0f, 0.0f, 0.0f), ==, PBIO_SUCCESS);
+    pbio_test_sleep_ms(&timer, 400);
+    tt_want(db->follow.sensor != NULL);
+    pbio_test_sleep_ms(&timer, 200);
+    tt_want(db->follow.sensor == NULL);
+    tt_want(pbio_drivebase_is_done(db));
+
+end:
+
+    PT_END(pt);
+}
+
+#if PBIO_CONFIG_DRIVEBASE_NUM_WHEELS > 2
+static PT_THREAD(test_drivebase_mecanum(struct pt *pt)) {
+
+    static struct timer timer;
+
+    // Simulated wheels are not coupled through the floor, so differences
+    // between these motors must be kept in check by the drive base.
+    static const pbio_port_id_t ports[] = { PBIO_PORT_ID_A, PBIO_PORT_ID_B, PBIO_PORT_ID_F, PBIO_PORT_ID_E };
+    static pbio_servo_t *srv[4];
+    static pbio_drivebase_wheel_t wheels[5];
+    static pbio_drivebase_t *db;
+    static int32_t angle_start[4];
+    static int32_t angle;
+    static int32_t speed;
+
+    static float x;
+    static float y;
+    static float heading;
+
+    // Start motor driver simulation process.
+    pbdrv_motor_driver_init_manual();
+
+    PT_BEGIN(pt);
+
+    // Wait for motor simulation process to be ready.
+    while (pbdrv_init_busy()) {
+        PT_YIELD(pt);
+    }
+
+    // Start motor control process manually.
+    pbio_motor_process_start();
+
+    // Initialize the servos for the front left, front right, rear left and
+    // rear right wheels.
+    for (uint8_t i = 0; i < 4; i++) {
+        pbdrv_legodev_dev_t *legodev;
+        pbdrv_legodev_type_id_t id = PBDRV_LEGODEV_TYPE_ID_ANY_ENCODED_MOTOR;
+        tt_uint_op(pbdrv_legodev_get_device(ports[i], &id, &legodev), ==, PBIO_SUCCESS);
+        tt_uint_op(pbio_servo_get_servo(legodev, &srv[i]), ==, PBIO_SUCCESS);
+        tt_uint_op(pbio_servo_setup(srv[i], id, i % 2 ? PBIO_DIRECTION_CLOCKWISE : PBIO_DIRECTION_COUNTERCLOCKWISE, 1000, true, 0), ==, PBIO_SUCCESS);
+    }
+    pbio_drivebase_get_mecanum_wheels(srv[0], srv[1], srv[2], srv[3], wheels);
+
+    // Wheels must be distinct, not too many, and able to tell all motion apart.
+    wheels[4] = wheels[3];
+    tt_uint_op(pbio_drivebase_get_drivebase_wheels(&db, wheels, 5, 56000, 200000), ==, PBIO_ERROR_INVALID_ARG);
+    wheels[4] = wheels[0];
+    tt_uint_op(pbio_drivebase_get_drivebase_wheels(&db, &wheels[3], 2, 56000, 200000), ==, PBIO_ERROR_INVALID_ARG);
+    wheels[4].servo = srv[3];
+    wheels[4].heading = 0;
+    tt_uint_op(pbio_drivebase_get_drivebase_wheels(&db, &wheels[3], 2, 56000, 200000), ==, PBIO_ERROR_INVALID_ARG);
+
+    // Now make the mecanum drive base. The wheels are then in use.
+    tt_uint_op(pbio_drivebase_get_drivebase_wheels(&db, wheels, 4, 56000, 200000), ==, PBIO_SUCCESS);
+    tt_want(db->holonomic);
+    tt_uint_op(pbio_drivebase_get_drivebase(&db, srv[0], srv[1], 56000, 112000), ==, PBIO_ERROR_BUSY);
+
+    // Driving straight turns all wheels forward.
+    for (uint8_t i = 0; i < 4; i++) {
+        tt_uint_op(pbio_servo_get_state_user(srv[i], &angle_start[i], &speed), ==, PBIO_SUCCESS);
+    }
+    tt_uint_op(pbio_drivebase_drive_straight(db, 200, PBIO_CONTROL_ON_COMPLETION_HOLD), ==, PBIO_SUCCESS);
+    pbio_test_sleep_until(pbio_drivebase_is_done(db));
+    pbio_test_sleep_ms(&timer, 200);
+    for (uint8_t i = 0; i < 4; i++) {
+        tt_uint_op(pbio_servo_get_state_user(srv[i], &angle, &speed), ==, PBIO_SUCCESS);
+        tt_want_int_op(abs(angle - angle_start[i] - 409), <, 20);
+    }
+    tt_uint_op(pbio_drivebase_get_pose(db, &x, &y, &heading), ==, PBIO_SUCCESS);
+    tt_want(fabsf(x - 200.0f) < 5.0f);
+    tt_want(fabsf(y) < 5.0f);
+    tt_want(fabsf(heading) < 2.0f);
+
+    // Driving sideways to the right turns the front left and rear right
+    // wheels forward and the others backward.
+    for (uint8_t i = 0; i < 4; i++) {
+        tt_uint_op(pbio_servo_get_state_user(srv[i], &angle_start[i], &speed), ==, PBIO_SUCCESS);
+    }
+    tt_uint_op(pbio_drivebase_drive_forever_holonomic(db, 0, 100, 0), ==, PBIO_SUCCESS);
+    pbio_test_sleep_ms(&timer, 2000);
+    tt_uint_op(pbio_drivebase_stop(db, PBIO_CONTROL_ON_COMPLETION_HOLD), ==, PBIO_SUCCESS);
+    pbio_test_sleep_until(pbio_drivebase_is_done(db));
+    pbio_test_sleep_ms(&timer, 200);
+    for (uint8_t i = 0; i < 4; i++) {
+        tt_uint_op(pbio_servo_get_state_user(srv[i], &angle, &speed), ==, PBIO_SUCCESS);
+        tt_want_int_op((angle - angle_start[i]) * (i == 0 || i == 3 ? 1 : -1), >, 300);
+    }
+    tt_uint_op(pbio_drivebase_get_pose(db, &x, &y, &heading), ==, PBIO_SUCCESS);
+    tt_want(fabsf(x - 200.0f) < 5.0f);
+    tt_want(y > 150.0f);
+    tt_want(fabsf(heading) < 2.0f);
+
+    // Turning in place keeps the position.
+    tt_uint_op(pbio_drivebase_drive_curve(db, 0, 90, PBIO_CONTROL_ON_COMPLETION_HOLD), ==, PBIO_SUCCESS);
+    pbio_test_sleep_until(pbio_drivebase_is_done(db));
+    pbio_test_sleep_ms(&timer, 200);
+    tt_uint_op(pbio_drivebase_get_pose(db, &x, &y, &heading), ==, PBIO_SUCCESS);
+    tt_want(fabsf(x - 200.0f) < 5.0f);
+    tt_want(y > 150.0f);
+    tt_want(fabsf(heading - 90.0f) < 2.0f);
+
+end:
+
+    PT_END(pt);
+}
+#endif // PBIO_CONFIG_DRIVEBASE_NUM_WHEELS > 2
+
+static PT_THREAD(test_drivebase_slip(struct pt *pt)) {
+
+    static struct timer timer;
+
+    static pbio_servo_t *srv_left;
+    static pbio_servo_t *srv_right;
+    static pbdrv_legodev_dev_t *legodev_left;
+    static pbdrv_legodev_dev_t *legodev_right;
+    static pbio_drivebase_t *db;
+
+    static bool slipping;
+    static float heading_rate_error;
+    static float acceleration_error;
+
+    static int32_t drive_speed;
+    static int32_t drive_acceleration;
+    static int32_t drive_deceleration;
+    static int32_t turn_rate;
+    static int32_t turn_acceleration;
+    static int32_t turn_deceleration;
+    static int32_t turn_acceleration_reduced;
+
+    // Start motor driver simulation process.
+    pbdrv_motor_driver_init_manual();
+
+    PT_BEGIN(pt);
+
+    // The simulated hub lies flat and never moves, as if the wheels spin
+    // without moving the robot.
+    static const int16_t frame[] = { 0, 0, 0, 0, 0, 4097 };
+    pbdrv_imu_test_set_frame(frame);
+    pbdrv_imu_test_start();
+
+    // Wait for motor simulation process to be ready.
+    while (pbdrv_init_busy()) {
+        PT_YIELD(pt);
+    }
+
+    // Start motor control process manually.
+    pbio_motor_process_start();
+
+    // Initialize the servos and the drivebase.
+    pbdrv_legodev_type_id_t id = PBDRV_LEGODEV_TYPE_ID_ANY_ENCODED_MOTOR;
+    tt_uint_op(pbdrv_legodev_get_device(PBIO_PORT_ID_A, &id, &legodev_left), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_servo_get_servo(legodev_left, &srv_left), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_servo_setup(srv_left, id, PBIO_DIRECTION_COUNTERCLOCKWISE, 1000, true, 0), ==, PBIO_SUCCESS);
+    id = PBDRV_LEGODEV_TYPE_ID_ANY_ENCODED_MOTOR;
+    tt_uint_op(pbdrv_legodev_get_device(PBIO_PORT_ID_B, &id, &legodev_right), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_servo_get_servo(legodev_right, &srv_right), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_servo_setup(srv_right, id, PBIO_DIRECTION_CLOCKWISE, 1000, true, 0), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_drivebase_get_drivebase(&db, srv_left, srv_right, 56000, 112000), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_drivebase_get_drive_settings(db, &drive_speed, &drive_acceleration, &drive_deceleration, &turn_rate, &turn_acceleration, &turn_deceleration), ==, PBIO_SUCCESS);
+
+    // Standing still agrees with the IMU.
+    tt_uint_op(pbio_drivebase_stop(db, PBIO_CONTROL_ON_COMPLETION_HOLD), ==, PBIO_SUCCESS);
+    pbio_test_sleep_ms(&timer, 200);
+    tt_uint_op(pbio_drivebase_is_slipping(db, &slipping, &heading_rate_error, &acceleration_error), ==, PBIO_SUCCESS);
+    tt_want(!slipping);
+    tt_want(fabsf(heading_rate_error) < 5.0f);
+    tt_want(fabsf(acceleration_error) < 100.0f);
+
+    // Turning the wheels while the gyro says the robot doesn't turn is slip.
+    // With the limit enabled, this reduces the acceleration.
+    pbio_drivebase_set_slip_limit(db, true);
+    tt_uint_op(pbio_drivebase_drive_forever(db, 0, 180), ==, PBIO_SUCCESS);
+    pbio_test_sleep_ms(&timer, 1000);
+    tt_uint_op(pbio_drivebase_is_slipping(db, &slipping, &heading_rate_error, &acceleration_error), ==, PBIO_SUCCESS);
+    tt_want(slipping);
+    tt_want(fabsf(heading_rate_error - 180.0f) < 10.0f);
+    tt_uint_op(pbio_drivebase_get_drive_settings(db, &drive_speed, &drive_acceleration, &drive_deceleration, &turn_rate, &turn_acceleration_reduced, &turn_deceleration), ==, PBIO_SUCCESS);
+    tt_want_int_op(turn_acceleration_reduced, <, turn_acceleration);
+    tt_want_int_op(turn_acceleration_reduced, >=, turn_acceleration / 4);
+
+    // Once stopped, the wheels agree with the IMU again.
+    tt_uint_op(pbio_drivebase_stop(db, PBIO_CONTROL_ON_COMPLETION_HOLD), ==, PBIO_SUCCESS);
+    pbio_test_sleep_ms(&timer, 1000);
+    tt_uint_op(pbio_drivebase_is_slipping(db, &slipping, &heading_rate_error, &acceleration_error), ==, PBIO_SUCCESS);
+    tt_want(!slipping);
+
+    // Disabling the limit restores the original acceleration.
+    pbio_drivebase_set_slip_limit(db, false);
+    tt_uint_op(pbio_drivebase_get_drive_settings(db, &drive_speed, &drive_acceleration, &drive_deceleration, &turn_rate, &turn_acceleration_reduced, &turn_deceleration), ==, PBIO_SUCCESS);
+    tt_want_int_op(turn_acceleration_reduced, ==, turn_acceleration);
+
+end:
+
+    PT_END(pt);
+}
+
 struct testcase_t pbio_drivebase_tests[] = {
     PBIO_PT_THREAD_TEST(test_drivebase_basics),
+    PBIO_PT_THREAD_TEST(test_drivebase_gyro),
+    PBIO_PT_THREAD_TEST(test_drivebase_pose),
+    PBIO_PT_THREAD_TEST(test_drivebase_path),
+    PBIO_PT_THREAD_TEST(test_drivebase_follow),
+    #if PBIO_CONFIG_DRIVEBASE_NUM_WHEELS > 2
+    PBIO_PT_THREAD_TEST(test_drivebase_mecanum),
+    #endif
+    PBIO_PT_THREAD_TEST(test_drivebase_slip),
     END_OF_TESTCASES
 };
@@ -0,0 +1,165 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2023 The Pybricks Authors
+
+#include <math.h>
+
+#include <pbio/geometry.h>
+
+#include <tinytest.h>
+#include <tinytest_macros.h>
+
+#include <test-pbio.h>
+
+// TODO: submit this upstream
+#ifndef tt_want_float_op
+#define tt_want_float_op(a, op, b) \
+    tt_assert_test_type(a, b,#a " "#op " "#b, float, (val1_ op val2_), "%f", (void)0)
+#endif
+
+// IMU sample time (s) similar to the hub IMU.
+#define SAMPLE_TIME (0.0012f)
+
+// Gravity in mm/s^2.
+#define GRAVITY (9806.65f)
+
+static void test_quaternion_from_gravity(void *env) {
+
+    static const float gravity_vectors[][3] = {
+        { 0.0f, 0.0f, GRAVITY },
+        { 0.0f, 0.0f, -GRAVITY },
+        { GRAVITY, 0.0f, 0.0f },
+        { 0.0f, -GRAVITY, 0.0f },
+        { 1000.0f, 2000.0f, 9000.0f },
+        { -5000.0f, 3000.0f, -7000.0f },
+    };
+
+    for (size_t i = 0; i < sizeof(gravity_vectors) / sizeof(gravity_vectors[0]); i++) {
+        pbio_geometry_xyz_t gravity = {
+            .x = gravity_vectors[i][0],
+            .y = gravity_vectors[i][1],
+            .z = gravity_vectors[i][2],
+        };
+        pbio_geometry_quaternion_t q;
+        tt_want_int_op(pbio_geometry_quaternion_from_gravity(&gravity, &q), ==, PBIO_SUCCESS);
+
+        pbio_geometry_matrix_3x3_t r;
+        pbio_geometry_quaternion_to_rotation_matrix(&q, &r);
+
+        // The vertical in the body frame is the normalized gravity vector.
+        pbio_geometry_xyz_t up;
+        pbio_geometry_vector_normalize(&gravity, &up);
+        tt_want_float_op(fabsf(r.m31 - up.x), <, 0.001f);
+        tt_want_float_op(fabsf(r.m32 - up.y), <, 0.001f);
+        tt_want_float_op(fabsf(r.m33 - up.z), <, 0.001f);
+
+        // Columns have unit length.
+        tt_want_float_op(fabsf(r.m11 * r.m11 + r.m21 * r.m21 + r.m31 * r.m31 - 1.0f), <, 0.001f);
+        tt_want_float_op(fabsf(r.m12 * r.m12 + r.m22 * r.m22 + r.m32 * r.m32 - 1.0f), <, 0.001f);
+        tt_want_float_op(fabsf(r.m13 * r.m13 + r.m23 * r.m23 + r.m33 * r.m33 - 1.0f), <, 0.001f);
+    }
+
+    // There is no attitude for zero gravity.
+    pbio_geometry_xyz_t zero = { 0 };
+    pbio_geometry_quaternion_t q;
+    tt_want_int_op(pbio_geometry_quaternion_from_gravity(&zero, &q), ==, PBIO_ERROR_INVALID_ARG);
+}
+
+/**
+ * Turns a hub that is tilted about its Y axis (like on a ramp) about the
+ * vertical, and checks that the rotation about the vertical is measured
+ * correctly, unlike a rotation about the hub Z axis.
+ */
+static void test_quaternion_rotation_on_ramp(void *env) {
+
+    const float tilt = 30.0f * (float)(M_PI / 180);
+    const float rate = 90.0f;
+
+    // In the body frame, the vertical axis is the same throughout this
+    // motion, and so are the gravity and angular velocity vectors.
+    pbio_geometry_xyz_t up = { .x = -sinf(tilt), .y = 0.0f, .z = cosf(tilt) };
+    pbio_geometry_xyz_t acceleration = { .x = up.x * GRAVITY, .y = up.y * GRAVITY, .z = up.z * GRAVITY };
+    pbio_geometry_xyz_t angular_velocity = { .x = up.x * rate, .y = up.y * rate, .z = up.z * rate };
+
+    pbio_geometry_quaternion_t q;
+    tt_want_int_op(pbio_geometry_quaternion_from_gravity(&acceleration, &q), ==, PBIO_SUCCESS);
+
+    // Turn for 4 seconds.
+    float vertical_rotation = 0.0f;
+    float hub_z_rotation = 0.0f;
+    for (int i = 0; i < (int)(4.0f / SAMPLE_TIME); i++) {
+        pbio_geometry_quaternion_update_attitude(&q, &angular_velocity, &acceleration, SAMPLE_TIME, 1.0f);
+
+        pbio_geometry_matrix_3x3_t r;
+        pbio_geometry_quaternion_to_rotation_matrix(&q, &r);
+        vertical_rotation += (r.m31 * angular_velocity.x + r.m32 * angular_velocity.y + r.m33 * angular_velocity.z) * SAMPLE_TIME;
+        hub_z_rotation += angular_velocity.z * SAMPLE_TIME;
+    }
+
+    // One full turn about the vertical, while the hub Z axis sees less.
+    tt_want_float_op(fabsf(vertical_rotation - 360.0f), <, 1.0f);
+    tt_want_float_op(fabsf(hub_z_rotation - 360.0f * cosf(tilt)), <, 1.0f);
+
+    // The estimated vertical is still the same.
+    pbio_geometry_matrix_3x3_t r;
+    pbio_geometry_quaternion_to_rotation_matrix(&q, &r);
+    tt_want_float_op(fabsf(r.m31 - up.x), <, 0.001f);
+    tt_want_float_op(fabsf(r.m32 - up.y), <, 0.001f);
+    tt_want_float_op(fabsf(r.m33 - up.z), <, 0.001f);
+
+    // A full turn about the vertical brings it back to the initial heading.
+    tt_want_float_op(fabsf(atan2f(r.m21, r.m11)), <, 0.01f);
+}
+
+/**
+ * Checks that a wrong initial tilt estimate is corrected by gravity.
+ */
+static void test_quaternion_tilt_correction(void *env) {
+
+    const float tilt = 30.0f * (float)(M_PI / 180);
+
+    // Stationary hub, tilted about its X axis.
+    pbio_geometry_xyz_t acceleration = { .x = 0.0f, .y = sinf(tilt) * GRAVITY, .z = cosf(tilt) * GRAVITY };
+    pbio_geometry_xyz_t angular_velocity = { 0 };
+
+    // Start with flat estimate.
+    pbio_geometry_quaternion_t q = { .w = 1.0f };
+
+    // Without correction, nothing changes.
+    for (int i = 0; i < 1000; i++) {
+        pbio_geometry_quaternion_update_attitude(&q, &angular_velocity, &acceleration, SAMPLE_TIME, 0.0f);
+    }
+    tt_want_float_op(fabsf(q.w - 1.0f), <, 0.0001f);
+
+    // The correction converges in a few seconds.
+    for (int i = 0; i < (int)(10.0f / SAMPLE_TIME); i++) {
+        pbio_geometry_quaternion_update_attitude(&q, &angular_velocity, &acceleration, SAMPLE_TIME, 1.0f);
+    }
+    pbio_geometry_matrix_3x3_t r;
+    pbio_geometry_quaternion_to_rotation_matrix(&q, &r);
+    float roll = atan2f(r.m32, r.m33);
+    tt_want_float_op(fabsf(roll - tilt) * (float)(180 / M_PI), <, 0.5f);
+    tt_want_float_op(fabsf(r.m31), <, 0.01f);
+}
+
+static void test_matrix_multiply_transpose(void *env) {
+
+    pbio_geometry_xyz_t front = { .x = 0.0f, .y = 1.0f, .z = 0.0f };
+    pbio_geometry_xyz_t top = { .x = 0.0f, .y = 0.0f, .z = 1.0f };
+    pbio_geometry_matrix_3x3_t map;
+    tt_want_int_op(pbio_geometry_map_from_base_axes(&front, &top, &map), ==, PBIO_SUCCESS);
+
+    // A rotation matrix times its transpose is identity.
+    pbio_geometry_matrix_3x3_t identity;
+    pbio_geometry_matrix_multiply_transpose(&map, &map, &identity);
+    for (uint8_t i = 0; i < 9; i++) {
+        tt_want_float_op(fabsf(identity.values[i] - (i % 4 == 0 ? 1.0f : 0.0f)), <, 0.0001f);
+    }
+}
+
+struct testcase_t pbio_geometry_tests[] = {
+    PBIO_TEST(test_matrix_multiply_transpose),
+    PBIO_TEST(test_quaternion_from_gravity),
+    PBIO_TEST(test_quaternion_rotation_on_ramp),
+    PBIO_TEST(test_quaternion_tilt_correction),
+    END_OF_TESTCASES
+};
@@ -0,0 +1,227 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2023 The Pybricks Authors
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <contiki.h>
+#include <tinytest.h>
+#include <tinytest_macros.h>
+
+#include <pbdrv/imu.h>
+#include <pbio/geometry.h>
+#include <pbio/imu.h>
+#include <pbio/util.h>
+#include <test-pbio.h>
+
+#include "../drv/clock/clock_test.h"
+#include "../drv/imu/imu_test.h"
+
+static PT_THREAD(test_imu_batched_frames(struct pt *pt)) {
+
+    static struct timer timer;
+    static uint32_t batch_count_start;
+    static float heading;
+
+    PT_BEGIN(pt);
+
+    pbdrv_imu_test_start();
+
+    // Hub flat on the table, turning at 70 deg/s about the vertical, which is
+    // 1000 raw gyro units. Gravity is about 4097 raw accelerometer units.
+    static const int16_t frame[] = { 0, 0, 1000, 0, 0, 4097 };
+    pbdrv_imu_test_set_frame(frame);
+    pbio_imu_set_heading(0.0f);
+    batch_count_start = pbdrv_imu_test_get_batch_count();
+
+    pbio_test_sleep_ms(&timer, 1000);
+
+    // Samples arrive in batches of 8 frames instead of one at a time.
+    uint32_t batch_count = pbdrv_imu_test_get_batch_count() - batch_count_start;
+    tt_want_int_op(batch_count, >=, 124);
+    tt_want_int_op(batch_count, <=, 126);
+
+    // All samples are used, so the heading is accurate.
+    heading = pbio_imu_get_heading();
+    tt_want(fabsf(heading + 70.0f) < 1.0f);
+
+    pbio_geometry_xyz_t angular_velocity;
+    pbio_imu_get_angular_velocity(&angular_velocity);
+    tt_want(fabsf(angular_velocity.z - 70.0f) < 0.01f);
+
+    // Stop turning and check that the heading stays put.
+    static const int16_t frame_stopped[] = { 0, 0, 0, 0, 0, 4097 };
+    pbdrv_imu_test_set_frame(frame_stopped);
+    pbio_test_sleep_ms(&timer, 100);
+    heading = pbio_imu_get_heading();
+    pbio_test_sleep_ms(&timer, 500);
+    tt_want(fabsf(pbio_imu_get_heading() - heading) < 0.001f);
+
+    PT_END(pt);
+}
+
+static PT_THREAD(test_imu_record(struct pt *pt)) {
+
+    static struct timer timer;
+    static uint32_t buffer[PBIO_IMU_RECORDING_SIZE(20) / sizeof(uint32_t)];
+    static pbio_imu_recording_t *recording = (pbio_imu_recording_t *)buffer;
+
+    PT_BEGIN(pt);
+
+    pbdrv_imu_test_start();
+
+    static const int16_t frame[] = { 1, -2, 3, -4, 5, 4097 };
+    pbdrv_imu_test_set_frame(frame);
+
+    // Recording stops when the buffer is full, even if more frames come in.
+    pbio_imu_record_start(recording, 20);
+    pbio_test_sleep_ms(&timer, 100);
+    tt_want_int_op(pbio_imu_record_get_count(), ==, 20);
+    tt_want_int_op(pbio_imu_record_stop(), ==, 20);
+
+    // The sample time is stored so the recording is replayed at the same
+    // rate. The test driver samples at 833 Hz like the hubs.
+    tt_want_int_op(recording->sample_time_us, ==, 1200);
+
+    // Raw frames are recorded, so they can be replayed as-is.
+    for (uint32_t i = 0; i < 20 * PBDRV_IMU_NUM_FRAME_VALUES; i++) {
+        tt_want_int_op(recording->frames[i], ==, frame[i % PBDRV_IMU_NUM_FRAME_VALUES]);
+    }
+
+    // Nothing is recorded after stopping.
+    recording->frames[0] = 0;
+    pbio_test_sleep_ms(&timer, 100);
+    tt_want_int_op(recording->frames[0], ==, 0);
+
+    PT_END(pt);
+}
+
+static PT_THREAD(test_imu_online_bias(struct pt *pt)) {
+
+    static struct timer timer;
+
+    PT_BEGIN(pt);
+
+    pbdrv_imu_test_start();
+
+    // Gyro bias of 0.7 deg/s while driving straight, so the accelerometer
+    // does not just measure gravity.
+    static const int16_t frame[] = { 0, 0, 10, 1000, 0, 4097 };
+    pbdrv_imu_test_set_frame(frame);
+
+    // The bias is estimated while moving, so that drift is reduced.
+    static pbio_geometry_xyz_t angular_velocity;
+    pbio_test_sleep_ms(&timer, 1000);
+    pbio_imu_get_angular_velocity(&angular_velocity);
+    tt_want(fabsf(angular_velocity.z - 0.7f) < 0.05f);
+    pbio_test_sleep_ms(&timer, 60000);
+    pbio_imu_get_angular_velocity(&angular_velocity);
+    tt_want(fabsf(angular_velocity.z) < 0.1f);
+
+    // Actual rotation is not mistaken for bias.
+    static const int16_t frame_turning[] = { 0, 0, 100, 1000, 0, 4097 };
+    pbdrv_imu_test_set_frame(frame_turning);
+    pbio_test_sleep_ms(&timer, 10000);
+    pbio_imu_get_angular_velocity(&angular_velocity);
+    tt_want(fabsf(angular_velocity.z - 6.3f) < 0.1f);
+
+    PT_END(pt);
+}
+
+static PT_THREAD(test_imu_calibrate_scale(struct pt *pt)) {
+
+    static struct timer timer;
+
+    PT_BEGIN(pt);
+
+    pbdrv_imu_test_start();
+
+    // Hub turning at 70 deg/s about the vertical.
+    static const int16_t frame[] = { 0, 0, 1000, 0, 0, 4097 };
+    pbdrv_imu_test_set_frame(frame);
+
+    // Measure 700 degrees in 10 seconds.
+    pbio_imu_calibrate_scale_start();
+    pbio_test_sleep_ms(&timer, 10000);
+
+    // Too little rotation, or a rotation that is too far off, is rejected.
+    pbio_geometry_xyz_t rotation = { .z = 180.0f };
+    tt_want_int_op(pbio_imu_calibrate_scale_finish(&rotation), ==, PBIO_ERROR_INVALID_ARG);
+    rotation.z = 1000.0f;
+    tt_want_int_op(pbio_imu_calibrate_scale_finish(&rotation), ==, PBIO_ERROR_FAILED);
+
+    // The actual rotation was 5% more than measured.
+    rotation.z = 735.0f;
+    tt_want_int_op(pbio_imu_calibrate_scale_finish(&rotation), ==, PBIO_SUCCESS);
+
+    pbio_geometry_xyz_t correction;
+    pbio_imu_get_scale_correction(&correction);
+    tt_want(fabsf(correction.x - 1.0f) < 0.0001f);
+    tt_want(fabsf(correction.y - 1.0f) < 0.0001f);
+    tt_want(fabsf(correction.z - 1.05f) < 0.001f);
+
+    pbio_test_sleep_ms(&timer, 10);
+    pbio_geometry_xyz_t angular_velocity;
+    pbio_imu_get_angular_velocity(&angular_velocity);
+    tt_want(fabsf(angular_velocity.z - 73.5f) < 0.1f);
+
+    PT_END(pt);
+}
+
+static void test_imu_persistent_settings(void *env) {
+
+    pbio_imu_init();
+
+    // Without calibration, only the scale is stored.
+    pbio_imu_persistent_settings_t settings;
+    pbio_imu_get_persistent_settings(&settings);
+    tt_want_int_op(settings.flags, ==, PBIO_IMU_PERSISTENT_SETTINGS_FLAG_SCALE);
+    tt_want(!pbio_imu_is_ready());
+
+    // Data that doesn't look like settings is rejected, such as empty storage.
+    pbio_imu_persistent_settings_t invalid;
+    memset(&invalid, 0xff, sizeof(invalid));
+    tt_want_int_op(pbio_imu_apply_persistent_settings(&invalid), ==, PBIO_ERROR_INVALID_ARG);
+    invalid = (pbio_imu_persistent_settings_t) {
+        .flags = PBIO_IMU_PERSISTENT_SETTINGS_FLAG_ALL,
+        .gyro_bias = { .x = 0.1f, .y = 20.0f, .z = 0.1f },
+        .gyro_scale_correction = { .x = 1.0f, .y = 1.0f, .z = 1.0f },
+    };
+    tt_want_int_op(pbio_imu_apply_persistent_settings(&invalid), ==, PBIO_ERROR_INVALID_ARG);
+    tt_want(!pbio_imu_is_ready());
+
+    // A stored bias makes the IMU ready immediately.
+    pbio_imu_persistent_settings_t stored = {
+        .flags = PBIO_IMU_PERSISTENT_SETTINGS_FLAG_ALL,
+        .gyro_bias = { .x = 0.1f, .y = -0.2f, .z = 0.3f },
+        .gyro_scale_correction = { .x = 1.0f, .y = 0.98f, .z = 1.02f },
+    };
+    tt_want_int_op(pbio_imu_apply_persistent_settings(&stored), ==, PBIO_SUCCESS);
+    tt_want(pbio_imu_is_ready());
+
+    // The same values are stored again.
+    pbio_imu_get_persistent_settings(&settings);
+    tt_want(memcmp(&settings, &stored, sizeof(settings)) == 0);
+    tt_want(!pbio_imu_persistent_settings_changed(&stored, &settings));
+
+    // Small refinements of the bias are not worth saving again.
+    settings.gyro_bias.z += PBIO_IMU_BIAS_SAVE_THRESHOLD / 2;
+    tt_want(!pbio_imu_persistent_settings_changed(&stored, &settings));
+    settings.gyro_bias.z += PBIO_IMU_BIAS_SAVE_THRESHOLD;
+    tt_want(pbio_imu_persistent_settings_changed(&stored, &settings));
+
+    // But any change in scale is saved.
+    settings.gyro_bias = stored.gyro_bias;
+    settings.gyro_scale_correction.x = 1.01f;
+    tt_want(pbio_imu_persistent_settings_changed(&stored, &settings));
+}
+
+struct testcase_t pbio_imu_tests[] = {
+    PBIO_PT_THREAD_TEST(test_imu_batched_frames),
+    PBIO_PT_THREAD_TEST(test_imu_record),
+    PBIO_PT_THREAD_TEST(test_imu_online_bias),
+    PBIO_PT_THREAD_TEST(test_imu_calibrate_scale),
+    PBIO_TEST(test_imu_persistent_settings),
+    END_OF_TESTCASES
+};
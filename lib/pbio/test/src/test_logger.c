@@ -0,0 +1,178 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2023 The Pybricks Authors
+
+#include <stdint.h>
+
+#include <tinytest.h>
+#include <tinytest_macros.h>
+
+#include <pbio/error.h>
+#include <pbio/logger.h>
+#include <test-pbio.h>
+
+#define NUM_VALUES (2)
+#define NUM_COLS (NUM_VALUES + PBIO_LOGGER_NUM_DEFAULT_COLS)
+#define NUM_ROWS (4)
+
+// Fake stream that accepts a limited number of rows before it is full.
+static uint32_t stream_rows_accepted;
+static uint32_t stream_rows_free;
+static int32_t stream_last_value;
+
+static pbio_error_t test_stream(void *context, const int32_t *row_data, uint8_t num_cols) {
+    tt_want_int_op(num_cols, ==, NUM_COLS);
+    tt_want(context == &stream_rows_accepted);
+
+    if (stream_rows_free == 0) {
+        return PBIO_ERROR_AGAIN;
+    }
+    stream_rows_free--;
+    stream_rows_accepted++;
+
+    // Rows must arrive in the order they were logged.
+    tt_want_int_op(row_data[PBIO_LOGGER_NUM_DEFAULT_COLS], ==, stream_last_value + 1);
+    stream_last_value = row_data[PBIO_LOGGER_NUM_DEFAULT_COLS];
+
+    return PBIO_SUCCESS;
+}
+
+static void test_logger_record(void *env) {
+    static int32_t buf[NUM_ROWS * NUM_COLS];
+    pbio_log_t log;
+
+    pbio_logger_start(&log, buf, NUM_ROWS, NUM_COLS, 2);
+    tt_want(pbio_logger_is_active(&log));
+
+    // Only every second row is logged, until the log is full.
+    for (int32_t i = 0; i < NUM_ROWS * 2 + 2; i++) {
+        int32_t row[NUM_VALUES] = { i, -i };
+        if (pbio_logger_is_active(&log)) {
+            pbio_logger_add_row(&log, row);
+        }
+    }
+    tt_want(!pbio_logger_is_active(&log));
+    tt_want_uint_op(pbio_logger_get_num_rows_used(&log), ==, NUM_ROWS);
+    tt_want_int_op(pbio_logger_get_row_data(&log, 0)[1], ==, 1);
+    tt_want_int_op(pbio_logger_get_row_data(&log, 3)[2], ==, -7);
+
+    // A recording log can't be flushed.
+    tt_want_int_op(pbio_logger_stream_flush(&log), ==, PBIO_ERROR_INVALID_OP);
+}
+
+static void test_logger_stream(void *env) {
+    static int32_t buf[NUM_ROWS * NUM_COLS];
+    pbio_log_t log;
+
+    stream_rows_accepted = 0;
+    stream_rows_free = 0;
+    stream_last_value = -1;
+
+    pbio_logger_start_stream(&log, buf, NUM_ROWS, NUM_COLS, 1, test_stream, &stream_rows_accepted);
+
+    // Stream is busy, so rows are buffered until the buffer is full.
+    int32_t value = 0;
+    for (; value < NUM_ROWS + 3; value++) {
+        int32_t row[NUM_VALUES] = { value, 0 };
+        pbio_logger_add_row(&log, row);
+    }
+    tt_want(pbio_logger_is_active(&log));
+    tt_want_uint_op(pbio_logger_get_num_rows_used(&log), ==, NUM_ROWS);
+    tt_want_uint_op(pbio_logger_get_num_rows_dropped(&log), ==, 3);
+    tt_want_uint_op(pbio_logger_get_num_rows_sent(&log), ==, 0);
+
+    // Partially drain the buffer.
+    stream_rows_free = 2;
+    tt_want_int_op(pbio_logger_stream_flush(&log), ==, PBIO_ERROR_AGAIN);
+    tt_want_uint_op(pbio_logger_get_num_rows_used(&log), ==, NUM_ROWS - 2);
+    tt_want_uint_op(pbio_logger_get_num_rows_sent(&log), ==, 2);
+
+    // Oldest unsent row is now at index 0.
+    tt_want_int_op(pbio_logger_get_row_data(&log, 0)[1], ==, 2);
+
+    // Dropped rows were never buffered, so the stream continues at the
+    // first row that was logged after the buffer had room again.
+    stream_rows_free = 100;
+    tt_want_int_op(pbio_logger_stream_flush(&log), ==, PBIO_SUCCESS);
+    tt_want_uint_op(pbio_logger_get_num_rows_sent(&log), ==, NUM_ROWS);
+    stream_last_value = value - 1;
+
+    // With a fast enough stream, the buffer wraps around without loss.
+    for (; value < 50; value++) {
+        int32_t row[NUM_VALUES] = { value, 0 };
+        pbio_logger_add_row(&log, row);
+        tt_want_uint_op(pbio_logger_get_num_rows_used(&log), ==, 0);
+    }
+    tt_want_uint_op(pbio_logger_get_num_rows_dropped(&log), ==, 3);
+    tt_want_uint_op(pbio_logger_get_num_rows_sent(&log), ==, stream_rows_accepted);
+
+    pbio_logger_stop(&log);
+    tt_want(!pbio_logger_is_active(&log));
+}
+
+static void test_logger_compact(void *env) {
+    static int32_t buf[256];
+    pbio_log_t log;
+
+    tt_want_int_op(pbio_logger_start_compact(&log, buf, sizeof(buf), PBIO_LOGGER_COMPACT_MAX_COLS + 1, 1), ==, PBIO_ERROR_INVALID_ARG);
+    tt_want_int_op(pbio_logger_start_compact(&log, buf, sizeof(buf), NUM_COLS, 1), ==, PBIO_SUCCESS);
+
+    // Slowly changing values with some large ones and some sign changes,
+    // like a motor that accelerates and then reverses.
+    int32_t expected[100][NUM_VALUES];
+    for (int32_t i = 0; i < 100; i++) {
+        expected[i][0] = 1000000 + i * i;
+        expected[i][1] = i < 50 ? -i * 3 : INT32_MAX - i;
+        pbio_logger_add_row(&log, expected[i]);
+    }
+
+    // Everything fits, taking much less space than full rows.
+    tt_want_uint_op(pbio_logger_get_num_rows_used(&log), ==, 100);
+    uint32_t size;
+    const uint8_t *data = pbio_logger_get_compact_data(&log, &size);
+    tt_want(data == (uint8_t *)&buf[NUM_COLS]);
+    tt_want_uint_op(size, <, 100 * NUM_COLS * sizeof(int32_t) / 3);
+
+    uint8_t header[PBIO_LOGGER_COMPACT_HEADER_SIZE];
+    pbio_logger_get_compact_header(&log, header);
+    tt_want_int_op(header[0], ==, 'P');
+    tt_want_int_op(header[3], ==, PBIO_LOGGER_COMPACT_VERSION);
+    tt_want_int_op(header[4], ==, NUM_COLS);
+    tt_want_int_op(header[5], ==, PBIO_LOGGER_COMPACT_KEYFRAME_INTERVAL);
+
+    // Decoding gives back the original values.
+    int32_t row[NUM_COLS] = { 0 };
+    uint32_t offset = 0;
+    int32_t time_prev = 0;
+    for (uint32_t i = 0; i < 100; i++) {
+        uint32_t row_size = pbio_logger_compact_decode_row(data + offset, size - offset, i, NUM_COLS, row);
+        tt_want_uint_op(row_size, >, 0);
+        offset += row_size;
+        tt_want_int_op(row[0], >=, time_prev);
+        time_prev = row[0];
+        tt_want_int_op(row[1], ==, expected[i][0]);
+        tt_want_int_op(row[2], ==, expected[i][1]);
+    }
+    tt_want_uint_op(offset, ==, size);
+
+    // Incomplete data is detected.
+    tt_want_uint_op(pbio_logger_compact_decode_row(data, 2, 0, NUM_COLS, row), ==, 0);
+
+    // The buffer must at least hold the previous row.
+    tt_want_int_op(pbio_logger_start_compact(&log, buf, NUM_COLS * sizeof(int32_t) - 1, NUM_COLS, 1), ==, PBIO_ERROR_INVALID_ARG);
+
+    // Logging stops when the buffer is full.
+    tt_want_int_op(pbio_logger_start_compact(&log, buf, NUM_COLS * sizeof(int32_t) + 20, NUM_COLS, 1), ==, PBIO_SUCCESS);
+    for (int32_t i = 0; i < 100 && pbio_logger_is_active(&log); i++) {
+        pbio_logger_add_row(&log, expected[i]);
+    }
+    tt_want(!pbio_logger_is_active(&log));
+    pbio_logger_get_compact_data(&log, &size);
+    tt_want_uint_op(size, <=, 20);
+}
+
+struct testcase_t pbio_logger_tests[] = {
+    PBIO_TEST(test_logger_record),
+    PBIO_TEST(test_logger_stream),
+    PBIO_TEST(test_logger_compact),
+    END_OF_TESTCASES
+};
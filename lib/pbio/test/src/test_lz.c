@@ -0,0 +1,147 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2023 The Pybricks Authors
+
+#include <stdint.h>
+#include <string.h>
+
+#include <pbio/error.h>
+#include <pbio/lz.h>
+#include <pbio/util.h>
+#include <test-pbio.h>
+
+#include <tinytest.h>
+#include <tinytest_macros.h>
+
+// "abcabcabcabcX" as one literal run, a match that overlaps itself and
+// another literal.
+static const uint8_t test_stream[] = {
+    0x02, 'a', 'b', 'c',
+    0x80 | (9 - PBIO_LZ_MIN_MATCH), 0x03, 0x00,
+    0x00, 'X',
+};
+
+static const char test_decoded[] = "abcabcabcabcX";
+
+static void test_lz_decode(void *env) {
+    pbio_lz_decoder_t decoder;
+    uint8_t out[32];
+
+    // Whole stream at once.
+    pbio_lz_decoder_init(&decoder, out, sizeof(out));
+    tt_want_uint_op(pbio_lz_decoder_write(&decoder, test_stream, sizeof(test_stream)), ==, PBIO_SUCCESS);
+    tt_want(pbio_lz_decoder_is_complete(&decoder));
+    tt_want_uint_op(decoder.size, ==, strlen(test_decoded));
+    tt_want_int_op(memcmp(out, test_decoded, strlen(test_decoded)), ==, 0);
+
+    // One byte at a time, so every token is split.
+    memset(out, 0, sizeof(out));
+    pbio_lz_decoder_init(&decoder, out, sizeof(out));
+    for (uint32_t i = 0; i < sizeof(test_stream); i++) {
+        tt_want_uint_op(pbio_lz_decoder_write(&decoder, &test_stream[i], 1), ==, PBIO_SUCCESS);
+        tt_want(pbio_lz_decoder_is_complete(&decoder) == (i == 3 || i == 6 || i == 8));
+    }
+    tt_want_uint_op(decoder.size, ==, strlen(test_decoded));
+    tt_want_int_op(memcmp(out, test_decoded, strlen(test_decoded)), ==, 0);
+}
+
+static void test_lz_invalid(void *env) {
+    pbio_lz_decoder_t decoder;
+    uint8_t out[32];
+
+    // A match can't refer to data before the start.
+    static const uint8_t too_far[] = { 0x00, 'a', 0x80, 0x02, 0x00 };
+    pbio_lz_decoder_init(&decoder, out, sizeof(out));
+    tt_want_uint_op(pbio_lz_decoder_write(&decoder, too_far, sizeof(too_far)), ==, PBIO_ERROR_INVALID_ARG);
+
+    static const uint8_t zero_distance[] = { 0x00, 'a', 0x80, 0x00, 0x00 };
+    pbio_lz_decoder_init(&decoder, out, sizeof(out));
+    tt_want_uint_op(pbio_lz_decoder_write(&decoder, zero_distance, sizeof(zero_distance)), ==, PBIO_ERROR_INVALID_ARG);
+
+    // Output must fit, both for literals and matches.
+    pbio_lz_decoder_init(&decoder, out, 3);
+    tt_want_uint_op(pbio_lz_decoder_write(&decoder, test_stream, sizeof(test_stream)), ==, PBIO_ERROR_INVALID_ARG);
+    pbio_lz_decoder_init(&decoder, out, 2);
+    tt_want_uint_op(pbio_lz_decoder_write(&decoder, test_stream, sizeof(test_stream)), ==, PBIO_ERROR_INVALID_ARG);
+}
+
+// Greedy encoder that mirrors what the host does, to test larger inputs.
+static uint32_t test_lz_encode(uint8_t *dst, const uint8_t *src, uint32_t size) {
+    uint32_t out = 0;
+    uint32_t literal_start = 0;
+    uint32_t i = 0;
+
+    while (i <= size) {
+        uint32_t best_len = 0;
+        uint32_t best_dist = 0;
+        for (uint32_t j = i > PBIO_LZ_MAX_DISTANCE ? i - PBIO_LZ_MAX_DISTANCE : 0; j < i; j++) {
+            uint32_t len = 0;
+            while (i + len < size && len < PBIO_LZ_MAX_MATCH && src[j + len] == src[i + len]) {
+                len++;
+            }
+            if (len > best_len) {
+                best_len = len;
+                best_dist = i - j;
+            }
+        }
+
+        // Flush pending literals before a match, when full, or at the end.
+        uint32_t literals = i - literal_start;
+        if (literals && (best_len >= PBIO_LZ_MIN_MATCH || literals == PBIO_LZ_MAX_LITERAL || i == size)) {
+            dst[out++] = literals - 1;
+            memcpy(&dst[out], &src[literal_start], literals);
+            out += literals;
+            literal_start = i;
+        }
+        if (i == size) {
+            break;
+        }
+
+        if (best_len >= PBIO_LZ_MIN_MATCH) {
+            dst[out++] = 0x80 | (best_len - PBIO_LZ_MIN_MATCH);
+            dst[out++] = best_dist;
+            dst[out++] = best_dist >> 8;
+            i += best_len;
+            literal_start = i;
+        } else {
+            i++;
+        }
+    }
+
+    return out;
+}
+
+static void test_lz_round_trip(void *env) {
+    static uint8_t input[2000];
+    static uint8_t compressed[sizeof(input) * 2];
+    static uint8_t out[sizeof(input)];
+
+    // Something that looks a bit like bytecode: repeated names and opcodes,
+    // mixed with some noise.
+    uint32_t seed = 1;
+    for (uint32_t i = 0; i < sizeof(input); i++) {
+        seed = seed * 1103515245 + 12345;
+        input[i] = (seed >> 16) % 32 ? "motor.run_target"[i % 16] : seed >> 24;
+    }
+
+    uint32_t compressed_size = test_lz_encode(compressed, input, sizeof(input));
+    tt_want_uint_op(compressed_size, <, sizeof(input) / 2);
+
+    // Decode in chunks of an awkward size.
+    pbio_lz_decoder_t decoder;
+    pbio_lz_decoder_init(&decoder, out, sizeof(out));
+    for (uint32_t i = 0; i < compressed_size; i += 19) {
+        uint32_t chunk = compressed_size - i < 19 ? compressed_size - i : 19;
+        tt_want_uint_op(pbio_lz_decoder_write(&decoder, &compressed[i], chunk), ==, PBIO_SUCCESS);
+    }
+    tt_want(pbio_lz_decoder_is_complete(&decoder));
+    tt_want_uint_op(decoder.size, ==, sizeof(input));
+    tt_want_int_op(memcmp(out, input, sizeof(input)), ==, 0);
+    tt_want_uint_op(pbio_crc32(out, decoder.size), ==, pbio_crc32(input, sizeof(input)));
+}
+
+struct testcase_t pbio_lz_tests[] = {
+    PBIO_TEST(test_lz_decode),
+    PBIO_TEST(test_lz_invalid),
+    PBIO_TEST(test_lz_round_trip),
+    END_OF_TESTCASES
+};
@@ -0,0 +1,75 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2023 The Pybricks Authors
+
+#include <stdint.h>
+
+#include <contiki.h>
+#include <tinytest.h>
+#include <tinytest_macros.h>
+
+#include <pbdrv/motor_driver.h>
+#include <pbio/motor_process.h>
+#include <test-pbio.h>
+
+#include "../drv/core.h"
+#include "../drv/clock/clock_test.h"
+#include "../drv/motor_driver/motor_driver_virtual_simulation.h"
+
+static PT_THREAD(test_motor_process_stats(struct pt *pt)) {
+
+    static struct timer timer;
+    static const pbio_motor_process_stats_t *stats;
+    static uint32_t count;
+
+    // Start motor driver simulation process.
+    pbdrv_motor_driver_init_manual();
+
+    PT_BEGIN(pt);
+
+    // Wait for motor simulation process to be ready.
+    while (pbdrv_init_busy()) {
+        PT_YIELD(pt);
+    }
+
+    // Start motor control process manually.
+    pbio_motor_process_start();
+
+    stats = pbio_motor_process_get_stats();
+    tt_want_uint_op(stats->stages[PBIO_MOTOR_PROCESS_STAGE_SERVO].count, ==, 0);
+
+    // Run the loop for a while.
+    pbio_test_sleep_ms(&timer, 100);
+
+    // Each stage runs once per loop. The test clock does not advance during
+    // the update, so all stages appear to take no time at all.
+    count = stats->stages[PBIO_MOTOR_PROCESS_STAGE_SERVO].count;
+    tt_want(pbio_test_int_is_close(count, 100 / PBIO_CONFIG_CONTROL_LOOP_TIME_MS, 1));
+    tt_want_uint_op(stats->stages[PBIO_MOTOR_PROCESS_STAGE_BATTERY].count, ==, count);
+    tt_want_uint_op(stats->stages[PBIO_MOTOR_PROCESS_STAGE_DRIVEBASE].count, ==, count);
+    tt_want_uint_op(stats->stages[PBIO_MOTOR_PROCESS_STAGE_SERVO].time_min, ==, 0);
+    tt_want_uint_op(stats->stages[PBIO_MOTOR_PROCESS_STAGE_SERVO].time_max, ==, 0);
+    tt_want_uint_op(pbio_motor_process_get_stage_time_mean(PBIO_MOTOR_PROCESS_STAGE_SERVO), ==, 0);
+
+    // All periods after the first one are exactly on time.
+    tt_want_uint_op(stats->jitter_histogram[0], ==, count - 1);
+    tt_want_uint_op(stats->overruns, ==, 0);
+
+    // Stall the loop for a few periods to trigger an overrun.
+    pbio_test_clock_tick(PBIO_CONFIG_CONTROL_LOOP_TIME_MS * 4);
+    PT_YIELD(pt);
+    tt_want_uint_op(stats->overruns, ==, 1);
+    tt_want_uint_op(stats->jitter_histogram[PBIO_MOTOR_PROCESS_STATS_JITTER_NUM_BINS - 1], ==, 1);
+
+    // Reset clears everything.
+    pbio_motor_process_reset_stats();
+    tt_want_uint_op(stats->overruns, ==, 0);
+    tt_want_uint_op(stats->stages[PBIO_MOTOR_PROCESS_STAGE_SERVO].count, ==, 0);
+    tt_want_uint_op(stats->jitter_histogram[0], ==, 0);
+
+    PT_END(pt);
+}
+
+struct testcase_t pbio_motor_process_tests[] = {
+    PBIO_PT_THREAD_TEST(test_motor_process_stats),
+    END_OF_TESTCASES
+};
@@ -0,0 +1,281 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2023 The Pybricks Authors
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#include <pbdrv/legodev.h>
+
+#include <pbio/control.h>
+#include <pbio/int_math.h>
+#include <pbio/observer.h>
+#include <pbio/servo.h>
+#include <pbio/util.h>
+
+#include <tinytest.h>
+#include <tinytest_macros.h>
+
+#include <test-pbio.h>
+
+#if PBIO_CONFIG_SERVO
+
+// Same as in observer.c, used to verify against the original division based
+// implementation.
+#define MAX_NUM_TORQUE (1000000)
+#define PRESCALE_SPEED (858)
+#define PRESCALE_ACCELERATION (85)
+#define PRESCALE_VOLTAGE (178956)
+#define PRESCALE_TORQUE (2147)
+
+// All motor types with a model, if enabled on this platform.
+static const pbdrv_legodev_type_id_t model_ids[] = {
+    PBDRV_LEGODEV_TYPE_ID_EV3_MEDIUM_MOTOR,
+    PBDRV_LEGODEV_TYPE_ID_EV3_LARGE_MOTOR,
+    PBDRV_LEGODEV_TYPE_ID_MOVE_HUB_MOTOR,
+    PBDRV_LEGODEV_TYPE_ID_INTERACTIVE_MOTOR,
+    PBDRV_LEGODEV_TYPE_ID_TECHNIC_L_MOTOR,
+    PBDRV_LEGODEV_TYPE_ID_TECHNIC_XL_MOTOR,
+    PBDRV_LEGODEV_TYPE_ID_SPIKE_S_MOTOR,
+    PBDRV_LEGODEV_TYPE_ID_TECHNIC_L_ANGULAR_MOTOR,
+    PBDRV_LEGODEV_TYPE_ID_TECHNIC_M_ANGULAR_MOTOR,
+};
+
+static pbio_control_settings_t test_control_settings = {
+    .ctl_steps_per_app_step = 1000,
+    .stall_speed_limit = 20000,
+    .stall_time = 2000,
+    .speed_max = 1000000,
+    .speed_default = 1000000,
+    .speed_tolerance = 50000,
+    .position_tolerance = 10000,
+    .acceleration = 2000000,
+    .deceleration = 2000000,
+    .actuation_max = 200000,
+    .actuation_max_temporary = 200000,
+    .pid_kp = 15000,
+    .pid_ki = 7500,
+    .pid_kd = 1800,
+    .pid_kp_low_pct = 50,
+    .pid_kp_low_error_threshold = 5000,
+    .pid_kp_low_speed_threshold = 250000,
+    .integral_deadzone = 8000,
+    .integral_change_max = 15000,
+    .smart_passive_hold_time = 1000,
+};
+
+static pbio_observer_settings_t test_observer_settings = {
+    .stall_speed_limit = 20000,
+    .stall_time = 2000,
+    .feedback_voltage_negligible = 500,
+    .feedback_voltage_stall_ratio = 75,
+    .feedback_gain_low = 150,
+    .feedback_gain_high = 1050,
+    .feedback_gain_threshold = 20000,
+    .coulomb_friction_speed_cutoff = 500,
+};
+
+/**
+ * Tests that the precomputed model gives the same result as dividing by the
+ * model constants for every model.
+ */
+static void test_observer_model_conversion(void *env) {
+
+    pbio_observer_t obs;
+    size_t num_models = 0;
+
+    for (size_t i = 0; i < PBIO_ARRAY_SIZE(model_ids); i++) {
+        const pbio_servo_settings_reduced_t *reduced = pbio_servo_get_reduced_settings(model_ids[i]);
+        if (!reduced) {
+            continue;
+        }
+        num_models++;
+
+        pbio_observer_set_model(&obs, reduced->model);
+        const pbio_observer_model_t *m = reduced->model;
+
+        for (int32_t voltage = -12000; voltage <= 12000; voltage += 100) {
+            int32_t expected = PRESCALE_VOLTAGE * voltage / m->d_torque_d_voltage;
+            tt_want_int_op(pbio_int_math_abs(pbio_observer_voltage_to_torque(&obs, voltage) - expected), <=, 1);
+        }
+
+        for (int32_t torque = -1000000; torque <= 1000000; torque += 5000) {
+            int32_t expected = PRESCALE_TORQUE * torque / m->d_voltage_d_torque;
+            tt_want_int_op(pbio_int_math_abs(pbio_observer_torque_to_voltage(&obs, torque) - expected), <=, 1);
+        }
+
+        for (int32_t speed = -2000000; speed <= 2000000; speed += 100000) {
+            for (int32_t acceleration = -20000000; acceleration <= 20000000; acceleration += 1000000) {
+                int32_t expected = pbio_int_math_clamp(
+                    m->torque_friction / 2 * pbio_int_math_sign(speed) +
+                    PRESCALE_SPEED * speed / m->d_torque_d_speed +
+                    PRESCALE_ACCELERATION * acceleration / m->d_torque_d_acceleration, MAX_NUM_TORQUE);
+                int32_t actual = pbio_observer_get_feedforward_torque(&obs, speed, acceleration);
+                tt_want_int_op(pbio_int_math_abs(actual - expected), <=, 2);
+            }
+        }
+    }
+
+    // At least one model should be enabled when servos are enabled.
+    tt_want(num_models > 0);
+}
+
+/**
+ * Measures the time spent in each part of the control loop for each model.
+ *
+ * The timing is only indicative of relative cost on the host. Run with
+ * --verbose to see the results.
+ */
+static void test_observer_control_loop_benchmark(void *env) {
+
+    const uint32_t increment = PBIO_CONFIG_CONTROL_LOOP_TIME_MS * PBIO_TRAJECTORY_TICKS_PER_MS;
+    const int num_loops = 20000;
+
+    pbio_observer_t obs;
+    pbio_control_t ctl;
+
+    for (size_t i = 0; i < PBIO_ARRAY_SIZE(model_ids); i++) {
+        const pbio_servo_settings_reduced_t *reduced = pbio_servo_get_reduced_settings(model_ids[i]);
+        if (!reduced) {
+            continue;
+        }
+
+        pbio_angle_t angle = { 0 };
+        pbio_observer_set_model(&obs, reduced->model);
+        obs.settings = test_observer_settings;
+        pbio_observer_reset(&obs, &angle);
+
+        pbio_control_reset(&ctl);
+        ctl.settings = test_control_settings;
+
+        pbio_control_state_t state = { 0 };
+        pbio_trajectory_reference_t ref;
+        pbio_dcmotor_actuation_t actuation;
+        int32_t control = 0;
+        bool external_pause = false;
+        int64_t checksum = 0;
+
+        // Observer update, fed with its own estimate as the measured angle.
+        clock_t start = clock();
+        for (int n = 0; n < num_loops; n++) {
+            angle = obs.angle;
+            pbio_observer_update(&obs, n * increment, &angle, PBIO_DCMOTOR_ACTUATION_VOLTAGE, 3000);
+            checksum += obs.speed;
+        }
+        clock_t elapsed_observer = clock() - start;
+
+        // Feedforward torque and conversion to voltage.
+        start = clock();
+        for (int n = 0; n < num_loops; n++) {
+            int32_t torque = pbio_observer_get_feedforward_torque(&obs, n * 50, 1000000);
+            checksum += pbio_observer_torque_to_voltage(&obs, torque);
+        }
+        clock_t elapsed_feedforward = clock() - start;
+
+        // Full controller update while following a trajectory, including
+        // reference evaluation and integrators.
+        tt_want_int_op(pbio_control_start_position_control(&ctl, 0, &state, 360000, 500000, PBIO_CONTROL_ON_COMPLETION_HOLD), ==, PBIO_SUCCESS);
+        start = clock();
+        for (int n = 0; n < num_loops; n++) {
+            pbio_control_update(&ctl, n * increment, &state, &ref, &actuation, &control, &external_pause);
+            checksum += control;
+        }
+        clock_t elapsed_control = clock() - start;
+
+        // Integrators on their own.
+        pbio_position_integrator_reset(&ctl.position_integrator, &ctl.settings, 0);
+        pbio_speed_integrator_reset(&ctl.speed_integrator, &ctl.settings);
+        start = clock();
+        for (int n = 0; n < num_loops; n++) {
+            checksum += pbio_position_integrator_update(&ctl.position_integrator, n % 10000, 10000);
+            checksum += pbio_speed_integrator_get_error(&ctl.speed_integrator, n % 10000);
+        }
+        clock_t elapsed_integrators = clock() - start;
+
+        TT_BLATHER(("Motor %d, %d loops: observer %ld, feedforward %ld, control %ld, integrators %ld ticks (%lld)",
+            model_ids[i], num_loops, (long)elapsed_observer, (long)elapsed_feedforward,
+            (long)elapsed_control, (long)elapsed_integrators, (long long)checksum));
+
+        // The observer must remain stable without feedback errors.
+        tt_want_int_op(pbio_int_math_abs(obs.speed), <, 2500000);
+    }
+}
+
+#if PBIO_CONFIG_CONTROL_LOOP_TIME_ADJUSTABLE
+
+/**
+ * Runs the observer with a constant voltage, feeding it its own estimate so
+ * there is no feedback. It starts with a small speed so that friction applies
+ * from the first step, which would otherwise last longer for longer steps.
+ *
+ * @param [in]  obs            The observer instance.
+ * @param [in]  model          The model to use.
+ * @param [in]  loop_time      Loop time in ms.
+ * @param [in]  duration       Duration in ms.
+ */
+static void run_observer(pbio_observer_t *obs, const pbio_observer_model_t *model, uint32_t loop_time, uint32_t duration) {
+    pbio_control_settings_set_loop_time(loop_time);
+
+    pbio_angle_t angle = { 0 };
+    pbio_observer_set_model(obs, model);
+    obs->settings = test_observer_settings;
+    pbio_observer_reset(obs, &angle);
+    obs->speed = 10000;
+
+    for (uint32_t time = 0; time < duration; time += loop_time) {
+        angle = obs->angle;
+        pbio_observer_update(obs, time * PBIO_TRAJECTORY_TICKS_PER_MS, &angle, PBIO_DCMOTOR_ACTUATION_VOLTAGE, 6000);
+    }
+}
+
+/**
+ * Tests that the model gives the same response at every loop time.
+ */
+static void test_observer_loop_time(void *env) {
+
+    static const uint32_t loop_times[] = { 2, 4, 10 };
+
+    pbio_observer_t obs;
+
+    for (size_t i = 0; i < PBIO_ARRAY_SIZE(model_ids); i++) {
+        // The EV3 models are made for a 10 ms step, not the default.
+        const pbio_servo_settings_reduced_t *reduced = pbio_servo_get_reduced_settings(model_ids[i]);
+        if (!reduced || model_ids[i] == PBDRV_LEGODEV_TYPE_ID_EV3_MEDIUM_MOTOR || model_ids[i] == PBDRV_LEGODEV_TYPE_ID_EV3_LARGE_MOTOR) {
+            continue;
+        }
+
+        // Response at the default loop time, for which the model was made.
+        // The speed is still rising after 20 ms, and settled after 200 ms.
+        for (uint32_t duration = 20; duration <= 200; duration += 180) {
+            run_observer(&obs, reduced->model, PBIO_CONFIG_CONTROL_LOOP_TIME_MS, duration);
+            int32_t expected_angle = pbio_angle_to_low_res(&obs.angle, 1);
+            int32_t expected_speed = obs.speed;
+
+            for (size_t j = 0; j < PBIO_ARRAY_SIZE(loop_times); j++) {
+                run_observer(&obs, reduced->model, loop_times[j], duration);
+                TT_BLATHER(("Motor %d, %d ms loop, %d ms: angle %d (%d), speed %d (%d)",
+                    model_ids[i], (int)loop_times[j], (int)duration,
+                    (int)pbio_angle_to_low_res(&obs.angle, 1), (int)expected_angle, (int)obs.speed, (int)expected_speed));
+                tt_want(pbio_test_int_is_close(obs.speed, expected_speed, pbio_int_math_abs(expected_speed) / 100));
+                tt_want(pbio_test_int_is_close(pbio_angle_to_low_res(&obs.angle, 1), expected_angle, pbio_int_math_abs(expected_angle) / 100 + 10));
+            }
+        }
+    }
+
+    pbio_control_settings_set_loop_time(PBIO_CONFIG_CONTROL_LOOP_TIME_MS);
+}
+
+#endif // PBIO_CONFIG_CONTROL_LOOP_TIME_ADJUSTABLE
+
+#endif // PBIO_CONFIG_SERVO
+
+struct testcase_t pbio_observer_tests[] = {
+    #if PBIO_CONFIG_SERVO
+    PBIO_TEST(test_observer_model_conversion),
+    PBIO_TEST(test_observer_control_loop_benchmark),
+    #if PBIO_CONFIG_CONTROL_LOOP_TIME_ADJUSTABLE
+    PBIO_TEST(test_observer_loop_time),
+    #endif
+    #endif
+    END_OF_TESTCASES
+};
@@ -20,9 +20,11 @@
 #include <pbio/control.h>
 #include <pbio/error.h>
 #include <pbio/logger.h>
+#include <pbio/main.h>
 #include <pbio/int_math.h>
 #include <pbio/motor_process.h>
 #include <pbio/servo.h>
+#include <pbio/util.h>
 #include <test-pbio.h>
 
 #include "../src/processes.h"
@@ -219,9 +221,322 @@ end:
     PT_END(pt);
 }
 
+#if PBIO_CONFIG_CONTROL_QUEUE_SIZE
+static PT_THREAD(test_servo_queue(struct pt *pt)) {
+
+    static struct timer timer;
+    static pbio_servo_t *srv;
+    static pbdrv_legodev_dev_t *legodev;
+    static int32_t angle;
+    static int32_t speed;
+    static uint32_t time_start;
+
+    // Start motor driver simulation process.
+    pbdrv_motor_driver_init_manual();
+
+    PT_BEGIN(pt);
+
+    // Wait for motor simulation process to be ready.
+    while (pbdrv_init_busy()) {
+        PT_YIELD(pt);
+    }
+
+    // Start motor control process manually.
+    pbio_motor_process_start();
+
+    pbdrv_legodev_type_id_t id = PBDRV_LEGODEV_TYPE_ID_ANY_ENCODED_MOTOR;
+    tt_uint_op(pbdrv_legodev_get_device(PBIO_PORT_ID_B, &id, &legodev), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_servo_get_servo(legodev, &srv), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_servo_setup(srv, id, PBIO_DIRECTION_CLOCKWISE, 1000, true, 0), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_servo_reset_angle(srv, 0, false), ==, PBIO_SUCCESS);
+
+    // Nothing is ongoing, so the first one starts right away.
+    tt_uint_op(pbio_servo_queue_target(srv, 500, 90, PBIO_CONTROL_ON_COMPLETION_HOLD), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_control_queue_get_size(&srv->control), ==, 0);
+    time_start = pbio_control_get_time_ticks();
+
+    // Queue more targets in the same direction, until the queue is full.
+    tt_uint_op(pbio_servo_queue_target(srv, 500, 180, PBIO_CONTROL_ON_COMPLETION_HOLD), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_servo_queue_target(srv, 500, 270, PBIO_CONTROL_ON_COMPLETION_HOLD), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_servo_queue_target(srv, 500, 360, PBIO_CONTROL_ON_COMPLETION_HOLD), ==, PBIO_SUCCESS);
+    for (int i = 3; i < PBIO_CONFIG_CONTROL_QUEUE_SIZE; i++) {
+        tt_uint_op(pbio_servo_queue_target(srv, 500, 360, PBIO_CONTROL_ON_COMPLETION_HOLD), ==, PBIO_SUCCESS);
+    }
+    tt_uint_op(pbio_servo_queue_target(srv, 500, 360, PBIO_CONTROL_ON_COMPLETION_HOLD), ==, PBIO_ERROR_BUSY);
+
+    // Intermediate targets are passed without stopping.
+    pbio_test_sleep_until(pbio_servo_get_state_user(srv, &angle, &speed) == PBIO_SUCCESS && angle >= 90);
+    tt_want_int_op(speed, >, 400);
+    tt_want(!pbio_control_is_done(&srv->control));
+    pbio_test_sleep_until(pbio_servo_get_state_user(srv, &angle, &speed) == PBIO_SUCCESS && angle >= 180);
+    tt_want_int_op(speed, >, 400);
+
+    // Final target is reached in one smooth run, much faster than four
+    // separate runs that each accelerate and decelerate.
+    pbio_test_sleep_until(pbio_control_is_done(&srv->control));
+    tt_uint_op(pbio_servo_get_state_user(srv, &angle, &speed), ==, PBIO_SUCCESS);
+    tt_want(pbio_test_int_is_close(angle, 360, 5));
+    tt_want_uint_op(pbio_control_queue_get_size(&srv->control), ==, 0);
+    tt_want_uint_op(pbio_control_get_time_ticks() - time_start, <, 1300 * PBIO_TRAJECTORY_TICKS_PER_MS);
+
+    // A reversal stops at the intermediate target before going back.
+    tt_uint_op(pbio_servo_queue_target(srv, 500, 450, PBIO_CONTROL_ON_COMPLETION_HOLD), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_servo_queue_target(srv, 500, 400, PBIO_CONTROL_ON_COMPLETION_HOLD), ==, PBIO_SUCCESS);
+    pbio_test_sleep_until(pbio_servo_get_state_user(srv, &angle, &speed) == PBIO_SUCCESS && speed < 0);
+    tt_want(pbio_test_int_is_close(angle, 450, 5));
+    pbio_test_sleep_until(pbio_control_is_done(&srv->control));
+    tt_uint_op(pbio_servo_get_state_user(srv, &angle, &speed), ==, PBIO_SUCCESS);
+    tt_want(pbio_test_int_is_close(angle, 400, 5));
+
+    // A regular command discards the queue.
+    tt_uint_op(pbio_servo_queue_target(srv, 500, 500, PBIO_CONTROL_ON_COMPLETION_HOLD), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_servo_queue_target(srv, 500, 600, PBIO_CONTROL_ON_COMPLETION_HOLD), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_control_queue_get_size(&srv->control), ==, 1);
+    tt_uint_op(pbio_servo_run_target(srv, 500, 300, PBIO_CONTROL_ON_COMPLETION_HOLD), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_control_queue_get_size(&srv->control), ==, 0);
+    pbio_test_sleep_until(pbio_control_is_done(&srv->control));
+    tt_uint_op(pbio_servo_get_state_user(srv, &angle, &speed), ==, PBIO_SUCCESS);
+    tt_want(pbio_test_int_is_close(angle, 300, 5));
+    pbio_test_sleep_ms(&timer, 100);
+
+end:
+
+    PT_END(pt);
+}
+#endif // PBIO_CONFIG_CONTROL_QUEUE_SIZE
+
+static PT_THREAD(test_servo_synchronized(struct pt *pt)) {
+
+    static struct timer timer;
+    static pbio_servo_t *srv[3];
+    static const pbio_port_id_t ports[] = { PBIO_PORT_ID_A, PBIO_PORT_ID_E, PBIO_PORT_ID_F };
+    static const int32_t targets[] = { -360, 90, 180 };
+    static uint32_t time_first_done;
+    static int32_t angle;
+    static int32_t speed;
+
+    // Start motor driver simulation process.
+    pbdrv_motor_driver_init_manual();
+
+    PT_BEGIN(pt);
+
+    // Wait for motor simulation process to be ready.
+    while (pbdrv_init_busy()) {
+        PT_YIELD(pt);
+    }
+
+    // Start motor control process manually.
+    pbio_motor_process_start();
+
+    for (uint8_t i = 0; i < PBIO_ARRAY_SIZE(srv); i++) {
+        pbdrv_legodev_dev_t *legodev;
+        pbdrv_legodev_type_id_t id = PBDRV_LEGODEV_TYPE_ID_ANY_ENCODED_MOTOR;
+        tt_uint_op(pbdrv_legodev_get_device(ports[i], &id, &legodev), ==, PBIO_SUCCESS);
+        tt_uint_op(pbio_servo_get_servo(legodev, &srv[i]), ==, PBIO_SUCCESS);
+        tt_uint_op(pbio_servo_setup(srv[i], id, PBIO_DIRECTION_CLOCKWISE, 1000, true, 0), ==, PBIO_SUCCESS);
+        tt_uint_op(pbio_servo_reset_angle(srv[i], 0, false), ==, PBIO_SUCCESS);
+    }
+
+    // Each servo can be given only one target.
+    pbio_servo_t *duplicate[] = { srv[0], srv[1], srv[0] };
+    tt_uint_op(pbio_servo_run_target_synchronized(duplicate, 3, 500, targets, PBIO_CONTROL_ON_COMPLETION_HOLD), ==, PBIO_ERROR_INVALID_ARG);
+
+    // All trajectories take as long as the longest one.
+    tt_uint_op(pbio_servo_run_target_synchronized(srv, 3, 500, targets, PBIO_CONTROL_ON_COMPLETION_HOLD), ==, PBIO_SUCCESS);
+    for (uint8_t i = 0; i < PBIO_ARRAY_SIZE(srv); i++) {
+        tt_want_int_op(srv[i]->control.trajectory.start.time, ==, srv[0]->control.trajectory.start.time);
+        tt_want_int_op(pbio_trajectory_get_duration(&srv[i]->control.trajectory), ==,
+            pbio_trajectory_get_duration(&srv[0]->control.trajectory));
+    }
+
+    // Only the longest one runs at full speed.
+    pbio_test_sleep_ms(&timer, 500);
+    tt_uint_op(pbio_servo_get_state_user(srv[0], &angle, &speed), ==, PBIO_SUCCESS);
+    tt_want(pbio_test_int_is_close(speed, -500, 50));
+    tt_uint_op(pbio_servo_get_state_user(srv[1], &angle, &speed), ==, PBIO_SUCCESS);
+    tt_want_int_op(speed, <, 200);
+
+    // All servos complete at about the same time.
+    pbio_test_sleep_until(pbio_control_is_done(&srv[0]->control) ||
+        pbio_control_is_done(&srv[1]->control) ||
+        pbio_control_is_done(&srv[2]->control));
+    time_first_done = pbio_control_get_time_ticks();
+    pbio_test_sleep_until(pbio_control_is_done(&srv[0]->control) &&
+        pbio_control_is_done(&srv[1]->control) &&
+        pbio_control_is_done(&srv[2]->control));
+    tt_want_uint_op(pbio_control_get_time_ticks() - time_first_done, <, 100 * PBIO_TRAJECTORY_TICKS_PER_MS);
+
+    for (uint8_t i = 0; i < PBIO_ARRAY_SIZE(srv); i++) {
+        tt_uint_op(pbio_servo_get_state_user(srv[i], &angle, &speed), ==, PBIO_SUCCESS);
+        tt_want(pbio_test_int_is_close(angle, targets[i], 5));
+    }
+    pbio_test_sleep_ms(&timer, 100);
+
+    // If one target can't be reached, none of the servos are left running.
+    static const int32_t targets_too_far[] = { 90, 90, 3000000 };
+    tt_uint_op(pbio_servo_run_target_synchronized(srv, 3, 500, targets_too_far, PBIO_CONTROL_ON_COMPLETION_HOLD), ==, PBIO_ERROR_INVALID_ARG);
+    for (uint8_t i = 0; i < PBIO_ARRAY_SIZE(srv); i++) {
+        tt_want(!pbio_control_is_active(&srv[i]->control));
+    }
+
+end:
+
+    PT_END(pt);
+}
+
+static PT_THREAD(test_servo_passive(struct pt *pt)) {
+
+    static struct timer timer;
+    static pbio_servo_t *srv;
+    static pbio_servo_t *srv_idle;
+    static pbdrv_legodev_dev_t *legodev;
+    static pbio_control_state_t state;
+    static int32_t angle;
+    static int32_t speed;
+
+    // Start motor driver simulation process.
+    pbdrv_motor_driver_init_manual();
+
+    PT_BEGIN(pt);
+
+    // Wait for motor simulation process to be ready.
+    while (pbdrv_init_busy()) {
+        PT_YIELD(pt);
+    }
+
+    // Start motor control process manually.
+    pbio_motor_process_start();
+
+    pbdrv_legodev_type_id_t id = PBDRV_LEGODEV_TYPE_ID_ANY_ENCODED_MOTOR;
+    tt_uint_op(pbdrv_legodev_get_device(PBIO_PORT_ID_A, &id, &legodev), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_servo_get_servo(legodev, &srv), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_servo_setup(srv, id, PBIO_DIRECTION_CLOCKWISE, 1000, true, 0), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_servo_reset_angle(srv, 0, false), ==, PBIO_SUCCESS);
+
+    id = PBDRV_LEGODEV_TYPE_ID_ANY_ENCODED_MOTOR;
+    tt_uint_op(pbdrv_legodev_get_device(PBIO_PORT_ID_B, &id, &legodev), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_servo_get_servo(legodev, &srv_idle), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_servo_setup(srv_idle, id, PBIO_DIRECTION_CLOCKWISE, 1000, true, 0), ==, PBIO_SUCCESS);
+
+    // Run one motor while the other stays idle.
+    tt_uint_op(pbio_servo_run_forever(srv, 500), ==, PBIO_SUCCESS);
+    pbio_test_sleep_ms(&timer, 500);
+    tt_uint_op(pbio_servo_get_state_user(srv, &angle, &speed), ==, PBIO_SUCCESS);
+    tt_want(pbio_test_int_is_close(speed, 500, 50));
+
+    // The idle motor estimate follows the measured state.
+    tt_uint_op(pbio_servo_get_state_control(srv_idle, &state), ==, PBIO_SUCCESS);
+    tt_want_int_op(pbio_angle_diff_mdeg(&state.position_estimate, &state.position), ==, 0);
+    tt_want_int_op(state.speed_estimate, ==, 0);
+
+    // Coasting while moving, the estimate keeps following the motor, up to
+    // the movement since the last update.
+    tt_uint_op(pbio_servo_stop(srv, PBIO_CONTROL_ON_COMPLETION_COAST), ==, PBIO_SUCCESS);
+    pbio_test_sleep_ms(&timer, 20);
+    tt_uint_op(pbio_servo_get_state_control(srv, &state), ==, PBIO_SUCCESS);
+    tt_want(pbio_test_int_is_close(pbio_angle_diff_mdeg(&state.position_estimate, &state.position), 0, 5000));
+    tt_want_int_op(state.speed_estimate, ==, state.speed);
+    tt_want_int_op(state.speed, >, 0);
+
+    // Control resumes from the passive state as usual.
+    pbio_test_sleep_ms(&timer, 500);
+    tt_uint_op(pbio_servo_run_target(srv, 500, 0, PBIO_CONTROL_ON_COMPLETION_HOLD), ==, PBIO_SUCCESS);
+    pbio_test_sleep_until(pbio_control_is_done(&srv->control));
+    tt_uint_op(pbio_servo_get_state_user(srv, &angle, &speed), ==, PBIO_SUCCESS);
+    tt_want(pbio_test_int_is_close(angle, 0, 5));
+
+    // Both motors are still updated.
+    tt_want(pbio_servo_update_loop_is_running(srv));
+    tt_want(pbio_servo_update_loop_is_running(srv_idle));
+
+end:
+
+    PT_END(pt);
+}
+
+#if PBIO_CONFIG_CONTROL_LOOP_TIME_ADJUSTABLE
+static PT_THREAD(test_servo_loop_time(struct pt *pt)) {
+
+    static struct timer timer;
+    static pbio_servo_t *srv;
+    static const uint32_t loop_times[] = { PBIO_CONFIG_CONTROL_LOOP_TIME_MIN_MS, 4, 10, PBIO_CONFIG_CONTROL_LOOP_TIME_MS };
+    static uint8_t i;
+    static int32_t start_angle;
+    static int32_t angle;
+    static int32_t speed;
+    static pbio_control_state_t state;
+
+    // Start motor driver simulation process.
+    pbdrv_motor_driver_init_manual();
+
+    PT_BEGIN(pt);
+
+    // Only loop times in range that divide the speed window are allowed.
+    tt_want_uint_op(pbio_control_settings_set_loop_time(1), ==, PBIO_ERROR_INVALID_ARG);
+    tt_want_uint_op(pbio_control_settings_set_loop_time(3), ==, PBIO_ERROR_INVALID_ARG);
+    tt_want_uint_op(pbio_control_settings_set_loop_time(20), ==, PBIO_ERROR_INVALID_ARG);
+    tt_want_uint_op(pbio_control_settings_get_loop_time(), ==, PBIO_CONFIG_CONTROL_LOOP_TIME_MS);
+
+    // Wait for motor simulation process to be ready.
+    while (pbdrv_init_busy()) {
+        PT_YIELD(pt);
+    }
+
+    // Start motor control process manually.
+    pbio_motor_process_start();
+
+    pbdrv_legodev_dev_t *legodev;
+    pbdrv_legodev_type_id_t id = PBDRV_LEGODEV_TYPE_ID_ANY_ENCODED_MOTOR;
+    tt_uint_op(pbdrv_legodev_get_device(PBIO_PORT_ID_A, &id, &legodev), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_servo_get_servo(legodev, &srv), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_servo_setup(srv, id, PBIO_DIRECTION_CLOCKWISE, 1000, true, 0), ==, PBIO_SUCCESS);
+
+    for (i = 0; i < PBIO_ARRAY_SIZE(loop_times); i++) {
+
+        // Change the loop time while the motor is idle, then run a maneuver.
+        tt_uint_op(pbio_control_settings_set_loop_time(loop_times[i]), ==, PBIO_SUCCESS);
+        pbio_test_sleep_ms(&timer, 100);
+        tt_uint_op(pbio_servo_get_state_user(srv, &start_angle, &speed), ==, PBIO_SUCCESS);
+        tt_uint_op(pbio_servo_run_angle(srv, 500, 360, PBIO_CONTROL_ON_COMPLETION_COAST), ==, PBIO_SUCCESS);
+
+        // Speed is tracked at any loop time, and the model keeps up.
+        pbio_test_sleep_ms(&timer, 600);
+        tt_uint_op(pbio_servo_get_state_user(srv, &angle, &speed), ==, PBIO_SUCCESS);
+        tt_want(pbio_test_int_is_close(speed, 500, 50));
+        tt_uint_op(pbio_servo_get_state_control(srv, &state), ==, PBIO_SUCCESS);
+        tt_want(pbio_test_int_is_close(state.speed_estimate, state.speed, 100000));
+
+        // Target is reached as usual.
+        pbio_test_sleep_until(pbio_control_is_done(&srv->control));
+        tt_uint_op(pbio_servo_get_state_user(srv, &angle, &speed), ==, PBIO_SUCCESS);
+        tt_want(pbio_test_int_is_close(angle, start_angle + 360, 10));
+
+        // Wait for the motor to coast to a stop.
+        pbio_test_sleep_ms(&timer, 500);
+    }
+
+    // The default loop time is restored when everything is reset.
+    tt_uint_op(pbio_control_settings_set_loop_time(10), ==, PBIO_SUCCESS);
+    pbio_stop_all(true);
+    tt_want_uint_op(pbio_control_settings_get_loop_time(), ==, PBIO_CONFIG_CONTROL_LOOP_TIME_MS);
+
+end:
+
+    PT_END(pt);
+}
+#endif // PBIO_CONFIG_CONTROL_LOOP_TIME_ADJUSTABLE
+
 struct testcase_t pbio_servo_tests[] = {
     PBIO_PT_THREAD_TEST(test_servo_basics),
     PBIO_PT_THREAD_TEST(test_servo_stall),
     PBIO_PT_THREAD_TEST(test_servo_gearing),
+    PBIO_PT_THREAD_TEST(test_servo_synchronized),
+    PBIO_PT_THREAD_TEST(test_servo_passive),
+    #if PBIO_CONFIG_CONTROL_QUEUE_SIZE
+    PBIO_PT_THREAD_TEST(test_servo_queue),
+    #endif
+    #if PBIO_CONFIG_CONTROL_LOOP_TIME_ADJUSTABLE
+    PBIO_PT_THREAD_TEST(test_servo_loop_time),
+    #endif
     END_OF_TESTCASES
 };
@@ -0,0 +1,99 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2023 The Pybricks Authors
+
+#include <stdint.h>
+
+#include <contiki.h>
+#include <tinytest.h>
+#include <tinytest_macros.h>
+
+#include <pbdrv/legodev.h>
+#include <pbio/error.h>
+#include <pbio/motor_process.h>
+#include <pbio/servo.h>
+#include <pbio/snapshot.h>
+#include <pbio/util.h>
+#include <test-pbio.h>
+
+#include "../drv/core.h"
+#include "../drv/clock/clock_test.h"
+#include "../drv/imu/imu_test.h"
+#include "../drv/motor_driver/motor_driver_virtual_simulation.h"
+
+static PT_THREAD(test_snapshot_motors_and_imu(struct pt *pt)) {
+
+    static struct timer timer;
+
+    static pbio_servo_t *srv;
+    static pbdrv_legodev_dev_t *legodev;
+    static pbio_snapshot_t snapshot;
+    static int32_t angle;
+    static int32_t speed;
+
+    // Start motor driver simulation process.
+    pbdrv_motor_driver_init_manual();
+
+    PT_BEGIN(pt);
+
+    // Hub flat on the table, standing still.
+    static const int16_t frame[] = { 0, 0, 0, 0, 0, 4097 };
+    pbdrv_imu_test_set_frame(frame);
+    pbdrv_imu_test_start();
+
+    // Wait for motor simulation process to be ready.
+    while (pbdrv_init_busy()) {
+        PT_YIELD(pt);
+    }
+
+    // Start motor control process manually.
+    pbio_motor_process_start();
+
+    // Initialize a servo and get it moving.
+    pbdrv_legodev_type_id_t id = PBDRV_LEGODEV_TYPE_ID_ANY_ENCODED_MOTOR;
+    tt_uint_op(pbdrv_legodev_get_device(PBIO_PORT_ID_A, &id, &legodev), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_servo_get_servo(legodev, &srv), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_servo_setup(srv, id, PBIO_DIRECTION_CLOCKWISE, 1000, true, 0), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_servo_run_forever(srv, 500), ==, PBIO_SUCCESS);
+    pbio_test_sleep_ms(&timer, 1000);
+
+    // Motor values come first, followed by the IMU.
+    static const pbio_port_id_t ports[] = { PBIO_PORT_ID_A };
+    tt_uint_op(pbio_snapshot_take(&snapshot, ports, 1, true), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_servo_get_state_user(srv, &angle, &speed), ==, PBIO_SUCCESS);
+    tt_want_uint_op(snapshot.num_values, ==, PBIO_SNAPSHOT_NUM_MOTOR_VALUES + PBIO_SNAPSHOT_NUM_IMU_VALUES);
+    tt_want_uint_op(snapshot.time, ==, pbdrv_clock_get_ms());
+    tt_want_int_op(snapshot.values[0], ==, angle);
+    tt_want_int_op(snapshot.values[1], ==, speed);
+    tt_want(pbio_test_int_is_close(snapshot.values[1], 500, 20));
+
+    // Gravity is along the z-axis and nothing is turning.
+    tt_want(pbio_test_int_is_close(snapshot.values[2 + 3], 0, 1));
+    tt_want(pbio_test_int_is_close(snapshot.values[2 + 6], 9807, 100));
+
+    // Without the IMU, there are only the motor values.
+    tt_uint_op(pbio_snapshot_take(&snapshot, ports, 1, false), ==, PBIO_SUCCESS);
+    tt_want_uint_op(snapshot.num_values, ==, PBIO_SNAPSHOT_NUM_MOTOR_VALUES);
+
+    // Nothing is read if one of the ports has no device.
+    static const pbio_port_id_t ports_missing[] = { PBIO_PORT_ID_A, PBIO_PORT_ID_D };
+    tt_want_uint_op(pbio_snapshot_take(&snapshot, ports_missing, 2, true), ==, PBIO_ERROR_NO_DEV);
+    tt_want_uint_op(snapshot.num_values, ==, 0);
+
+    // Too many values don't fit.
+    static pbio_port_id_t ports_many[PBIO_CONFIG_SNAPSHOT_NUM_VALUES / PBIO_SNAPSHOT_NUM_MOTOR_VALUES + 1];
+    for (uint8_t i = 0; i < PBIO_ARRAY_SIZE(ports_many); i++) {
+        ports_many[i] = PBIO_PORT_ID_A;
+    }
+    tt_want_uint_op(pbio_snapshot_take(&snapshot, ports_many, PBIO_ARRAY_SIZE(ports_many), false), ==, PBIO_ERROR_INVALID_ARG);
+
+    tt_uint_op(pbio_servo_stop(srv, PBIO_CONTROL_ON_COMPLETION_COAST), ==, PBIO_SUCCESS);
+
+end:
+
+    PT_END(pt);
+}
+
+struct testcase_t pbio_snapshot_tests[] = {
+    PBIO_PT_THREAD_TEST(test_snapshot_motors_and_imu),
+    END_OF_TESTCASES
+};
@@ -3,6 +3,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <time.h>
 
 #include <pbio/int_math.h>
 #include <pbio/trajectory.h>
@@ -370,9 +371,278 @@ static void test_position_trajectory(void *env) {
     }
 }
 
+#if PBIO_CONFIG_TRAJECTORY_INCREMENTAL
+
+/**
+ * Walks a trajectory one control loop step at a time and compares the
+ * incremental evaluation with a full evaluation at each step.
+ */
+static void compare_incremental(const pbio_trajectory_t *trj, uint32_t duration) {
+
+    pbio_trajectory_t incremental = *trj;
+    pbio_trajectory_t full = *trj;
+
+    const uint32_t increment = PBIO_CONFIG_CONTROL_LOOP_TIME_MS * PBIO_TRAJECTORY_TICKS_PER_MS;
+    for (uint32_t t = 0; t < duration; t += increment) {
+        uint32_t now = t + trj->start.time;
+
+        pbio_trajectory_reference_t ref_incremental;
+        pbio_trajectory_get_reference(&incremental, now, &ref_incremental);
+
+        pbio_trajectory_reference_t ref_full;
+        pbio_trajectory_reset_incremental(&full);
+        pbio_trajectory_get_reference(&full, now, &ref_full);
+
+        tt_want_int_op(ref_incremental.time, ==, ref_full.time);
+        tt_want_int_op(ref_incremental.speed, ==, ref_full.speed);
+        tt_want_int_op(ref_incremental.acceleration, ==, ref_full.acceleration);
+
+        // The full evaluation rounds intermediate results, which adds up to
+        // a small error in long acceleration phases. Incremental evaluation
+        // is exact, so this is the only source of differences.
+        int32_t error = pbio_int_math_abs(pbio_angle_diff_mdeg(&ref_incremental.position, &ref_full.position));
+        tt_want_int_op(error, <=, 10 + t / 200);
+    }
+}
+
+static void test_incremental_trajectory(void *env) {
+
+    pbio_trajectory_command_t command;
+
+    // Check every 7th trajectory to keep the test fast while still covering
+    // all angles, speeds, and accelerations.
+    for (uint32_t i = 0; i < num_position_trajectories; i += 7) {
+        get_position_command(i, &command);
+
+        pbio_trajectory_t trj;
+        if (pbio_trajectory_new_angle_command(&trj, &command) != PBIO_SUCCESS) {
+            continue;
+        }
+
+        uint32_t duration = pbio_trajectory_get_duration(&trj);
+        compare_incremental(&trj, pbio_int_math_min(duration + 10000, duration * 2));
+    }
+}
+
+static void test_incremental_trajectory_jitter(void *env) {
+
+    pbio_trajectory_command_t command;
+
+    const int32_t increment = PBIO_CONFIG_CONTROL_LOOP_TIME_MS * PBIO_TRAJECTORY_TICKS_PER_MS;
+
+    // Offset added to the incremental state after it is initialized. It is
+    // kept until the next segment only if that state is not initialized again.
+    const int32_t offset = 1000;
+
+    for (uint32_t i = 0; i < num_position_trajectories; i += 7) {
+        get_position_command(i, &command);
+
+        pbio_trajectory_t incremental;
+        if (pbio_trajectory_new_angle_command(&incremental, &command) != PBIO_SUCCESS) {
+            continue;
+        }
+        pbio_trajectory_t full = incremental;
+        uint32_t duration = pbio_trajectory_get_duration(&incremental);
+        uint8_t segment = UINT8_MAX;
+
+        // Step by one control loop with -1, 0, or +1 tick of jitter.
+        uint32_t step = 0;
+        for (uint32_t t = 0; t < duration + 10000; t += increment + step % 3 - 1, step++) {
+            uint32_t now = t + incremental.start.time;
+
+            pbio_trajectory_reference_t ref_incremental;
+            pbio_trajectory_get_reference(&incremental, now, &ref_incremental);
+
+            pbio_trajectory_reference_t ref_full;
+            pbio_trajectory_reset_incremental(&full);
+            pbio_trajectory_get_reference(&full, now, &ref_full);
+
+            tt_want_int_op(ref_incremental.speed, ==, ref_full.speed);
+            tt_want_int_op(ref_incremental.acceleration, ==, ref_full.acceleration);
+
+            if (!incremental.incremental.valid) {
+                continue;
+            }
+
+            int32_t error = pbio_angle_diff_mdeg(&ref_incremental.position, &ref_full.position);
+            if (incremental.incremental.segment != segment) {
+                // Initialized at the start of a segment.
+                segment = incremental.incremental.segment;
+                incremental.incremental.th += offset;
+                tt_want_int_op(pbio_int_math_abs(error), <=, 10 + t / 200);
+            } else {
+                // Stepped without starting over, even with jitter.
+                tt_want_int_op(pbio_int_math_abs(error - offset), <=, 10 + t / 200);
+            }
+        }
+    }
+}
+
+static void test_incremental_trajectory_benchmark(void *env) {
+
+    // Run for 10000 degrees at 1000 deg/s with a = 200 deg/s/s, so a good
+    // part of the maneuver is spent accelerating, which is most costly.
+    pbio_trajectory_command_t command = {
+        .time_start = 0,
+        .position_start = { .rotations = 0, .millidegrees = 0 },
+        .position_end = { .rotations = 27, .millidegrees = 280 * MDEG_PER_DEG },
+        .speed_start = 0,
+        .speed_target = 1000 * MDEG_PER_DEG,
+        .speed_max = 1000 * MDEG_PER_DEG,
+        .acceleration = 200 * MDEG_PER_DEG,
+        .deceleration = 200 * MDEG_PER_DEG,
+        .continue_running = false,
+    };
+
+    pbio_trajectory_t trj;
+    tt_want_int_op(pbio_trajectory_new_angle_command(&trj, &command), ==, PBIO_SUCCESS);
+
+    const uint32_t increment = PBIO_CONFIG_CONTROL_LOOP_TIME_MS * PBIO_TRAJECTORY_TICKS_PER_MS;
+    uint32_t duration = pbio_trajectory_get_duration(&trj);
+    pbio_trajectory_reference_t ref;
+    int64_t checksum[2] = { 0 };
+    clock_t elapsed[2];
+
+    for (int mode = 0; mode < 2; mode++) {
+        clock_t start = clock();
+        for (int repeat = 0; repeat < 100; repeat++) {
+            for (uint32_t t = 0; t < duration; t += increment) {
+                if (mode == 0) {
+                    pbio_trajectory_reset_incremental(&trj);
+                }
+                pbio_trajectory_get_reference(&trj, t, &ref);
+                checksum[mode] += ref.speed;
+            }
+        }
+        elapsed[mode] = clock() - start;
+    }
+
+    TT_BLATHER(("Full evaluation: %ld ticks, incremental: %ld ticks", (long)elapsed[0], (long)elapsed[1]));
+
+    // Speeds are identical in both modes.
+    tt_want(checksum[0] == checksum[1]);
+}
+
+#endif // PBIO_CONFIG_TRAJECTORY_INCREMENTAL
+
+#if PBIO_CONFIG_TRAJECTORY_S_CURVE
+
+static void test_s_curve_trajectory(void *env) {
+
+    // Peak acceleration of 2000 deg/s/s, so the mean acceleration is 1500
+    // deg/s/s and the ramps to and from 750 deg/s take 500 ms.
+    pbio_trajectory_command_t command = {
+        .time_start = 0,
+        .position_start = { .rotations = 0, .millidegrees = 0 },
+        .position_end = { .rotations = 21, .millidegrees = 315 * MDEG_PER_DEG },
+        .speed_start = 0,
+        .speed_target = 750 * MDEG_PER_DEG,
+        .speed_max = 1000 * MDEG_PER_DEG,
+        .acceleration = 2000 * MDEG_PER_DEG,
+        .deceleration = 2000 * MDEG_PER_DEG,
+        .continue_running = false,
+        .profile = PBIO_TRAJECTORY_PROFILE_S_CURVE,
+    };
+
+    pbio_trajectory_t trj;
+    tt_want_int_op(pbio_trajectory_new_angle_command(&trj, &command), ==, PBIO_SUCCESS);
+
+    // Timing and vertices are the same as for a trapezoid at the mean.
+    tt_want_int_op(trj.t1, ==, 500 * PBIO_TRAJECTORY_TICKS_PER_MS);
+    tt_want_int_op(trj.t3, ==, 11000 * PBIO_TRAJECTORY_TICKS_PER_MS);
+    tt_want_int_op(trj.th1, ==, 187500);
+
+    // Acceleration starts at zero and reaches the configured value after a
+    // quarter of the ramp.
+    pbio_trajectory_reference_t ref;
+    pbio_trajectory_get_reference(&trj, 0, &ref);
+    tt_want_int_op(ref.acceleration, ==, 0);
+    pbio_trajectory_get_reference(&trj, 125 * PBIO_TRAJECTORY_TICKS_PER_MS, &ref);
+    tt_want_int_op(ref.acceleration, ==, 2000 * MDEG_PER_DEG);
+    pbio_trajectory_get_reference(&trj, 250 * PBIO_TRAJECTORY_TICKS_PER_MS, &ref);
+    tt_want_int_op(ref.acceleration, ==, 2000 * MDEG_PER_DEG);
+    tt_want_int_op(ref.speed, ==, 375 * MDEG_PER_DEG);
+
+    // Ramp ends at the vertex, without a step in acceleration.
+    pbio_trajectory_get_reference(&trj, 499 * PBIO_TRAJECTORY_TICKS_PER_MS, &ref);
+    tt_want(pbio_test_int_is_close(ref.acceleration, 0, 50 * MDEG_PER_DEG));
+    tt_want(pbio_test_int_is_close(pbio_angle_diff_mdeg(&ref.position, &command.position_start), 186750, 10));
+
+    // Same on the way down.
+    pbio_trajectory_get_reference(&trj, 10750 * PBIO_TRAJECTORY_TICKS_PER_MS, &ref);
+    tt_want_int_op(ref.acceleration, ==, -2000 * MDEG_PER_DEG);
+    tt_want_int_op(ref.speed, ==, 375 * MDEG_PER_DEG);
+    pbio_trajectory_get_reference(&trj, 11000 * PBIO_TRAJECTORY_TICKS_PER_MS, &ref);
+    tt_want_int_op(ref.speed, ==, 0);
+    tt_want_int_op(pbio_angle_diff_mdeg(&ref.position, &command.position_end), ==, 0);
+}
+
+static void test_s_curve_trajectory_bounds(void *env) {
+
+    pbio_trajectory_command_t command;
+
+    for (uint32_t i = 0; i < num_position_trajectories; i += 7) {
+        get_position_command(i, &command);
+        command.profile = PBIO_TRAJECTORY_PROFILE_S_CURVE;
+
+        pbio_trajectory_t trj;
+        if (pbio_trajectory_new_angle_command(&trj, &command) != PBIO_SUCCESS) {
+            continue;
+        }
+
+        // Planning matches the trapezoid at the mean acceleration.
+        pbio_trajectory_command_t command_trapezoid = command;
+        command_trapezoid.profile = PBIO_TRAJECTORY_PROFILE_TRAPEZOID;
+        command_trapezoid.acceleration = command.acceleration * 3 / 4;
+        command_trapezoid.deceleration = command.deceleration * 3 / 4;
+        pbio_trajectory_t trapezoid;
+        tt_want_int_op(pbio_trajectory_new_angle_command(&trapezoid, &command_trapezoid), ==, PBIO_SUCCESS);
+        tt_want_int_op(trj.t1, ==, trapezoid.t1);
+        tt_want_int_op(trj.t3, ==, trapezoid.t3);
+        tt_want_int_op(trj.th3, ==, trapezoid.th3);
+
+        // Speed and position change smoothly, and acceleration never exceeds
+        // the configured value, beyond rounding to whole deg/s/s. Very low
+        // values are raised to the minimum mean acceleration of 50 deg/s/s.
+        // The speed may change a bit faster on very short ramps, where the
+        // planner rounds the vertices to whole ticks.
+        int32_t accel_max = pbio_int_math_max(command.acceleration, command.deceleration);
+        accel_max = pbio_int_math_max(accel_max, 67 * MDEG_PER_DEG) + 2 * MDEG_PER_DEG;
+        uint32_t duration = pbio_trajectory_get_duration(&trj);
+        pbio_trajectory_reference_t ref_prev, ref_now;
+        pbio_trajectory_get_reference(&trj, command.time_start, &ref_prev);
+        for (uint32_t t = 10; t <= duration; t += 10) {
+            pbio_trajectory_get_reference(&trj, command.time_start + t, &ref_now);
+            tt_want(pbio_int_math_abs(ref_now.acceleration) <= accel_max);
+            tt_want(pbio_int_math_abs(ref_now.speed - ref_prev.speed) <= accel_max / 1000 * 21 / 20 + 200);
+            int32_t movement = pbio_angle_diff_mdeg(&ref_now.position, &ref_prev.position);
+            int32_t movement_expected = (ref_now.speed + ref_prev.speed) / 2 / 1000;
+            tt_want(pbio_int_math_abs(movement - movement_expected) < 5000);
+            ref_prev = ref_now;
+        }
+
+        // The endpoint is reached exactly.
+        pbio_trajectory_reference_t end;
+        pbio_trajectory_get_endpoint(&trj, &end);
+        pbio_trajectory_get_reference(&trj, command.time_start + duration, &ref_now);
+        tt_want(pbio_test_int_is_close(pbio_angle_diff_mdeg(&ref_now.position, &end.position), 0, 10));
+    }
+}
+
+#endif // PBIO_CONFIG_TRAJECTORY_S_CURVE
+
 struct testcase_t pbio_trajectory_tests[] = {
     PBIO_TEST(test_simple_trajectory),
     PBIO_TEST(test_position_trajectory),
     PBIO_TEST(test_infinite_trajectory),
+    #if PBIO_CONFIG_TRAJECTORY_INCREMENTAL
+    PBIO_TEST(test_incremental_trajectory),
+    PBIO_TEST(test_incremental_trajectory_jitter),
+    PBIO_TEST(test_incremental_trajectory_benchmark),
+    #endif
+    #if PBIO_CONFIG_TRAJECTORY_S_CURVE
+    PBIO_TEST(test_s_curve_trajectory),
+    PBIO_TEST(test_s_curve_trajectory_bounds),
+    #endif
     END_OF_TESTCASES
 };
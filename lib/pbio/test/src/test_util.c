@@ -44,6 +44,15 @@ static void test_uuid128_reverse_copy(void *env) {
     tt_want_int_op(memcmp(uuid, test_reversed_uuid, 16), ==, 0);
 }
 
+static void test_crc32(void *env) {
+    // Check value from the CRC-32 specification.
+    static const uint8_t check[] = "123456789";
+    tt_want_uint_op(pbio_crc32(check, 9), ==, 0xCBF43926);
+
+    tt_want_uint_op(pbio_crc32(check, 0), ==, 0);
+    tt_want_uint_op(pbio_crc32(test_uuid, 16), !=, pbio_crc32(test_reversed_uuid, 16));
+}
+
 static void test_oneshot(void *env) {
     PBIO_ONESHOT(test_oneshot);
 
@@ -66,6 +75,7 @@ static void test_oneshot(void *env) {
 struct testcase_t pbio_util_tests[] = {
     PBIO_TEST(test_uuid128_reverse_compare),
     PBIO_TEST(test_uuid128_reverse_copy),
+    PBIO_TEST(test_crc32),
     PBIO_TEST(test_oneshot),
     END_OF_TESTCASES
 };
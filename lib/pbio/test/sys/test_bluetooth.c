@@ -9,6 +9,8 @@
 #include <tinytest_macros.h>
 #include <tinytest.h>
 
+#include <pbdrv/bluetooth.h>
+#include <pbdrv/clock.h>
 #include <pbio/util.h>
 #include <pbsys/bluetooth.h>
 #include <pbsys/main.h>
@@ -106,7 +108,76 @@ static PT_THREAD(test_bluetooth(struct pt *pt)) {
     PT_END(pt);
 }
 
+static PT_THREAD(test_bluetooth_stdout_throughput(struct pt *pt)) {
+    static uint8_t data[4096];
+    static uint32_t written;
+    static uint32_t count;
+    static uint32_t start;
+    uint32_t size;
+
+    PT_BEGIN(pt);
+
+    pbsys_bluetooth_init();
+
+    PT_WAIT_UNTIL(pt, ({
+        pbio_test_clock_tick(1);
+        pbio_test_bluetooth_is_advertising_enabled();
+    }));
+
+    pbio_test_bluetooth_connect();
+
+    PT_WAIT_UNTIL(pt, ({
+        pbio_test_clock_tick(1);
+        pbio_test_bluetooth_is_connected();
+    }));
+
+    // Typical MTU requested by computers and phones that support larger packets.
+    pbio_test_bluetooth_exchange_mtu(247);
+    pbio_test_bluetooth_enable_pybricks_service_notifications();
+
+    PT_WAIT_UNTIL(pt, ({
+        pbio_test_clock_tick(1);
+        pbdrv_bluetooth_is_connected(PBDRV_BLUETOOTH_CONNECTION_PYBRICKS);
+    }));
+
+    tt_want_uint_op(pbdrv_bluetooth_get_max_char_size(), ==, 247 - 3);
+
+    for (size_t i = 0; i < PBIO_ARRAY_SIZE(data); i++) {
+        data[i] = 'a' + i % 26;
+    }
+
+    count = pbio_test_bluetooth_get_pybricks_service_notification_count();
+    start = pbdrv_clock_get_ms();
+
+    // Write as fast as the buffer allows.
+    for (written = 0; written < PBIO_ARRAY_SIZE(data);) {
+        size = PBIO_ARRAY_SIZE(data) - written;
+        if (pbsys_bluetooth_tx(&data[written], &size) == PBIO_SUCCESS) {
+            written += size;
+        } else {
+            pbio_test_clock_tick(1);
+        }
+        PT_YIELD(pt);
+    }
+
+    PT_WAIT_UNTIL(pt, ({
+        pbio_test_clock_tick(1);
+        pbsys_bluetooth_tx_is_idle() && (pbio_test_bluetooth_get_pybricks_service_stdout_size() == written
+                                         || pbdrv_clock_get_ms() - start > 10000);
+    }));
+
+    tt_want_uint_op(pbio_test_bluetooth_get_pybricks_service_stdout_size(), ==, PBIO_ARRAY_SIZE(data));
+
+    // With the minimum MTU, this would take 4096 / 19 = 216 notifications.
+    // Status notifications may be sent in between.
+    count = pbio_test_bluetooth_get_pybricks_service_notification_count() - count;
+    tt_want_uint_op(count, <, PBIO_ARRAY_SIZE(data) / 19 / 4);
+
+    PT_END(pt);
+}
+
 struct testcase_t pbsys_bluetooth_tests[] = {
     PBIO_PT_THREAD_TEST(test_bluetooth),
+    PBIO_PT_THREAD_TEST(test_bluetooth_stdout_throughput),
     END_OF_TESTCASES
 };
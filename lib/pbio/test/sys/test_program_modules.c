@@ -0,0 +1,178 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2023 The Pybricks Authors
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <tinytest.h>
+#include <tinytest_macros.h>
+
+#include <pbio/error.h>
+#include <pbio/util.h>
+#include <pbsys/program_modules.h>
+#include <test-pbio.h>
+
+// Adds a module to a user program and returns the new program size.
+static uint32_t test_add_module(uint8_t *program, uint32_t size, const char *name, const char *data) {
+    pbio_set_uint32_le(program + size, strlen(data));
+    size += sizeof(uint32_t);
+    strcpy((char *)program + size, name);
+    size += strlen(name) + 1;
+    memcpy(program + size, data, strlen(data));
+    return size + strlen(data);
+}
+
+static uint32_t test_make_program(uint8_t *program) {
+    uint32_t size = 0;
+    size = test_add_module(program, size, "__main__", "main data");
+    size = test_add_module(program, size, "robot", "robot data, a bit longer");
+    size = test_add_module(program, size, "empty", "");
+    return test_add_module(program, size, "util", "util data");
+}
+
+static void test_program_modules_get(void *env) {
+    uint8_t program[128];
+    uint32_t size = test_make_program(program);
+    pbsys_program_module_t module;
+
+    tt_want_uint_op(pbsys_program_modules_get(program, size, 0, &module), ==, PBIO_SUCCESS);
+    tt_want_str_op(module.name, ==, "__main__");
+    tt_want_uint_op(module.data_size, ==, strlen("main data"));
+    tt_want_int_op(memcmp(module.data, "main data", module.data_size), ==, 0);
+    tt_want_uint_op(module.size, ==, 4 + sizeof("__main__") + strlen("main data"));
+
+    // Walk through all modules.
+    static const char *const names[] = { "__main__", "robot", "empty", "util" };
+    uint32_t offset = 0;
+    for (uint32_t i = 0; i < PBIO_ARRAY_SIZE(names); i++) {
+        tt_want_uint_op(pbsys_program_modules_get(program, size, offset, &module), ==, PBIO_SUCCESS);
+        tt_want_str_op(module.name, ==, names[i]);
+        offset += module.size;
+    }
+    tt_want_uint_op(offset, ==, size);
+    tt_want_uint_op(pbsys_program_modules_get(program, size, offset, &module), ==, PBIO_ERROR_INVALID_ARG);
+
+    // Truncated modules are rejected.
+    tt_want_uint_op(pbsys_program_modules_get(program, size - 1, offset - module.size, &module), ==, PBIO_ERROR_INVALID_ARG);
+    tt_want_uint_op(pbsys_program_modules_get(program, 6, 0, &module), ==, PBIO_ERROR_INVALID_ARG);
+}
+
+static void test_program_modules_hashes(void *env) {
+    uint8_t program[128];
+    uint32_t size = test_make_program(program);
+    uint8_t buf[16];
+    uint32_t buf_size = sizeof(buf);
+
+    // All four fit.
+    tt_want_uint_op(pbsys_program_modules_get_hashes(program, size, 0, buf, &buf_size), ==, 4);
+    tt_want_uint_op(buf_size, ==, 16);
+    uint32_t main_size = 4 + sizeof("__main__") + strlen("main data");
+    tt_want_uint_op(pbio_get_uint32_le(&buf[0]), ==, pbio_crc32(program, main_size));
+
+    // Starting later, with room for only one.
+    uint8_t one[6];
+    buf_size = sizeof(one);
+    tt_want_uint_op(pbsys_program_modules_get_hashes(program, size, 1, one, &buf_size), ==, 4);
+    tt_want_uint_op(buf_size, ==, 4);
+    tt_want_int_op(memcmp(one, &buf[4], 4), ==, 0);
+
+    // Past the end.
+    buf_size = sizeof(buf);
+    tt_want_uint_op(pbsys_program_modules_get_hashes(program, size, 4, buf, &buf_size), ==, 4);
+    tt_want_uint_op(buf_size, ==, 0);
+
+    // The same module gives the same hash after it was moved.
+    uint8_t other[128];
+    uint32_t other_size = test_add_module(other, 0, "__main__", "changed main");
+    other_size = test_add_module(other, other_size, "robot", "robot data, a bit longer");
+    uint8_t other_buf[8];
+    buf_size = sizeof(other_buf);
+    tt_want_uint_op(pbsys_program_modules_get_hashes(other, other_size, 0, other_buf, &buf_size), ==, 2);
+    tt_want_int_op(memcmp(&other_buf[0], &buf[0], 4), !=, 0);
+    tt_want_int_op(memcmp(&other_buf[4], &buf[4], 4), ==, 0);
+}
+
+static void test_program_modules_keep(void *env) {
+    uint8_t program[128];
+    uint32_t size = test_make_program(program);
+
+    // Keep robot and util, then add a new main module after them.
+    static const uint8_t keep[] = { 0x0A };
+    size = pbsys_program_modules_keep(program, size, keep, sizeof(keep));
+
+    uint8_t expected[128];
+    uint32_t expected_size = test_add_module(expected, 0, "robot", "robot data, a bit longer");
+    expected_size = test_add_module(expected, expected_size, "util", "util data");
+    tt_want_uint_op(size, ==, expected_size);
+    tt_want_int_op(memcmp(program, expected, expected_size), ==, 0);
+
+    size = test_add_module(program, size, "__main__", "new main");
+    pbsys_program_module_t module;
+    tt_want_uint_op(pbsys_program_modules_get(program, size, expected_size, &module), ==, PBIO_SUCCESS);
+    tt_want_str_op(module.name, ==, "__main__");
+
+    // Modules beyond the bit map are removed.
+    tt_want_uint_op(pbsys_program_modules_keep(program, size, keep, 0), ==, 0);
+}
+
+static void test_program_modules_find(void *env) {
+    static uint8_t program[4096];
+    static pbsys_program_modules_index_entry_t entries[64];
+    pbsys_program_modules_index_t index;
+    pbsys_program_module_t module;
+    char name[16];
+    char data[16];
+
+    // Synthetic bundle with many modules, with a duplicate name at the end.
+    uint32_t size = 0;
+    for (int i = 0; i < 50; i++) {
+        snprintf(name, sizeof(name), "module_%d", i);
+        snprintf(data, sizeof(data), "data %d", i);
+        size = test_add_module(program, size, name, data);
+    }
+    size = test_add_module(program, size, "module_7", "duplicate");
+    uint32_t num_modules = pbsys_program_modules_count(program, size);
+    tt_want_uint_op(num_modules, ==, 51);
+
+    // Search both with and without index, which should give the same result.
+    for (int with_index = 0; with_index < 2; with_index++) {
+        pbsys_program_modules_index_init(&index, program, size, with_index ? entries : NULL, num_modules);
+        tt_want((index.entries != NULL) == with_index);
+
+        for (int i = 0; i < 50; i++) {
+            snprintf(name, sizeof(name), "module_%d", i);
+            snprintf(data, sizeof(data), "data %d", i);
+            tt_want_uint_op(pbsys_program_modules_find(&index, name, &module), ==, PBIO_SUCCESS);
+            tt_want_str_op(module.name, ==, name);
+            tt_want_uint_op(module.data_size, ==, strlen(data));
+            tt_want_int_op(memcmp(module.data, data, module.data_size), ==, 0);
+        }
+
+        // The first module wins if a name occurs twice.
+        tt_want_uint_op(pbsys_program_modules_find(&index, "module_7", &module), ==, PBIO_SUCCESS);
+        tt_want_int_op(memcmp(module.data, "data 7", module.data_size), ==, 0);
+
+        tt_want_uint_op(pbsys_program_modules_find(&index, "module_50", &module), ==, PBIO_ERROR_NO_DEV);
+        tt_want_uint_op(pbsys_program_modules_find(&index, "module", &module), ==, PBIO_ERROR_NO_DEV);
+        tt_want_uint_op(pbsys_program_modules_find(&index, "", &module), ==, PBIO_ERROR_NO_DEV);
+    }
+
+    // Sorted by hash.
+    for (uint32_t i = 1; i < index.num_entries; i++) {
+        tt_want_uint_op(index.entries[i - 1].hash, <=, index.entries[i].hash);
+    }
+
+    // An empty program has no modules.
+    pbsys_program_modules_index_init(&index, program, 0, entries, pbsys_program_modules_count(program, 0));
+    tt_want_uint_op(index.num_entries, ==, 0);
+    tt_want_uint_op(pbsys_program_modules_find(&index, "__main__", &module), ==, PBIO_ERROR_NO_DEV);
+}
+
+struct testcase_t pbsys_program_modules_tests[] = {
+    PBIO_TEST(test_program_modules_get),
+    PBIO_TEST(test_program_modules_hashes),
+    PBIO_TEST(test_program_modules_keep),
+    PBIO_TEST(test_program_modules_find),
+    END_OF_TESTCASES
+};
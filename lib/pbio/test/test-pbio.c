@@ -82,16 +82,24 @@ extern struct testcase_t pbio_angle_tests[];
 extern struct testcase_t pbio_battery_tests[];
 extern struct testcase_t pbio_color_tests[];
 extern struct testcase_t pbio_drivebase_tests[];
+extern struct testcase_t pbio_geometry_tests[];
+extern struct testcase_t pbio_imu_tests[];
 extern struct testcase_t pbio_light_animation_tests[];
 extern struct testcase_t pbio_color_light_tests[];
 extern struct testcase_t pbio_light_matrix_tests[];
 extern struct testcase_t pbio_int_math_tests[];
+extern struct testcase_t pbio_logger_tests[];
+extern struct testcase_t pbio_lz_tests[];
+extern struct testcase_t pbio_motor_process_tests[];
+extern struct testcase_t pbio_observer_tests[];
 extern struct testcase_t pbio_servo_tests[];
+extern struct testcase_t pbio_snapshot_tests[];
 extern struct testcase_t pbio_task_tests[];
 extern struct testcase_t pbio_trajectory_tests[];
 extern struct testcase_t pbdrv_legodev_tests[];
 extern struct testcase_t pbio_util_tests[];
 extern struct testcase_t pbsys_bluetooth_tests[];
+extern struct testcase_t pbsys_program_modules_tests[];
 extern struct testcase_t pbsys_status_tests[];
 static struct testgroup_t test_groups[] = {
     { "drv/bluetooth/", pbdrv_bluetooth_tests },
@@ -100,16 +108,24 @@ static struct testgroup_t test_groups[] = {
     { "src/battery/", pbio_battery_tests },
     { "src/color/", pbio_color_tests },
     { "src/drivebase/", pbio_drivebase_tests },
+    { "src/geometry/", pbio_geometry_tests },
+    { "src/imu/", pbio_imu_tests },
     { "src/light/", pbio_light_animation_tests },
     { "src/light/", pbio_color_light_tests },
     { "src/light/", pbio_light_matrix_tests },
+    { "src/logger/", pbio_logger_tests },
+    { "src/lz/", pbio_lz_tests },
     { "src/math/", pbio_int_math_tests },
+    { "src/motor_process/", pbio_motor_process_tests },
+    { "src/observer/", pbio_observer_tests },
     { "src/servo/", pbio_servo_tests },
+    { "src/snapshot/", pbio_snapshot_tests },
     { "src/task/", pbio_task_tests, },
     { "src/trajectory/", pbio_trajectory_tests },
     { "src/uartdev/", pbdrv_legodev_tests, },
     { "src/util/", pbio_util_tests, },
     { "sys/bluetooth/", pbsys_bluetooth_tests, },
+    { "sys/program_modules/", pbsys_program_modules_tests, },
     { "sys/status/", pbsys_status_tests, },
     END_OF_GROUPS
 };
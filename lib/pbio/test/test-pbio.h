@@ -30,6 +30,8 @@ uint32_t pbio_test_bluetooth_get_uart_service_notification_count(void);
 void pbio_test_bluetooth_send_uart_data(const uint8_t *data, uint32_t size);
 void pbio_test_bluetooth_enable_pybricks_service_notifications(void);
 uint32_t pbio_test_bluetooth_get_pybricks_service_notification_count(void);
+uint32_t pbio_test_bluetooth_get_pybricks_service_stdout_size(void);
+void pbio_test_bluetooth_exchange_mtu(uint16_t mtu);
 void pbio_test_bluetooth_send_pybricks_command(const uint8_t *data, uint32_t size);
 
 typedef enum {
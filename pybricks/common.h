@@ -133,6 +133,8 @@ extern const mp_obj_type_t pb_type_Speaker;
 
 mp_obj_t pb_type_IMU_obj_new(mp_obj_t top_side_axis, mp_obj_t front_side_axis);
 
+void pb_type_IMU_cleanup(void);
+
 #endif // PYBRICKS_PY_COMMON_IMU
 
 
@@ -8,6 +8,8 @@
 #include <pbdrv/legodev.h>
 #include <pbdrv/legodev.h>
 
+#include <pbio/drivebase.h>
+
 #include <pybricks/common.h>
 #include <pybricks/pupdevices.h>
 #include <pybricks/common/pb_type_device.h>
@@ -17,6 +19,20 @@
 #include <py/runtime.h>
 #include <py/mphal.h>
 
+/**
+ * Sets the mode of a powered up device, unless a drive base is following a
+ * line with it in another mode.
+ *
+ * @param [in]  sensor      The powered up device.
+ * @param [in]  mode        Desired mode.
+ */
+STATIC void pb_type_device_set_mode(pb_type_device_obj_base_t *sensor, uint8_t mode) {
+    #if PBIO_CONFIG_DRIVEBASE_FOLLOW
+    pb_assert(pbio_drivebase_follow_check_sensor_mode(sensor->legodev, mode));
+    #endif
+    pb_assert(pbdrv_legodev_set_mode(sensor->legodev, mode));
+}
+
 /**
  * Non-blocking version of powered up data getter. Will raise exception if
  * sensor is not already in the right mode.
@@ -46,7 +62,7 @@ void *pb_type_device_get_data(mp_obj_t self_in, uint8_t mode) {
  */
 void *pb_type_device_get_data_blocking(mp_obj_t self_in, uint8_t mode) {
     pb_type_device_obj_base_t *sensor = MP_OBJ_TO_PTR(self_in);
-    pb_assert(pbdrv_legodev_set_mode(sensor->legodev, mode));
+    pb_type_device_set_mode(sensor, mode);
     pbio_error_t err;
     while ((err = pbdrv_legodev_is_ready(sensor->legodev)) == PBIO_ERROR_AGAIN) {
         MICROPY_EVENT_POLL_HOOK
@@ -74,7 +90,7 @@ mp_obj_t pb_type_device_method_call(mp_obj_t self_in, size_t n_args, size_t n_kw
 
     mp_obj_t sensor_in = args[0];
     pb_type_device_obj_base_t *sensor = MP_OBJ_TO_PTR(sensor_in);
-    pb_assert(pbdrv_legodev_set_mode(sensor->legodev, method->mode));
+    pb_type_device_set_mode(sensor, method->mode);
 
     return pb_type_awaitable_await_or_wait(
         sensor_in,
@@ -93,6 +109,9 @@ MP_DEFINE_CONST_OBJ_TYPE(
     );
 
 mp_obj_t pb_type_device_set_data(pb_type_device_obj_base_t *sensor, uint8_t mode, const void *data, uint8_t size) {
+    #if PBIO_CONFIG_DRIVEBASE_FOLLOW
+    pb_assert(pbio_drivebase_follow_check_sensor_mode(sensor->legodev, mode));
+    #endif
     pb_assert(pbdrv_legodev_set_mode_with_data(sensor->legodev, mode, data, size));
     return pb_type_awaitable_await_or_wait(
         MP_OBJ_FROM_PTR(sensor),
@@ -9,16 +9,21 @@
 #include <stdbool.h>
 #include <string.h>
 
+#include <pbdrv/imu.h>
+
 #include <pbio/error.h>
 #include <pbio/geometry.h>
 #include <pbio/imu.h>
 
 #include "py/obj.h"
+#include "py/runtime.h"
 
 #include <pybricks/common.h>
+#include <pybricks/tools/pb_type_awaitable.h>
 #include <pybricks/tools/pb_type_matrix.h>
 #include <pybricks/parameters.h>
 #include <pybricks/util_pb/pb_error.h>
+#include <pybricks/util_mp/pb_obj_helper.h>
 #include <pybricks/util_mp/pb_kwarg_helper.h>
 
 typedef struct _common_IMU_obj_t {
@@ -48,22 +53,38 @@ MP_DEFINE_CONST_FUN_OBJ_1(common_IMU_up_obj, common_IMU_up);
 // pybricks._common.IMU.tilt
 STATIC mp_obj_t common_IMU_tilt(mp_obj_t self_in) {
 
-    // Read acceleration in the user frame.
-    pbio_geometry_xyz_t accl;
-    pbio_imu_get_acceleration(&accl);
+    // Read estimated orientation in the user frame.
+    pbio_geometry_xyz_t angles;
+    pbio_imu_get_euler_angles(&angles);
 
     mp_obj_t tilt[2];
     // Pitch
-    float pitch = atan2f(-accl.x, sqrtf(accl.z * accl.z + accl.y * accl.y));
-    tilt[0] = mp_obj_new_int_from_float(pitch * 57.296f);
+    tilt[0] = mp_obj_new_int_from_float(angles.y);
 
     // Roll
-    float roll = atan2f(accl.y, accl.z);
-    tilt[1] = mp_obj_new_int_from_float(roll * 57.296f);
+    tilt[1] = mp_obj_new_int_from_float(angles.x);
     return mp_obj_new_tuple(2, tilt);
 }
 MP_DEFINE_CONST_FUN_OBJ_1(common_IMU_tilt_obj, common_IMU_tilt);
 
+// pybricks._common.IMU.orientation
+STATIC mp_obj_t common_IMU_orientation(mp_obj_t self_in) {
+
+    pbio_geometry_matrix_3x3_t rotation;
+    pbio_imu_get_orientation(&rotation);
+
+    // Return as a 3x3 matrix.
+    pb_type_Matrix_obj_t *mat = mp_obj_malloc(pb_type_Matrix_obj_t, &pb_type_Matrix);
+    mat->m = 3;
+    mat->n = 3;
+    mat->scale = 1;
+    mat->transposed = false;
+    mat->data = m_new(float, 9);
+    memcpy(mat->data, rotation.values, sizeof(rotation.values));
+    return MP_OBJ_FROM_PTR(mat);
+}
+MP_DEFINE_CONST_FUN_OBJ_1(common_IMU_orientation_obj, common_IMU_orientation);
+
 STATIC void pb_type_imu_extract_axis(mp_obj_t obj_in, pbio_geometry_xyz_t *vector) {
     if (!mp_obj_is_type(obj_in, &pb_type_Matrix)) {
         mp_raise_TypeError(MP_ERROR_TEXT("Axis must be Matrix."));
@@ -191,6 +212,36 @@ STATIC mp_obj_t common_IMU_settings(size_t n_args, const mp_obj_t *pos_args, mp_
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_KW(common_IMU_settings_obj, 1, common_IMU_settings);
 
+// pybricks._common.IMU.calibrate_scale
+STATIC mp_obj_t common_IMU_calibrate_scale(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    PB_PARSE_ARGS_METHOD(n_args, pos_args, kw_args,
+        common_IMU_obj_t, self,
+        PB_ARG_DEFAULT_NONE(rotation));
+
+    (void)self;
+
+    // Without arguments, start measuring the rotation.
+    if (rotation_in == mp_const_none) {
+        pbio_imu_calibrate_scale_start();
+        return mp_const_none;
+    }
+
+    // Otherwise compare it to the actual rotation about each hub axis.
+    mp_obj_t *rotation_objs;
+    mp_obj_get_array_fixed_n(rotation_in, 3, &rotation_objs);
+    pbio_geometry_xyz_t rotation;
+    for (uint8_t i = 0; i < MP_ARRAY_SIZE(rotation.values); i++) {
+        rotation.values[i] = mp_obj_get_float(rotation_objs[i]);
+    }
+    pb_assert(pbio_imu_calibrate_scale_finish(&rotation));
+
+    // Return the new correction factors.
+    pbio_geometry_xyz_t correction;
+    pbio_imu_get_scale_correction(&correction);
+    return pb_type_Matrix_make_vector(3, correction.values, false);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(common_IMU_calibrate_scale_obj, 1, common_IMU_calibrate_scale);
+
 // pybricks._common.IMU.heading
 STATIC mp_obj_t common_IMU_heading(mp_obj_t self_in) {
     (void)self_in;
@@ -211,12 +262,79 @@ STATIC mp_obj_t common_IMU_reset_heading(size_t n_args, const mp_obj_t *pos_args
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_KW(common_IMU_reset_heading_obj, 1, common_IMU_reset_heading);
 
+// Recording in progress, of which the data becomes the returned bytes.
+STATIC struct {
+    vstr_t vstr;
+    uint32_t num_frames;
+} record_request;
+
+// Keeps the recording data from being garbage collected while frames are
+// still being copied into it.
+MP_REGISTER_ROOT_POINTER(char *imu_record_buffer);
+
+// Awaitables for the record() method. There can only be one recording at once.
+MP_REGISTER_ROOT_POINTER(mp_obj_t imu_record_awaitables);
+
+STATIC void common_IMU_record_stop(void) {
+    pbio_imu_record_stop();
+    MP_STATE_PORT(imu_record_buffer) = NULL;
+}
+
+STATIC bool common_IMU_record_test_completion(mp_obj_t obj, uint32_t end_time) {
+    return pbio_imu_record_get_count() >= record_request.num_frames;
+}
+
+STATIC mp_obj_t common_IMU_record_return_value(mp_obj_t obj) {
+    common_IMU_record_stop();
+    return mp_obj_new_bytes_from_vstr(&record_request.vstr);
+}
+
+STATIC void common_IMU_record_cancel(mp_obj_t obj) {
+    common_IMU_record_stop();
+}
+
+// pybricks._common.IMU.record
+STATIC mp_obj_t common_IMU_record(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    PB_PARSE_ARGS_METHOD(n_args, pos_args, kw_args,
+        common_IMU_obj_t, self,
+        PB_ARG_REQUIRED(frames));
+
+    mp_int_t num_frames = pb_obj_get_int(frames_in);
+    if (num_frames <= 0) {
+        pb_assert(PBIO_ERROR_INVALID_ARG);
+    }
+
+    // Raise if another task is still recording.
+    pb_type_awaitable_update_all(MP_STATE_PORT(imu_record_awaitables), PB_TYPE_AWAITABLE_OPT_RAISE_ON_BUSY);
+
+    // Record the sample time and raw frames directly into the data of the
+    // returned bytes. This can be replayed by the test IMU driver, such as on
+    // the virtual hub.
+    vstr_init_len(&record_request.vstr, PBIO_IMU_RECORDING_SIZE(num_frames));
+    record_request.num_frames = num_frames;
+    MP_STATE_PORT(imu_record_buffer) = record_request.vstr.buf;
+    pbio_imu_record_start((pbio_imu_recording_t *)record_request.vstr.buf, num_frames);
+
+    return pb_type_awaitable_await_or_wait(
+        MP_OBJ_FROM_PTR(self),
+        MP_STATE_PORT(imu_record_awaitables),
+        pb_type_awaitable_end_time_none,
+        common_IMU_record_test_completion,
+        common_IMU_record_return_value,
+        common_IMU_record_cancel,
+        PB_TYPE_AWAITABLE_OPT_RAISE_ON_BUSY);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(common_IMU_record_obj, 1, common_IMU_record);
+
 // dir(pybricks.common.IMU)
 STATIC const mp_rom_map_elem_t common_IMU_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_acceleration),     MP_ROM_PTR(&common_IMU_acceleration_obj)    },
     { MP_ROM_QSTR(MP_QSTR_angular_velocity), MP_ROM_PTR(&common_IMU_angular_velocity_obj)},
+    { MP_ROM_QSTR(MP_QSTR_calibrate_scale),  MP_ROM_PTR(&common_IMU_calibrate_scale_obj) },
     { MP_ROM_QSTR(MP_QSTR_heading),          MP_ROM_PTR(&common_IMU_heading_obj)         },
+    { MP_ROM_QSTR(MP_QSTR_orientation),      MP_ROM_PTR(&common_IMU_orientation_obj)     },
     { MP_ROM_QSTR(MP_QSTR_ready),            MP_ROM_PTR(&common_IMU_ready_obj)           },
+    { MP_ROM_QSTR(MP_QSTR_record),           MP_ROM_PTR(&common_IMU_record_obj)          },
     { MP_ROM_QSTR(MP_QSTR_reset_heading),    MP_ROM_PTR(&common_IMU_reset_heading_obj)   },
     { MP_ROM_QSTR(MP_QSTR_rotation),         MP_ROM_PTR(&common_IMU_rotation_obj)        },
     { MP_ROM_QSTR(MP_QSTR_settings),         MP_ROM_PTR(&common_IMU_settings_obj)        },
@@ -236,6 +354,12 @@ STATIC common_IMU_obj_t singleton_imu_obj = {
     .base.type = &pb_type_IMU,
 };
 
+// Stops recording when the program ends, so no frames are copied into memory
+// that is no longer in use.
+void pb_type_IMU_cleanup(void) {
+    common_IMU_record_stop();
+}
+
 // pybricks._common.IMU.__init__
 mp_obj_t pb_type_IMU_obj_new(mp_obj_t top_side_axis_in, mp_obj_t front_side_axis_in) {
 
@@ -251,6 +375,11 @@ mp_obj_t pb_type_IMU_obj_new(mp_obj_t top_side_axis_in, mp_obj_t front_side_axis
     // Default noise thresholds.
     pbio_imu_set_stationary_thresholds(5.0f, 2500.0f);
 
+    // Reset awaitables unless a recording from this program is in progress.
+    if (!MP_STATE_PORT(imu_record_buffer)) {
+        MP_STATE_PORT(imu_record_awaitables) = mp_obj_new_list(0, NULL);
+    }
+
     // Return singleton instance.
     return MP_OBJ_FROM_PTR(&singleton_imu_obj);
 }
@@ -11,9 +11,11 @@
 #include <string.h>
 
 #include <pbio/config.h>
+#include <pbio/control_settings.h>
 #include <pbio/logger.h>
 #include <pbio/int_math.h>
 #include <pbio/servo.h>
+#include <pbsys/bluetooth.h>
 
 #include "py/obj.h"
 #include "py/runtime.h"
@@ -44,22 +46,108 @@ typedef struct _tools_Logger_obj_t {
      * Buffer size. Used to free (renew) old data when resetting logger.
      */
     uint32_t last_size;
+    #if PYBRICKS_PY_COMMON_LOGGER_REAL_FILE
+    /**
+     * File that streamed rows are written to, or NULL if not streaming.
+     */
+    FILE *stream_file;
+    #endif
 } tools_Logger_obj_t;
 
+#if PYBRICKS_PY_COMMON_LOGGER_REAL_FILE
+
+// Writes one row to the stream file as comma separated values.
+STATIC pbio_error_t tools_Logger_stream_row(void *context, const int32_t *row_data, uint8_t num_cols) {
+    tools_Logger_obj_t *self = context;
+
+    for (uint32_t col = 0; col < num_cols; col++) {
+        const char *format = col + 1 < num_cols ? "%d, " : "%d\n";
+        if (fprintf(self->stream_file, format, row_data[col]) < 0) {
+            return PBIO_ERROR_IO;
+        }
+    }
+    return PBIO_SUCCESS;
+}
+
+#else
+
+// Sends one row over Bluetooth, encoded as described for PBIO_PYBRICKS_EVENT_WRITE_LOG.
+STATIC pbio_error_t tools_Logger_stream_row(void *context, const int32_t *row_data, uint8_t num_cols) {
+    // This runs from the control loop, so keep the stack use small.
+    uint8_t encoded[1 + PBIO_CONFIG_LOGGER_MAX_COLS * sizeof(int32_t)];
+    if (num_cols > PBIO_CONFIG_LOGGER_MAX_COLS) {
+        return PBIO_ERROR_INVALID_ARG;
+    }
+
+    encoded[0] = num_cols;
+    for (uint32_t col = 0; col < num_cols; col++) {
+        pbio_set_uint32_le(&encoded[1 + col * sizeof(int32_t)], row_data[col]);
+    }
+    return pbsys_bluetooth_tx_log(encoded, 1 + num_cols * sizeof(int32_t));
+}
+
+#endif // PYBRICKS_PY_COMMON_LOGGER_REAL_FILE
+
+// Allocates the log buffer for the given number of rows.
+STATIC void tools_Logger_alloc(tools_Logger_obj_t *self, mp_uint_t num_rows) {
+    // Size is number of rows times column width. All data are int32.
+    mp_int_t size = num_rows * self->num_cols;
+    self->buf = m_renew(int32_t, self->buf, self->last_size, size);
+    self->last_size = size;
+}
+
+// Stops the log and sends out any rows that have not been streamed yet.
+STATIC void tools_Logger_stop_stream(tools_Logger_obj_t *self) {
+
+    pbio_logger_stop(self->log);
+
+    if (!self->log->stream) {
+        return;
+    }
+
+    // Wait for the remaining rows to be sent. This stops early if the stream
+    // fails, such as when Bluetooth is disconnected. Data sent up to that
+    // point is all we can get, so that is not raised as an error.
+    pbio_error_t err;
+    while ((err = pbio_logger_stream_flush(self->log)) == PBIO_ERROR_AGAIN) {
+        MICROPY_EVENT_POLL_HOOK;
+    }
+    self->log->stream = NULL;
+
+    #if PYBRICKS_PY_COMMON_LOGGER_REAL_FILE
+    // Writing to a local file should not fail, so raise errors here.
+    if (fclose(self->stream_file) != 0 && err == PBIO_SUCCESS) {
+        err = PBIO_ERROR_IO;
+    }
+    self->stream_file = NULL;
+    pb_assert(err);
+    #endif
+}
+
 STATIC mp_obj_t tools_Logger_start(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
     PB_PARSE_ARGS_METHOD(n_args, pos_args, kw_args,
         tools_Logger_obj_t, self,
         PB_ARG_REQUIRED(duration),
-        PB_ARG_DEFAULT_INT(down_sample, 1));
+        PB_ARG_DEFAULT_INT(down_sample, 1),
+        PB_ARG_DEFAULT_FALSE(compact));
 
     // Log only one row per divisor samples.
     mp_uint_t down_sample = pbio_int_math_max(pb_obj_get_int(down_sample_in), 1);
-    mp_uint_t num_rows = pb_obj_get_int(duration_in) / PBIO_CONFIG_CONTROL_LOOP_TIME_MS / down_sample;
+    mp_uint_t num_rows = pb_obj_get_int(duration_in) / pbio_control_settings_get_loop_time() / down_sample;
+
+    // End any ongoing stream before reusing the buffer.
+    tools_Logger_stop_stream(self);
+
+    if (mp_obj_is_true(compact_in)) {
+        // Most values take one byte in the compact format. Some take more, so
+        // allow two bytes per value on average. The log stops early if the
+        // data doesn't fit. One more row holds the previous row values.
+        tools_Logger_alloc(self, num_rows / 2 + 2);
+        pb_assert(pbio_logger_start_compact(self->log, self->buf, self->last_size * sizeof(int32_t), self->num_cols, down_sample));
+        return mp_const_none;
+    }
 
-    // Size is number of rows times column width. All data are int32.
-    mp_int_t size = num_rows * self->num_cols;
-    self->buf = m_renew(int32_t, self->buf, self->last_size, size);
-    self->last_size = size;
+    tools_Logger_alloc(self, num_rows);
 
     // Indicates that background control loops may enter data in log.
     pbio_logger_start(self->log, self->buf, num_rows, self->num_cols, down_sample);
@@ -68,16 +156,133 @@ STATIC mp_obj_t tools_Logger_start(size_t n_args, const mp_obj_t *pos_args, mp_m
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_KW(tools_Logger_start_obj, 1, tools_Logger_start);
 
+STATIC mp_obj_t tools_Logger_stream(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    PB_PARSE_ARGS_METHOD(n_args, pos_args, kw_args,
+        tools_Logger_obj_t, self,
+        PB_ARG_DEFAULT_INT(down_sample, 1),
+        PB_ARG_DEFAULT_INT(buffer, 32),
+        PB_ARG_DEFAULT_NONE(path));
+
+    // Log only one row per divisor samples.
+    mp_uint_t down_sample = pbio_int_math_max(pb_obj_get_int(down_sample_in), 1);
+
+    // Only rows that have not been sent yet are buffered.
+    mp_uint_t num_rows = pbio_int_math_max(pb_obj_get_int(buffer_in), 1);
+
+    // End any ongoing stream before reusing the buffer.
+    tools_Logger_stop_stream(self);
+    tools_Logger_alloc(self, num_rows);
+
+    #if PYBRICKS_PY_COMMON_LOGGER_REAL_FILE
+    // Rows are written to a local file as they come in.
+    const char *path = path_in == mp_const_none ? "log.txt" : mp_obj_str_get_str(path_in);
+    self->stream_file = fopen(path, "w");
+    if (self->stream_file == NULL) {
+        pb_assert(PBIO_ERROR_IO);
+    }
+    #else
+    // Rows are sent over Bluetooth, which does not use file names.
+    if (path_in != mp_const_none) {
+        pb_assert(PBIO_ERROR_NOT_SUPPORTED);
+    }
+    // Check that there is somewhere to send the data to.
+    pb_assert(pbsys_bluetooth_tx_log(NULL, 0));
+    #endif // PYBRICKS_PY_COMMON_LOGGER_REAL_FILE
+
+    // Indicates that background control loops may enter data in log.
+    pbio_logger_start_stream(self->log, self->buf, num_rows, self->num_cols, down_sample, tools_Logger_stream_row, self);
+
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(tools_Logger_stream_obj, 1, tools_Logger_stream);
+
+STATIC mp_obj_t tools_Logger_stream_stats(mp_obj_t self_in) {
+    tools_Logger_obj_t *self = MP_OBJ_TO_PTR(self_in);
+
+    mp_obj_t stats[] = {
+        mp_obj_new_int(pbio_logger_get_num_rows_sent(self->log)),
+        mp_obj_new_int(pbio_logger_get_num_rows_dropped(self->log)),
+    };
+    return mp_obj_new_tuple(MP_ARRAY_SIZE(stats), stats);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(tools_Logger_stream_stats_obj, tools_Logger_stream_stats);
+
 STATIC mp_obj_t tools_Logger_stop(mp_obj_t self_in) {
     tools_Logger_obj_t *self = MP_OBJ_TO_PTR(self_in);
 
-    // Indicates that background control loops log write more data.
-    pbio_logger_stop(self->log);
+    // Indicates that background control loops log write more data. If
+    // streaming, this also sends out the remaining buffered rows.
+    tools_Logger_stop_stream(self);
 
     return mp_const_none;
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(tools_Logger_stop_obj, tools_Logger_stop);
 
+#if !PYBRICKS_PY_COMMON_LOGGER_REAL_FILE
+// Prints data as base64 encoded lines, since stdout carries text.
+STATIC void tools_Logger_print_base64(const uint8_t *data, uint32_t size) {
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    // Each line has up to 48 bytes of data, encoded as 64 characters.
+    char line[64 + 2];
+    uint32_t line_len = 0;
+
+    for (uint32_t i = 0; i < size; i += 3) {
+        uint32_t chunk = data[i] << 16;
+        if (i + 1 < size) {
+            chunk |= data[i + 1] << 8;
+        }
+        if (i + 2 < size) {
+            chunk |= data[i + 2];
+        }
+        line[line_len++] = alphabet[(chunk >> 18) & 0x3F];
+        line[line_len++] = alphabet[(chunk >> 12) & 0x3F];
+        line[line_len++] = i + 1 < size ? alphabet[(chunk >> 6) & 0x3F] : '=';
+        line[line_len++] = i + 2 < size ? alphabet[chunk & 0x3F] : '=';
+
+        if (line_len == 64 || i + 3 >= size) {
+            line[line_len++] = '\n';
+            line[line_len] = '\0';
+            mp_print_str(&mp_plat_print, line);
+            line_len = 0;
+
+            // Writing data can take a while, so give system some time too.
+            MICROPY_VM_HOOK_LOOP
+            mp_handle_pending(true);
+        }
+    }
+}
+#endif // !PYBRICKS_PY_COMMON_LOGGER_REAL_FILE
+
+// Saves a compact log as a header followed by the encoded rows.
+STATIC void tools_Logger_save_compact(tools_Logger_obj_t *self, const char *path) {
+
+    uint8_t header[PBIO_LOGGER_COMPACT_HEADER_SIZE];
+    pbio_logger_get_compact_header(self->log, header);
+
+    uint32_t size;
+    const uint8_t *data = pbio_logger_get_compact_data(self->log, &size);
+
+    #if PYBRICKS_PY_COMMON_LOGGER_REAL_FILE
+    FILE *log_file = fopen(path, "wb");
+    if (log_file == NULL) {
+        pb_assert(PBIO_ERROR_IO);
+    }
+    bool ok = fwrite(header, 1, sizeof(header), log_file) == sizeof(header) &&
+        fwrite(data, 1, size, log_file) == size;
+    if (fclose(log_file) != 0 || !ok) {
+        pb_assert(PBIO_ERROR_IO);
+    }
+    #else
+    // Tell IDE to open remote file. The data can be decoded on the computer
+    // with tools/logdecode.py.
+    mp_printf(&mp_plat_print, "PB_OF:%s\n", path);
+    tools_Logger_print_base64(header, sizeof(header));
+    tools_Logger_print_base64(data, size);
+    mp_print_str(&mp_plat_print, "PB_EOF\n");
+    #endif // PYBRICKS_PY_COMMON_LOGGER_REAL_FILE
+}
+
 STATIC mp_obj_t tools_Logger_save(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
 
     PB_PARSE_ARGS_METHOD(n_args, pos_args, kw_args,
@@ -85,11 +290,17 @@ STATIC mp_obj_t tools_Logger_save(size_t n_args, const mp_obj_t *pos_args, mp_ma
         PB_ARG_DEFAULT_NONE(path));
 
     // Don't allow any more data to be added to logs.
-    pbio_logger_stop(self->log);
+    tools_Logger_stop_stream(self);
 
     // Get log file path.
     const char *path = path_in == mp_const_none ? "log.txt" : mp_obj_str_get_str(path_in);
 
+    // Compact logs are saved as they are stored.
+    if (self->log->compact_data) {
+        tools_Logger_save_compact(self, path);
+        return mp_const_none;
+    }
+
     #if PYBRICKS_PY_COMMON_LOGGER_REAL_FILE
     // Create an empty log file locally.
     FILE *log_file = fopen(path, "w");
@@ -148,6 +359,8 @@ STATIC const mp_rom_map_elem_t tools_Logger_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_start), MP_ROM_PTR(&tools_Logger_start_obj) },
     { MP_ROM_QSTR(MP_QSTR_stop), MP_ROM_PTR(&tools_Logger_stop_obj) },
     { MP_ROM_QSTR(MP_QSTR_save), MP_ROM_PTR(&tools_Logger_save_obj) },
+    { MP_ROM_QSTR(MP_QSTR_stream), MP_ROM_PTR(&tools_Logger_stream_obj) },
+    { MP_ROM_QSTR(MP_QSTR_stream_stats), MP_ROM_PTR(&tools_Logger_stream_stats_obj) },
 };
 STATIC MP_DEFINE_CONST_DICT(tools_Logger_locals_dict, tools_Logger_locals_dict_table);
 
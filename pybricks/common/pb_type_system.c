@@ -8,6 +8,8 @@
 #include <string.h>
 
 #include <pbdrv/bluetooth.h>
+#include <pbio/control_settings.h>
+#include <pbio/motor_process.h>
 #include <pbsys/program_load.h>
 
 #include "py/obj.h"
@@ -124,6 +126,65 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_KW(pb_type_System_storage_obj, 0, pb_type_System_
 
 #endif // PBIO_CONFIG_ENABLE_SYS
 
+#if PBIO_CONFIG_MOTOR_PROCESS_STATS
+
+STATIC mp_obj_t pb_type_System_loop_stats(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    PB_PARSE_ARGS_FUNCTION(n_args, pos_args, kw_args,
+        PB_ARG_DEFAULT_FALSE(reset));
+
+    const pbio_motor_process_stats_t *stats = pbio_motor_process_get_stats();
+
+    // Execution time (min, max, mean) in microseconds for each stage.
+    mp_obj_t ret[PBIO_MOTOR_PROCESS_NUM_STAGES + 2];
+    for (uint8_t i = 0; i < PBIO_MOTOR_PROCESS_NUM_STAGES; i++) {
+        const pbio_motor_process_stage_stats_t *stage = &stats->stages[i];
+        mp_obj_t times[] = {
+            mp_obj_new_int(stage->count ? stage->time_min : 0),
+            mp_obj_new_int(stage->time_max),
+            mp_obj_new_int(pbio_motor_process_get_stage_time_mean(i)),
+        };
+        ret[i] = mp_obj_new_tuple(MP_ARRAY_SIZE(times), times);
+    }
+
+    // Loop period jitter histogram.
+    mp_obj_t histogram[PBIO_MOTOR_PROCESS_STATS_JITTER_NUM_BINS];
+    for (uint8_t i = 0; i < PBIO_MOTOR_PROCESS_STATS_JITTER_NUM_BINS; i++) {
+        histogram[i] = mp_obj_new_int(stats->jitter_histogram[i]);
+    }
+    ret[PBIO_MOTOR_PROCESS_NUM_STAGES] = mp_obj_new_tuple(MP_ARRAY_SIZE(histogram), histogram);
+
+    // Number of times the loop fell behind.
+    ret[PBIO_MOTOR_PROCESS_NUM_STAGES + 1] = mp_obj_new_int(stats->overruns);
+
+    if (mp_obj_is_true(reset_in)) {
+        pbio_motor_process_reset_stats();
+    }
+
+    return mp_obj_new_tuple(MP_ARRAY_SIZE(ret), ret);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(pb_type_System_loop_stats_obj, 0, pb_type_System_loop_stats);
+
+#endif // PBIO_CONFIG_MOTOR_PROCESS_STATS
+
+#if PBIO_CONFIG_CONTROL_LOOP_TIME_ADJUSTABLE
+
+STATIC mp_obj_t pb_type_System_loop_time(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    PB_PARSE_ARGS_FUNCTION(n_args, pos_args, kw_args,
+        PB_ARG_DEFAULT_NONE(time));
+
+    // Return current value if no argument is given.
+    if (time_in == mp_const_none) {
+        return mp_obj_new_int(pbio_control_settings_get_loop_time());
+    }
+
+    // Otherwise set the new loop time, which applies to all motors.
+    pb_assert(pbio_control_settings_set_loop_time(pb_obj_get_positive_int(time_in)));
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(pb_type_System_loop_time_obj, 0, pb_type_System_loop_time);
+
+#endif // PBIO_CONFIG_CONTROL_LOOP_TIME_ADJUSTABLE
+
 // dir(pybricks.common.System)
 STATIC const mp_rom_map_elem_t common_System_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_name), MP_ROM_PTR(&pb_type_System_name_obj) },
@@ -135,6 +196,12 @@ STATIC const mp_rom_map_elem_t common_System_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_shutdown), MP_ROM_PTR(&pb_type_System_shutdown_obj) },
     { MP_ROM_QSTR(MP_QSTR_storage), MP_ROM_PTR(&pb_type_System_storage_obj) },
     #endif
+    #if PBIO_CONFIG_MOTOR_PROCESS_STATS
+    { MP_ROM_QSTR(MP_QSTR_loop_stats), MP_ROM_PTR(&pb_type_System_loop_stats_obj) },
+    #endif
+    #if PBIO_CONFIG_CONTROL_LOOP_TIME_ADJUSTABLE
+    { MP_ROM_QSTR(MP_QSTR_loop_time), MP_ROM_PTR(&pb_type_System_loop_time_obj) },
+    #endif
 };
 STATIC MP_DEFINE_CONST_DICT(common_System_locals_dict, common_System_locals_dict_table);
 
@@ -16,12 +16,16 @@
 #include <pybricks/util_mp/pb_kwarg_helper.h>
 
 #include <pybricks/common.h>
+#include <pybricks/tools/pb_type_matrix.h>
 #include <pybricks/hubs.h>
 
 typedef struct _hubs_VirtualHub_obj_t {
     mp_obj_base_t base;
     mp_obj_t battery;
     mp_obj_t buttons;
+    #if PYBRICKS_PY_COMMON_IMU
+    mp_obj_t imu;
+    #endif
     mp_obj_t light;
     mp_obj_t system;
 } hubs_VirtualHub_obj_t;
@@ -31,9 +35,19 @@ static const pb_obj_enum_member_t *virtualhub_buttons[] = {
 };
 
 STATIC mp_obj_t hubs_VirtualHub_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
+    #if PYBRICKS_PY_COMMON_IMU
+    PB_PARSE_ARGS_CLASS(n_args, n_kw, args,
+        PB_ARG_DEFAULT_OBJ(top_side, pb_type_Axis_Z_obj),
+        PB_ARG_DEFAULT_OBJ(front_side, pb_type_Axis_X_obj));
+    #endif
+
     hubs_VirtualHub_obj_t *self = mp_obj_malloc(hubs_VirtualHub_obj_t, type);
     self->battery = MP_OBJ_FROM_PTR(&pb_module_battery);
     self->buttons = pb_type_Keypad_obj_new(MP_ARRAY_SIZE(virtualhub_buttons), virtualhub_buttons, pbio_button_is_pressed);
+    #if PYBRICKS_PY_COMMON_IMU
+    // The IMU data is replayed from a recording, if given.
+    self->imu = pb_type_IMU_obj_new(top_side_in, front_side_in);
+    #endif
     // FIXME: Implement lights.
     // self->light = common_ColorLight_internal_obj_new(pbsys_status_light);
     self->system = MP_OBJ_FROM_PTR(&pb_type_System);
@@ -43,6 +57,9 @@ STATIC mp_obj_t hubs_VirtualHub_make_new(const mp_obj_type_t *type, size_t n_arg
 STATIC const pb_attr_dict_entry_t hubs_VirtualHub_attr_dict[] = {
     PB_DEFINE_CONST_ATTR_RO(MP_QSTR_battery, hubs_VirtualHub_obj_t, battery),
     PB_DEFINE_CONST_ATTR_RO(MP_QSTR_buttons, hubs_VirtualHub_obj_t, buttons),
+    #if PYBRICKS_PY_COMMON_IMU
+    PB_DEFINE_CONST_ATTR_RO(MP_QSTR_imu, hubs_VirtualHub_obj_t, imu),
+    #endif
     // PB_DEFINE_CONST_ATTR_RO(MP_QSTR_light, hubs_VirtualHub_obj_t, light),
     PB_DEFINE_CONST_ATTR_RO(MP_QSTR_system, hubs_VirtualHub_obj_t, system),
     PB_ATTR_DICT_SENTINEL
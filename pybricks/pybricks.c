@@ -135,4 +135,8 @@ void pb_package_pybricks_deinit(void) {
     #if PYBRICKS_PY_PUPDEVICES
     pb_type_Remote_cleanup();
     #endif // PYBRICKS_PY_PUPDEVICES
+    // Stop recording IMU data.
+    #if PYBRICKS_PY_COMMON && PYBRICKS_PY_COMMON_IMU
+    pb_type_IMU_cleanup();
+    #endif // PYBRICKS_PY_COMMON && PYBRICKS_PY_COMMON_IMU
 }
@@ -20,6 +20,10 @@ extern const mp_obj_type_t pb_type_drivebase;
 extern const mp_obj_type_t pb_type_spikebase;
 #endif
 
+#if PYBRICKS_PY_ROBOTICS_EXTRA
+extern const mp_obj_type_t pb_type_motorgroup;
+#endif
+
 
 #endif // PYBRICKS_PY_ROBOTICS
 
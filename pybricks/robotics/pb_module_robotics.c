@@ -39,6 +39,9 @@ STATIC const mp_rom_map_elem_t robotics_globals_table[] = {
     #if PYBRICKS_PY_ROBOTICS_DRIVEBASE_SPIKE
     { MP_ROM_QSTR(MP_QSTR_SpikeBase),   MP_ROM_PTR(&pb_type_spikebase)  },
     #endif
+    #if PYBRICKS_PY_ROBOTICS_EXTRA
+    { MP_ROM_QSTR(MP_QSTR_MotorGroup),  MP_ROM_PTR(&pb_type_motorgroup) },
+    #endif
     #endif
     #if PYBRICKS_PY_ROBOTICS_EXTRA
     { MP_ROM_QSTR(MP_QSTR___init__),    MP_ROM_PTR(&pb_module_robotics___init___obj) },
@@ -14,9 +14,12 @@
 #include "py/mphal.h"
 
 #include <pybricks/common.h>
+#include <pybricks/ev3devices.h>
 #include <pybricks/parameters.h>
+#include <pybricks/pupdevices.h>
 #include <pybricks/robotics.h>
 #include <pybricks/tools.h>
+#include <pybricks/common/pb_type_device.h>
 #include <pybricks/tools/pb_type_awaitable.h>
 
 #include <pybricks/util_mp/pb_kwarg_helper.h>
@@ -48,6 +51,11 @@ STATIC mp_obj_t pb_type_DriveBase_reset(mp_obj_t self_in) {
     self->initial_distance = distance;
     self->initial_heading = angle;
 
+    #if PYBRICKS_PY_ROBOTICS_DRIVEBASE_POSE
+    // The pose is relative to where the drive base was reset.
+    pb_assert(pbio_drivebase_reset_pose(self->db, 0.0f, 0.0f, 0.0f));
+    #endif
+
     return mp_const_none;
 }
 MP_DEFINE_CONST_FUN_OBJ_1(pb_type_DriveBase_reset_obj, pb_type_DriveBase_reset);
@@ -55,24 +63,55 @@ MP_DEFINE_CONST_FUN_OBJ_1(pb_type_DriveBase_reset_obj, pb_type_DriveBase_reset);
 // pybricks.robotics.DriveBase.__init__
 STATIC mp_obj_t pb_type_DriveBase_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
 
+    #if PBIO_CONFIG_DRIVEBASE_NUM_WHEELS > 2
+    PB_PARSE_ARGS_CLASS(n_args, n_kw, args,
+        PB_ARG_REQUIRED(left_motor),
+        PB_ARG_REQUIRED(right_motor),
+        PB_ARG_REQUIRED(wheel_diameter),
+        PB_ARG_REQUIRED(axle_track),
+        PB_ARG_DEFAULT_NONE(rear_left_motor),
+        PB_ARG_DEFAULT_NONE(rear_right_motor),
+        PB_ARG_DEFAULT_FALSE(mecanum));
+    #else
     PB_PARSE_ARGS_CLASS(n_args, n_kw, args,
         PB_ARG_REQUIRED(left_motor),
         PB_ARG_REQUIRED(right_motor),
         PB_ARG_REQUIRED(wheel_diameter),
         PB_ARG_REQUIRED(axle_track));
+    #endif
 
     pb_type_DriveBase_obj_t *self = mp_obj_malloc(pb_type_DriveBase_obj_t, type);
 
     // Pointers to servos
     pbio_servo_t *srv_left = ((pb_type_Motor_obj_t *)pb_obj_get_base_class_obj(left_motor_in, &pb_type_Motor))->srv;
     pbio_servo_t *srv_right = ((pb_type_Motor_obj_t *)pb_obj_get_base_class_obj(right_motor_in, &pb_type_Motor))->srv;
-
-    // Create drivebase. Initialized to use motor encoders (not gyro) for heading.
-    pb_assert(pbio_drivebase_get_drivebase(&self->db,
-        srv_left,
-        srv_right,
-        pb_obj_get_scaled_int(wheel_diameter_in, 1000),
-        pb_obj_get_scaled_int(axle_track_in, 1000)));
+    int32_t wheel_diameter = pb_obj_get_scaled_int(wheel_diameter_in, 1000);
+    int32_t axle_track = pb_obj_get_scaled_int(axle_track_in, 1000);
+
+    #if PBIO_CONFIG_DRIVEBASE_NUM_WHEELS > 2
+    // With rear motors, the left and right motors are at the front.
+    if (rear_left_motor_in != mp_const_none || rear_right_motor_in != mp_const_none) {
+        pbio_servo_t *srv_rear_left = ((pb_type_Motor_obj_t *)pb_obj_get_base_class_obj(rear_left_motor_in, &pb_type_Motor))->srv;
+        pbio_servo_t *srv_rear_right = ((pb_type_Motor_obj_t *)pb_obj_get_base_class_obj(rear_right_motor_in, &pb_type_Motor))->srv;
+
+        pbio_drivebase_wheel_t wheels[4];
+        pbio_drivebase_get_mecanum_wheels(srv_left, srv_right, srv_rear_left, srv_rear_right, wheels);
+
+        // Without mecanum wheels, each side drives like one wheel.
+        if (!mp_obj_is_true(mecanum_in)) {
+            for (uint8_t i = 0; i < MP_ARRAY_SIZE(wheels); i++) {
+                wheels[i].lateral = 0;
+            }
+        }
+        pb_assert(pbio_drivebase_get_drivebase_wheels(&self->db, wheels, MP_ARRAY_SIZE(wheels), wheel_diameter, axle_track));
+    } else if (mp_obj_is_true(mecanum_in)) {
+        mp_raise_ValueError(MP_ERROR_TEXT("mecanum drive needs four motors"));
+    } else
+    #endif
+    {
+        // Create drivebase. Initialized to use motor encoders (not gyro) for heading.
+        pb_assert(pbio_drivebase_get_drivebase(&self->db, srv_left, srv_right, wheel_diameter, axle_track));
+    }
 
     #if PYBRICKS_PY_COMMON_CONTROL
     // Create instances of the Control class
@@ -189,12 +228,65 @@ STATIC mp_obj_t pb_type_DriveBase_curve(size_t n_args, const mp_obj_t *pos_args,
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_KW(pb_type_DriveBase_curve_obj, 1, pb_type_DriveBase_curve);
 
+#if PBIO_CONFIG_DRIVEBASE_PATH_SIZE
+// pybricks.robotics.DriveBase.path
+STATIC mp_obj_t pb_type_DriveBase_path(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    PB_PARSE_ARGS_METHOD(n_args, pos_args, kw_args,
+        pb_type_DriveBase_obj_t, self,
+        PB_ARG_REQUIRED(segments),
+        PB_ARG_DEFAULT_OBJ(then, pb_Stop_HOLD_obj),
+        PB_ARG_DEFAULT_TRUE(wait));
+
+    pbio_control_on_completion_t then = pb_type_enum_get_value(then_in, &pb_enum_type_Stop);
+
+    // Each segment is either a distance to drive straight by, or a
+    // (radius, angle) tuple to drive along an arc as in curve().
+    pbio_drivebase_path_segment_t segments[PBIO_CONFIG_DRIVEBASE_PATH_SIZE];
+    size_t num_segments = 0;
+    mp_obj_iter_buf_t iter_buf;
+    mp_obj_t segments_iter = mp_getiter(segments_in, &iter_buf);
+    mp_obj_t segment_in;
+    while ((segment_in = mp_iternext(segments_iter)) != MP_OBJ_STOP_ITERATION) {
+        if (num_segments == PBIO_CONFIG_DRIVEBASE_PATH_SIZE) {
+            pb_assert(PBIO_ERROR_INVALID_ARG);
+        }
+        pbio_drivebase_path_segment_t *segment = &segments[num_segments++];
+        if (mp_obj_is_int(segment_in) || mp_obj_is_float(segment_in)) {
+            segment->distance = pb_obj_get_int(segment_in);
+            segment->angle = 0;
+        } else {
+            mp_obj_t *arc;
+            mp_obj_get_array_fixed_n(segment_in, 2, &arc);
+            pbio_drivebase_get_arc_segment(pb_obj_get_int(arc[0]), pb_obj_get_int(arc[1]), segment);
+        }
+    }
+
+    pb_assert(pbio_drivebase_drive_path(self->db, segments, num_segments, then));
+
+    // Old way to do parallel movement is to start and not wait on anything.
+    if (!mp_obj_is_true(wait_in)) {
+        return mp_const_none;
+    }
+    // Handle completion by awaiting or blocking.
+    return await_or_wait(self);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(pb_type_DriveBase_path_obj, 1, pb_type_DriveBase_path);
+#endif // PBIO_CONFIG_DRIVEBASE_PATH_SIZE
+
 // pybricks.robotics.DriveBase.drive
 STATIC mp_obj_t pb_type_DriveBase_drive(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    #if PBIO_CONFIG_DRIVEBASE_NUM_WHEELS > 2
+    PB_PARSE_ARGS_METHOD(n_args, pos_args, kw_args,
+        pb_type_DriveBase_obj_t, self,
+        PB_ARG_REQUIRED(speed),
+        PB_ARG_REQUIRED(turn_rate),
+        PB_ARG_DEFAULT_INT(lateral_speed, 0));
+    #else
     PB_PARSE_ARGS_METHOD(n_args, pos_args, kw_args,
         pb_type_DriveBase_obj_t, self,
         PB_ARG_REQUIRED(speed),
         PB_ARG_REQUIRED(turn_rate));
+    #endif
 
     // Get wheel diameter and axle track dimensions
     mp_int_t speed = pb_obj_get_int(speed_in);
@@ -203,11 +295,53 @@ STATIC mp_obj_t pb_type_DriveBase_drive(size_t n_args, const mp_obj_t *pos_args,
     // Cancel awaitables but not hardware. Drive forever will handle this.
     pb_type_awaitable_update_all(self->awaitables, PB_TYPE_AWAITABLE_OPT_CANCEL_ALL);
 
+    #if PBIO_CONFIG_DRIVEBASE_NUM_WHEELS > 2
+    pb_assert(pbio_drivebase_drive_forever_holonomic(self->db, speed, pb_obj_get_int(lateral_speed_in), turn_rate));
+    #else
     pb_assert(pbio_drivebase_drive_forever(self->db, speed, turn_rate));
+    #endif
     return mp_const_none;
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_KW(pb_type_DriveBase_drive_obj, 1, pb_type_DriveBase_drive);
 
+#if PBIO_CONFIG_DRIVEBASE_FOLLOW
+// pybricks.robotics.DriveBase.follow_line
+STATIC mp_obj_t pb_type_DriveBase_follow_line(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    PB_PARSE_ARGS_METHOD(n_args, pos_args, kw_args,
+        pb_type_DriveBase_obj_t, self,
+        PB_ARG_REQUIRED(sensor),
+        PB_ARG_REQUIRED(speed),
+        PB_ARG_DEFAULT_INT(target, 50),
+        PB_ARG_DEFAULT_INT(kp, 3),
+        PB_ARG_DEFAULT_INT(ki, 0),
+        PB_ARG_DEFAULT_INT(kd, 0));
+
+    // Only color sensors that measure reflection can be used. They all start
+    // with the common device base.
+    if (
+        #if PYBRICKS_PY_PUPDEVICES
+        !mp_obj_is_type(sensor_in, &pb_type_pupdevices_ColorSensor) &&
+        !mp_obj_is_type(sensor_in, &pb_type_pupdevices_ColorDistanceSensor) &&
+        #endif
+        #if PYBRICKS_PY_EV3DEVICES
+        !mp_obj_is_type(sensor_in, &pb_type_ev3devices_ColorSensor) &&
+        #endif
+        true) {
+        mp_raise_TypeError(MP_ERROR_TEXT("sensor must measure reflection"));
+    }
+    pb_type_device_obj_base_t *sensor = MP_OBJ_TO_PTR(sensor_in);
+
+    // Cancel awaitables but not hardware. Following will handle this.
+    pb_type_awaitable_update_all(self->awaitables, PB_TYPE_AWAITABLE_OPT_CANCEL_ALL);
+
+    pb_assert(pbio_drivebase_follow(self->db, pbio_drivebase_follow_get_reflection, sensor->legodev,
+        pb_obj_get_int(speed_in), mp_obj_get_float(target_in),
+        mp_obj_get_float(kp_in), mp_obj_get_float(ki_in), mp_obj_get_float(kd_in)));
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(pb_type_DriveBase_follow_line_obj, 1, pb_type_DriveBase_follow_line);
+#endif // PBIO_CONFIG_DRIVEBASE_FOLLOW
+
 // pybricks.robotics.DriveBase.stop
 STATIC mp_obj_t pb_type_DriveBase_stop(mp_obj_t self_in) {
 
@@ -275,6 +409,46 @@ STATIC mp_obj_t pb_type_DriveBase_state(mp_obj_t self_in) {
 }
 MP_DEFINE_CONST_FUN_OBJ_1(pb_type_DriveBase_state_obj, pb_type_DriveBase_state);
 
+#if PYBRICKS_PY_ROBOTICS_DRIVEBASE_POSE
+// pybricks.robotics.DriveBase.pose
+STATIC mp_obj_t pb_type_DriveBase_pose(mp_obj_t self_in) {
+    pb_type_DriveBase_obj_t *self = MP_OBJ_TO_PTR(self_in);
+
+    float x, y, heading;
+    pb_assert(pbio_drivebase_get_pose(self->db, &x, &y, &heading));
+
+    mp_obj_t ret[3];
+    ret[0] = mp_obj_new_float_from_f(x);
+    ret[1] = mp_obj_new_float_from_f(y);
+    ret[2] = mp_obj_new_float_from_f(heading);
+
+    return mp_obj_new_tuple(3, ret);
+}
+MP_DEFINE_CONST_FUN_OBJ_1(pb_type_DriveBase_pose_obj, pb_type_DriveBase_pose);
+
+// pybricks.robotics.DriveBase.drive_to
+STATIC mp_obj_t pb_type_DriveBase_drive_to(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    PB_PARSE_ARGS_METHOD(n_args, pos_args, kw_args,
+        pb_type_DriveBase_obj_t, self,
+        PB_ARG_REQUIRED(x),
+        PB_ARG_REQUIRED(y),
+        PB_ARG_DEFAULT_OBJ(then, pb_Stop_HOLD_obj),
+        PB_ARG_DEFAULT_TRUE(wait));
+
+    pbio_control_on_completion_t then = pb_type_enum_get_value(then_in, &pb_enum_type_Stop);
+
+    pb_assert(pbio_drivebase_drive_to(self->db, mp_obj_get_float(x_in), mp_obj_get_float(y_in), then));
+
+    // Old way to do parallel movement is to start and not wait on anything.
+    if (!mp_obj_is_true(wait_in)) {
+        return mp_const_none;
+    }
+    // Handle completion by awaiting or blocking.
+    return await_or_wait(self);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(pb_type_DriveBase_drive_to_obj, 1, pb_type_DriveBase_drive_to);
+#endif // PYBRICKS_PY_ROBOTICS_DRIVEBASE_POSE
+
 // pybricks.robotics.DriveBase.done
 STATIC mp_obj_t pb_type_DriveBase_done(mp_obj_t self_in) {
     pb_type_DriveBase_obj_t *self = MP_OBJ_TO_PTR(self_in);
@@ -292,6 +466,43 @@ STATIC mp_obj_t pb_type_DriveBase_stalled(mp_obj_t self_in) {
 }
 MP_DEFINE_CONST_FUN_OBJ_1(pb_type_DriveBase_stalled_obj, pb_type_DriveBase_stalled);
 
+#if PBIO_CONFIG_DRIVEBASE_SLIP
+// pybricks.robotics.DriveBase.slipping
+STATIC mp_obj_t pb_type_DriveBase_slipping(mp_obj_t self_in) {
+    pb_type_DriveBase_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    bool slipping;
+    float heading_rate_error, acceleration_error;
+    pb_assert(pbio_drivebase_is_slipping(self->db, &slipping, &heading_rate_error, &acceleration_error));
+    return mp_obj_new_bool(slipping);
+}
+MP_DEFINE_CONST_FUN_OBJ_1(pb_type_DriveBase_slipping_obj, pb_type_DriveBase_slipping);
+
+// pybricks.robotics.DriveBase.slip_errors
+STATIC mp_obj_t pb_type_DriveBase_slip_errors(mp_obj_t self_in) {
+    pb_type_DriveBase_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    bool slipping;
+    float heading_rate_error, acceleration_error;
+    pb_assert(pbio_drivebase_is_slipping(self->db, &slipping, &heading_rate_error, &acceleration_error));
+
+    mp_obj_t ret[2];
+    ret[0] = mp_obj_new_float_from_f(heading_rate_error);
+    ret[1] = mp_obj_new_float_from_f(acceleration_error);
+
+    return mp_obj_new_tuple(2, ret);
+}
+MP_DEFINE_CONST_FUN_OBJ_1(pb_type_DriveBase_slip_errors_obj, pb_type_DriveBase_slip_errors);
+
+// pybricks.robotics.DriveBase.limit_slip
+STATIC mp_obj_t pb_type_DriveBase_limit_slip(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    PB_PARSE_ARGS_METHOD(n_args, pos_args, kw_args,
+        pb_type_DriveBase_obj_t, self,
+        PB_ARG_REQUIRED(limit));
+    pbio_drivebase_set_slip_limit(self->db, mp_obj_is_true(limit_in));
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(pb_type_DriveBase_limit_slip_obj, 1, pb_type_DriveBase_limit_slip);
+#endif
+
 // pybricks.robotics.DriveBase.settings
 STATIC mp_obj_t pb_type_DriveBase_settings(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
 
@@ -342,6 +553,28 @@ STATIC mp_obj_t pb_type_DriveBase_settings(size_t n_args, const mp_obj_t *pos_ar
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_KW(pb_type_DriveBase_settings_obj, 1, pb_type_DriveBase_settings);
 
+#if PBIO_CONFIG_TRAJECTORY_S_CURVE
+// pybricks.robotics.DriveBase.profile
+STATIC mp_obj_t pb_type_DriveBase_profile(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+
+    PB_PARSE_ARGS_METHOD(n_args, pos_args, kw_args,
+        pb_type_DriveBase_obj_t, self,
+        PB_ARG_DEFAULT_NONE(s_curve));
+
+    // If no value is given, return current value
+    if (s_curve_in == mp_const_none) {
+        return mp_obj_new_bool(pbio_drivebase_get_drive_profile(self->db) == PBIO_TRAJECTORY_PROFILE_S_CURVE);
+    }
+
+    // Set the profile for both distance and heading.
+    pbio_trajectory_profile_t profile = mp_obj_is_true(s_curve_in) ? PBIO_TRAJECTORY_PROFILE_S_CURVE : PBIO_TRAJECTORY_PROFILE_TRAPEZOID;
+    pb_assert(pbio_drivebase_set_drive_profile(self->db, profile));
+
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(pb_type_DriveBase_profile_obj, 1, pb_type_DriveBase_profile);
+#endif // PBIO_CONFIG_TRAJECTORY_S_CURVE
+
 #if PYBRICKS_PY_ROBOTICS_DRIVEBASE_GYRO
 // pybricks.robotics.DriveBase.use_gyro
 STATIC mp_obj_t pb_type_DriveBase_use_gyro(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
@@ -368,6 +601,12 @@ STATIC const mp_rom_map_elem_t pb_type_DriveBase_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_straight),         MP_ROM_PTR(&pb_type_DriveBase_straight_obj) },
     { MP_ROM_QSTR(MP_QSTR_turn),             MP_ROM_PTR(&pb_type_DriveBase_turn_obj)     },
     { MP_ROM_QSTR(MP_QSTR_drive),            MP_ROM_PTR(&pb_type_DriveBase_drive_obj)    },
+    #if PBIO_CONFIG_DRIVEBASE_PATH_SIZE
+    { MP_ROM_QSTR(MP_QSTR_path),             MP_ROM_PTR(&pb_type_DriveBase_path_obj)     },
+    #endif
+    #if PBIO_CONFIG_DRIVEBASE_FOLLOW
+    { MP_ROM_QSTR(MP_QSTR_follow_line),      MP_ROM_PTR(&pb_type_DriveBase_follow_line_obj) },
+    #endif
     { MP_ROM_QSTR(MP_QSTR_stop),             MP_ROM_PTR(&pb_type_DriveBase_stop_obj)     },
     { MP_ROM_QSTR(MP_QSTR_brake),            MP_ROM_PTR(&pb_type_DriveBase_brake_obj)    },
     { MP_ROM_QSTR(MP_QSTR_distance),         MP_ROM_PTR(&pb_type_DriveBase_distance_obj) },
@@ -376,10 +615,22 @@ STATIC const mp_rom_map_elem_t pb_type_DriveBase_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_state),            MP_ROM_PTR(&pb_type_DriveBase_state_obj)    },
     { MP_ROM_QSTR(MP_QSTR_reset),            MP_ROM_PTR(&pb_type_DriveBase_reset_obj)    },
     { MP_ROM_QSTR(MP_QSTR_settings),         MP_ROM_PTR(&pb_type_DriveBase_settings_obj) },
+    #if PBIO_CONFIG_TRAJECTORY_S_CURVE
+    { MP_ROM_QSTR(MP_QSTR_profile),          MP_ROM_PTR(&pb_type_DriveBase_profile_obj) },
+    #endif
     { MP_ROM_QSTR(MP_QSTR_stalled),          MP_ROM_PTR(&pb_type_DriveBase_stalled_obj)  },
+    #if PBIO_CONFIG_DRIVEBASE_SLIP
+    { MP_ROM_QSTR(MP_QSTR_slipping),         MP_ROM_PTR(&pb_type_DriveBase_slipping_obj) },
+    { MP_ROM_QSTR(MP_QSTR_slip_errors),      MP_ROM_PTR(&pb_type_DriveBase_slip_errors_obj) },
+    { MP_ROM_QSTR(MP_QSTR_limit_slip),       MP_ROM_PTR(&pb_type_DriveBase_limit_slip_obj) },
+    #endif
     #if PYBRICKS_PY_ROBOTICS_DRIVEBASE_GYRO
     { MP_ROM_QSTR(MP_QSTR_use_gyro),         MP_ROM_PTR(&pb_type_DriveBase_use_gyro_obj) },
     #endif
+    #if PYBRICKS_PY_ROBOTICS_DRIVEBASE_POSE
+    { MP_ROM_QSTR(MP_QSTR_pose),             MP_ROM_PTR(&pb_type_DriveBase_pose_obj)     },
+    { MP_ROM_QSTR(MP_QSTR_drive_to),         MP_ROM_PTR(&pb_type_DriveBase_drive_to_obj) },
+    #endif
 };
 // First N entries are common to both drive base classes.
 STATIC MP_DEFINE_CONST_DICT(pb_type_DriveBase_locals_dict, pb_type_DriveBase_locals_dict_table);
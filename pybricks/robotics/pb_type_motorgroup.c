@@ -0,0 +1,165 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2023 The Pybricks Authors
+
+#include "py/mpconfig.h"
+
+#if PYBRICKS_PY_ROBOTICS && PYBRICKS_PY_ROBOTICS_EXTRA && PYBRICKS_PY_COMMON_MOTORS
+
+#include <pbio/control.h>
+#include <pbio/servo.h>
+
+#include "py/obj.h"
+#include "py/runtime.h"
+
+#include <pybricks/common.h>
+#include <pybricks/parameters.h>
+#include <pybricks/robotics.h>
+#include <pybricks/tools/pb_type_awaitable.h>
+
+#include <pybricks/util_mp/pb_kwarg_helper.h>
+#include <pybricks/util_mp/pb_obj_helper.h>
+#include <pybricks/util_pb/pb_error.h>
+
+// pybricks.robotics.MotorGroup class object
+typedef struct _pb_type_MotorGroup_obj_t {
+    mp_obj_base_t base;
+    mp_obj_t motors;
+    pbio_servo_t *srv[PBIO_CONFIG_SERVO_NUM_DEV];
+    uint8_t num_servos;
+    mp_obj_t awaitables;
+} pb_type_MotorGroup_obj_t;
+
+// pybricks.robotics.MotorGroup.__init__
+STATIC mp_obj_t pb_type_MotorGroup_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
+
+    mp_arg_check_num(n_args, n_kw, 1, PBIO_CONFIG_SERVO_NUM_DEV, false);
+
+    pb_type_MotorGroup_obj_t *self = mp_obj_malloc(pb_type_MotorGroup_obj_t, type);
+
+    // Get the servos, raising if an argument is not a motor.
+    for (size_t i = 0; i < n_args; i++) {
+        self->srv[i] = ((pb_type_Motor_obj_t *)pb_obj_get_base_class_obj(args[i], &pb_type_Motor))->srv;
+    }
+    self->num_servos = n_args;
+
+    // Keep motors so they can't be garbage collected while in use.
+    self->motors = mp_obj_new_tuple(n_args, args);
+
+    // List of awaitables associated with this group. By keeping track,
+    // we can cancel them as needed when a new movement is started.
+    self->awaitables = mp_obj_new_list(0, NULL);
+
+    return MP_OBJ_FROM_PTR(self);
+}
+
+// Checks if all motors in the group are done.
+STATIC bool pb_type_MotorGroup_is_done(pb_type_MotorGroup_obj_t *self) {
+    for (uint8_t i = 0; i < self->num_servos; i++) {
+        if (!pbio_control_is_done(&self->srv[i]->control)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+STATIC bool pb_type_MotorGroup_test_completion(mp_obj_t self_in, uint32_t end_time) {
+    pb_type_MotorGroup_obj_t *self = MP_OBJ_TO_PTR(self_in);
+
+    // Handle I/O exceptions like port unplugged.
+    for (uint8_t i = 0; i < self->num_servos; i++) {
+        if (!pbio_servo_update_loop_is_running(self->srv[i])) {
+            pb_assert(PBIO_ERROR_NO_DEV);
+        }
+    }
+
+    // Get completion state.
+    return pb_type_MotorGroup_is_done(self);
+}
+
+STATIC void pb_type_MotorGroup_cancel(mp_obj_t self_in) {
+    pb_type_MotorGroup_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    for (uint8_t i = 0; i < self->num_servos; i++) {
+        pb_assert(pbio_servo_stop(self->srv[i], PBIO_CONTROL_ON_COMPLETION_COAST));
+    }
+}
+
+// pybricks.robotics.MotorGroup.run_target
+STATIC mp_obj_t pb_type_MotorGroup_run_target(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    PB_PARSE_ARGS_METHOD(n_args, pos_args, kw_args,
+        pb_type_MotorGroup_obj_t, self,
+        PB_ARG_REQUIRED(speed),
+        PB_ARG_REQUIRED(target_angles),
+        PB_ARG_DEFAULT_OBJ(then, pb_Stop_HOLD_obj),
+        PB_ARG_DEFAULT_TRUE(wait));
+
+    mp_int_t speed = pb_obj_get_int(speed_in);
+    pbio_control_on_completion_t then = pb_type_enum_get_value(then_in, &pb_enum_type_Stop);
+
+    // Need exactly one target for each motor.
+    mp_obj_t *target_objs;
+    size_t num_targets;
+    mp_obj_get_array(target_angles_in, &num_targets, &target_objs);
+    if (num_targets != self->num_servos) {
+        pb_assert(PBIO_ERROR_INVALID_ARG);
+    }
+    int32_t targets[PBIO_CONFIG_SERVO_NUM_DEV];
+    for (size_t i = 0; i < num_targets; i++) {
+        targets[i] = pb_obj_get_int(target_objs[i]);
+    }
+
+    // Start all motors together, so they arrive at the same time.
+    pb_assert(pbio_servo_run_target_synchronized(self->srv, self->num_servos, speed, targets, then));
+
+    // Old way to do parallel movement is to start and not wait on anything.
+    if (!mp_obj_is_true(wait_in)) {
+        return mp_const_none;
+    }
+    // Handle completion by awaiting or blocking.
+    return pb_type_awaitable_await_or_wait(
+        MP_OBJ_FROM_PTR(self),
+        self->awaitables,
+        pb_type_awaitable_end_time_none,
+        pb_type_MotorGroup_test_completion,
+        pb_type_awaitable_return_none,
+        pb_type_MotorGroup_cancel,
+        PB_TYPE_AWAITABLE_OPT_CANCEL_ALL);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(pb_type_MotorGroup_run_target_obj, 1, pb_type_MotorGroup_run_target);
+
+// pybricks.robotics.MotorGroup.stop
+STATIC mp_obj_t pb_type_MotorGroup_stop(mp_obj_t self_in) {
+
+    // Cancel awaitables.
+    pb_type_MotorGroup_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    pb_type_awaitable_update_all(self->awaitables, PB_TYPE_AWAITABLE_OPT_CANCEL_ALL);
+
+    // Stop hardware.
+    pb_type_MotorGroup_cancel(self_in);
+
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(pb_type_MotorGroup_stop_obj, pb_type_MotorGroup_stop);
+
+// pybricks.robotics.MotorGroup.done
+STATIC mp_obj_t pb_type_MotorGroup_done(mp_obj_t self_in) {
+    pb_type_MotorGroup_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    return mp_obj_new_bool(pb_type_MotorGroup_is_done(self));
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(pb_type_MotorGroup_done_obj, pb_type_MotorGroup_done);
+
+// dir(pybricks.robotics.MotorGroup)
+STATIC const mp_rom_map_elem_t pb_type_MotorGroup_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_run_target),       MP_ROM_PTR(&pb_type_MotorGroup_run_target_obj) },
+    { MP_ROM_QSTR(MP_QSTR_stop),             MP_ROM_PTR(&pb_type_MotorGroup_stop_obj)       },
+    { MP_ROM_QSTR(MP_QSTR_done),             MP_ROM_PTR(&pb_type_MotorGroup_done_obj)       },
+};
+STATIC MP_DEFINE_CONST_DICT(pb_type_MotorGroup_locals_dict, pb_type_MotorGroup_locals_dict_table);
+
+// type(pybricks.robotics.MotorGroup)
+MP_DEFINE_CONST_OBJ_TYPE(pb_type_motorgroup,
+    MP_QSTR_MotorGroup,
+    MP_TYPE_FLAG_NONE,
+    make_new, pb_type_MotorGroup_make_new,
+    locals_dict, &pb_type_MotorGroup_locals_dict);
+
+#endif // PYBRICKS_PY_ROBOTICS && PYBRICKS_PY_ROBOTICS_EXTRA && PYBRICKS_PY_COMMON_MOTORS
@@ -5,6 +5,8 @@
 
 #if PYBRICKS_PY_TOOLS
 
+#include <string.h>
+
 #include "py/builtin.h"
 #include "py/gc.h"
 #include "py/mphal.h"
@@ -13,6 +15,7 @@
 #include "py/stream.h"
 
 #include <pbio/int_math.h>
+#include <pbio/snapshot.h>
 #include <pbio/task.h>
 #include <pbsys/light.h>
 #include <pbsys/program_stop.h>
@@ -210,10 +213,103 @@ STATIC mp_obj_t pb_module_tools_run_task(size_t n_args, const mp_obj_t *pos_args
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_KW(pb_module_tools_run_task_obj, 1, pb_module_tools_run_task);
 
+#if PBIO_CONFIG_SNAPSHOT
+
+// Awaitables for snapshot(). Only one snapshot can be taken at a time, since
+// they share the request below.
+MP_REGISTER_ROOT_POINTER(mp_obj_t snapshot_awaitables);
+
+// How long to wait for all devices to become ready (ms).
+#define PB_MODULE_TOOLS_SNAPSHOT_TIMEOUT (1000)
+
+// Ports to read and the resulting values of the ongoing snapshot.
+static struct {
+    pbio_snapshot_t snapshot;
+    pbio_port_id_t ports[PBIO_CONFIG_SNAPSHOT_NUM_VALUES];
+    uint8_t num_ports;
+    bool imu;
+} snapshot_request;
+
+STATIC bool pb_module_tools_snapshot_test_completion(mp_obj_t obj, uint32_t end_time) {
+
+    // Try to read all devices in one go.
+    pbio_error_t err = pbio_snapshot_take(&snapshot_request.snapshot, snapshot_request.ports, snapshot_request.num_ports, snapshot_request.imu);
+
+    // Keep going until all devices are ready, but don't wait forever.
+    if (err == PBIO_ERROR_AGAIN) {
+        if (mp_hal_ticks_ms() - end_time < UINT32_MAX / 2) {
+            pb_assert(PBIO_ERROR_TIMEDOUT);
+        }
+        return false;
+    }
+
+    pb_assert(err);
+    return true;
+}
+
+STATIC mp_obj_t pb_module_tools_snapshot_return_value(mp_obj_t obj) {
+    pbio_snapshot_t *snapshot = &snapshot_request.snapshot;
+    mp_obj_tuple_t *values = MP_OBJ_TO_PTR(mp_obj_new_tuple(snapshot->num_values, NULL));
+    for (size_t i = 0; i < snapshot->num_values; i++) {
+        values->items[i] = mp_obj_new_int(snapshot->values[i]);
+    }
+    return MP_OBJ_FROM_PTR(values);
+}
+
+/**
+ * Reads several ports and optionally the IMU at the same time.
+ *
+ * @param [in]  ports   Tuple or list of ports.
+ * @param [in]  imu     Whether to add the IMU values.
+ * @returns             Tuple with the values of each port, followed by the IMU,
+ *                      or an awaitable for it within the run loop.
+ */
+STATIC mp_obj_t pb_module_tools_snapshot(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    PB_PARSE_ARGS_FUNCTION(n_args, pos_args, kw_args,
+        PB_ARG_REQUIRED(ports),
+        PB_ARG_DEFAULT_FALSE(imu));
+
+    size_t num_ports;
+    mp_obj_t *port_objs;
+    mp_obj_get_array(ports_in, &num_ports, &port_objs);
+    if (num_ports > PBIO_CONFIG_SNAPSHOT_NUM_VALUES) {
+        pb_assert(PBIO_ERROR_INVALID_ARG);
+    }
+
+    // Validate the arguments before changing the shared request.
+    pbio_port_id_t ports[PBIO_CONFIG_SNAPSHOT_NUM_VALUES];
+    for (size_t i = 0; i < num_ports; i++) {
+        ports[i] = pb_type_enum_get_value(port_objs[i], &pb_enum_type_Port);
+    }
+
+    // Raise if another snapshot is still waiting for its devices.
+    pb_type_awaitable_update_all(MP_STATE_PORT(snapshot_awaitables), PB_TYPE_AWAITABLE_OPT_RAISE_ON_BUSY);
+
+    memcpy(snapshot_request.ports, ports, sizeof(ports));
+    snapshot_request.num_ports = num_ports;
+    snapshot_request.imu = mp_obj_is_true(imu_in);
+
+    // Wait until all devices can be read, then read them in one go.
+    return pb_type_awaitable_await_or_wait(
+        MP_OBJ_FROM_PTR(&snapshot_request),
+        MP_STATE_PORT(snapshot_awaitables),
+        mp_hal_ticks_ms() + PB_MODULE_TOOLS_SNAPSHOT_TIMEOUT,
+        pb_module_tools_snapshot_test_completion,
+        pb_module_tools_snapshot_return_value,
+        pb_type_awaitable_cancel_none,
+        PB_TYPE_AWAITABLE_OPT_RAISE_ON_BUSY);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(pb_module_tools_snapshot_obj, 1, pb_module_tools_snapshot);
+
+#endif // PBIO_CONFIG_SNAPSHOT
+
 // Reset global awaitable state when user program starts.
 void pb_module_tools_init(void) {
     MP_STATE_PORT(wait_awaitables) = mp_obj_new_list(0, NULL);
     MP_STATE_PORT(pbio_task_awaitables) = mp_obj_new_list(0, NULL);
+    #if PBIO_CONFIG_SNAPSHOT
+    MP_STATE_PORT(snapshot_awaitables) = mp_obj_new_list(0, NULL);
+    #endif
     run_loop_is_active = false;
 }
 
@@ -319,6 +415,9 @@ STATIC const mp_rom_map_elem_t tools_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR_hub_menu),    MP_ROM_PTR(&pb_module_tools_hub_menu_obj)     },
     #endif // PYBRICKS_PY_TOOLS_HUB_MENU
     { MP_ROM_QSTR(MP_QSTR_run_task),    MP_ROM_PTR(&pb_module_tools_run_task_obj)     },
+    #if PBIO_CONFIG_SNAPSHOT
+    { MP_ROM_QSTR(MP_QSTR_snapshot),    MP_ROM_PTR(&pb_module_tools_snapshot_obj)     },
+    #endif // PBIO_CONFIG_SNAPSHOT
     { MP_ROM_QSTR(MP_QSTR_StopWatch),   MP_ROM_PTR(&pb_type_StopWatch)                },
     { MP_ROM_QSTR(MP_QSTR_multitask),   MP_ROM_PTR(&pb_type_Task)                     },
     #if MICROPY_PY_BUILTINS_FLOAT
@@ -0,0 +1,25 @@
+from pybricks.hubs import ThisHub
+
+hub = ThisHub()
+
+# Start measuring the rotation.
+print(hub.imu.calibrate_scale())
+
+# Each axis needs at least one full turn to be calibrated.
+try:
+    hub.imu.calibrate_scale((0, 0, 90))
+except ValueError:
+    print("ValueError")
+
+# The virtual hub does not turn, so the measured rotation is too far off to be
+# a scale error.
+try:
+    hub.imu.calibrate_scale((0, 0, 3600))
+except RuntimeError:
+    print("RuntimeError")
+
+# The rotation is given about each of the three hub axes.
+try:
+    hub.imu.calibrate_scale((0, 3600))
+except ValueError:
+    print("ValueError")
@@ -0,0 +1,103 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: MIT
+# Copyright (c) 2023 The Pybricks Authors
+
+"""
+Decodes compact motor logs to comma separated values.
+
+Compact logs are made with ``Logger.start(duration, compact=True)``. They can
+be saved as a binary file on hubs with a file system, or as base64 encoded
+lines printed between ``PB_OF:`` and ``PB_EOF`` on other hubs. This tool
+accepts both.
+
+Format (see lib/pbio/src/logger.c):
+    header      6 bytes     "PBL", version, number of columns, keyframe interval
+    rows        ...         one zigzag variable length integer per value
+
+Rows at a multiple of the keyframe interval hold full values. Other rows hold
+the difference from the previous row.
+"""
+
+import argparse
+import base64
+import sys
+from typing import Iterator, List
+
+SUPPORTED_VERSION = 1
+
+
+def _load(raw: bytes) -> bytes:
+    """Gets the binary log data from a binary or base64 encoded file."""
+    if raw.startswith(b"PBL"):
+        return raw
+
+    data = bytearray()
+    for line in raw.splitlines():
+        line = line.strip()
+        if not line or line.startswith(b"PB_"):
+            continue
+        data += base64.b64decode(line)
+    return bytes(data)
+
+
+def _read_varint(data: bytes, offset: int) -> "tuple[int, int]":
+    """Reads one zigzag variable length integer."""
+    value = 0
+    shift = 0
+    while True:
+        if offset >= len(data) or shift > 28:
+            raise ValueError("incomplete or invalid value at offset {}".format(offset))
+        byte = data[offset]
+        offset += 1
+        value |= (byte & 0x7F) << shift
+        shift += 7
+        if not byte & 0x80:
+            break
+    return (value >> 1) ^ -(value & 1), offset
+
+
+def _to_int32(value: int) -> int:
+    """Wraps a value to a signed 32-bit integer, like the hub does."""
+    return (value + 2**31) % 2**32 - 2**31
+
+
+def decode(data: bytes) -> Iterator[List[int]]:
+    """Decodes compact log data, including the header, into rows."""
+    if len(data) < 6 or data[:3] != b"PBL":
+        raise ValueError("not a compact Pybricks log")
+    if data[3] != SUPPORTED_VERSION:
+        raise ValueError("unsupported log version {}".format(data[3]))
+
+    num_cols = data[4]
+    keyframe_interval = data[5]
+
+    row = [0] * num_cols
+    offset = 6
+    index = 0
+    while offset < len(data):
+        keyframe = index % keyframe_interval == 0
+        for col in range(num_cols):
+            value, offset = _read_varint(data, offset)
+            row[col] = value if keyframe else _to_int32(row[col] + value)
+        yield list(row)
+        index += 1
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[1])
+    parser.add_argument("log", type=argparse.FileType("rb"), help="compact log file")
+    parser.add_argument(
+        "output",
+        nargs="?",
+        type=argparse.FileType("w"),
+        default=sys.stdout,
+        help="output file (default: stdout)",
+    )
+    args = parser.parse_args()
+
+    for row in decode(_load(args.log.read())):
+        print(", ".join(str(v) for v in row), file=args.output)
+
+
+if __name__ == "__main__":
+    main()